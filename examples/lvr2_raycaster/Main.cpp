@@ -1,6 +1,8 @@
 #include <iostream>
 #include <memory>
 #include <tuple>
+#include <string>
+#include <vector>
 #include <stdlib.h>
 
 #include <boost/optional.hpp>
@@ -448,6 +450,23 @@ int main(int argc, char** argv)
         raycaster.reset(new BVHRaycaster<PointType, NormalType>(buffer));
         std::cout << realTest(raycaster, num_rays) << " ms" << std::endl;
 
+        // BVH builders: build time vs. trace time on a larger mesh
+        MeshBufferPtr large = synthetic::genSphere(500, 500);
+        std::vector<std::pair<std::string, BVHTree<PointType>::BuildMethod> > methods = {
+            {"binned SAH", BVHTree<PointType>::BINNED_SAH},
+            {"Morton", BVHTree<PointType>::MORTON}
+        };
+        for(auto method : methods)
+        {
+            std::cout << "Testing BVH builder: " << method.first << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            raycaster.reset(new BVHRaycaster<PointType, NormalType>(large, method.second));
+            auto end = std::chrono::steady_clock::now();
+            std::cout << "build: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+                      << " ms" << std::endl;
+            std::cout << "trace: " << realTest(raycaster, num_rays) << " ms" << std::endl;
+        }
+
         // GPU test
         #if defined LVR2_USE_OPENCL
         std::cout << "Testing CLRaycaster" << std::endl;
@@ -168,9 +168,10 @@ bool ChunkingPipeline<BaseVecT>::getScanProject(const boost::filesystem::path& d
     // load scans from hdf5
     ScanProjectPtr scanProjectPtr = hdf.loadScanProject();
 
-    // load scans from directory
+    // load the meta data of the scans from directory, the payload is only
+    // needed for new scan positions
     ScanProject dirScanProject;
-    bool importStatus = loadScanProject(dirPath, dirScanProject);
+    bool importStatus = loadScanProject(dirPath, dirScanProject, false);
 
     ScanProjectEditMark tmpScanProject;
     std::vector<bool> init(scanProjectPtr->positions.size(), false);
@@ -185,6 +186,7 @@ bool ChunkingPipeline<BaseVecT>::getScanProject(const boost::filesystem::path& d
         std::cout << timestamp << "Found " << dirScanProject.positions.size() - scanProjectPtr->positions.size() << " new scanPosition(s)" << std::endl;
         for (int i = scanProjectPtr->positions.size(); i < dirScanProject.positions.size(); i++)
         {
+            loadScanPositionData(*dirScanProject.positions[i]);
             scanProjectPtr->positions.push_back(dirScanProject.positions[i]);
             tmpScanProject.changed.push_back(true);
         }
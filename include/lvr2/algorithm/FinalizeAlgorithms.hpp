@@ -47,6 +47,7 @@
 #include "lvr2/algorithm/ColorAlgorithms.hpp"
 #include "lvr2/util/ClusterBiMap.hpp"
 #include "lvr2/texture/Texture.hpp"
+#include "lvr2/texture/TextureAtlas.hpp"
 #include "lvr2/texture/Material.hpp"
 #include "lvr2/algorithm/ClusterPainter.hpp"
 
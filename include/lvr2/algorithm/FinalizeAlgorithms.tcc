@@ -49,85 +49,113 @@ namespace lvr2
 template<typename BaseVecT>
 MeshBufferPtr SimpleFinalizer<BaseVecT>::apply(const BaseMesh <BaseVecT>& mesh)
 {
-    // Create vertex and normal buffer
-    DenseVertexMap<size_t> idxMap;
-    idxMap.reserve(mesh.numVertices());
+    // Compute the new, compacted index of every vertex. Deleted vertices
+    // leave gaps in the handle space which are removed by an exclusive
+    // prefix sum over the "vertex exists" flags.
+    const size_t numVertexIndices = mesh.nextVertexIndex();
+    vector<size_t> idxMap(numVertexIndices);
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < numVertexIndices; i++)
+    {
+        idxMap[i] = mesh.containsVertex(VertexHandle(i)) ? 1 : 0;
+    }
+    const size_t numVertices = Util::parallel_exclusive_scan(idxMap);
 
-    vector<float> vertices;
-    vertices.reserve(mesh.numVertices() * 3);
+    // Same for faces
+    const size_t numFaceIndices = mesh.nextFaceIndex();
+    vector<size_t> faceMap(numFaceIndices);
 
-    vector<float> normals;
-    if (m_normalData)
+    #pragma omp parallel for
+    for (size_t i = 0; i < numFaceIndices; i++)
     {
-        normals.reserve(mesh.numVertices() * 3);
+        faceMap[i] = mesh.containsFace(FaceHandle(i)) ? 1 : 0;
     }
+    const size_t numFaces = Util::parallel_exclusive_scan(faceMap);
 
-    vector<unsigned char> colors;
+    // Allocate the final buffers. They are handed over to the mesh buffer
+    // without any further copy.
+    floatArr vertices(new float[numVertices * 3]);
+    floatArr normals;
+    if (m_normalData)
+    {
+        normals = floatArr(new float[numVertices * 3]);
+    }
+    ucharArr colors;
     if (m_colorData)
     {
-        colors.reserve(mesh.numVertices() * 3);
+        colors = ucharArr(new unsigned char[numVertices * 3]);
     }
+    indexArray faces(new unsigned int[numFaces * 3]);
 
     // for all vertices
-    size_t vertexCount = 0;
-    for (auto vH : mesh.vertices())
+    #pragma omp parallel for
+    for (size_t i = 0; i < numVertexIndices; i++)
     {
-        auto point = mesh.getVertexPosition(vH);
+        VertexHandle vH(i);
+        if (!mesh.containsVertex(vH))
+        {
+            continue;
+        }
+        const size_t idx = idxMap[i];
 
         // add vertex positions to buffer
-        vertices.push_back(point.x);
-        vertices.push_back(point.y);
-        vertices.push_back(point.z);
+        auto point = mesh.getVertexPosition(vH);
+        vertices[idx * 3 + 0] = point.x;
+        vertices[idx * 3 + 1] = point.y;
+        vertices[idx * 3 + 2] = point.z;
 
         if (m_normalData)
         {
             // add normal data to buffer if given
             auto normal = (*m_normalData)[vH];
-            normals.push_back(normal.getX());
-            normals.push_back(normal.getY());
-            normals.push_back(normal.getZ());
+            normals[idx * 3 + 0] = normal.getX();
+            normals[idx * 3 + 1] = normal.getY();
+            normals[idx * 3 + 2] = normal.getZ();
         }
 
         if (m_colorData)
         {
             // add color data to buffer if given
-            colors.push_back(static_cast<unsigned char>((*m_colorData)[vH][0]));
-            colors.push_back(static_cast<unsigned char>((*m_colorData)[vH][1]));
-            colors.push_back(static_cast<unsigned char>((*m_colorData)[vH][2]));
+            const auto& color = (*m_colorData)[vH];
+            colors[idx * 3 + 0] = static_cast<unsigned char>(color[0]);
+            colors[idx * 3 + 1] = static_cast<unsigned char>(color[1]);
+            colors[idx * 3 + 2] = static_cast<unsigned char>(color[2]);
         }
-
-        // Save index of vertex for face mapping
-        idxMap.insert(vH, vertexCount);
-        vertexCount++;
     }
 
     // Create face buffer
-    vector<unsigned int> faces;
-    faces.reserve(mesh.numFaces() * 3);
-    for (auto fH : mesh.faces())
+    #pragma omp parallel for
+    for (size_t i = 0; i < numFaceIndices; i++)
     {
+        FaceHandle fH(i);
+        if (!mesh.containsFace(fH))
+        {
+            continue;
+        }
+        const size_t idx = faceMap[i];
+
         auto handles = mesh.getVerticesOfFace(fH);
-        for (auto handle : handles)
+        for (size_t j = 0; j < 3; j++)
         {
-            // add faces to buffer
-            faces.push_back(idxMap[handle]);
+            faces[idx * 3 + j] = idxMap[handles[j].idx()];
         }
     }
 
     // create buffer object and pass values
     MeshBufferPtr buffer( new MeshBuffer );
 
-    buffer->setVertices(Util::convert_vector_to_shared_array(vertices), vertices.size() / 3);
-    buffer->setFaceIndices(Util::convert_vector_to_shared_array(faces), faces.size() / 3);
+    buffer->setVertices(vertices, numVertices);
+    buffer->setFaceIndices(faces, numFaces);
 
     if (m_normalData)
     {
-        buffer->setVertexNormals(Util::convert_vector_to_shared_array(normals));
+        buffer->setVertexNormals(normals);
     }
 
     if (m_colorData)
     {
-        buffer->setVertexColors(Util::convert_vector_to_shared_array(colors));
+        buffer->setVertexColors(colors);
     }
 
     return buffer;
@@ -180,20 +208,67 @@ void TextureFinalizer<BaseVecT>::setMaterializerResult(const MaterializerResult<
 template<typename BaseVecT>
 MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
 {
-    // Create vertex buffer and all buffers holding vertex attributes
-    vector<float> vertices;
-    vertices.reserve(mesh.numVertices() * 3 * 2);
+    // Clusters are processed in parallel, so we need random access to them.
+    // Their order defines the order of vertices and faces in the buffer.
+    vector<ClusterHandle> clusters;
+    clusters.reserve(m_cluster.numCluster());
+    for (auto clusterH: m_cluster)
+    {
+        clusters.push_back(clusterH);
+    }
+    const size_t numClusters = clusters.size();
+
+    // Every cluster gets its own copy of the vertices of its faces. In a
+    // first pass we count these vertices to be able to compute the offset
+    // of every cluster in the final buffers. The face offsets are known
+    // directly from the cluster sizes.
+    vector<size_t> vertexOffsets(numClusters);
+    vector<size_t> faceOffsets(numClusters);
+
+    #pragma omp parallel
+    {
+        // This map remembers which vertex we already counted. It is reused
+        // for all clusters of a thread to avoid reallocations.
+        SparseVertexMap<size_t> idxMap;
 
-    vector<float> normals;
+        #pragma omp for schedule(dynamic, 16)
+        for (size_t i = 0; i < numClusters; i++)
+        {
+            idxMap.clear();
+            auto& cluster = m_cluster.getCluster(clusters[i]);
+            for (auto faceH: cluster.handles)
+            {
+                for (auto vertexH: mesh.getVerticesOfFace(faceH))
+                {
+                    if (!idxMap.containsKey(vertexH))
+                    {
+                        idxMap.insert(vertexH, idxMap.numValues());
+                    }
+                }
+            }
+            vertexOffsets[i] = idxMap.numValues();
+            faceOffsets[i] = cluster.handles.size();
+        }
+    }
+
+    const size_t numVertices = Util::parallel_exclusive_scan(vertexOffsets);
+    const size_t numFaces = Util::parallel_exclusive_scan(faceOffsets);
+
+    // Create vertex buffer and all buffers holding vertex attributes. They
+    // are handed over to the mesh buffer without any further copy.
+    floatArr vertices(new float[numVertices * 3]);
+    indexArray faces(new unsigned int[numFaces * 3]);
+
+    floatArr normals;
     if (m_vertexNormals)
     {
-        normals.reserve(mesh.numVertices() * 3 * 2);
+        normals = floatArr(new float[numVertices * 3]);
     }
 
-    vector<unsigned char> colors;
-    if (m_clusterColors)
+    ucharArr colors;
+    if (m_clusterColors || m_vertexColors)
     {
-        colors.reserve(mesh.numVertices() * 3 * 2);
+        colors = ucharArr(new unsigned char[numVertices * 3]);
     }
 
     // Create buffer and variables for texturizing
@@ -202,116 +277,39 @@ MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
     {
         useTextures = true;
     }
-    vector<float> texCoords;
+    floatArr texCoords;
+    indexArray faceMaterials;
     vector<Material> materials;
-    vector<unsigned int> faceMaterials;
     vector<unsigned int> clusterMaterials;
     vector<Texture> textures;
-    vector<vector<unsigned int>> clusterFaceIndices;
-    size_t clusterCount = 0;
-    size_t faceCount = 0;
-
-    // Global material index will be used for indexing materials in the faceMaterialIndexBuffer
-    // The basic material will have the index 0
-    unsigned int globalMaterialIndex = 1;
-    // Create default material
-    unsigned char defaultR = 0, defaultG = 0, defaultB = 0;
-    Material m;
-    std::array<unsigned char, 3> arr = {defaultR, defaultG, defaultB};
-    m.m_color = std::move(arr);
-    materials.push_back(m);
-    // This map remembers which texture and material are associated with each other
-    std::map<int, unsigned int> textureMaterialMap; // Stores the ID of the material for each textureIndex
-    textureMaterialMap[-1] = 0; // texIndex -1 => no texture => default material with index 0
-
-    std::map<Rgb8Color, int> colorMaterialMap;
-
-    // Create face buffer
-    vector<unsigned int> faces;
-    faces.reserve(mesh.numFaces() * 3);
-
-    // This counter is used to determine the index of a newly inserted vertex
-    size_t vertexCount = 0;
 
-    string comment = timestamp.getElapsedTime() + "Finalizing mesh ";
-    ProgressBar progress(m_cluster.numCluster(), comment);
-
-    // Loop over all clusters
-    for (auto clusterH: m_cluster)
+    if (m_materializerResult)
     {
-        // This map remembers which vertex we already inserted and at what
-        // position. This is important to create the face map.
-        SparseVertexMap<size_t> idxMap;
-
-        // Vector for storing indices of created faces
-        vector<unsigned int> faceIndices;
-
-        ++progress;
-
-        auto& cluster = m_cluster.getCluster(clusterH);
-
-        // Loop over all faces of the cluster
-        for (auto faceH: cluster.handles)
+        texCoords = floatArr(new float[numVertices * 2]);
+        faceMaterials = indexArray(new unsigned int[numFaces]);
+        clusterMaterials.resize(numClusters);
+
+        // Global material index will be used for indexing materials in the faceMaterialIndexBuffer
+        // The basic material will have the index 0
+        unsigned int globalMaterialIndex = 1;
+        // Create default material
+        unsigned char defaultR = 0, defaultG = 0, defaultB = 0;
+        Material m;
+        std::array<unsigned char, 3> arr = {defaultR, defaultG, defaultB};
+        m.m_color = std::move(arr);
+        materials.push_back(m);
+        // This map remembers which texture and material are associated with each other
+        std::map<int, unsigned int> textureMaterialMap; // Stores the ID of the material for each textureIndex
+        textureMaterialMap[-1] = 0; // texIndex -1 => no texture => default material with index 0
+
+        std::map<Rgb8Color, int> colorMaterialMap;
+
+        // Material indices depend on the order in which they are first
+        // used, so they are assigned sequentially (this is cheap, as it
+        // only touches one material per cluster).
+        for (size_t i = 0; i < numClusters; i++)
         {
-            for (auto vertexH: mesh.getVerticesOfFace(faceH))
-            {
-                // Check if we already inserted this vertex. If not...
-                if (!idxMap.containsKey(vertexH))
-                {
-                    // ... insert it into the buffers (with all its attributes)
-                    auto point = mesh.getVertexPosition(vertexH);
-
-                    vertices.push_back(point.x);
-                    vertices.push_back(point.y);
-                    vertices.push_back(point.z);
-
-                    if (m_vertexNormals)
-                    {
-                        auto normal = (*m_vertexNormals)[vertexH];
-                        normals.push_back(normal.getX());
-                        normals.push_back(normal.getY());
-                        normals.push_back(normal.getZ());
-                    }
-
-                    // If individual vertex colors are present: use these
-                    if (m_vertexColors)
-                    {
-                        colors.push_back(static_cast<unsigned char>((*m_vertexColors)[vertexH][0]));
-                        colors.push_back(static_cast<unsigned char>((*m_vertexColors)[vertexH][1]));
-                        colors.push_back(static_cast<unsigned char>((*m_vertexColors)[vertexH][2]));
-                    }
-                    else if (m_clusterColors)
-                    {
-                        // else: use cluster colors if present
-                        colors.push_back(static_cast<unsigned char>((*m_clusterColors)[clusterH][0]));
-                        colors.push_back(static_cast<unsigned char>((*m_clusterColors)[clusterH][1]));
-                        colors.push_back(static_cast<unsigned char>((*m_clusterColors)[clusterH][2]));
-                    } // else: no colors
-
-                    // Save index of vertex for face mapping
-                    idxMap.insert(vertexH, vertexCount);
-                    vertexCount++;
-                }
-
-                // At this point we know that the vertex is certainly in the
-                // map (and the buffers).
-                faces.push_back(idxMap[vertexH]);
-            }
-            faceIndices.push_back(faceCount++);
-        }
-
-        clusterFaceIndices.push_back(faceIndices);
-
-        // When using textures,
-        // For each cluster:
-        if (m_materializerResult)
-        {
-            // This map remembers which vertices were already visited for materials and textures
-            // Each vertex must be visited exactly once
-            SparseVertexMap<size_t> vertexVisitedMap;
-            size_t vertexVisitCount = 0;
-
-            Material m = m_materializerResult.get().m_clusterMaterials.get(clusterH).get();
+            Material m = m_materializerResult.get().m_clusterMaterials.get(clusters[i]).get();
             bool clusterHasTextures = static_cast<bool>(m.m_texture); // optional
             bool clusterHasColor = static_cast<bool>(m.m_color); // optional
 
@@ -365,68 +363,154 @@ MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
                 materialIndex = 0;
             }
 
-            clusterMaterials.push_back(materialIndex);
+            clusterMaterials[i] = materialIndex;
+        }
+    }
+
+    string comment = timestamp.getElapsedTime() + "Finalizing mesh ";
+    ProgressBar progress(numClusters, comment);
+
+    // Second pass: write all vertices, attributes and faces of each cluster
+    // directly to their final position.
+    #pragma omp parallel
+    {
+        // This map remembers which vertex we already inserted and at what
+        // position. This is important to create the face map.
+        SparseVertexMap<size_t> idxMap;
+
+        #pragma omp for schedule(dynamic, 16)
+        for (size_t i = 0; i < numClusters; i++)
+        {
+            idxMap.clear();
 
+            auto clusterH = clusters[i];
+            auto& cluster = m_cluster.getCluster(clusterH);
 
+            // This counter is used to determine the index of a newly inserted vertex
+            size_t vertexCount = vertexOffsets[i];
+            size_t faceCount = faceOffsets[i];
 
-            // For each face in cluster:
-            // Materials
-            for (auto faceH : cluster.handles)
+            // Tex coords are relative to the texture of the cluster. If the
+            // textures were packed into an atlas, they are moved into the page.
+            boost::optional<AtlasRegion> atlasRegion;
+            if (m_materializerResult && m_materializerResult.get().m_atlasRegions)
             {
+                auto region = m_materializerResult.get().m_atlasRegions.get().get(clusterH);
+                if (region)
+                {
+                    atlasRegion = region.get();
+                }
+            }
 
-                faceMaterials.push_back(materialIndex);
-
-                // For each vertex in face:
-                for (auto vertexH : mesh.getVerticesOfFace(faceH))
+            // Loop over all faces of the cluster
+            for (auto faceH: cluster.handles)
+            {
+                size_t corner = 0;
+                for (auto vertexH: mesh.getVerticesOfFace(faceH))
                 {
-                    if (!vertexVisitedMap.containsKey(vertexH))
+                    // Check if we already inserted this vertex. If not...
+                    if (!idxMap.containsKey(vertexH))
                     {
-                        auto& vertexTexCoords = m_materializerResult.get().m_vertexTexCoords;
-                        bool vertexHasTexCoords = vertexTexCoords.is_initialized()
-                                                  ? static_cast<bool>(vertexTexCoords.get().get(vertexH))
-                                                  : false;
+                        // ... insert it into the buffers (with all its attributes)
+                        const size_t idx = vertexCount;
+                        auto point = mesh.getVertexPosition(vertexH);
+
+                        vertices[idx * 3 + 0] = point.x;
+                        vertices[idx * 3 + 1] = point.y;
+                        vertices[idx * 3 + 2] = point.z;
+
+                        if (m_vertexNormals)
+                        {
+                            auto normal = (*m_vertexNormals)[vertexH];
+                            normals[idx * 3 + 0] = normal.getX();
+                            normals[idx * 3 + 1] = normal.getY();
+                            normals[idx * 3 + 2] = normal.getZ();
+                        }
 
-                        if (useTextures && vertexHasTexCoords)
+                        // If individual vertex colors are present: use these
+                        if (m_vertexColors)
+                        {
+                            const auto& color = (*m_vertexColors)[vertexH];
+                            colors[idx * 3 + 0] = static_cast<unsigned char>(color[0]);
+                            colors[idx * 3 + 1] = static_cast<unsigned char>(color[1]);
+                            colors[idx * 3 + 2] = static_cast<unsigned char>(color[2]);
+                        }
+                        else if (m_clusterColors)
                         {
-                            // Use tex coord vertex map to find texture coords
-                            const TexCoords coords = m_materializerResult.get()
-                                .m_vertexTexCoords.get()
-                                .get(vertexH).get()
-                                .getTexCoords(clusterH);
-
-                            texCoords.push_back(coords.u);
-                            texCoords.push_back(coords.v);
-                            texCoords.push_back(0.0);
-                        } else {
-                            // Cluster does not have a texture, use default coords
-                            // Every vertex needs an entry in this buffer,
-                            // This is why 0's are inserted
-                            texCoords.push_back(0.0);
-                            texCoords.push_back(0.0);
-                            texCoords.push_back(0.0);
+                            // else: use cluster colors if present
+                            const auto& color = (*m_clusterColors)[clusterH];
+                            colors[idx * 3 + 0] = static_cast<unsigned char>(color[0]);
+                            colors[idx * 3 + 1] = static_cast<unsigned char>(color[1]);
+                            colors[idx * 3 + 2] = static_cast<unsigned char>(color[2]);
+                        } // else: no colors
+
+                        if (m_materializerResult)
+                        {
+                            auto& vertexTexCoords = m_materializerResult.get().m_vertexTexCoords;
+                            bool vertexHasTexCoords = vertexTexCoords.is_initialized()
+                                                      ? static_cast<bool>(vertexTexCoords.get().get(vertexH))
+                                                      : false;
+
+                            if (useTextures && vertexHasTexCoords)
+                            {
+                                // Use tex coord vertex map to find texture coords
+                                TexCoords coords = vertexTexCoords.get()
+                                    .get(vertexH).get()
+                                    .getTexCoords(clusterH);
+                                if (atlasRegion)
+                                {
+                                    coords = atlasRegion.get().toPage(coords);
+                                }
+
+                                texCoords[idx * 2 + 0] = coords.u;
+                                texCoords[idx * 2 + 1] = coords.v;
+                            }
+                            else
+                            {
+                                // Cluster does not have a texture, use default coords
+                                // Every vertex needs an entry in this buffer,
+                                // This is why 0's are inserted
+                                texCoords[idx * 2 + 0] = 0.0;
+                                texCoords[idx * 2 + 1] = 0.0;
+                            }
                         }
-                        vertexVisitedMap.insert(vertexH, vertexVisitCount);
-                        vertexVisitCount++;
+
+                        // Save index of vertex for face mapping
+                        idxMap.insert(vertexH, idx);
+                        vertexCount++;
                     }
+
+                    // At this point we know that the vertex is certainly in the
+                    // map (and the buffers).
+                    faces[faceCount * 3 + corner] = idxMap[vertexH];
+                    corner++;
                 }
+
+                if (m_materializerResult)
+                {
+                    faceMaterials[faceCount] = clusterMaterials[i];
+                }
+                faceCount++;
             }
+
+            ++progress;
         }
     }
 
     cout << endl;
 
     MeshBufferPtr buffer = MeshBufferPtr( new MeshBuffer );
-    buffer->setVertices(Util::convert_vector_to_shared_array(vertices), vertices.size() / 3);
-    buffer->setFaceIndices(Util::convert_vector_to_shared_array(faces), faces.size() / 3);
+    buffer->setVertices(vertices, numVertices);
+    buffer->setFaceIndices(faces, numFaces);
 
     if (m_vertexNormals)
     {
-        buffer->setVertexNormals(Util::convert_vector_to_shared_array(normals));
+        buffer->setVertexNormals(normals);
     }
 
     if (m_clusterColors || m_vertexColors)
     {
-        buffer->setVertexColors(Util::convert_vector_to_shared_array(colors));
+        buffer->setVertexColors(colors);
     }
 
     if (m_materializerResult)
@@ -436,24 +520,30 @@ MeshBufferPtr TextureFinalizer<BaseVecT>::apply(const BaseMesh<BaseVecT>& mesh)
         mats.insert(mats.end(), materials.begin(), materials.end());
         texts.insert(texts.end(), textures.begin(), textures.end());
 
-        buffer->setFaceMaterialIndices(Util::convert_vector_to_shared_array(faceMaterials));
+        buffer->setFaceMaterialIndices(faceMaterials);
         buffer->addIndexChannel(Util::convert_vector_to_shared_array(clusterMaterials), "cluster_material_indices", clusterMaterials.size(), 1);
+        buffer->setTextureCoordinates(texCoords);
 
-        // convert from 3 floats per vertex to 2...
-        floatArr texCoordsArr = floatArr( new float[(texCoords.size() / 3) * 2] );
+        // The faces of each cluster are stored consecutively, so the face
+        // indices of a cluster are just a range starting at its offset.
+        vector<indexArray> clusterFaceIndices(numClusters);
 
-        for (size_t i = 0; i < texCoords.size() / 3; i++)
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = 0; i < numClusters; i++)
         {
-            texCoordsArr[i*2 + 0] = texCoords[i*3 + 0];
-            texCoordsArr[i*2 + 1] = texCoords[i*3 + 1];
+            const size_t numClusterFaces = m_cluster.getCluster(clusters[i]).handles.size();
+            clusterFaceIndices[i] = indexArray(new unsigned int[numClusterFaces]);
+            for (size_t j = 0; j < numClusterFaces; j++)
+            {
+                clusterFaceIndices[i][j] = faceOffsets[i] + j;
+            }
         }
-        buffer->setTextureCoordinates(texCoordsArr);
 
         // TODO TALK TO THOMAS
-        for (size_t i = 0; i < clusterFaceIndices.size(); i++)
+        for (size_t i = 0; i < numClusters; i++)
         {
             std::string cluster_name = "cluster" + std::to_string(i) + "_face_indices";
-            buffer->addIndexChannel(Util::convert_vector_to_shared_array(clusterFaceIndices[i]), cluster_name, clusterFaceIndices[i].size(), 1);
+            buffer->addIndexChannel(clusterFaceIndices[i], cluster_name, m_cluster.getCluster(clusters[i]).handles.size(), 1);
         }
     }
 
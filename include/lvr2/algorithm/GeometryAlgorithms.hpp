@@ -35,11 +35,17 @@
 #include "lvr2/geometry/BaseMesh.hpp"
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/geometry/Handles.hpp"
+#include <algorithm>
+#include <cstdint>
 #include <list>
+#include <vector>
 
 namespace lvr2
 {
 
+template<typename BaseVecT>
+class PointsetSurface;
+
 /**
  * @brief   Calculates the local neighborhood of a given vertex (defined by it's handle).
  *
@@ -63,6 +69,126 @@ void calcLocalVertexNeighborhood(
 );
 
 
+/**
+ * @brief Scratch memory for repeated local neighborhood traversals.
+ *
+ * Instead of allocating a fresh visited set for every traversal, visited
+ * vertices are stored in an open addressing hash set whose slots are marked
+ * with the id of the current traversal. Starting a new traversal is then just
+ * an increment of that id. The set only grows to twice the size of the
+ * largest traversal, not to the size of the mesh. One instance is meant to be
+ * used by exactly one thread; vertices for which no neighbors could be
+ * determined (non manifold vertices) are collected in `invalid`.
+ */
+struct LocalNeighborhoodScratch
+{
+    LocalNeighborhoodScratch()
+        : currentStamp(0), numVisited(0)
+    {
+        stack.reserve(8);
+    }
+
+    /// Prepares the scratch for a new traversal.
+    void next()
+    {
+        // On overflow all old stamps have to be invalidated.
+        if (++currentStamp == 0)
+        {
+            std::fill(slots.begin(), slots.end(), Slot());
+            currentStamp = 1;
+        }
+        numVisited = 0;
+        stack.clear();
+    }
+
+    /// Marks `vH` as visited in the current traversal. Returns false if it
+    /// has already been visited.
+    bool visit(VertexHandle vH)
+    {
+        if ((numVisited + 1) * 2 > slots.size())
+        {
+            grow();
+        }
+
+        size_t i = slotOf(vH.idx());
+        while (slots[i].stamp == currentStamp)
+        {
+            if (slots[i].index == vH.idx())
+            {
+                return false;
+            }
+            i = (i + 1) & (slots.size() - 1);
+        }
+
+        slots[i].index = vH.idx();
+        slots[i].stamp = currentStamp;
+        numVisited++;
+        return true;
+    }
+
+    /// Vertices that still need to be expanded
+    std::vector<VertexHandle> stack;
+
+    /// Neighbors of the vertex that is currently expanded
+    std::vector<VertexHandle> directNeighbors;
+
+    /// Non manifold vertices found during all traversals
+    std::vector<VertexHandle> invalid;
+
+    /// Result of a search tree query around the current vertex
+    std::vector<size_t> treeNeighbors;
+
+private:
+
+    struct Slot
+    {
+        Slot() : index(0), stamp(0) {}
+
+        Index index;
+
+        /// Traversal id of the traversal in which the slot was used last
+        uint32_t stamp;
+    };
+
+    size_t slotOf(Index idx) const
+    {
+        // Fibonacci hashing, slots.size() is a power of two
+        return (static_cast<uint64_t>(idx) * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+    }
+
+    /// Doubles the number of slots and reinserts the vertices of the current traversal
+    void grow()
+    {
+        std::vector<Slot> old;
+        old.swap(slots);
+
+        bits = old.empty() ? 6 : bits + 1;
+        slots.resize(size_t(1) << bits);
+
+        for (const Slot& slot : old)
+        {
+            if (slot.stamp == currentStamp)
+            {
+                size_t i = slotOf(slot.index);
+                while (slots[i].stamp == currentStamp)
+                {
+                    i = (i + 1) & (slots.size() - 1);
+                }
+                slots[i] = slot;
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    uint32_t bits = 0;
+
+    /// Id of the current traversal
+    uint32_t currentStamp;
+
+    /// Number of vertices visited in the current traversal
+    size_t numVisited;
+};
+
 /**
  * @brief Visits every vertex in the local neighborhood of `vH`.
  *
@@ -72,6 +198,10 @@ void calcLocalVertexNeighborhood(
  *
  * For every such vertex in the local neighborhood (not `vH` itself!) the
  * given `visitor` is called exactly once.
+ *
+ * This allocates a new visited set for every call. When visiting the
+ * neighborhoods of many vertices, use the overload taking a
+ * LocalNeighborhoodScratch instead.
  */
 template <typename BaseVecT, typename VisitorF>
 void visitLocalVertexNeighborhood(
@@ -81,6 +211,23 @@ void visitLocalVertexNeighborhood(
     VisitorF visitor
 );
 
+/**
+ * @brief Like the other overload, but reuses the given scratch memory.
+ *
+ * No memory is allocated by this function once the scratch has grown to the
+ * size of the largest neighborhood, which makes it suitable for the inner
+ * loop of per vertex attribute computations. Non manifold vertices are recorded in
+ * `scratch.invalid`.
+ */
+template <typename BaseVecT, typename VisitorF>
+void visitLocalVertexNeighborhood(
+    const BaseMesh<BaseVecT>& mesh,
+    LocalNeighborhoodScratch& scratch,
+    VertexHandle vH,
+    double radius,
+    VisitorF visitor
+);
+
 /**
  * @brief   Calculate the height difference value for each vertex of the given BaseMesh.
  *
@@ -93,6 +240,31 @@ void visitLocalVertexNeighborhood(
 template<typename BaseVecT>
 DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT>& mesh, double radius);
 
+/**
+ * @brief   Calculate the height difference value for each vertex of the given BaseMesh
+ *          using a radius search in the search tree of the given surface.
+ *
+ * Instead of a breadth first search over the mesh topology, the neighborhood
+ * of a vertex consists of all points of the surface's point cloud that lie
+ * within `radius` around the vertex. This is independent of the mesh
+ * connectivity and also works for meshes with holes or non manifold regions.
+ *
+ * The caller has to include "lvr2/reconstruction/PointsetSurface.hpp".
+ *
+ * @param mesh      The given BaseMesh for calculating vertex height differences.
+ * @param surface   The surface whose search tree and point cloud are used.
+ * @param radius    The radius of the neighborhood.
+ *
+ * @return  A map filled with <Vertex, float>-entries, storing the height difference value
+ *          of each vertex.
+ */
+template<typename BaseVecT>
+DenseVertexMap<float> calcVertexHeightDifferences(
+        const BaseMesh<BaseVecT>& mesh,
+        const PointsetSurface<BaseVecT>& surface,
+        double radius
+);
+
 /**
  * @brief Calculates the roughness for each vertex.
  *
@@ -184,6 +356,8 @@ DenseEdgeMap<float> calcVertexDistances(const BaseMesh<BaseVecT>& mesh);
 /**
  * @brief  Dijkstra's algorithm
  *
+ * For many queries on the same mesh, `PathEngine` is considerably faster.
+ *
  * @param mesh        The mesh containing the vertices and edges of interest
  * @param start       Start vertex
  * @param goal        Goal vertex
@@ -31,23 +31,23 @@
 
 #include <algorithm>
 #include <limits>
-#include <queue>
 #include <set>
 
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/io/Progress.hpp"
+#include "lvr2/util/Meap.hpp"
 
 namespace lvr2
 {
 
 template <typename BaseVecT>
-void calcVertexLocalNeighborhood(
+void calcLocalVertexNeighborhood(
     const BaseMesh<BaseVecT> &mesh,
     VertexHandle vH,
     double radius,
     vector<VertexHandle> &neighborsOut)
 {
-    visitLocalNeighborhoodOfVertex(mesh, vH, radius, [&](auto newVH) {
+    visitLocalVertexNeighborhood(mesh, vH, radius, [&](auto newVH) {
         neighborsOut.push_back(newVH);
     });
 }
@@ -55,7 +55,18 @@ void calcVertexLocalNeighborhood(
 template <typename BaseVecT, typename VisitorF>
 void visitLocalVertexNeighborhood(
     const BaseMesh<BaseVecT> &mesh,
-    std::set<VertexHandle> &invalid,
+    VertexHandle vH,
+    double radius,
+    VisitorF visitor)
+{
+    LocalNeighborhoodScratch scratch;
+    visitLocalVertexNeighborhood(mesh, scratch, vH, radius, visitor);
+}
+
+template <typename BaseVecT, typename VisitorF>
+void visitLocalVertexNeighborhood(
+    const BaseMesh<BaseVecT> &mesh,
+    LocalNeighborhoodScratch &scratch,
     VertexHandle vH,
     double radius,
     VisitorF visitor)
@@ -64,26 +75,17 @@ void visitLocalVertexNeighborhood(
     auto vPos = mesh.getVertexPosition(vH);
     const double radiusSquared = radius * radius;
 
-    // Store the vertices we want to expand. We reserve memory for 8 vertices
-    // already, since it's rather likely to have at least that many vertices
-    // in the stack. In the beginning, the stack only contains the original
+    // Start a new traversal. Marking a vertex with the current stamp means
+    // that we have already visited it, where visiting means: calling the
+    // visitor with it and pushing it on the stack of vertices we still need
+    // to expand. In the beginning, the stack only contains the original
     // vertex we were given.
-    vector<VertexHandle> stack;
-    stack.reserve(8);
-    stack.push_back(vH);
+    scratch.next();
+    auto& stack = scratch.stack;
+    auto& directNeighbors = scratch.directNeighbors;
 
-    // In this map we store whether or not we have already visited a vertex,
-    // where visiting means: calling the visitor with it and pushing it on
-    // the stack of vertices we still need to expand.
-    //
-    // It would be more appropriate to use a set instead of a map, but there
-    // are no attribute-sets...
-    SparseVertexMap<bool> visited(8, false);
-    visited.insert(vH, true);
-
-    // This vector is later used to store the neighbors of a vertex. It's
-    // created here to reduce the amount of heap allocations.
-    vector<VertexHandle> directNeighbors;
+    stack.push_back(vH);
+    scratch.visit(vH);
 
     // As long as there are vertices we want to expand...
     while (!stack.empty())
@@ -100,58 +102,126 @@ void visitLocalVertexNeighborhood(
         }
         catch (lvr2::PanicException exception)
         {
-            invalid.insert(curVH);
+            scratch.invalid.push_back(curVH);
         }
         for (auto newVH : directNeighbors)
         {
             // If this vertex is within the radius of the original vertex, we
             // want to visit it later, thus pushing it onto the stack. But we
-            // only do that if we haven't visited the vertex before. We use
-            // `containsKey` here because we only insert `true` anyway.
+            // only do that if we haven't visited the vertex before.
             auto distSquared = mesh.getVertexPosition(newVH).squaredDistanceFrom(vPos);
-            if (!visited.containsKey(newVH) && distSquared < radiusSquared)
+            if (distSquared < radiusSquared && scratch.visit(newVH))
             {
                 visitor(newVH);
                 stack.push_back(newVH);
-                visited.insert(newVH, true);
             }
         }
     }
 }
 
+namespace detail
+{
+
+/**
+ * @brief Inserts a value for every vertex of the mesh into the given map.
+ *
+ * After this call, existing entries of the map can be overwritten from
+ * multiple threads in parallel, as long as every thread writes to different
+ * vertices: no insertion and thus no reallocation happens anymore.
+ */
+template <typename BaseVecT, typename ValueT>
+void presizeVertexMap(const BaseMesh<BaseVecT> &mesh, DenseVertexMap<ValueT> &map, const ValueT &value)
+{
+    map.clear();
+    map.reserve(mesh.nextVertexIndex());
+    for (auto vH : mesh.vertices())
+    {
+        map.insert(vH, value);
+    }
+}
+
+/**
+ * @brief Calls `kernel(vH, scratch)` for every vertex of the mesh in parallel.
+ *
+ * Every thread owns a LocalNeighborhoodScratch which is reused for all of its
+ * vertices. Non manifold vertices found by the threads are reported once at
+ * the end. The progress bar (if any) is updated in batches to avoid locking
+ * its mutex for every single vertex.
+ */
+template <typename BaseVecT, typename KernelF>
+void parallelVertexKernel(const BaseMesh<BaseVecT> &mesh, ProgressBar *progress, KernelF kernel)
+{
+    const size_t numIndices = mesh.nextVertexIndex();
+    const size_t progressBatch = 1024;
+    std::set<VertexHandle> invalid;
+
+#pragma omp parallel
+    {
+        LocalNeighborhoodScratch scratch;
+        size_t done = 0;
+
+#pragma omp for schedule(dynamic, 256)
+        for (size_t i = 0; i < numIndices; i++)
+        {
+            auto vH = VertexHandle(i);
+            if (!mesh.containsVertex(vH))
+            {
+                continue;
+            }
+
+            kernel(vH, scratch);
+
+            if (progress && ++done == progressBatch)
+            {
+                *progress += done;
+                done = 0;
+            }
+        }
+
+        if (progress && done)
+        {
+            *progress += done;
+        }
+
+#pragma omp critical
+        invalid.insert(scratch.invalid.begin(), scratch.invalid.end());
+    }
+
+    if (progress && !timestamp.isQuiet())
+    {
+        cout << endl;
+    }
+
+    if (!invalid.empty())
+    {
+        std::cerr << "Found " << invalid.size() << " invalid, non manifold "
+            << "vertices." << std::endl;
+    }
+}
+
+} // namespace detail
+
 template <typename BaseVecT>
 DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT> &mesh, double radius)
 {
-    // We create a map to store a height-diff for each vertex. We preallocate
-    // memory for all vertices. This is not only an optimization, but more
-    // importantly to avoid multithreading crashes. The parallelized loop
-    // further down inserts into this data structure; if there is no free
-    // memory left, it will reallocate which will crash horribly when multiple
-    // threads are involved.
+    // We create a map to store a height-diff for each vertex. All entries
+    // are inserted up front, so the parallel loop further down only
+    // overwrites existing values and never triggers a reallocation.
     DenseVertexMap<float> heightDiff;
-    heightDiff.reserve(mesh.nextVertexIndex());
+    detail::presizeVertexMap(mesh, heightDiff, 0.0f);
 
     // Output
     string msg = timestamp.getElapsedTime() + "Computing height differences...";
     ProgressBar progress(mesh.numVertices(), msg);
     ++progress;
 
-    std::set<VertexHandle> invalid;
-
-// Calculate height difference for each vertex
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
+    // Calculate height difference for each vertex
+    detail::parallelVertexKernel(mesh, &progress, [&](VertexHandle vH, LocalNeighborhoodScratch& scratch)
     {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
         float minHeight = std::numeric_limits<float>::max();
         float maxHeight = std::numeric_limits<float>::lowest();
 
-        visitLocalVertexNeighborhood(mesh, invalid, vH, radius, [&](auto neighbor) {
+        visitLocalVertexNeighborhood(mesh, scratch, vH, radius, [&](auto neighbor) {
             auto curPos = mesh.getVertexPosition(neighbor);
 
             if (curPos.z < minHeight)
@@ -164,22 +234,47 @@ DenseVertexMap<float> calcVertexHeightDifferences(const BaseMesh<BaseVecT> &mesh
             }
         });
 
-// Calculate the final height difference
-#pragma omp critical
-        {
-            heightDiff.insert(vH, maxHeight - minHeight);
-            ++progress;
-        }
-    }
+        // Calculate the final height difference
+        heightDiff[vH] = maxHeight - minHeight;
+    });
+
+    return heightDiff;
+}
 
-    if(!timestamp.isQuiet())
-    cout << endl;
+template <typename BaseVecT>
+DenseVertexMap<float> calcVertexHeightDifferences(
+    const BaseMesh<BaseVecT> &mesh,
+    const PointsetSurface<BaseVecT> &surface,
+    double radius)
+{
+    DenseVertexMap<float> heightDiff;
+    detail::presizeVertexMap(mesh, heightDiff, 0.0f);
+
+    auto tree = surface.searchTree();
+    auto points = surface.pointBuffer()->getPointArray();
+
+    // Output
+    string msg = timestamp.getElapsedTime() + "Computing height differences (radius search)...";
+    ProgressBar progress(mesh.numVertices(), msg);
+    ++progress;
 
-  if (!invalid.empty())
+    detail::parallelVertexKernel(mesh, &progress, [&](VertexHandle vH, LocalNeighborhoodScratch& scratch)
     {
-        std::cerr << "Found " << invalid.size() << " invalid, non manifold "
-            << "vertices." << std::endl;
-    }
+        vector<size_t>& neighbors = scratch.treeNeighbors;
+        neighbors.clear();
+        tree->radiusSearch(mesh.getVertexPosition(vH), radius, neighbors);
+
+        float minHeight = std::numeric_limits<float>::max();
+        float maxHeight = std::numeric_limits<float>::lowest();
+        for (auto idx : neighbors)
+        {
+            float z = points[3 * idx + 2];
+            minHeight = std::min(minHeight, z);
+            maxHeight = std::max(maxHeight, z);
+        }
+
+        heightDiff[vH] = neighbors.empty() ? 0 : maxHeight - minHeight;
+    });
 
     return heightDiff;
 }
@@ -242,58 +337,34 @@ DenseVertexMap<float> calcVertexRoughness(
     double radius,
     const VertexMap<Normal<typename BaseVecT::CoordType>> &normals)
 {
-    // We create a map to store the roughness for each vertex. We preallocate
-    // memory for all vertices. This is not only an optimization, but more
-    // importantly to avoid multithreading crashes. The parallelized loop
-    // further down inserts into this data structure; if there is no free
-    // memory left, it will reallocate which will crash horribly when multiple
-    // threads are involved.
+    // We create a map to store the roughness for each vertex. All entries
+    // are inserted up front, so the parallel loop further down only
+    // overwrites existing values and never triggers a reallocation.
     DenseVertexMap<float> roughness;
-    roughness.reserve(mesh.nextVertexIndex());
+    detail::presizeVertexMap(mesh, roughness, 0.0f);
 
-    auto averageAngles = calcAverageVertexAngles(mesh, normals);
+    const auto averageAngles = calcAverageVertexAngles(mesh, normals);
 
     // Output
     string msg = timestamp.getElapsedTime() + "Computing roughness";
     ProgressBar progress(mesh.numVertices(), msg);
     ++progress;
 
-    std::set<VertexHandle> invalid;
-
-// Calculate roughness for each vertex
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
+    // Calculate roughness for each vertex
+    detail::parallelVertexKernel(mesh, &progress, [&](VertexHandle vH, LocalNeighborhoodScratch& scratch)
     {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
         float sum = 0.0;
         size_t count = 0;
 
-        visitLocalVertexNeighborhood(mesh, invalid, vH, radius, [&](auto neighbor) {
+        visitLocalVertexNeighborhood(mesh, scratch, vH, radius, [&](auto neighbor) {
             sum += averageAngles[neighbor];
             count += 1;
         });
 
-#pragma omp critical
-        {
-            // Calculate the final roughness
-            roughness.insert(vH, count ? sum / count : 0);
-            ++progress;
-        }
-    }
-    if(!timestamp.isQuiet())
-        cout << endl;
+        // Calculate the final roughness
+        roughness[vH] = count ? sum / count : 0;
+    });
 
-    if (!invalid.empty())
-    {
-        std::cerr << "Found " << invalid.size() << " invalid, non manifold "
-            << "vertices." << std::endl;
-    }
-    
     return roughness;
 }
 
@@ -305,32 +376,22 @@ void calcVertexRoughnessAndHeightDifferences(
     DenseVertexMap<float> &roughness,
     DenseVertexMap<float> &heightDiff)
 {
-    // Reserving memory in those maps is important to avoid multi threading
+    // Inserting all entries up front is important to avoid multi threading
     // related crashes.
-    roughness.clear();
-    roughness.reserve(mesh.nextVertexIndex());
-    heightDiff.clear();
-    heightDiff.reserve(mesh.nextVertexIndex());
+    detail::presizeVertexMap(mesh, roughness, 0.0f);
+    detail::presizeVertexMap(mesh, heightDiff, 0.0f);
 
-    std::set<VertexHandle> invalid;
-    auto averageAngles = calcAverageVertexAngles(mesh, normals);
+    const auto averageAngles = calcAverageVertexAngles(mesh, normals);
 
-// Calculate roughness and height difference for each vertex
-#pragma omp parallel for
-    for (size_t i = 0; i < mesh.nextVertexIndex(); i++)
+    // Calculate roughness and height difference for each vertex
+    detail::parallelVertexKernel(mesh, nullptr, [&](VertexHandle vH, LocalNeighborhoodScratch& scratch)
     {
-        auto vH = VertexHandle(i);
-        if (!mesh.containsVertex(vH))
-        {
-            continue;
-        }
-
         double sum = 0.0;
         uint32_t count = 0;
         float minHeight = std::numeric_limits<float>::max();
         float maxHeight = std::numeric_limits<float>::lowest();
 
-        visitLocalVertexNeighborhood(mesh, invalid, vH, radius, [&](auto neighbor) {
+        visitLocalVertexNeighborhood(mesh, scratch, vH, radius, [&](auto neighbor) {
             sum += averageAngles[neighbor];
             count += 1;
 
@@ -345,20 +406,12 @@ void calcVertexRoughnessAndHeightDifferences(
             }
         });
 
-#pragma omp critical
-        {
-            // Calculate the final roughness
-            roughness.insert(vH, count ? sum / count : 0);
+        // Calculate the final roughness
+        roughness[vH] = count ? sum / count : 0;
 
-            // Calculate the final height difference
-            heightDiff.insert(vH, maxHeight - minHeight);
-        }
-    }
-    if (!invalid.empty())
-    {
-        std::cerr << "Found " << invalid.size() << " invalid, non manifold "
-            << "vertices." << std::endl;
-    }
+        // Calculate the final height difference
+        heightDiff[vH] = maxHeight - minHeight;
+    });
 }
 
 template <typename BaseVecT>
@@ -377,15 +430,6 @@ DenseEdgeMap<float> calcVertexDistances(const BaseMesh<BaseVecT> &mesh)
     return distances;
 }
 
-class CompareDist
-{
-public:
-    bool operator()(pair<lvr2::VertexHandle, float> n1, pair<lvr2::VertexHandle, float> n2)
-    {
-        return n1.second > n2.second;
-    }
-};
-
 template <typename BaseVecT>
 bool Dijkstra(
     const BaseMesh<BaseVecT> &mesh,
@@ -417,29 +461,24 @@ bool Dijkstra(
         return true;
     }
 
-    std::priority_queue<pair<VertexHandle, float>, vector<pair<VertexHandle, float>>, CompareDist> pq;
+    // Every vertex is contained at most once, its distance is lowered in
+    // place when a shorter path is found.
+    Meap<VertexHandle, float> pq(mesh.nextVertexIndex());
+    pq.insert(start, 0);
 
-    pair<VertexHandle, float> first_pair(start, 0);
-    pq.push(first_pair);
+    // This vector is only used in the loop, but is created here to avoid
+    // unnecessary heap allocations.
+    std::vector<VertexHandle> neighbours;
 
-    while (!pq.empty())
+    while (!pq.isEmpty())
     {
-        pair<VertexHandle, float> pair = pq.top();
-        VertexHandle current_vh = pair.first;
-        float current_dist = pair.second;
-        pq.pop();
+        VertexHandle current_vh = pq.popMin().key();
 
-        // Check if the current Vertex was seen already
-        if (seen[current_vh])
-        {
-            // Skip to while
-            continue;
-        }
         // Set the seen vertex to True
         seen[current_vh] = true;
 
         // Get all edges from the current Vertex
-        std::vector<VertexHandle> neighbours;
+        neighbours.clear();
         mesh.getNeighboursOfVertex(current_vh, neighbours);
 
         for (auto neighbour_vh : neighbours)
@@ -454,7 +493,7 @@ bool Dijkstra(
             {
                 distances[neighbour_vh] = tmp_neighbour_cost;
                 predecessors[neighbour_vh] = current_vh;
-                pq.push(std::pair<VertexHandle, float>(neighbour_vh, tmp_neighbour_cost));
+                pq.insertOrDecrease(neighbour_vh, tmp_neighbour_cost);
             }
         }
     }
@@ -36,6 +36,7 @@
 #define LVR2_ALGORITHM_IMAGETEXTURIZER_HPP
 
 #include "lvr2/algorithm/Texturizer.hpp"
+#include "lvr2/algorithm/raycasting/RaycasterBase.hpp"
 #include "lvr2/geometry/Normal.hpp"
 
 #include "lvr2/registration/TransformUtils.hpp"
@@ -45,12 +46,34 @@
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 
+#include <vector>
+
 namespace lvr2
 {
 
 /**
  * @brief A texturizer that uses images instead of pointcloud colors for creating the textures
  *        for meshes.
+ *
+ * All images of all cameras of all scan positions of the project are used. The pose of an
+ * image in world coordinates is
+ *
+ *      ScanProject::pose * ScanPosition::registration * ScanImage::extrinsics
+ *
+ * and its intrinsics are taken from the PinholeModel of its ScanCamera. The camera looks along
+ * its z axis, x points to the right and y down in the image (OpenCV convention). Distortion
+ * coefficients are interpreted as OpenCV's k1, k2, p1, p2[, k3[, k4, k5, k6]].
+ *
+ * For each cluster, the images that can see its bounding rectangle are selected first (the
+ * rectangle must lie in front of the camera and intersect its frustum). Each texel then gets
+ * the color of the image that sees it with the highest resolution. If a raycaster is set, the
+ * best views of all texels are checked for occlusions with one batch of rays per image, and
+ * occluded texels fall back to their next best view. Texels that no image sees are colored
+ * from the point cloud like in the Texturizer.
+ *
+ * Images that are not already held in memory by the project are loaded on demand. At most
+ * setMaxLoadedImages() of them are kept at once, so projects with thousands of images can be
+ * textured.
  */
 template<typename BaseVecT>
 class ImageTexturizer : public Texturizer<BaseVecT> 
@@ -58,6 +81,8 @@ class ImageTexturizer : public Texturizer<BaseVecT>
 
 public:
 
+    using CoordType = typename BaseVecT::CoordType;
+
     /**
      * @brief constructor
      */
@@ -65,10 +90,7 @@ public:
         float texelSize,
         int minClusterSize,
         int maxClusterSize
-    ) : Texturizer<BaseVecT>(texelSize, minClusterSize, maxClusterSize)
-    {
-        image_data_initialized = false;
-    }
+    );
 
     /**
      * @brief Sets the internal UOS Scanproject to the given one
@@ -78,6 +100,36 @@ public:
     void set_project(ScanProject& project)
     {
         this->project = project;
+        image_data_initialized = false;
+        images.clear();
+    }
+
+    /**
+     * @brief Sets a raycaster that contains the mesh. It is used to discard views of a
+     *        texel that are occluded by other parts of the mesh. Without a raycaster,
+     *        every view is considered to be unoccluded.
+     */
+    void setRaycaster(RaycasterBasePtr<BaseVecT, Normal<CoordType>> raycaster)
+    {
+        m_raycaster = raycaster;
+    }
+
+    /**
+     * @brief Sets the number of views per texel that are checked for occlusions, best
+     *        view first. Default: 3
+     */
+    void setViewsPerTexel(int views)
+    {
+        m_viewsPerTexel = std::max(views, 1);
+    }
+
+    /**
+     * @brief Sets the maximum number of images that are loaded from disk at once.
+     *        Default: 32
+     */
+    void setMaxLoadedImages(size_t maxImages)
+    {
+        m_maxLoadedImages = std::max<size_t>(maxImages, 1);
     }
 
     /**
@@ -85,13 +137,13 @@ public:
      *
      * @param index The newly created texture will get this index.
      *
-     * @param surface Unused in this Texturizer
+     * @param surface Used to color texels that are not seen by any image
      *
      * @param boudingRect The texture will be generated for this rectangle
      *
-     * @return Returns a handle for the newly created texture.
+     * @return Returns the newly created texture.
      */
-    virtual TextureHandle generateTexture(
+    virtual Texture createTexture(
         int index,
         const PointsetSurface<BaseVecT>& surface,
         const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
@@ -99,19 +151,63 @@ public:
 
 private:
     /// @cond internal
+
+    /// An image of the project together with its camera parameters in world coordinates
+    struct ImageData
+    {
+        /// Rotation from world into camera coordinates
+        Eigen::Matrix3d rotation;
+        /// Translation from world into camera coordinates
+        Eigen::Vector3d translation;
+        /// Projection center in world coordinates
+        Eigen::Vector3d center;
+
+        double fx, fy, cx, cy;
+        int width, height;
+        std::vector<double> distortion;
+
+        /// The image as stored in the project, may be empty
+        ScanImagePtr scanImage;
+        /// The image if it was loaded from disk, empty if it is not loaded
+        cv::Mat loaded;
+        /// Value of the use counter when the image was used last
+        size_t lastUse;
+        /// Set if loading the image failed
+        bool unreadable;
+    };
+
+    /// A view of a texel
+    struct View
+    {
+        int image;
+        float u, v;
+        float score;
+    };
+
     ScanProject project;
 
     bool image_data_initialized;
-    std::vector<ScanImage> images;
+    std::vector<ImageData> images;
+
+    RaycasterBasePtr<BaseVecT, Normal<CoordType>> m_raycaster;
+    int m_viewsPerTexel;
+    size_t m_maxLoadedImages;
+    size_t m_numLoaded;
+    size_t m_useCounter;
 
     void init_image_data();
 
-    template<typename ValueType>
-    void undistorted_to_distorted_uv(ValueType &u, ValueType &v, const ScanImage &img);
+    /// Returns the indices of the images whose frustum intersects the rectangle
+    std::vector<int> cull_images(const BoundingRectangle<CoordType>& boundingRect) const;
 
-    bool exclude_image(BaseVecT pos, const ScanImage &image_data);
+    /// Projects a point in world coordinates into an image, returns false if it is not visible
+    bool project_point(const ImageData& img, const Eigen::Vector3d& p, double& u, double& v) const;
+
+    template<typename ValueType>
+    void undistorted_to_distorted_uv(ValueType &u, ValueType &v, const ImageData &img) const;
 
-    bool point_behind_camera(BaseVecT pos, const ScanImage &image_data);
+    /// Returns the given image, loading it from disk if necessary
+    cv::Mat get_image(int index);
     /// @endcond
 };
 
@@ -25,247 +25,484 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-namespace lvr2
-{
+/*
+ * ImageTexturizer.tcc
+ *
+ *  @date 01.11.2018
+ *  @author Alexander Loehr (aloehr@uos.de)
+ */
 
-template<typename BaseVecT>
-bool ImageTexturizer<BaseVecT>::exclude_image(BaseVecT pos, const ScanImage &image_data)
-{
-    if (point_behind_camera(pos, image_data)) {
-        return true;
-    }
+#include "lvr2/io/Timestamp.hpp"
 
-    // @TODO raytracing for objects between point and camera...
+#include <algorithm>
+#include <cmath>
+#include <utility>
 
-    return false;
-}
+namespace lvr2
+{
 
 template<typename BaseVecT>
-bool ImageTexturizer<BaseVecT>::point_behind_camera(BaseVecT pos, const ScanImage &image_data)
+ImageTexturizer<BaseVecT>::ImageTexturizer(
+    float texelSize,
+    int minClusterSize,
+    int maxClusterSize
+) : Texturizer<BaseVecT>(texelSize, minClusterSize, maxClusterSize),
+    image_data_initialized(false),
+    m_viewsPerTexel(3),
+    m_maxLoadedImages(32),
+    m_numLoaded(0),
+    m_useCounter(0)
 {
-    BaseVecT diff = image_data.pos - pos;
-    
-    Normal<double> norm(diff.x, diff.y, diff.z);
-    norm.normalize();
-    if (norm.dot(image_data.dir) >= 0.0f) {
-        return true;
-    }
-
-    return false;
 }
 
 template<typename BaseVecT>
-TextureHandle ImageTexturizer<BaseVecT>::generateTexture(
+Texture ImageTexturizer<BaseVecT>::createTexture(
     int index,
     const PointsetSurface<BaseVecT>& surface,
     const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
 )
 {
+    // load images if not already done. Textures of several clusters may be
+    // created at once, so only one of them loads the images.
+    #pragma omp critical(ImageTexturizer_init)
+    {
+        if (!image_data_initialized)
+        {
+            this->init_image_data();
+        }
+    }
+
+    if (images.empty())
+    {
+        return Texturizer<BaseVecT>::createTexture(index, surface, boundingRect);
+    }
+
     // Calculate the texture size
     unsigned short int sizeX = ceil((boundingRect.m_maxDistA - boundingRect.m_minDistA) / this->m_texelSize);
     unsigned short int sizeY = ceil((boundingRect.m_maxDistB - boundingRect.m_minDistB) / this->m_texelSize);
+    const size_t numTexels = static_cast<size_t>(sizeX) * sizeY;
+    auto texelOffset = [sizeX, sizeY](size_t t)
+    {
+        return ((sizeY - t / sizeX - 1) * sizeX + t % sizeX) * 3;
+    };
 
     // Create texture
     Texture texture(index, sizeX, sizeY, 3, 1, this->m_texelSize);
 
-    cout << "images: " << images.size() << endl;
+    // Only images that see the cluster at all have to be considered per texel
+    std::vector<int> candidates = cull_images(boundingRect);
 
-    // load images if not already done
-    if (!image_data_initialized)
-    {
-        this->init_image_data();
-    }
+    const Eigen::Vector3d normal(boundingRect.m_normal.x, boundingRect.m_normal.y, boundingRect.m_normal.z);
+    const int numViews = m_viewsPerTexel;
 
+    // Find the best views of each texel, sorted by score. Empty slots are at the end.
+    std::vector<Eigen::Vector3d> positions(numTexels);
+    std::vector<View> views(numTexels * numViews, View{-1, 0.0f, 0.0f, 0.0f});
 
-    if (image_data_initialized)
+    for (size_t t = 0; t < numTexels; t++)
     {
-        #pragma omp parallel for collapse(2)
-        for (int y = 0; y < sizeY; y++)
+        const int x = t % sizeX;
+        const int y = t / sizeX;
+        BaseVecT pos =
+            boundingRect.m_supportVector
+            + boundingRect.m_vec1 * (x * this->m_texelSize + boundingRect.m_minDistA - this->m_texelSize / 2.0)
+            + boundingRect.m_vec2 * (y * this->m_texelSize + boundingRect.m_minDistB - this->m_texelSize / 2.0);
+        const Eigen::Vector3d p(pos.x, pos.y, pos.z);
+        positions[t] = p;
+
+        View* best = &views[t * numViews];
+        for (int i : candidates)
         {
-            for (int x = 0; x < sizeX; x++)
-            {
+            const ImageData& img = images[i];
 
-                BaseVecT currentPos =
-                    boundingRect.m_supportVector
-                    + boundingRect.m_vec1 * (x * this->m_texelSize + boundingRect.m_minDistA - this->m_texelSize / 2.0)
-                    + boundingRect.m_vec2 * (y * this->m_texelSize + boundingRect.m_minDistB - this->m_texelSize / 2.0);
-
-                int c = 0;
+            const Eigen::Vector3d toCamera = img.center - p;
+            const double dist = toCamera.norm();
+            const double cosAngle = normal.dot(toCamera) / dist;
+            if (cosAngle <= 0)
+            {
+                continue;
+            }
 
-                // Init pixel with red color
-                texture.m_data[(sizeX * y + x) * 3 + 0] = 255;
-                texture.m_data[(sizeX * y + x) * 3 + 1] = 0;
-                texture.m_data[(sizeX * y + x) * 3 + 2] = 0;
+            // Number of pixels per unit length on the surface
+            const float score = img.fx * cosAngle / dist;
+            if (best[numViews - 1].image != -1 && score <= best[numViews - 1].score)
+            {
+                continue;
+            }
 
-                for (const ImageData<BaseVecT> &img_data : images)
-                {
-                    
-                    double ac_angle = (36.0 + 72.0 * c);
-                    ac_angle *= (M_PI/180.0);
+            double u, v;
+            if (!project_point(img, p, u, v))
+            {
+                continue;
+            }
 
-                    Eigen::Vector3d direction(1.0, 0.0, 0.0);
-                    Eigen::Matrix3d angle_rot;
-                    angle_rot = Eigen::AngleAxisd(ac_angle, Eigen::Vector3d::UnitZ());
+            int j = numViews - 1;
+            while (j > 0 && (best[j - 1].image == -1 || best[j - 1].score < score))
+            {
+                best[j] = best[j - 1];
+                j--;
+            }
+            best[j] = View{i, static_cast<float>(u), static_cast<float>(v), score};
+        }
+    }
 
-                    Eigen::Vector3d p(currentPos[0], currentPos[1], currentPos[2]);
+    // Check the views of all texels for occlusions, best views first. The
+    // texels that are checked against the same image share one batch of
+    // rays from its projection center.
+    std::vector<uint8_t> done(numTexels, 0);
+    std::vector<std::pair<int, size_t>> requests;
+    std::vector<Normal<CoordType>> directions;
+    std::vector<BaseVecT> intersections;
+    std::vector<uint8_t> hits;
 
-                    Intrinsicsd intrinsics;
-                    intrinsics  <<
-                        2395.4336550315002 , 0 , 3027.8728609530291 ,         // UOS
-                        0 , 2393.3126174899603 , 2031.02743729632 ,
-                        0 , 0 , 1;
+    for (int round = 0; round < numViews; round++)
+    {
+        requests.clear();
+        for (size_t t = 0; t < numTexels; t++)
+        {
+            const View& view = views[t * numViews + round];
+            if (!done[t] && view.image != -1)
+            {
+                requests.push_back(std::make_pair(view.image, t));
+            }
+        }
 
-                    Transformd tmp; 
-                    tmp << -0.16570779, -0.00014603, 0.98617489, -0.19101685,
-                        -0.02101020, -0.99977249, -0.00367840, -0.00125086,
-                        0.98595106, -0.02132927,  0.16566702, -0.05212102,
-                        0, 0, 0, 1;
+        if (requests.empty())
+        {
+            break;
+        }
 
-//                    img_data.extrinsics = tmp;
+        std::sort(requests.begin(), requests.end());
 
-                    //cout << "Projection: " << intrinsics << endl;
+        size_t first = 0;
+        while (first < requests.size())
+        {
+            const int i = requests[first].first;
+            size_t last = first;
+            while (last < requests.size() && requests[last].first == i)
+            {
+                last++;
+            }
 
-                    p = angle_rot * p;
+            const ImageData& img = images[i];
+            cv::Mat image = get_image(i);
+            if (image.empty())
+            {
+                first = last;
+                continue;
+            }
 
-                    //cout << "P:" << p << endl;
+            if (m_raycaster)
+            {
+                directions.clear();
+                for (size_t r = first; r < last; r++)
+                {
+                    const Eigen::Vector3d d = positions[requests[r].second] - img.center;
+                    directions.push_back(Normal<CoordType>(d.x(), d.y(), d.z()));
+                }
+                const BaseVecT origin(img.center.x(), img.center.y(), img.center.z());
+                m_raycaster->castRays(origin, directions, intersections, hits);
+            }
 
-                    double angle = p.dot(direction);
+            for (size_t r = first; r < last; r++)
+            {
+                const size_t t = requests[r].second;
 
-                    if (angle > 0) // is in view direction
+                if (m_raycaster && hits[r - first])
+                {
+                    // The texel is occluded if the ray hits the mesh clearly
+                    // before it reaches the texel
+                    const BaseVecT& hit = intersections[r - first];
+                    const double dist = (positions[t] - img.center).norm();
+                    const double hitDist = (Eigen::Vector3d(hit.x, hit.y, hit.z) - img.center).norm();
+                    const double tolerance = std::max<double>(this->m_texelSize, 0.005 * dist);
+                    if (hitDist < dist - tolerance)
                     {
-                        // TODO I think this should maybe be done in homogeneous coords
-                        p = tmp.block<3, 3>(0, 0) * p; // rotation
-                        p = p + tmp.block<3, 1>(0, 3); // translation
-
-                        Eigen::Vector3d proj = intrinsics * p; // [s * u, s * v, s * 1] = s * [u, v, 1]
-                        proj /= proj[2];                       //  (s * [u, v, 1] ) / s
-
-                        //cout << "Undist: " << proj[0] << " " << proj[1] << endl;
-
-                        undistorted_to_distorted_uv(proj[0], proj[1], img_data);
-
-                        //cout << "Dist:   " << proj[0] << " " << proj[1] << endl;
-
-                        // TODO fix negated logic...
-                        // if (proj[0] < 0 || std::floor(proj[0]) >= img_data.data.cols ||
-                        //     proj[1] < 0 || std::floor(proj[1]) >= img_data.data.rows)
-                        
-                        // Check if projected point is within current image
-                        if(std::floor(proj[0]) < img_data.data.cols && std::floor(proj[1]) < img_data.data.rows)
-                        {
-                            // Visibility check
-                            if(proj[0] >= 0  && proj[1] >= 0 )
-                            {
-                                cv::Vec3b p = img_data.data.template at<cv::Vec3b>(std::floor(proj[1]), std::floor(proj[0]));
-                                texture.m_data[(sizeX * y + x) * 3 + 0] = p[2];
-                                texture.m_data[(sizeX * y + x) * 3 + 1] = p[1];
-                                texture.m_data[(sizeX * y + x) * 3 + 2] = p[0];
-
-                                // We found a valid value for this point so we can stop
-                                // for know. For later optimization a best found point
-                                // should be used
-                                break;
-                            }
-                        }
+                        continue;
                     }
-                    c++;
                 }
+
+                // Bilinear interpolation of the surrounding pixels
+                const View& view = views[t * numViews + round];
+                const int x0 = std::min(std::max(static_cast<int>(std::floor(view.u)), 0), image.cols - 1);
+                const int y0 = std::min(std::max(static_cast<int>(std::floor(view.v)), 0), image.rows - 1);
+                const int x1 = std::min(x0 + 1, image.cols - 1);
+                const int y1 = std::min(y0 + 1, image.rows - 1);
+                const float wx = std::min(std::max(view.u - x0, 0.0f), 1.0f);
+                const float wy = std::min(std::max(view.v - y0, 0.0f), 1.0f);
+
+                const cv::Vec3b& p00 = image.template at<cv::Vec3b>(y0, x0);
+                const cv::Vec3b& p01 = image.template at<cv::Vec3b>(y0, x1);
+                const cv::Vec3b& p10 = image.template at<cv::Vec3b>(y1, x0);
+                const cv::Vec3b& p11 = image.template at<cv::Vec3b>(y1, x1);
+
+                // Rows are stored bottom up, like in the Texturizer
+                unsigned char* texel = texture.m_data + texelOffset(t);
+                for (int c = 0; c < 3; c++)
+                {
+                    const float value =
+                        (1 - wy) * ((1 - wx) * p00[c] + wx * p01[c])
+                        + wy * ((1 - wx) * p10[c] + wx * p11[c]);
+
+                    // OpenCV stores the channels in BGR order
+                    texel[2 - c] = static_cast<unsigned char>(value + 0.5f);
+                }
+                done[t] = 1;
+            }
+
+            first = last;
+        }
+    }
+
+    // Texels that are not seen by any image get the colors of the point cloud
+    if (std::find(done.begin(), done.end(), 0) != done.end())
+    {
+        Texture fallback = Texturizer<BaseVecT>::createTexture(index, surface, boundingRect);
+        for (size_t t = 0; t < numTexels; t++)
+        {
+            if (!done[t])
+            {
+                std::copy_n(fallback.m_data + texelOffset(t), 3, texture.m_data + texelOffset(t));
             }
         }
     }
-    else
+
+    return texture;
+}
+
+template<typename BaseVecT>
+std::vector<int> ImageTexturizer<BaseVecT>::cull_images(const BoundingRectangle<CoordType>& boundingRect) const
+{
+    const BoundingRectangle<CoordType>& r = boundingRect;
+    const BaseVecT corners[4] = {
+        r.m_supportVector + r.m_vec1 * r.m_minDistA + r.m_vec2 * r.m_minDistB,
+        r.m_supportVector + r.m_vec1 * r.m_maxDistA + r.m_vec2 * r.m_minDistB,
+        r.m_supportVector + r.m_vec1 * r.m_maxDistA + r.m_vec2 * r.m_maxDistB,
+        r.m_supportVector + r.m_vec1 * r.m_minDistA + r.m_vec2 * r.m_maxDistB
+    };
+    const Eigen::Vector3d normal(r.m_normal.x, r.m_normal.y, r.m_normal.z);
+
+    std::vector<int> result;
+    for (size_t i = 0; i < images.size(); i++)
     {
-        for (int y = 0; y < sizeY; y++)
+        const ImageData& img = images[i];
+
+        // The front of the rectangle has to face the camera
+        const Eigen::Vector3d c0(corners[0].x, corners[0].y, corners[0].z);
+        if (normal.dot(img.center - c0) <= 0)
         {
-            for (int x = 0; x < sizeX; x++)
+            continue;
+        }
+
+        // The rectangle is outside of the frustum if all corners are behind
+        // the same plane of it. The image is enlarged by a margin for the
+        // lens distortion.
+        const double marginX = 0.1 * img.width;
+        const double marginY = 0.1 * img.height;
+        int common = 0x1f;
+        for (const BaseVecT& corner : corners)
+        {
+            const Eigen::Vector3d p = img.rotation * Eigen::Vector3d(corner.x, corner.y, corner.z) + img.translation;
+
+            int code = 0;
+            if (p.z() <= 0)
+            {
+                code |= 0x01;
+            }
+            if (img.fx * p.x() + (img.cx + marginX) * p.z() < 0)
+            {
+                code |= 0x02;
+            }
+            if (img.fx * p.x() + (img.cx - img.width - marginX) * p.z() > 0)
             {
-                texture.m_data[(sizeX * y + x) * 3 + 0] = 0;
-                texture.m_data[(sizeX * y + x) * 3 + 1] = 0;
-                texture.m_data[(sizeX * y + x) * 3 + 2] = 0;
+                code |= 0x04;
             }
+            if (img.fy * p.y() + (img.cy + marginY) * p.z() < 0)
+            {
+                code |= 0x08;
+            }
+            if (img.fy * p.y() + (img.cy - img.height - marginY) * p.z() > 0)
+            {
+                code |= 0x10;
+            }
+            common &= code;
         }
 
+        if (common == 0)
+        {
+            result.push_back(i);
+        }
     }
 
-    return this->m_textures.push(texture);
+    return result;
 }
 
 template<typename BaseVecT>
-void ImageTexturizer<BaseVecT>::init_image_data()
+bool ImageTexturizer<BaseVecT>::project_point(
+    const ImageData& img,
+    const Eigen::Vector3d& p,
+    double& u,
+    double& v) const
 {
-    // orthogonal projection matrix is the same for every image
-    for (const ScanPosition &pos : project.scans)
+    const Eigen::Vector3d pc = img.rotation * p + img.translation;
+    if (pc.z() <= 0)
     {
-        for (const ImageFile &img : pos.images)
+        return false;
+    }
+
+    u = img.fx * pc.x() / pc.z() + img.cx;
+    v = img.fy * pc.y() / pc.z() + img.cy;
+
+    // The distortion polynomial is only meaningful close to the image
+    if (u < -0.1 * img.width || u > 1.1 * img.width || v < -0.1 * img.height || v > 1.1 * img.height)
+    {
+        return false;
+    }
+
+    undistorted_to_distorted_uv(u, v, img);
+
+    return u >= 0 && v >= 0 && u <= img.width - 1 && v <= img.height - 1;
+}
+
+template<typename BaseVecT>
+cv::Mat ImageTexturizer<BaseVecT>::get_image(int index)
+{
+    ImageData& img = images[index];
+
+    // Images held by the project are used as they are
+    if (!img.scanImage->image.empty())
+    {
+        return img.scanImage->image.type() == CV_8UC3 ? img.scanImage->image : cv::Mat();
+    }
+
+    cv::Mat result;
+
+    #pragma omp critical(ImageTexturizer_cache)
+    {
+        img.lastUse = ++m_useCounter;
+
+        if (img.loaded.empty() && !img.unreadable)
         {
-            ImageData<BaseVecT> image_data;
+            // Release the least recently used image. Textures that are still
+            // created from it hold their own reference.
+            if (m_numLoaded >= m_maxLoadedImages)
+            {
+                size_t lru = images.size();
+                for (size_t i = 0; i < images.size(); i++)
+                {
+                    if (!images[i].loaded.empty() && (lru == images.size() || images[i].lastUse < images[lru].lastUse))
+                    {
+                        lru = i;
+                    }
+                }
+                images[lru].loaded.release();
+                m_numLoaded--;
+            }
 
-            cout << "INIT ADD: " << img.image_file.string() << endl;
+            img.loaded = cv::imread(img.scanImage->imageFile.string(), cv::IMREAD_COLOR);
+            if (img.loaded.empty())
+            {
+                std::cout << timestamp << "ImageTexturizer: Unable to read image "
+                          << img.scanImage->imageFile.string() << std::endl;
+                img.unreadable = true;
+            }
+            else
+            {
+                m_numLoaded++;
+            }
+        }
 
-            //load image
-            image_data.data = cv::imread(img.image_file.string(), CV_LOAD_IMAGE_COLOR);
+        result = img.loaded;
+    }
 
-            cv::rotate(image_data.data, image_data.data, cv::ROTATE_90_CLOCKWISE);
+    return result;
+}
 
-            // skip image if we weren't able to load it
-            if (image_data.data.empty())
+template<typename BaseVecT>
+void ImageTexturizer<BaseVecT>::init_image_data()
+{
+    for (const ScanPositionPtr& pos : project.positions)
+    {
+        if (!pos)
+        {
+            continue;
+        }
+
+        for (const ScanCameraPtr& cam : pos->cams)
+        {
+            if (!cam)
             {
                 continue;
             }
 
-            for (int i = 0; i < 6; i++)
+            const PinholeModeld& model = cam->camera;
+            if (model.fx <= 0 || model.fy <= 0)
             {
-                image_data.distortion_params[i] = img.distortion_params[i];
+                std::cout << timestamp << "ImageTexturizer: Skipping camera " << cam->sensorName
+                          << " without intrinsics" << std::endl;
+                continue;
             }
 
-            for (int i = 0; i < 4; i++)
+            for (const ScanImagePtr& scanImage : cam->images)
             {
-                image_data.intrinsic_params[i] = img.intrinsic_params[i];
-            }
+                if (!scanImage)
+                {
+                    continue;
+                }
+
+                ImageData image_data;
+
+                // pose of the camera in world coordinates
+                Transformd cameraToWorld = project.pose * pos->registration * scanImage->extrinsics;
+                Transformd worldToCamera = cameraToWorld.inverse();
+
+                image_data.rotation = worldToCamera.block<3, 3>(0, 0);
+                image_data.translation = worldToCamera.block<3, 1>(0, 3);
+                image_data.center = cameraToWorld.block<3, 1>(0, 3);
+
+                image_data.fx = model.fx;
+                image_data.fy = model.fy;
+                image_data.cx = model.cx;
+                image_data.cy = model.cy;
+                image_data.width = model.width;
+                image_data.height = model.height;
+                image_data.distortion = model.k;
+
+                image_data.scanImage = scanImage;
+                image_data.lastUse = 0;
+                image_data.unreadable = false;
+
+                // the image size is needed for culling, read it from the image
+                // if the camera model does not contain it
+                if (image_data.width == 0 || image_data.height == 0)
+                {
+                    cv::Mat image = scanImage->image;
+                    if (image.empty())
+                    {
+                        image = cv::imread(scanImage->imageFile.string(), cv::IMREAD_COLOR);
+                    }
+
+                    // skip image if we weren't able to load it
+                    if (image.empty())
+                    {
+                        std::cout << timestamp << "ImageTexturizer: Unable to read image "
+                                  << scanImage->imageFile.string() << std::endl;
+                        continue;
+                    }
+
+                    image_data.width = image.cols;
+                    image_data.height = image.rows;
+                }
 
-            //calculate transformation matrix
-            Intrinsicsd pro;
-            double* projection = pro.data();
-            projection[0] = img.intrinsic_params[0];
-            projection[5] = img.intrinsic_params[1];
-            projection[2] = img.intrinsic_params[2];
-            projection[6] = img.intrinsic_params[3];
-
-            //Transformd transform;
-            image_data.orientation = img.orientation_transform.transpose();
-            image_data.extrinsics = img.extrinsic_transform.transpose();
- 
-            //Transformd orientation = img.orientation_transform;
-
-            // because matrix multipl. is CM and our matrices are RM we have to do it this way
-            // transform = lvr2::slam6dToLvr(pos.transform).inverse();
-            // transform = transform * orientation.inverse();
-            // transform = transform * img.extrinsic_transform;
-            // Transformd transform_inverse = transform.inverse();
-            // transform_inverse.transposeInPlace();
-
-            //caluclate cam direction and cam pos for image in project space
-            BaseVecT cam_pos(0.0f, 0.0f, 0.0f);
-            Normal<double> cam_dir(0.0f, 0.0f, 1.0f);
-            // cam_pos = transform_inverse * cam_pos;
-            // cam_dir = transform_inverse * cam_dir;
-
-            image_data.pos = cam_pos;
-            image_data.dir = cam_dir;
-
-            // transform from project space to image space incl orthogonal projection
-            // image_data.project_to_image_transform = transform * pro;
-            // image_data.project_to_image_transform.transposeInPlace();
-
-            images.push_back(image_data);
+                images.push_back(image_data);
+            }
         }
     }
 
-    // only if we have images we should try to texturize with them...
-    if (!images.empty())
-    {
-        image_data_initialized = true;
-    }
+    std::cout << timestamp << "ImageTexturizer: Texturing with " << images.size() << " images" << std::endl;
+
+    // without images the textures are created from the point cloud colors
+    image_data_initialized = true;
 }
 
 template<typename BaseVecT>
@@ -273,37 +510,39 @@ template<typename ValueType>
 void ImageTexturizer<BaseVecT>::undistorted_to_distorted_uv(
     ValueType &u,
     ValueType &v,
-    const ImageData<BaseVecT> &img)
+    const ImageData &img) const
 {
-    ValueType x, y, ud, vd, r_2, r_4, r_6, r_8, fx, fy, Cx, Cy, k1, k2, k3, k4, p1, p2;
-
-    fx = img.intrinsic_params[0];
-    fy = img.intrinsic_params[1];
-    Cx = img.intrinsic_params[2];
-    Cy = img.intrinsic_params[3];
-
-    k1 = img.distortion_params[0];
-    k2 = img.distortion_params[1];
-    k3 = img.distortion_params[2];
-    k4 = img.distortion_params[3];
-    p1 = img.distortion_params[4];
-    p2 = img.distortion_params[5];
-
-    x = (u - Cx)/fx;
-    y = (v - Cy)/fy;
-
-    //r_2 = std::pow(x, 2) + std::pow(y, 2);
-    //r_2 = std::atan(std::sqrt(std::pow(x, 2) + std::pow(y, 2)));
-    r_2 = std::pow(std::atan(std::sqrt(std::pow(x, 2) + std::pow(y, 2))), 2);
-    r_4 = std::pow(r_2, 2);
-    r_6 = std::pow(r_2, 3);
-    r_8 = std::pow(r_2, 4);
-
-    ud = u + x*fx*(k1*r_2 + k2*r_4 + k3*r_6 + k4*r_8) + 2*fx*x*y*p1 + p2*fx*(r_2 + 2*std::pow(x, 2));
-    vd = v + y*fy*(k1*r_2 + k2*r_4 + k3*r_6 + k4*r_8) + 2*fy*x*y*p2 + p1*fy*(r_2 + 2*std::pow(y, 2));
-
-    u = ud;
-    v = vd;
+    const std::vector<double>& k = img.distortion;
+    if (k.size() < 4)
+    {
+        return;
+    }
+
+    // OpenCV coefficient order: k1, k2, p1, p2[, k3[, k4, k5, k6]]
+    const double k1 = k[0];
+    const double k2 = k[1];
+    const double p1 = k[2];
+    const double p2 = k[3];
+    const double k3 = k.size() > 4 ? k[4] : 0.0;
+
+    const double x = (u - img.cx) / img.fx;
+    const double y = (v - img.cy) / img.fy;
+
+    const double r_2 = x * x + y * y;
+    const double r_4 = r_2 * r_2;
+    const double r_6 = r_4 * r_2;
+
+    double radial = 1.0 + k1 * r_2 + k2 * r_4 + k3 * r_6;
+    if (k.size() >= 8)
+    {
+        radial /= 1.0 + k[5] * r_2 + k[6] * r_4 + k[7] * r_6;
+    }
+
+    const double xd = x * radial + 2 * p1 * x * y + p2 * (r_2 + 2 * x * x);
+    const double yd = y * radial + p1 * (r_2 + 2 * y * y) + 2 * p2 * x * y;
+
+    u = img.fx * xd + img.cx;
+    v = img.fy * yd + img.cy;
 }
 
 } // namespace lvr2
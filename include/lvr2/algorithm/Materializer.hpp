@@ -84,6 +84,9 @@ struct MaterializerResult
     /// Keypoints
     boost::optional<std::unordered_map<BaseVecT, std::vector<float>>> m_keypoints;
 
+    /// Placement of the cluster textures in the pages of a texture atlas, if one was used
+    boost::optional<DenseClusterMap<AtlasRegion>> m_atlasRegions;
+
     /**
      * @brief Constructor
      *
@@ -35,8 +35,11 @@
 
 #include "lvr2/algorithm/ClusterAlgorithms.hpp"
 #include "lvr2/algorithm/FinalizeAlgorithms.hpp"
+#include "lvr2/config/lvropenmp.hpp"
 #include <opencv2/features2d.hpp>
 
+#include <algorithm>
+
 
 namespace lvr2
 {
@@ -86,18 +89,36 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
     int numClustersTooSmall = 0;
     int numClustersTooLarge = 0;
     int textureCount = 0;
-    int clusterCount = 0;
 
-    // For all clusters ...
-    for (auto clusterH : m_cluster)
+    boost::optional<DenseClusterMap<AtlasRegion>> atlasRegions;
+    if (m_texturizer && m_texturizer.get().hasAtlas())
     {
-        ++progress;
+        atlasRegions = DenseClusterMap<AtlasRegion>();
+    }
 
+    // Process the largest clusters first, so that no thread is left with a
+    // large texture at the end. This is also the best order for packing the
+    // textures into an atlas.
+    std::vector<ClusterHandle> clusters;
+    clusters.reserve(m_cluster.numCluster());
+    for (auto clusterH : m_cluster)
+    {
+        clusters.push_back(clusterH);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [&](ClusterHandle a, ClusterHandle b)
+    {
+        return m_cluster.getCluster(a).handles.size() > m_cluster.getCluster(b).handles.size();
+    });
 
-        // Get number of faces in cluster
-        const Cluster<FaceHandle>& cluster = m_cluster.getCluster(clusterH);
-        int numFacesInCluster = cluster.handles.size();
+    // Decide for each cluster whether it gets a texture. Textures are numbered
+    // in processing order, so the result does not depend on the number of threads.
+    std::vector<int> textureIndices;
+    textureIndices.reserve(clusters.size());
 
+    for (auto clusterH : clusters)
+    {
+        int numFacesInCluster = m_cluster.getCluster(clusterH).handles.size();
+        int textureIndex = -1;
 
         if (!m_texturizer
             || (m_texturizer && numFacesInCluster < m_texturizer.get().m_texMinClusterSize
@@ -107,9 +128,7 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
         )
         {
             // No textures, or using textures and texture is too small/large
-            // Generate plain color material
             // (texMin/MaxClustersize = 0 means: no limit)
-
             if (m_texturizer)
             {
                 // If using textures, count whether this cluster was too small or too large
@@ -122,47 +141,125 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
                     numClustersTooLarge++;
                 }
             }
+        }
+        else
+        {
+            textureIndex = textureCount++;
+        }
 
+        textureIndices.push_back(textureIndex);
+    }
+
+    // Everything computed for a single cluster
+    struct ClusterResult
+    {
+        Material material;
+        Texture texture;
+        std::vector<std::pair<VertexHandle, TexCoords>> texCoords;
+        std::vector<BaseVecT> features;
+        cv::Mat descriptors;
+    };
+    std::vector<ClusterResult> results(clusters.size());
+
+    // Adds the result of a cluster to the materializer result
+    auto merge = [&](size_t c)
+    {
+        const ClusterHandle clusterH = clusters[c];
+        ClusterResult& result = results[c];
 
-            // Calculate (a sorta-kinda not really) median value
-            std::map<Rgb8Color, int> colorMap;
-            int maxColorCount = 0;
-            Rgb8Color mostUsedColor;
+        if (textureIndices[c] >= 0)
+        {
+            AtlasRegion region;
+            result.material.m_texture = m_texturizer.get().addTexture(std::move(result.texture), &region);
+            if (atlasRegions)
+            {
+                atlasRegions.get().insert(clusterH, region);
+            }
+
+            // Transform descriptor from matrix row to float vector
+            for (unsigned int row = 0; row < result.features.size(); ++row)
+            {
+                keypoints_map[result.features[row]] = std::vector<float>(
+                    result.descriptors.ptr(row),
+                    result.descriptors.ptr(row) + result.descriptors.cols
+                );
+            }
+
+            // Insert tex coords into result map
+            for (const auto& vertexTexCoord : result.texCoords)
+            {
+                VertexHandle vertexH = vertexTexCoord.first;
+                if (vertexTexCoords.get(vertexH))
+                {
+                    vertexTexCoords.get(vertexH).get().push(clusterH, vertexTexCoord.second);
+                }
+                else
+                {
+                    ClusterTexCoordMapping mapping;
+                    mapping.push(clusterH, vertexTexCoord.second);
+                    vertexTexCoords.insert(vertexH, mapping);
+                }
+            }
+        }
+
+        clusterMaterials.insert(clusterH, result.material);
+
+        // Free the per-cluster data as soon as it is merged
+        result = ClusterResult();
+    };
+
+    // Generates the material, and for textured clusters the texture, of a cluster
+    auto generate = [&](size_t c)
+    {
+        const ClusterHandle clusterH = clusters[c];
+        const Cluster<FaceHandle>& cluster = m_cluster.getCluster(clusterH);
+        ClusterResult& result = results[c];
+
+        if (textureIndices[c] < 0)
+        {
+            // Generate plain color material from the most frequent centroid
+            // color. The colors are packed into integers and sorted, so that
+            // equal colors form runs.
+            std::vector<uint32_t> colors;
+            colors.reserve(cluster.handles.size());
 
             // For each face ...
             for (auto faceH : cluster.handles)
             {
                 // Calculate color of centroid
                 Rgb8Color color = calcColorForFaceCentroid(m_mesh, m_surface, faceH);
-                if (colorMap.count(color))
-                {
-                    colorMap[color]++;
-                }
-                else
+                colors.push_back((color[0] << 16) | (color[1] << 8) | color[2]);
+            }
+            std::sort(colors.begin(), colors.end());
+
+            uint32_t mostUsedColor = 0;
+            size_t maxColorCount = 0;
+            for (size_t run = 0; run < colors.size(); )
+            {
+                size_t next = run + 1;
+                while (next < colors.size() && colors[next] == colors[run])
                 {
-                    colorMap[color] = 1;
+                    next++;
                 }
-                if (colorMap[color] > maxColorCount)
+                if (next - run > maxColorCount)
                 {
-                    mostUsedColor = color;
+                    maxColorCount = next - run;
+                    mostUsedColor = colors[run];
                 }
+                run = next;
             }
 
-            // Create material and save in map
-            Material material;
             std::array<unsigned char, 3> arr = {
-                static_cast<uint8_t>(mostUsedColor[0]),
-                static_cast<uint8_t>(mostUsedColor[1]),
-                static_cast<uint8_t>(mostUsedColor[2])
+                static_cast<uint8_t>(mostUsedColor >> 16),
+                static_cast<uint8_t>(mostUsedColor >> 8),
+                static_cast<uint8_t>(mostUsedColor)
             };
-
-            material.m_color =  std::move(arr);
-              clusterMaterials.insert(clusterH, material);
-
+            result.material.m_color = std::move(arr);
         }
         else
         {
             // Textures
+            Texturizer<BaseVecT>& texturizer = m_texturizer.get();
 
             // Contour
             std::vector<VertexHandle> contour = calculateClusterContourVertices(
@@ -177,43 +274,28 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
                 m_mesh,
                 cluster,
                 m_normals,
-                m_texturizer.get().m_texelSize,
+                texturizer.m_texelSize,
                 clusterH
             );
 
-            cout << "Generate Texture..." << endl;
             // Create texture
-            TextureHandle texH = m_texturizer.get().generateTexture(
-                textureCount,
+            result.texture = texturizer.createTexture(
+                textureIndices[c],
                 m_surface,
                 boundingRect
             );
 
             std::vector<cv::KeyPoint> keypoints;
-            cv::Mat descriptors;
             cv::Ptr<cv::AKAZE> detector = cv::AKAZE::create();
-            m_texturizer.get().findKeyPointsInTexture(texH,
-                    boundingRect, detector, keypoints, descriptors);
-            std::vector<BaseVecT> features3d =
-                m_texturizer.get().keypoints23d(keypoints, boundingRect, texH);
-
-            // Transform descriptor from matrix row to float vector
-            for (unsigned int row = 0; row < features3d.size(); ++row)
-            {
-                keypoints_map[features3d[row]] =
-                    std::vector<float>(descriptors.ptr(row), descriptors.ptr(row) + descriptors.cols);
-            }
+            texturizer.findKeyPointsInTexture(result.texture,
+                    boundingRect, detector, keypoints, result.descriptors);
+            result.features = texturizer.keypoints23d(keypoints, boundingRect, result.texture);
 
-            // Create material with default color and insert into face map
-            Material material;
-            material.m_texture = texH;
+            // Material with default color, the texture handle is set when merging
             std::array<unsigned char, 3> arr = {255, 255, 255};
-
-            material.m_color = std::move(arr);            
-              clusterMaterials.insert(clusterH, material);
+            result.material.m_color = std::move(arr);
 
             // Calculate tex coords
-            // Insert material into face map for each face
             // Find unique vertices in cluster
             std::unordered_set<VertexHandle> verticesOfCluster;
             for (auto faceH : cluster.handles)
@@ -225,37 +307,105 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
                 }
             }
             // For each unique vertex in this cluster
+            result.texCoords.reserve(verticesOfCluster.size());
             for (auto vertexH : verticesOfCluster)
             {
-                // Calculate tex coords
-                TexCoords texCoords = m_texturizer.get().calculateTexCoords(
-                    texH,
+                result.texCoords.emplace_back(vertexH, texturizer.calculateTexCoords(
+                    result.texture,
                     boundingRect,
                     m_mesh.getVertexPosition(vertexH)
-                );
+                ));
+            }
+        }
+    };
+
+    // Results are merged in processing order as soon as all previous clusters
+    // are done. This keeps the result deterministic and lets the texturizer
+    // write finished atlas pages while later clusters are still being generated.
+    // Only one thread merges at a time. It does so outside of the critical
+    // section, so packing textures and writing pages doesn't stall the threads
+    // that finish other clusters in the meantime.
+    std::vector<char> done(clusters.size(), 0);
+    size_t numMerged = 0;
+    bool merging = false;
+
+    auto finish = [&](size_t c)
+    {
+        bool merger = false;
+        #pragma omp critical(Materializer_merge)
+        {
+            done[c] = 1;
+            if (!merging && done[numMerged])
+            {
+                merging = merger = true;
+            }
+        }
 
-                // Insert into result map
-                if (vertexTexCoords.get(vertexH))
-                {
-                    vertexTexCoords.get(vertexH).get().push(clusterH, texCoords);
-                }
-                else
+        while (merger)
+        {
+            merge(numMerged);
+
+            #pragma omp critical(Materializer_merge)
+            {
+                numMerged++;
+                if (numMerged == clusters.size() || !done[numMerged])
                 {
-                    ClusterTexCoordMapping mapping;
-                    mapping.push(clusterH, texCoords);
-                    vertexTexCoords.insert(vertexH, mapping);
+                    merging = merger = false;
                 }
             }
+        }
 
-            textureCount++;
+        ++progress;
+    };
+
+    // Nested parallel regions are inactive, so a texture created in the
+    // parallel loop below is colored by a single thread. Textured clusters
+    // that are larger than an even share of all textured faces per thread
+    // are therefore generated one after another, each using all threads.
+    size_t numTexturedFaces = 0;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        if (textureIndices[c] >= 0)
+        {
+            numTexturedFaces += m_cluster.getCluster(clusters[c]).handles.size();
         }
     }
 
+    const size_t numThreads = OpenMPConfig::getNumThreads();
+    std::vector<size_t> bigClusters, otherClusters;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        if (numThreads > 1 && textureIndices[c] >= 0
+            && m_cluster.getCluster(clusters[c]).handles.size() * numThreads > numTexturedFaces)
+        {
+            bigClusters.push_back(c);
+        }
+        else
+        {
+            otherClusters.push_back(c);
+        }
+    }
+
+    for (size_t c : bigClusters)
+    {
+        generate(c);
+        finish(c);
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (long i = 0; i < (long)otherClusters.size(); i++)
+    {
+        generate(otherClusters[i]);
+        finish(otherClusters[i]);
+    }
+
     cout << endl;
 
     // Write result
     if (m_texturizer)
     {
+        // Store the pages that are still open, if an atlas is used
+        m_texturizer.get().finishTextures();
 
         cout << timestamp << "Skipped " << (numClustersTooSmall+numClustersTooLarge)
         << " clusters while generating textures" << endl;
@@ -265,12 +415,14 @@ MaterializerResult<BaseVecT> Materializer<BaseVecT>::generateMaterials()
 
         cout << timestamp << "Generated " << textureCount << " textures" << endl;
 
-        return MaterializerResult<BaseVecT>(
+        MaterializerResult<BaseVecT> result(
             clusterMaterials,
             m_texturizer.get().getTextures(),
             vertexTexCoords,
             keypoints_map
         );
+        result.m_atlasRegions = atlasRegions;
+        return result;
     }
     else
     {
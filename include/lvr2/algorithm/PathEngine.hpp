@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PathEngine.hpp
+ */
+
+#ifndef LVR2_ALGORITHM_PATHENGINE_H_
+#define LVR2_ALGORITHM_PATHENGINE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "lvr2/geometry/BaseMesh.hpp"
+#include "lvr2/geometry/Handles.hpp"
+#include "lvr2/attrmaps/AttrMaps.hpp"
+#include "lvr2/util/Meap.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Shortest path queries and distance fields on the vertices of a mesh.
+ *
+ * In contrast to `Dijkstra()`, the engine is meant to be created once per
+ * mesh and then used for many queries:
+ *
+ * - The graph is converted into a compact adjacency array (one entry per
+ *   directed edge with its cost), so a query never has to circulate around
+ *   vertices in the mesh or search for the edge between two vertices.
+ * - All per vertex state of a query is allocated once. Instead of resetting
+ *   it before each query, it is marked as outdated with a query counter.
+ * - Path queries are goal directed (A*). The Euclidean distance to the goal
+ *   is scaled with the smallest ratio of edge cost to edge length, which
+ *   keeps the heuristic consistent for any non-negative edge costs. For pure
+ *   length costs like the ones of `calcVertexDistances()`, it's the plain
+ *   Euclidean distance.
+ * - Full distance fields can be computed in parallel with delta-stepping.
+ *
+ * The engine keeps a reference to the mesh and copies the edge costs. It must
+ * be rebuilt if the mesh or the edge costs change. A single engine must not
+ * be used by several threads at the same time.
+ */
+template<typename BaseVecT>
+class PathEngine
+{
+public:
+    /**
+     * @brief Creates an engine which uses the lengths of the edges as costs.
+     */
+    PathEngine(const BaseMesh<BaseVecT>& mesh);
+
+    /**
+     * @brief Creates an engine with the given (non-negative) edge costs.
+     */
+    PathEngine(const BaseMesh<BaseVecT>& mesh, const DenseEdgeMap<float>& edgeCosts);
+
+    /**
+     * @brief Sets costs for the vertices. Like in `Dijkstra()`, vertices with
+     *        a cost of 1 or more can't be passed. Start vertices are always
+     *        valid.
+     */
+    void setVertexCosts(const DenseVertexMap<float>& vertexCosts);
+
+    /**
+     * @brief Makes all vertices passable again.
+     */
+    void clearVertexCosts();
+
+    /**
+     * @brief Searches the shortest path from `start` to `goal`.
+     *
+     * @param path  The vertices of the path, starting with `start` and ending
+     *              with `goal`. Empty if there is no path.
+     *
+     * @return true if a path between start and goal exists
+     */
+    bool findPath(VertexHandle start, VertexHandle goal, std::list<VertexHandle>& path);
+
+    /**
+     * @brief Searches the shortest path from any of the given start vertices
+     *        to `goal`. The path starts with the start vertex that is closest
+     *        to the goal.
+     */
+    bool findPath(
+        const std::vector<VertexHandle>& starts,
+        VertexHandle goal,
+        std::list<VertexHandle>& path
+    );
+
+    /**
+     * @brief Returns the distance of `vH` to the start vertices of the last
+     *        `findPath()` query.
+     *
+     * The distance is only known for vertices whose shortest path has been
+     * found before the goal was reached. For all other vertices, this returns
+     * infinity.
+     */
+    float distance(VertexHandle vH) const;
+
+    /**
+     * @brief Computes the distance of every vertex to the closest of the
+     *        given sources with Dijkstra's algorithm. Unreachable vertices
+     *        have a distance of infinity.
+     */
+    DenseVertexMap<float> distanceField(const std::vector<VertexHandle>& sources);
+
+    /**
+     * @brief Like `distanceField()`, but computed in parallel with the
+     *        delta-stepping algorithm.
+     *
+     * Vertices are processed in buckets of width `delta` by their distance.
+     * All vertices of a bucket are relaxed in parallel. Small values result
+     * in less redundant work, but less parallelism. If `delta` is not
+     * positive, the mean edge cost is used.
+     */
+    DenseVertexMap<float> distanceFieldParallel(
+        const std::vector<VertexHandle>& sources,
+        float delta = 0
+    );
+
+private:
+    /// Sentinel for "no vertex"
+    static constexpr Index none = std::numeric_limits<Index>::max();
+
+    /// Builds the adjacency array and the heuristic data
+    void build(const DenseEdgeMap<float>& edgeCosts);
+
+    /// Runs Dijkstra/A* from the sources until `goal` is reached. Without a
+    /// goal, all reachable vertices are visited.
+    bool search(const std::vector<VertexHandle>& sources, Index goal);
+
+    /// Invalidates the state of the previous query
+    void beginQuery();
+
+    /// Collects the path to `goal` found by the last query
+    void collectPath(Index goal, std::list<VertexHandle>& path) const;
+
+    /// Copies per vertex values into a map for all vertices of the mesh
+    template<typename GetF>
+    DenseVertexMap<float> toVertexMap(GetF get) const;
+
+    inline bool isSettled(Index v) const { return m_stamps[v] == m_stamp + 1; }
+    inline bool isReached(Index v) const { return m_stamps[v] >= m_stamp; }
+
+    const BaseMesh<BaseVecT>& m_mesh;
+
+    /// Adjacency array: the neighbours of vertex `v` and the costs of the
+    /// edges to them are stored in `[m_offsets[v], m_offsets[v + 1])`.
+    std::vector<Index> m_offsets;
+    std::vector<Index> m_targets;
+    std::vector<float> m_costs;
+
+    /// 1 for vertices that can't be passed
+    std::vector<uint8_t> m_blocked;
+
+    /// Vertex positions and the scale of the A* heuristic
+    std::vector<BaseVecT> m_positions;
+    float m_heuristicScale;
+
+    /// Mean cost of all edges
+    float m_meanCost;
+
+    /// State of the current query. A vertex with `m_stamps[v] == m_stamp` has
+    /// been reached, with `m_stamp + 1` it has been settled. Other values
+    /// belong to older queries.
+    std::vector<float> m_distances;
+    std::vector<Index> m_predecessors;
+    std::vector<uint32_t> m_stamps;
+    uint32_t m_stamp;
+    Meap<VertexHandle, float> m_queue;
+
+    /// Distances and buckets of the delta-stepping algorithm
+    std::unique_ptr<std::atomic<float>[]> m_atomicDistances;
+    std::vector<std::vector<Index>> m_buckets;
+};
+
+} // namespace lvr2
+
+#include "lvr2/algorithm/PathEngine.tcc"
+
+#endif /* LVR2_ALGORITHM_PATHENGINE_H_ */
@@ -0,0 +1,473 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PathEngine.tcc
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "lvr2/algorithm/GeometryAlgorithms.hpp"
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/util/Util.hpp"
+
+namespace lvr2
+{
+
+template<typename BaseVecT>
+PathEngine<BaseVecT>::PathEngine(const BaseMesh<BaseVecT>& mesh)
+    : m_mesh(mesh)
+{
+    build(calcVertexDistances(mesh));
+}
+
+template<typename BaseVecT>
+PathEngine<BaseVecT>::PathEngine(const BaseMesh<BaseVecT>& mesh, const DenseEdgeMap<float>& edgeCosts)
+    : m_mesh(mesh)
+{
+    build(edgeCosts);
+}
+
+template<typename BaseVecT>
+void PathEngine<BaseVecT>::build(const DenseEdgeMap<float>& edgeCosts)
+{
+    const size_t numVertices = m_mesh.nextVertexIndex();
+
+    // Not all indices below `nextEdgeIndex()` are valid edge handles (e.g.
+    // the half edge mesh uses one index per half edge), so the handles are
+    // collected first.
+    std::vector<EdgeHandle> edges;
+    edges.reserve(m_mesh.numEdges());
+    for (auto eH: m_mesh.edges())
+    {
+        edges.push_back(eH);
+    }
+    const size_t numEdges = edges.size();
+
+    // Count the edges of each vertex. We iterate over the edges instead of
+    // the vertices, since the endpoints of an edge can be found without
+    // circulating around a vertex.
+    m_offsets.assign(numVertices + 1, 0);
+
+    #pragma omp parallel for
+    for (size_t i = 0; i < numEdges; i++)
+    {
+        auto vertices = m_mesh.getVerticesOfEdge(edges[i]);
+        #pragma omp atomic
+        m_offsets[vertices[0].idx()]++;
+        #pragma omp atomic
+        m_offsets[vertices[1].idx()]++;
+    }
+
+    const Index numEntries = Util::parallel_exclusive_scan(m_offsets);
+    m_offsets[numVertices] = numEntries;
+    m_targets.resize(numEntries);
+    m_costs.resize(numEntries);
+
+    // Fill in both directions of each edge. Costs of the edge and smallest
+    // ratio of cost to length for the A* heuristic are computed on the way.
+    std::vector<Index> cursor(m_offsets.begin(), m_offsets.end() - 1);
+    double costSum = 0;
+    float minRatio = std::numeric_limits<float>::infinity();
+
+    #pragma omp parallel for reduction(+:costSum) reduction(min:minRatio)
+    for (size_t i = 0; i < numEdges; i++)
+    {
+        const EdgeHandle eH = edges[i];
+        auto vertices = m_mesh.getVerticesOfEdge(eH);
+        const float cost = edgeCosts[eH];
+        costSum += cost;
+
+        const float length = m_mesh.getVertexPosition(vertices[0])
+            .distance(m_mesh.getVertexPosition(vertices[1]));
+        if (length > 0)
+        {
+            minRatio = std::min(minRatio, cost / length);
+        }
+
+        for (int j = 0; j < 2; j++)
+        {
+            Index pos;
+            #pragma omp atomic capture
+            pos = cursor[vertices[j].idx()]++;
+            m_targets[pos] = vertices[1 - j].idx();
+            m_costs[pos] = cost;
+        }
+    }
+
+    // The order within each vertex depends on the thread scheduling above.
+    // Sort it to get deterministic results for equally long paths.
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        const Index begin = m_offsets[v];
+        const Index end = m_offsets[v + 1];
+        for (Index i = begin + 1; i < end; i++)
+        {
+            for (Index j = i; j > begin && m_targets[j] < m_targets[j - 1]; j--)
+            {
+                std::swap(m_targets[j], m_targets[j - 1]);
+                std::swap(m_costs[j], m_costs[j - 1]);
+            }
+        }
+    }
+
+    m_meanCost = numEntries ? static_cast<float>(2 * costSum / numEntries) : 1.0f;
+
+    // A slightly smaller scale protects the heuristic from rounding errors
+    m_heuristicScale = std::isfinite(minRatio) ? std::max(0.0f, minRatio * 0.9999f) : 0.0f;
+    if (m_heuristicScale > 0)
+    {
+        m_positions.resize(numVertices);
+
+        #pragma omp parallel for
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            if (m_mesh.containsVertex(VertexHandle(v)))
+            {
+                m_positions[v] = m_mesh.getVertexPosition(VertexHandle(v));
+            }
+        }
+    }
+
+    m_blocked.assign(numVertices, 0);
+    m_distances.assign(numVertices, std::numeric_limits<float>::infinity());
+    m_predecessors.assign(numVertices, none);
+    m_stamps.assign(numVertices, 0);
+    m_stamp = 0;
+    m_queue = Meap<VertexHandle, float>(numVertices);
+}
+
+template<typename BaseVecT>
+void PathEngine<BaseVecT>::setVertexCosts(const DenseVertexMap<float>& vertexCosts)
+{
+    #pragma omp parallel for
+    for (size_t v = 0; v < m_blocked.size(); v++)
+    {
+        auto cost = vertexCosts.get(VertexHandle(v));
+        m_blocked[v] = cost && *cost >= 1;
+    }
+}
+
+template<typename BaseVecT>
+void PathEngine<BaseVecT>::clearVertexCosts()
+{
+    std::fill(m_blocked.begin(), m_blocked.end(), 0);
+}
+
+template<typename BaseVecT>
+void PathEngine<BaseVecT>::beginQuery()
+{
+    // Each query uses two stamp values. Only when the counter overflows, the
+    // stamps of all vertices have to be reset.
+    if (m_stamp >= std::numeric_limits<uint32_t>::max() - 4)
+    {
+        std::fill(m_stamps.begin(), m_stamps.end(), 0);
+        m_stamp = 0;
+    }
+    m_stamp += 2;
+    m_queue.clear();
+}
+
+template<typename BaseVecT>
+bool PathEngine<BaseVecT>::search(const std::vector<VertexHandle>& sources, Index goal)
+{
+    beginQuery();
+
+    const bool directed = goal != none && m_heuristicScale > 0;
+    const BaseVecT goalPos = directed ? m_positions[goal] : BaseVecT();
+    auto heuristic = [&](Index v)
+    {
+        return directed ? m_heuristicScale * m_positions[v].distance(goalPos) : 0.0f;
+    };
+
+    for (auto vH: sources)
+    {
+        const Index s = vH.idx();
+        if (s < m_stamps.size() && m_mesh.containsVertex(vH))
+        {
+            m_distances[s] = 0;
+            m_predecessors[s] = s;
+            m_stamps[s] = m_stamp;
+            m_queue.insertOrDecrease(vH, heuristic(s));
+        }
+    }
+
+    while (!m_queue.isEmpty())
+    {
+        const Index v = m_queue.popMin().key().idx();
+        m_stamps[v] = m_stamp + 1;
+
+        if (v == goal)
+        {
+            return true;
+        }
+
+        const float dist = m_distances[v];
+        for (Index i = m_offsets[v]; i < m_offsets[v + 1]; i++)
+        {
+            const Index t = m_targets[i];
+            if (m_blocked[t] || isSettled(t))
+            {
+                continue;
+            }
+
+            const float newDist = dist + m_costs[i];
+            if (!isReached(t) || newDist < m_distances[t])
+            {
+                m_distances[t] = newDist;
+                m_predecessors[t] = v;
+                m_stamps[t] = m_stamp;
+                m_queue.insertOrDecrease(VertexHandle(t), newDist + heuristic(t));
+            }
+        }
+    }
+
+    return goal == none;
+}
+
+template<typename BaseVecT>
+void PathEngine<BaseVecT>::collectPath(Index goal, std::list<VertexHandle>& path) const
+{
+    Index v = goal;
+    path.push_front(VertexHandle(v));
+    while (m_predecessors[v] != v)
+    {
+        v = m_predecessors[v];
+        path.push_front(VertexHandle(v));
+    }
+}
+
+template<typename BaseVecT>
+bool PathEngine<BaseVecT>::findPath(VertexHandle start, VertexHandle goal, std::list<VertexHandle>& path)
+{
+    return findPath(std::vector<VertexHandle>{ start }, goal, path);
+}
+
+template<typename BaseVecT>
+bool PathEngine<BaseVecT>::findPath(
+    const std::vector<VertexHandle>& starts,
+    VertexHandle goal,
+    std::list<VertexHandle>& path
+)
+{
+    path.clear();
+    if (goal.idx() >= m_stamps.size() || !m_mesh.containsVertex(goal))
+    {
+        return false;
+    }
+
+    if (!search(starts, goal.idx()))
+    {
+        return false;
+    }
+
+    collectPath(goal.idx(), path);
+    return true;
+}
+
+template<typename BaseVecT>
+float PathEngine<BaseVecT>::distance(VertexHandle vH) const
+{
+    const Index v = vH.idx();
+    if (v < m_stamps.size() && isSettled(v))
+    {
+        return m_distances[v];
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+template<typename BaseVecT>
+template<typename GetF>
+DenseVertexMap<float> PathEngine<BaseVecT>::toVertexMap(GetF get) const
+{
+    // All entries are inserted up front, so they can be overwritten in
+    // parallel afterwards.
+    DenseVertexMap<float> out;
+    out.reserve(m_mesh.nextVertexIndex());
+    for (auto vH: m_mesh.vertices())
+    {
+        out.insert(vH, std::numeric_limits<float>::infinity());
+    }
+
+    #pragma omp parallel for
+    for (size_t v = 0; v < m_stamps.size(); v++)
+    {
+        VertexHandle vH(v);
+        if (m_mesh.containsVertex(vH))
+        {
+            out[vH] = get(v);
+        }
+    }
+    return out;
+}
+
+template<typename BaseVecT>
+DenseVertexMap<float> PathEngine<BaseVecT>::distanceField(const std::vector<VertexHandle>& sources)
+{
+    search(sources, none);
+    return toVertexMap([this](Index v)
+    {
+        return isSettled(v) ? m_distances[v] : std::numeric_limits<float>::infinity();
+    });
+}
+
+template<typename BaseVecT>
+DenseVertexMap<float> PathEngine<BaseVecT>::distanceFieldParallel(
+    const std::vector<VertexHandle>& sources,
+    float delta
+)
+{
+    const size_t numVertices = m_stamps.size();
+    const float inf = std::numeric_limits<float>::infinity();
+    if (!(delta > 0))
+    {
+        delta = m_meanCost > 0 ? m_meanCost : 1.0f;
+    }
+
+    if (!m_atomicDistances)
+    {
+        m_atomicDistances.reset(new std::atomic<float>[numVertices]);
+    }
+    auto& dist = m_atomicDistances;
+
+    #pragma omp parallel for
+    for (size_t v = 0; v < numVertices; v++)
+    {
+        dist[v].store(inf, std::memory_order_relaxed);
+    }
+
+    auto bucketOf = [delta](float d)
+    {
+        return static_cast<size_t>(d / delta);
+    };
+
+    for (auto& bucket: m_buckets)
+    {
+        bucket.clear();
+    }
+    if (m_buckets.empty())
+    {
+        m_buckets.resize(1);
+    }
+
+    for (auto vH: sources)
+    {
+        if (vH.idx() < numVertices && m_mesh.containsVertex(vH))
+        {
+            dist[vH.idx()].store(0, std::memory_order_relaxed);
+            m_buckets[0].push_back(vH.idx());
+        }
+    }
+
+    // Relaxes either the light (cost <= delta) or the heavy edges of all
+    // given vertices in parallel. Improved vertices are put into the bucket
+    // of their new distance.
+    auto relax = [&](const std::vector<Index>& vertices, bool light)
+    {
+        #pragma omp parallel if(vertices.size() > 256)
+        {
+            std::vector<std::pair<size_t, Index>> requests;
+
+            #pragma omp for schedule(dynamic, 64)
+            for (size_t i = 0; i < vertices.size(); i++)
+            {
+                const Index v = vertices[i];
+                const float d = dist[v].load(std::memory_order_relaxed);
+                for (Index j = m_offsets[v]; j < m_offsets[v + 1]; j++)
+                {
+                    if ((m_costs[j] <= delta) != light || m_blocked[m_targets[j]])
+                    {
+                        continue;
+                    }
+
+                    // Atomic minimum
+                    const float newDist = d + m_costs[j];
+                    auto& target = dist[m_targets[j]];
+                    float old = target.load(std::memory_order_relaxed);
+                    while (newDist < old && !target.compare_exchange_weak(old, newDist));
+                    if (newDist < old)
+                    {
+                        requests.emplace_back(bucketOf(newDist), m_targets[j]);
+                    }
+                }
+            }
+
+            #pragma omp critical
+            {
+                for (auto& r: requests)
+                {
+                    if (r.first >= m_buckets.size())
+                    {
+                        m_buckets.resize(r.first + 1);
+                    }
+                    m_buckets[r.first].push_back(r.second);
+                }
+            }
+        }
+    };
+
+    std::vector<Index> frontier;
+    std::vector<Index> settled;
+    for (size_t current = 0; current < m_buckets.size(); current++)
+    {
+        settled.clear();
+        while (!m_buckets[current].empty())
+        {
+            // Vertices might be contained several times or might have moved
+            // to an earlier bucket in the meantime.
+            frontier.swap(m_buckets[current]);
+            m_buckets[current].clear();
+            frontier.erase(
+                std::remove_if(frontier.begin(), frontier.end(), [&](Index v)
+                {
+                    return bucketOf(dist[v].load(std::memory_order_relaxed)) != current;
+                }),
+                frontier.end()
+            );
+            std::sort(frontier.begin(), frontier.end());
+            frontier.erase(std::unique(frontier.begin(), frontier.end()), frontier.end());
+
+            relax(frontier, true);
+            settled.insert(settled.end(), frontier.begin(), frontier.end());
+        }
+
+        // Heavy edges can't lead into the current bucket, so they only need
+        // to be relaxed once for all vertices settled in it.
+        std::sort(settled.begin(), settled.end());
+        settled.erase(std::unique(settled.begin(), settled.end()), settled.end());
+        relax(settled, false);
+    }
+
+    return toVertexMap([&](Index v)
+    {
+        return dist[v].load(std::memory_order_relaxed);
+    });
+}
+
+} // namespace lvr2
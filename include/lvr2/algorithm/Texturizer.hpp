@@ -36,6 +36,7 @@
 #ifndef LVR2_ALGORITHM_TEXTURIZER_H_
 #define LVR2_ALGORITHM_TEXTURIZER_H_
 
+#include <boost/optional.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/smart_ptr/make_shared.hpp>
 
@@ -47,6 +48,7 @@
 #include "lvr2/reconstruction/PointsetSurface.hpp"
 #include "lvr2/texture/ClusterTexCoordMapping.hpp"
 #include "lvr2/texture/Texture.hpp"
+#include "lvr2/texture/TextureAtlas.hpp"
 #include "lvr2/texture/Material.hpp"
 #include "lvr2/util/ClusterBiMap.hpp"
 
@@ -78,6 +80,16 @@ public:
         int texMaxClusterSize
     );
 
+    /**
+     * @brief Sets the number of points whose colors are blended for a texel
+     *
+     * The colors are weighted by their inverse squared distance to the texel. With
+     * the default of 1, each texel gets the color of the closest point.
+     *
+     * @param k The number of points
+     */
+    void setTexelNeighbours(int k);
+
     /**
      * @brief Get the texture to a given texture handle
      *
@@ -118,6 +130,21 @@ public:
             std::vector<cv::KeyPoint>&
             keypoints, cv::Mat& descriptors);
 
+    /**
+     * @brief Discover keypoints in a texture that has not been added yet
+     *
+     * @param[in] texture The texture
+     * @param[in] boundingRect Bounding rectangle computed for the texture
+     * @param[in] detector Feature detector to use (any of @c cv::Feature2D)
+     * @param[out] keypoints Vector of keypoints
+     * @param[out] descriptors Matrix of descriptors for the keypoint
+     */
+    void findKeyPointsInTexture(const Texture& texture,
+            const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect,
+            const cv::Ptr<cv::Feature2D>& detector,
+            std::vector<cv::KeyPoint>&
+            keypoints, cv::Mat& descriptors) const;
+
     /**
      * @brief Compute 3D coordinates for texture-relative keypoints
      *
@@ -129,6 +156,18 @@ public:
     std::vector<BaseVecT> keypoints23d(const std::vector<cv::KeyPoint>&
         keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const TextureHandle& h);
 
+    /**
+     * @brief Compute 3D coordinates for keypoints of a texture that has not been added yet
+     *
+     * @param[in] keypoints Keypoints in image coordinates
+     * @param[in] boundingRect Bounding rectangle of the texture embedded in 3D
+     * @param[in] texture The texture
+     *
+     * @return Vector of 3D coordinates of all keypoints
+     */
+    std::vector<BaseVecT> keypoints23d(const std::vector<cv::KeyPoint>&
+        keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const Texture& texture) const;
+
     /**
      * @brief Generates a texture for a given bounding rectangle
      *
@@ -142,12 +181,70 @@ public:
      *
      * @return Texture handle of the generated texture
      */
-    virtual TextureHandle generateTexture(
+    TextureHandle generateTexture(
         int index,
         const PointsetSurface<BaseVecT>& surface,
         const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
     );
 
+    /**
+     * @brief Computes the texture for a given bounding rectangle without adding it
+     *
+     * Same as `generateTexture()`, but the texture is returned instead of being stored
+     * in this texturizer. Subclasses override this method to change how texels are
+     * colored. It may be called for several clusters in parallel, so implementations
+     * must not modify shared state without synchronization.
+     *
+     * @param index The index the texture will get
+     * @param surface The point cloud
+     * @param boundingRect The bounding rectangle of the cluster
+     *
+     * @return The generated texture
+     */
+    virtual Texture createTexture(
+        int index,
+        const PointsetSurface<BaseVecT>& surface,
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+    );
+
+    /**
+     * @brief Stores a texture in this texturizer
+     *
+     * If an atlas is used, the texture is packed into one of its pages instead.
+     *
+     * @param texture The texture, e.g. created by `createTexture()`
+     * @param region If an atlas is used, receives the placement of the texture in its page
+     *
+     * @return Texture handle of the added texture, or of the page containing it
+     */
+    TextureHandle addTexture(Texture&& texture, AtlasRegion* region = nullptr);
+
+    /**
+     * @brief Packs all textures added from now on into the pages of an atlas
+     *
+     * Instead of one texture per cluster, the texturizer then stores one texture per
+     * finished page and the handles returned by `addTexture()` refer to these pages.
+     * Texture coordinates are still calculated relative to the cluster textures, they
+     * have to be converted with the region returned by `addTexture()`. The atlas should
+     * be set before any texture is added.
+     *
+     * @param atlas The atlas
+     * @param streamPages Write each page to disk as soon as it is finished, instead of
+     *                    waiting for `saveTextures()`. The texel data of a written page
+     *                    is released, so its texture only describes the page file.
+     */
+    void setAtlas(TextureAtlas& atlas, bool streamPages = true);
+
+    /**
+     * @brief Returns true if textures are packed into an atlas
+     */
+    bool hasAtlas() const;
+
+    /**
+     * @brief Finishes all pages of the atlas and stores them, if an atlas is used
+     */
+    void finishTextures();
+
     /**
      * @brief Calculate texture coordinates for a given 3D point in a texture
      *
@@ -163,6 +260,21 @@ public:
         BaseVecT v
     );
 
+    /**
+     * @brief Calculate texture coordinates for a given 3D point in a texture that has not been added yet
+     *
+     * @param texture The texture
+     * @param boundingRect The bounding rectangle of the texture
+     * @param v The 3D point
+     *
+     * @return The texture coordinates
+     */
+    TexCoords calculateTexCoords(
+        const Texture& texture,
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect,
+        BaseVecT v
+    ) const;
+
     /**
      * @brief Calculate a global 3D position for given texture coordinates
      *
@@ -176,7 +288,7 @@ public:
         TextureHandle texH,
         const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect,
         const TexCoords& coords
-    );
+    ) const;
 
     /**
      * @brief Calls the save method for each texture
@@ -195,6 +307,23 @@ protected:
     /// StableVector, that contains all generated textures with texture handles
     StableVector<TextureHandle, Texture> m_textures;
 
+    /// Atlas the textures are packed into, if any
+    boost::optional<TextureAtlas&> m_atlas;
+
+    /// Whether finished atlas pages are written to disk right away
+    bool m_streamPages;
+
+    /// Index of the handle of the first atlas page
+    Index m_firstPage;
+
+    /// Number of points blended for each texel
+    int m_texelNeighbours;
+
+private:
+
+    /// Moves the finished pages of the atlas into m_textures, written pages without texels
+    void storeFinishedPages();
+
 };
 
 
@@ -37,6 +37,8 @@
 #include "lvr2/io/Timestamp.hpp"
 #include "lvr2/algorithm/ColorAlgorithms.hpp"
 
+#include <algorithm>
+
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -52,8 +54,17 @@ Texturizer<BaseVecT>::Texturizer(
 ) :
     m_texelSize(texelSize),
     m_texMinClusterSize(texMinClusterSize),
-    m_texMaxClusterSize(texMaxClusterSize)
+    m_texMaxClusterSize(texMaxClusterSize),
+    m_streamPages(false),
+    m_firstPage(0),
+    m_texelNeighbours(1)
+{
+}
+
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::setTexelNeighbours(int k)
 {
+    m_texelNeighbours = std::max(k, 1);
 }
 
 
@@ -76,9 +87,61 @@ int Texturizer<BaseVecT>::getTextureIndex(TextureHandle h)
     return m_textures[h].m_index;
 }
 
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::setAtlas(TextureAtlas& atlas, bool streamPages)
+{
+    m_atlas = atlas;
+    m_streamPages = streamPages;
+    m_firstPage = m_textures.nextHandle().idx();
+}
+
+template<typename BaseVecT>
+bool Texturizer<BaseVecT>::hasAtlas() const
+{
+    return static_cast<bool>(m_atlas);
+}
+
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::finishTextures()
+{
+    if (m_atlas)
+    {
+        m_atlas.get().finish();
+        storeFinishedPages();
+    }
+}
+
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::storeFinishedPages()
+{
+    Texture page;
+    while (m_atlas.get().takeFinishedPage(page))
+    {
+        // The file name of a texture is derived from its index, which has
+        // to match the handle
+        page.m_index = m_textures.nextHandle().idx();
+        if (m_streamPages)
+        {
+            // Only the dimensions of a written page are kept, its texels
+            // would otherwise stay in memory until the program ends
+            page.save();
+            delete[] page.m_data;
+            page.m_data = nullptr;
+        }
+        m_textures.push(std::move(page));
+    }
+}
+
 template<typename BaseVecT>
 void Texturizer<BaseVecT>::saveTextures()
 {
+    finishTextures();
+    if (m_atlas && m_streamPages)
+    {
+        // All pages were written as soon as they were finished
+        return;
+    }
+
     string comment = timestamp.getElapsedTime() + "Saving textures ";
     ProgressBar progress(m_textures.numUsed(), comment);
     for (auto h : m_textures)
@@ -96,10 +159,19 @@ TexCoords Texturizer<BaseVecT>::calculateTexCoords(
     BaseVecT point
 )
 {
-    //return m_textures[h].calcTexCoords(boundingRect, v);
-    auto texelSize = m_textures[h].m_texelSize;
-    auto width = m_textures[h].m_width;
-    auto height = m_textures[h].m_height;
+    return calculateTexCoords(m_textures[h], br, point);
+}
+
+template<typename BaseVecT>
+TexCoords Texturizer<BaseVecT>::calculateTexCoords(
+    const Texture& texture,
+    const BoundingRectangle<typename BaseVecT::CoordType>& br,
+    BaseVecT point
+) const
+{
+    auto texelSize = texture.m_texelSize;
+    auto width = texture.m_width;
+    auto height = texture.m_height;
 
     BaseVecT w =  point - ((br.m_vec1 * br.m_minDistA) + (br.m_vec2 * br.m_minDistB)
             + br.m_supportVector);
@@ -114,7 +186,7 @@ BaseVecT Texturizer<BaseVecT>::calculateTexCoordsInv(
     TextureHandle h,
     const BoundingRectangle<typename BaseVecT::CoordType>& br,
     const TexCoords& coords
-)
+) const
 {
     return br.m_supportVector + (br.m_vec1 * br.m_minDistA)
                               + br.m_vec1 * coords.u
@@ -131,70 +203,131 @@ TextureHandle Texturizer<BaseVecT>::generateTexture(
     const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
 )
 {
-    cout << "Wrong" << endl;
+    return addTexture(createTexture(index, surface, boundingRect));
+}
+
+template<typename BaseVecT>
+TextureHandle Texturizer<BaseVecT>::addTexture(Texture&& texture, AtlasRegion* region)
+{
+    if (!m_atlas)
+    {
+        return m_textures.push(std::move(texture));
+    }
+
+    AtlasRegion placed = m_atlas.get().insert(texture);
+    if (region)
+    {
+        *region = placed;
+    }
+    storeFinishedPages();
+
+    // Pages are finished in the order of their index, so the handle of a
+    // page is known before it is stored
+    return TextureHandle(m_firstPage + placed.page);
+}
+
+template<typename BaseVecT>
+Texture Texturizer<BaseVecT>::createTexture(
+    int index,
+    const PointsetSurface<BaseVecT>& surface,
+    const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect
+)
+{
     // Calculate the texture size
     unsigned short int sizeX = ceil((boundingRect.m_maxDistA - boundingRect.m_minDistA) / m_texelSize);
     unsigned short int sizeY = ceil((boundingRect.m_maxDistB - boundingRect.m_minDistB) / m_texelSize);
 
     // Create texture
     Texture texture(index, sizeX, sizeY, 3, 1, m_texelSize);
+    const size_t numTexels = static_cast<size_t>(sizeX) * sizeY;
 
-    string comment = timestamp.getElapsedTime() + "Computing texture pixels ";
-    ProgressBar progress(sizeX * sizeY, comment);
-
-    if (surface.pointBuffer()->hasColors())
+    if (surface.pointBuffer()->hasColors() && numTexels > 0)
     {
-        UCharChannel colors = *(surface.pointBuffer()->getUCharChannel("colors"));
+        using CoordT = typename BaseVecT::CoordType;
 
-        // For each texel find the color of the nearest point
-        #pragma omp parallel for schedule(dynamic,1) collapse(2)
-        for (int y = 0; y < sizeY; y++)
+        UCharChannel colors = *(surface.pointBuffer()->getUCharChannel("colors"));
+        const unsigned char* colorData = colors.dataPtr().get();
+        const size_t colorWidth = colors.width();
+        const size_t numPoints = colors.numElements();
+        auto searchTree = surface.searchTree();
+
+        const int k = m_texelNeighbours;
+        const size_t blockSize = 1024;
+        const long numBlocks = (numTexels + blockSize - 1) / blockSize;
+
+        // Keeps the weight of points that lie exactly on a texel finite
+        const float eps = 1e-6f * m_texelSize * m_texelSize;
+
+        // The texels are colored in blocks. The neighbours of all texels of a
+        // block are searched at once and their colors are blended with inverse
+        // squared distance weights.
+        #pragma omp parallel
         {
-            for (int x = 0; x < sizeX; x++)
-            {
-                int k = 1; // k-nearest-neighbors
+            vector<BaseVecT> positions(blockSize);
+            vector<size_t> indices(blockSize * k);
+            vector<CoordT> distances(blockSize * k);
+            vector<float> sums(blockSize * 4);
 
-                vector<size_t> cv;
+            #pragma omp for schedule(dynamic)
+            for (long block = 0; block < numBlocks; block++)
+            {
+                const size_t first = block * blockSize;
+                const int count = std::min(blockSize, numTexels - first);
 
-                BaseVecT currentPos =
-                    boundingRect.m_supportVector
-                    + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0)
-                    + boundingRect.m_vec2 * (y * m_texelSize + boundingRect.m_minDistB - m_texelSize / 2.0);
+                for (int i = 0; i < count; i++)
+                {
+                    const int x = (first + i) % sizeX;
+                    const int y = (first + i) / sizeX;
+                    positions[i] =
+                        boundingRect.m_supportVector
+                        + boundingRect.m_vec1 * (x * m_texelSize + boundingRect.m_minDistA - m_texelSize / 2.0)
+                        + boundingRect.m_vec2 * (y * m_texelSize + boundingRect.m_minDistB - m_texelSize / 2.0);
+                }
 
-                surface.searchTree()->kSearch(currentPos, k, cv);
+                searchTree->kSearchMany(positions.data(), count, k, indices.data(), distances.data());
 
-                uint8_t r = 0, g = 0, b = 0;
+                float* r = sums.data();
+                float* g = r + blockSize;
+                float* b = g + blockSize;
+                float* w = b + blockSize;
+                std::fill(sums.begin(), sums.end(), 0.0f);
 
-                for (size_t pointIdx : cv)
+                for (int j = 0; j < k; j++)
                 {
-                    auto cur_color = colors[pointIdx];
-                    r += cur_color[0];
-                    g += cur_color[1];
-                    b += cur_color[2];
+                    #pragma omp simd
+                    for (int i = 0; i < count; i++)
+                    {
+                        const size_t idx = indices[i * k + j];
+                        const bool valid = idx < numPoints;
+                        const unsigned char* color = colorData + (valid ? idx : 0) * colorWidth;
+                        const float weight = valid ? 1.0f / (distances[i * k + j] + eps) : 0.0f;
+                        r[i] += weight * color[0];
+                        g[i] += weight * color[1];
+                        b[i] += weight * color[2];
+                        w[i] += weight;
+                    }
                 }
 
-                r /= k;
-                g /= k;
-                b /= k;
-
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 0] = r;
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 1] = g;
-                texture.m_data[(sizeY - y - 1) * (sizeX * 3) + 3 * x + 2] = b;
-
-                ++progress;
+                for (int i = 0; i < count; i++)
+                {
+                    const int x = (first + i) % sizeX;
+                    const int y = (first + i) / sizeX;
+                    const float norm = w[i] > 0.0f ? 1.0f / w[i] : 0.0f;
+
+                    unsigned char* texel = texture.m_data + ((sizeY - y - 1) * sizeX + x) * 3;
+                    texel[0] = static_cast<unsigned char>(r[i] * norm + 0.5f);
+                    texel[1] = static_cast<unsigned char>(g[i] * norm + 0.5f);
+                    texel[2] = static_cast<unsigned char>(b[i] * norm + 0.5f);
+                }
             }
         }
-        std::cout << std::endl;
     }
     else
     {
-        for (int i = 0; i < sizeX * sizeY; i++)
-        {
-            texture.m_data[i] = 0;
-        }
+        std::fill(texture.m_data, texture.m_data + numTexels * 3, 0);
     }
 
-    return m_textures.push(texture);
+    return texture;
 }
 
 
@@ -204,7 +337,15 @@ void Texturizer<BaseVecT>::findKeyPointsInTexture(const TextureHandle texH,
         const cv::Ptr<cv::Feature2D>& detector,
         std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors)
 {
-    const Texture texture = m_textures[texH];
+    findKeyPointsInTexture(m_textures[texH], boundingRect, detector, keypoints, descriptors);
+}
+
+template<typename BaseVecT>
+void Texturizer<BaseVecT>::findKeyPointsInTexture(const Texture& texture,
+        const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect,
+        const cv::Ptr<cv::Feature2D>& detector,
+        std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const
+{
     if (texture.m_height <= 32 && texture.m_width <= 32)
     {
         return;
@@ -219,11 +360,18 @@ void Texturizer<BaseVecT>::findKeyPointsInTexture(const TextureHandle texH,
 template<typename BaseVecT>
 std::vector<BaseVecT> Texturizer<BaseVecT>::keypoints23d(const std::vector<cv::KeyPoint>&
         keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const TextureHandle& h)
+{
+    return keypoints23d(keypoints, boundingRect, m_textures[h]);
+}
+
+template<typename BaseVecT>
+std::vector<BaseVecT> Texturizer<BaseVecT>::keypoints23d(const std::vector<cv::KeyPoint>&
+        keypoints, const BoundingRectangle<typename BaseVecT::CoordType>& boundingRect, const Texture& texture) const
 {
     const size_t N = keypoints.size();
     std::vector<BaseVecT> keypoints3d(N);
-    const int width            = m_textures[h].m_width;
-    const int height           = m_textures[h].m_height;
+    const int width            = texture.m_width;
+    const int height           = texture.m_height;
 
     for (size_t p_idx = 0; p_idx < N; ++p_idx)
     {
@@ -234,7 +382,7 @@ std::vector<BaseVecT> Texturizer<BaseVecT>::keypoints23d(const std::vector<cv::K
         // I'm not sure why we need to mirror this coordinate, but it works like
         // this
         const float v      = 1 - keypoint.y / height;
-        BaseVecT location  = calculateTexCoordsInv(h, boundingRect, TexCoords(u, v));
+        BaseVecT location  = calculateTexCoordsInv(TextureHandle(texture.m_index), boundingRect, TexCoords(u, v));
         keypoints3d[p_idx] = location;
     }
     return keypoints3d;
@@ -39,6 +39,7 @@
 
 
 #include "lvr2/io/MeshBuffer.hpp"
+#include "lvr2/io/Timestamp.hpp"
 #include "lvr2/geometry/BaseVector.hpp"
 #include "lvr2/geometry/BVH.hpp"
 #include "lvr2/algorithm/raycasting/RaycasterBase.hpp"
@@ -47,21 +48,35 @@
 #define PI 3.14159265
 #define BVH_STACK_SIZE 128
 
+// Number of children of a node in the wide BVH used for CPU traversal
+#ifndef BVH_NODE_WIDTH
+#define BVH_NODE_WIDTH 4
+#endif
+
 namespace lvr2
 {
 
 
 
 /**
- *  @brief BVHRaycaster: CPU version of BVH Raycasting: WIP
+ *  @brief BVHRaycaster: CPU version of BVH Raycasting.
+ *
+ *  The binary BVH is collapsed into a wide BVH with BVH_NODE_WIDTH children
+ *  per node (4 by default, 8 is a good choice for AVX builds). Rays are
+ *  traced one by one or in packets of 4, 8 or 16 rays.
  */
 template<typename PointT, typename NormalT>
 class BVHRaycaster : public RaycasterBase<PointT, NormalT > {
 public:
     /**
      * @brief Constructor: Stores mesh as member
+     *
+     * @param mesh      The mesh to cast rays against
+     * @param method    Algorithm used to build the BVH
      */
-    BVHRaycaster(const MeshBufferPtr mesh);
+    BVHRaycaster(
+        const MeshBufferPtr mesh,
+        typename BVHTree<PointT>::BuildMethod method = BVHTree<PointT>::BINNED_SAH);
 
     bool castRay(
         const PointT& origin,
@@ -83,6 +98,29 @@ public:
         std::vector<uint8_t>& hits
     );
 
+    void castRaysWithFaceIds(
+        const PointT& origin,
+        const std::vector<NormalT >& directions,
+        std::vector<PointT >& intersections,
+        std::vector<unsigned int>& faceIds,
+        std::vector<uint8_t>& hits
+    );
+
+    /**
+     * @brief Sets the number of rays that are traced together. Packets
+     *        share one traversal stack and are tested against the
+     *        scene with vectorized loops, which pays off for coherent
+     *        rays like those of a simulated scanner.
+     *
+     * @param size  1 (single ray traversal), 4, 8 or 16
+     */
+    void setPacketSize(size_t size);
+
+    /**
+     * @brief Returns the number of rays that are traced together
+     */
+    size_t packetSize() const { return m_packetSize; }
+
 
     /**
      * @struct Ray
@@ -113,128 +151,110 @@ protected:
 
 private:
 
-
     /**
-     * @brief Calculates the squared distance of two vectors
-     * @param a First vector
-     * @param b Second vector
-     * @return The square distance
+     * @brief Node of the wide BVH that is traversed on the CPU. The bounds
+     *        of all children are stored component-wise, so that one ray
+     *        (or one packet of rays) can be tested against all of them in
+     *        a single vectorized loop.
      */
-    inline float distanceSquare(const PointT& a, const PointT& b) const
+    struct WideNode
     {
-        return fabs((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
-    }
+        /// Child bounds in the order min x, max x, min y, max y, min z, max z
+        float       bounds[6][BVH_NODE_WIDTH];
+
+        /// Index of the child node or of the first triangle of a leaf
+        uint32_t    child[BVH_NODE_WIDTH];
+
+        /// Number of triangles of a leaf, 0 for inner nodes
+        uint32_t    count[BVH_NODE_WIDTH];
+    };
 
     /**
-     * @brief Calculates whether a ray intersects a box
-     * @param origin    The origin of the ray
-     * @param ray       The ray
-     * @param boxPtr    A pointer to the box data
-     * @return          A boolean indicating whether the ray hits the box
+     * @brief Entry of the traversal stack
      */
-    bool rayIntersectsBox(PointT origin, Ray ray, const float* boxPtr);
+    struct StackEntry
+    {
+        uint32_t    child;
+        uint32_t    count;
+        float       tnear;
+    };
 
     /**
-     * @brief Calculates the closest intersection of a raycast into a scene of triangles, given a bounding volume hierarchy
+     * @brief Collapses the binary BVH below the given node into a wide node
      *
-     * @param clBVHindicesOrTriLists        Compressed BVH Node data, that stores for each node, whether it is a leaf node
-     *                                      and triangle indices lists for leaf nodes and the indices of their child nodes
-     *                                      for inner nodes
-     * @param origin                        Origin of the ray
-     * @param ray                           Direction of the ray
-     * @param clBVHlimits                   3d upper and lower limits for each bounding box in the BVH
-     * @param clTriangleIntersectionData    Precomputed intersection data for each triangle
-     * @param clTriIdxList                  List of triangle indices
-     * @return The TriangleIntersectionResult, containing information about the triangle intersection
+     * @param binaryNode    Index of the node in the cache friendly binary BVH
+     * @param depth         Depth of the new wide node
+     * @return              Index of the new node in m_wideNodes
      */
-    TriangleIntersectionResult intersectTrianglesBVH(
-        const unsigned int* clBVHindicesOrTriLists,
-        PointT origin,
-        Ray ray,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList
-    );
+    uint32_t collapseNode(uint32_t binaryNode, uint32_t depth);
 
     /**
-     * @brief Casts one ray from one origin into a scene of triangles, given a bounding volume hierarchy
+     * @brief Traces a single ray through the wide BVH. The boxes of all
+     *        children of a node are tested at once.
      *
-     * @param rays_origin                   Origins of the rays
-     * @param rays                          Forward directions of each pose
-     * @param clBVHindicesOrTriLists        Compressed BVH Node data, that stores for each node, whether it is a leaf node
-     *                                      and triangle indices lists for leaf nodes and the indices of their child nodes
-     *                                      for inner nodes
-     * @param clBVHlimits                   3d upper and lower limits for each bounding box in the BVH
-     * @param clTriangleIntersectionData    Precomputed intersection data for each triangle
-     * @param clTriIdxList                  List of triangle indices
-     * @param result                        Result point positions
-     * @param result_hits                   Result hits, where for each ray is stored whether it has hit a triangle
+     * @param origin    Origin of the ray
+     * @param dir       Direction of the ray
+     * @param stack     Traversal stack with m_stackSize entries
+     * @param hit       Intersection point, if any
+     * @param face      Index of the hit face, if any
+     * @return          True if a triangle was hit
      */
-    void cast_rays_one_one(
-        const float* ray_origin,
-        const float* rays,
-        const unsigned int* clBVHindicesOrTriLists,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList,
-        float* result,
-        uint8_t* result_hits
-    );
+    bool traceRay(
+        const float* origin,
+        const float* dir,
+        StackEntry* stack,
+        float* hit,
+        uint32_t& face
+    ) const;
 
     /**
-     * @brief Casts multiple rays from one origin into a scene of triangles, given a bounding volume hierarchy
+     * @brief Traces a packet of rays that share one traversal stack. A node
+     *        is visited if any ray of the packet hits its box.
      *
-     * @param rays_origin                   Origins of the rays
-     * @param rays                          Forward directions of each pose
-     * @param clBVHindicesOrTriLists        Compressed BVH Node data, that stores for each node, whether it is a leaf node
-     *                                      and triangle indices lists for leaf nodes and the indices of their child nodes
-     *                                      for inner nodes
-     * @param clBVHlimits                   3d upper and lower limits for each bounding box in the BVH
-     * @param clTriangleIntersectionData    Precomputed intersection data for each triangle
-     * @param clTriIdxList                  List of triangle indices
-     * @param result                        Result point positions
-     * @param result_hits                   Result hits, where for each ray is stored whether it has hit a triangle
+     * @param origins       Origins of the rays (3 floats each)
+     * @param originStride  Number of floats between two origins (0 if all rays
+     *                      share one origin, 3 otherwise)
+     * @param dirs          Directions of the rays (3 floats each)
+     * @param num           Number of rays in this packet (<= P)
+     * @param stack         Traversal stack with m_stackSize entries
+     * @param hits          Intersection points
+     * @param hitFlags      Hit flags
+     * @param faceIds       Indices of the hit faces, may be nullptr
      */
-
-    void cast_rays_one_multi(
-        const float* ray_origin,
-        const float* rays,
-        size_t num_rays,
-        const unsigned int* clBVHindicesOrTriLists,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList,
-        float* result,
-        uint8_t* result_hits
-    );
+    template<int P>
+    void tracePacket(
+        const float* origins,
+        size_t originStride,
+        const float* dirs,
+        size_t num,
+        StackEntry* stack,
+        float* hits,
+        uint8_t* hitFlags,
+        unsigned int* faceIds
+    ) const;
 
     /**
-     * @brief Casts multiple rays from multiple origins into a scene of triangles, given a bounding volume hierarchy
-     *
-     * @param rays_origin                   Origins of the rays
-     * @param rays                          Forward directions of each pose
-     * @param clBVHindicesOrTriLists        Compressed BVH Node data, that stores for each node, whether it is a leaf node
-     *                                      and triangle indices lists for leaf nodes and the indices of their child nodes
-     *                                      for inner nodes
-     * @param clBVHlimits                   3d upper and lower limits for each bounding box in the BVH
-     * @param clTriangleIntersectionData    Precomputed intersection data for each triangle
-     * @param clTriIdxList                  List of triangle indices
-     * @param result                        Result point positions
-     * @param result_hits                   Result hits, where for each ray is stored whether it has hit a triangle
+     * @brief Casts rays in parallel using the configured packet size.
+     *        Face ids are only reported if result_faces is not nullptr.
      */
-    void cast_rays_multi_multi(
-        const float* ray_origin,
-        const float* rays,
+    void castRaysWide(
+        const float* origins,
+        size_t originStride,
+        const float* dirs,
         size_t num_rays,
-        const unsigned int* clBVHindicesOrTriLists,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList,
         float* result,
-        uint8_t* result_hits
-    );
+        uint8_t* result_hits,
+        unsigned int* result_faces = nullptr
+    ) const;
+
+    /// Wide BVH built from the binary BVH
+    std::vector<WideNode>   m_wideNodes;
 
+    /// Traversal stack size required by the wide BVH
+    size_t                  m_stackSize;
 
+    /// Number of rays that are traced together
+    size_t                  m_packetSize;
 };
 
 } // namespace lvr2
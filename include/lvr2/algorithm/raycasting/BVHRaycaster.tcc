@@ -25,15 +25,37 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <limits>
+
 namespace lvr2 
 {
 
 template <typename PointT, typename NormalT>
-BVHRaycaster<PointT, NormalT>::BVHRaycaster(const MeshBufferPtr mesh)
+BVHRaycaster<PointT, NormalT>::BVHRaycaster(
+    const MeshBufferPtr mesh,
+    typename BVHTree<PointT>::BuildMethod method)
 :RaycasterBase<PointT, NormalT>(mesh)
-,m_bvh(mesh)
+,m_bvh(mesh, method)
+,m_stackSize(BVH_NODE_WIDTH)
+,m_packetSize(1)
 {
-    
+    if(!m_bvh.getIndexesOrTrilists().empty())
+    {
+        collapseNode(0, 1);
+    }
+}
+
+template <typename PointT, typename NormalT>
+void BVHRaycaster<PointT, NormalT>::setPacketSize(size_t size)
+{
+    if(size != 1 && size != 4 && size != 8 && size != 16)
+    {
+        std::cout << timestamp << "BVHRaycaster: Unsupported packet size " << size
+                  << ", using single ray traversal." << std::endl;
+        size = 1;
+    }
+    m_packetSize = size;
 }
 
 template <typename PointT, typename NormalT>
@@ -44,27 +66,17 @@ bool BVHRaycaster<PointT, NormalT>::castRay(
 )
 {
     // Cast one ray from one origin
-    std::vector<uint8_t> tmp(1);
+    std::vector<StackEntry> stack(m_stackSize);
+    float hit[3] = {0.0f, 0.0f, 0.0f};
+    const float origin_f[3] = {origin.x, origin.y, origin.z};
+    const float direction_f[3] = {direction.x, direction.y, direction.z};
 
-    const float *origin_f = reinterpret_cast<const float*>(&origin.x);
-    const float *direction_f = reinterpret_cast<const float*>(&direction.x);
-    const unsigned int* clBVHindicesOrTriLists = m_bvh.getIndexesOrTrilists().data();
-    const float* clBVHlimits = m_bvh.getLimits().data();
-    const float* clTriangleIntersectionData = m_bvh.getTrianglesIntersectionData().data();
-    const unsigned int* clTriIdxList = m_bvh.getTriIndexList().data();
-    float* result = reinterpret_cast<float*>(&intersection.x);
-    uint8_t* result_hits = tmp.data();
-
-    cast_rays_one_one(origin_f, 
-        direction_f, 
-        clBVHindicesOrTriLists,
-        clBVHlimits,
-        clTriangleIntersectionData,
-        clTriIdxList,
-        result,
-        result_hits);
-
-    bool success = tmp[0];
+    uint32_t face;
+    bool success = traceRay(origin_f, direction_f, stack.data(), hit, face);
+
+    intersection.x = hit[0];
+    intersection.y = hit[1];
+    intersection.z = hit[2];
 
     return success;
 }
@@ -77,32 +89,15 @@ void BVHRaycaster<PointT, NormalT>::castRays(
     std::vector<uint8_t>& hits
 )
 {
+    // Cast multiple rays from one origin
     intersections.resize(directions.size());
     hits.resize(directions.size());
 
-
     const float *origin_f = reinterpret_cast<const float*>(&origin.x);
     const float *direction_f = reinterpret_cast<const float*>(directions.data());
-    const unsigned int* clBVHindicesOrTriLists = m_bvh.getIndexesOrTrilists().data();
-    const float* clBVHlimits = m_bvh.getLimits().data();
-    const float* clTriangleIntersectionData = m_bvh.getTrianglesIntersectionData().data();
-    const unsigned int* clTriIdxList = m_bvh.getTriIndexList().data();
     float* result = reinterpret_cast<float*>(intersections.data());
-    uint8_t* result_hits = hits.data();
-
-    size_t num_rays = directions.size();
 
-    cast_rays_one_multi(origin_f, 
-        direction_f, 
-        num_rays,
-        clBVHindicesOrTriLists,
-        clBVHlimits,
-        clTriangleIntersectionData,
-        clTriIdxList,
-        result,
-        result_hits);
-
-    // Cast multiple rays from one origin
+    castRaysWide(origin_f, 0, direction_f, directions.size(), result, hits.data());
 }
 
 template <typename PointT, typename NormalT>
@@ -113,380 +108,468 @@ void BVHRaycaster<PointT, NormalT>::castRays(
     std::vector<uint8_t>& hits
 )
 {
+    // Cast multiple rays from multiple origins
     intersections.resize(directions.size());
     hits.resize(directions.size());
 
     const float *origin_f = reinterpret_cast<const float*>(origins.data());
     const float *direction_f = reinterpret_cast<const float*>(directions.data());
-    const unsigned int* clBVHindicesOrTriLists = m_bvh.getIndexesOrTrilists().data();
-    const float* clBVHlimits = m_bvh.getLimits().data();
-    const float* clTriangleIntersectionData = m_bvh.getTrianglesIntersectionData().data();
-    const unsigned int* clTriIdxList = m_bvh.getTriIndexList().data();
     float* result = reinterpret_cast<float*>(intersections.data());
-    uint8_t* result_hits = hits.data();
 
-    size_t num_rays = directions.size();
+    castRaysWide(origin_f, 3, direction_f, directions.size(), result, hits.data());
+}
 
-    cast_rays_multi_multi(origin_f, 
-        direction_f, 
-        num_rays,
-        clBVHindicesOrTriLists,
-        clBVHlimits,
-        clTriangleIntersectionData,
-        clTriIdxList,
-        result,
-        result_hits);
+template <typename PointT, typename NormalT>
+void BVHRaycaster<PointT, NormalT>::castRaysWithFaceIds(
+    const PointT& origin,
+    const std::vector<NormalT >& directions,
+    std::vector<PointT >& intersections,
+    std::vector<unsigned int>& faceIds,
+    std::vector<uint8_t>& hits
+)
+{
+    intersections.resize(directions.size());
+    faceIds.resize(directions.size());
+    hits.resize(directions.size());
 
+    const float *origin_f = reinterpret_cast<const float*>(&origin.x);
+    const float *direction_f = reinterpret_cast<const float*>(directions.data());
+    float* result = reinterpret_cast<float*>(intersections.data());
+
+    castRaysWide(origin_f, 0, direction_f, directions.size(), result, hits.data(), faceIds.data());
 }
 
 
 // PRIVATE FUNCTIONS
 template <typename PointT, typename NormalT>
-bool BVHRaycaster<PointT, NormalT>::rayIntersectsBox(
-    PointT origin,
-    Ray ray,
-    const float* boxPtr)
+uint32_t BVHRaycaster<PointT, NormalT>::collapseNode(uint32_t binaryNode, uint32_t depth)
 {
-    const float* limitsX2 = boxPtr;
-    const float* limitsY2 = boxPtr+2;
-    const float* limitsZ2 = boxPtr+4;
-
-    float tmin, tmax, tymin, tymax, tzmin, tzmax;
+    const std::vector<uint32_t>& nodes = m_bvh.getIndexesOrTrilists();
+    const std::vector<float>& limits = m_bvh.getLimits();
 
-    tmin =  (limitsX2[    ray.rayDirSign.x] - origin.x) * ray.invDir.x;
-    tmax =  (limitsX2[1 - ray.rayDirSign.x] - origin.x) * ray.invDir.x;
-    tymin = (limitsY2[    ray.rayDirSign.y] - origin.y) * ray.invDir.y;
-    tymax = (limitsY2[1 - ray.rayDirSign.y] - origin.y) * ray.invDir.y;
-
-    // std::cout << "Statisics: " << std::endl;
-    // std::cout << tmin << std::endl;
-    // std::cout << tmax << std::endl;
-    // std::cout << tymin << std::endl;
-    // std::cout << tymax << std::endl;
-    // std::cout << std::endl;
-
-    if ((tmin > tymax) || (tymin > tmax))
+    auto isLeaf = [&](uint32_t n) { return (nodes[4 * n] & 0x80000000) != 0; };
+    auto area = [&](uint32_t n)
     {
-        return false;
-    }
-    if (tymin >tmin)
+        const float* l = &limits[6 * n];
+        float dx = l[1] - l[0];
+        float dy = l[3] - l[2];
+        float dz = l[5] - l[4];
+        return dx * dy + dy * dz + dz * dx;
+    };
+
+    // Gather the children of the new node: Starting with the children of
+    // the binary node, inner nodes with the largest surface area are
+    // replaced by their children until the node is full.
+    std::vector<uint32_t> slots;
+    if(isLeaf(binaryNode))
     {
-        tmin = tymin;
+        slots.push_back(binaryNode);
     }
-    if (tymax < tmax)
+    else
     {
-        tmax = tymax;
+        slots.push_back(nodes[4 * binaryNode + 1]);
+        slots.push_back(nodes[4 * binaryNode + 2]);
     }
 
-    tzmin = (limitsZ2[    ray.rayDirSign.z] - origin.z) * ray.invDir.z;
-    tzmax = (limitsZ2[1 - ray.rayDirSign.z] - origin.z) * ray.invDir.z;
-
-    if ((tmin > tzmax) || (tzmin > tmax))
+    while(slots.size() < BVH_NODE_WIDTH)
     {
-        return false;
+        int best = -1;
+        float bestArea = -1.0f;
+        for(size_t i = 0; i < slots.size(); i++)
+        {
+            if(!isLeaf(slots[i]) && area(slots[i]) > bestArea)
+            {
+                best = i;
+                bestArea = area(slots[i]);
+            }
+        }
+        if(best < 0)
+        {
+            break;
+        }
+        uint32_t n = slots[best];
+        slots[best] = nodes[4 * n + 1];
+        slots.push_back(nodes[4 * n + 2]);
     }
-    if (tzmin > tmin)
+
+    uint32_t index = m_wideNodes.size();
+    m_wideNodes.emplace_back();
+    m_stackSize = std::max<size_t>(m_stackSize, (BVH_NODE_WIDTH - 1) * depth + 1);
+
+    // Unused slots get empty bounds and are skipped during traversal
+    for(int c = 0; c < BVH_NODE_WIDTH; c++)
     {
-        tmin = tzmin;
+        for(int a = 0; a < 3; a++)
+        {
+            m_wideNodes[index].bounds[2 * a][c] = std::numeric_limits<float>::max();
+            m_wideNodes[index].bounds[2 * a + 1][c] = -std::numeric_limits<float>::max();
+        }
+        m_wideNodes[index].child[c] = 0;
+        m_wideNodes[index].count[c] = 0;
     }
-    if (tzmax < tmax)
+
+    int c = 0;
+    for(uint32_t n : slots)
     {
-        tmax = tzmax;
+        uint32_t child = 0;
+        uint32_t count = 0;
+        if(isLeaf(n))
+        {
+            count = nodes[4 * n] & 0x7fffffff;
+            child = nodes[4 * n + 3];
+            if(count == 0)
+            {
+                continue;
+            }
+        }
+        else
+        {
+            // m_wideNodes may be reallocated here
+            child = collapseNode(n, depth + 1);
+        }
+
+        WideNode& node = m_wideNodes[index];
+        for(int a = 0; a < 6; a++)
+        {
+            node.bounds[a][c] = limits[6 * n + a];
+        }
+        node.child[c] = child;
+        node.count[c] = count;
+        c++;
     }
 
-    return true;
+    return index;
 }
 
 template <typename PointT, typename NormalT>
-typename BVHRaycaster<PointT, NormalT>::TriangleIntersectionResult BVHRaycaster<PointT, NormalT>::intersectTrianglesBVH(
-    const unsigned int* clBVHindicesOrTriLists,
-    PointT origin,
-    Ray ray,
-    const float* clBVHlimits,
-    const float* clTriangleIntersectionData,
-    const unsigned int* clTriIdxList
-)
+bool BVHRaycaster<PointT, NormalT>::traceRay(
+    const float* origin,
+    const float* dir,
+    StackEntry* stack,
+    float* hit,
+    uint32_t& face
+) const
 {
+    const float* triData = m_bvh.getTrianglesIntersectionData().data();
+    const uint32_t* triIdxList = m_bvh.getTriIndexList().data();
 
-    int tid_scale = 4;
-    int bvh_limits_scale = 2;
+    const float ox = origin[0], oy = origin[1], oz = origin[2];
+    const float dx = dir[0], dy = dir[1], dz = dir[2];
+    const float ix = 1.0f / dx, iy = 1.0f / dy, iz = 1.0f / dz;
 
-    TriangleIntersectionResult result;
-    result.hit = false;
-    unsigned int pBestTriId = 0;
-    float bestTriDist = std::numeric_limits<float>::max();
+    // Precompute which bound is hit first on each axis
+    const int sx = ix < 0, sy = iy < 0, sz = iz < 0;
 
-    unsigned int stack[BVH_STACK_SIZE];
+    float bestT = std::numeric_limits<float>::max();
+    bool found = false;
+
+    if(m_wideNodes.empty())
+    {
+        return false;
+    }
 
     int stackId = 0;
-    stack[stackId++] = 0;
-    PointT hitpoint;
+    stack[stackId++] = {0, 0, 0.0f};
 
-    // while stack is not empty
     while (stackId)
     {
-        
-        unsigned int boxId = stack[stackId - 1];
-
-        stackId--;
+        StackEntry entry = stack[--stackId];
+        if(entry.tnear > bestT)
+        {
+            continue;
+        }
 
-        // the first bit of the data of a bvh node indicates whether it is a leaf node, by performing a bitwise and
-        // with 0x80000000 all other bits are set to zero and the value of that one bit can be checked
-        if (!(clBVHindicesOrTriLists[4 * boxId + 0] & 0x80000000)) // inner node
+        if(entry.count == 0)
         {
-            
-            // if ray intersects inner node, push indices of left and right child nodes on the stack
-            if (rayIntersectsBox(origin, ray, &clBVHlimits[bvh_limits_scale * 3 * boxId]))
+            // inner node: test the boxes of all children at once
+            const WideNode& node = m_wideNodes[entry.child];
+            float tnear[BVH_NODE_WIDTH];
+            float tfar[BVH_NODE_WIDTH];
+
+            #pragma omp simd
+            for(int c = 0; c < BVH_NODE_WIDTH; c++)
             {
-                stack[stackId++] = clBVHindicesOrTriLists[4 * boxId + 1];
-                stack[stackId++] = clBVHindicesOrTriLists[4 * boxId + 2];
+                float tx0 = (node.bounds[    sx][c] - ox) * ix;
+                float tx1 = (node.bounds[1 - sx][c] - ox) * ix;
+                float ty0 = (node.bounds[2 + sy][c] - oy) * iy;
+                float ty1 = (node.bounds[3 - sy][c] - oy) * iy;
+                float tz0 = (node.bounds[4 + sz][c] - oz) * iz;
+                float tz1 = (node.bounds[5 - sz][c] - oz) * iz;
+                tnear[c] = std::max(std::max(tx0, ty0), std::max(tz0, 0.0f));
+                tfar[c] = std::min(std::min(tx1, ty1), std::min(tz1, bestT));
+            }
 
-                // return if stack size is exceeded
-                if ( stackId > BVH_STACK_SIZE)
+            // push hit children, farthest first
+            int first = stackId;
+            for(int c = 0; c < BVH_NODE_WIDTH; c++)
+            {
+                if(tnear[c] <= tfar[c] && (node.count[c] || node.bounds[0][c] <= node.bounds[1][c]))
                 {
-                    printf("BVH stack size exceeded!\n");
-                    result.hit = 0;
-                    return result;
+                    StackEntry e = {node.child[c], node.count[c], tnear[c]};
+                    int j = stackId++;
+                    while(j > first && stack[j - 1].tnear < e.tnear)
+                    {
+                        stack[j] = stack[j - 1];
+                        j--;
+                    }
+                    stack[j] = e;
                 }
             }
         }
-        else // leaf node
+        else
         {
-            
-            // iterate over all triangles in this leaf node
-            for (
-                unsigned int i = clBVHindicesOrTriLists[4 * boxId + 3];
-                i < (clBVHindicesOrTriLists[4 * boxId + 3] + (clBVHindicesOrTriLists[4* boxId + 0] & 0x7fffffff));
-                i++
-            )
+            // leaf node: intersect all triangles
+            for(uint32_t i = entry.child; i < entry.child + entry.count; i++)
             {
-                unsigned int idx = clTriIdxList[i];
-                const float* normal = clTriangleIntersectionData + tid_scale * 4 * idx;
+                uint32_t idx = triIdxList[i];
+                const float* t = triData + 16 * idx;
 
-                float k = normal[0] * ray.dir[0] + normal[1] * ray.dir[1] + normal[2] * ray.dir[2];
+                float k = t[0] * dx + t[1] * dy + t[2] * dz;
                 if (k == 0.0f)
                 {
                     continue; // this triangle is parallel to the ray -> ignore it
                 }
-                float s = (normal[3] - (normal[0] * origin[0] + normal[1] * origin[1] + normal[2] * origin[2])  ) / k;
-                if (s <= 0.0f)
+                float s = (t[3] - (t[0] * ox + t[1] * oy + t[2] * oz)) / k;
+                if (s <= EPSILON || s >= bestT)
                 {
-                    continue; // this triangle is "behind" the origin
+                    continue; // behind the origin or farther than the best hit
                 }
-                if (s <= EPSILON)
-                {
-                    continue; // epsilon
-                }
-                PointT hit = ray.dir * s;
-                hit += origin;
 
-                // ray triangle intersection
                 // check if the intersection with the triangle's plane is inside the triangle
-                const float* ee1 = clTriangleIntersectionData + tid_scale * 4 * idx + tid_scale*1;
-                float kt1 = ee1[0] * hit[0] + ee1[1] * hit[1] + ee1[2] * hit[2] - ee1[3];
-                if (kt1 < 0.0f)
-                {
-                    continue;
-                }
-                const float* ee2 = clTriangleIntersectionData + tid_scale * 4 * idx + tid_scale * 2;
-                float kt2 = ee2[0] * hit[0] + ee2[1] * hit[1] + ee2[2] * hit[2] - ee2[3];
-                if (kt2 < 0.0f)
+                float hx = dx * s + ox;
+                float hy = dy * s + oy;
+                float hz = dz * s + oz;
+                if (t[4] * hx + t[5] * hy + t[6] * hz - t[7] < 0.0f
+                    || t[8] * hx + t[9] * hy + t[10] * hz - t[11] < 0.0f
+                    || t[12] * hx + t[13] * hy + t[14] * hz - t[15] < 0.0f)
                 {
                     continue;
                 }
-                const float* ee3 = clTriangleIntersectionData + tid_scale * 4 * idx + tid_scale * 3;
-                float kt3 = ee3[0] * hit[0] + ee3[1] * hit[1] + ee3[2] * hit[2] - ee3[3];
-                if (kt3 < 0.0f)
-                {
-                    continue;
-                }
-
-                // ray intersects triangle, "hit" is the coordinate of the intersection
-                {
-                    // check if this intersection closer than others
-                    // use quadratic distance for comparison to save some root calculations
-                    float hitZ = distanceSquare(origin, hit);
-                    if (hitZ < bestTriDist)
-                    {
-                        bestTriDist = hitZ;
-                        pBestTriId = idx;
-                        result.hit = true;
-                        hitpoint = hit;
-                    }
-                }
 
+                bestT = s;
+                face = idx;
+                hit[0] = hx;
+                hit[1] = hy;
+                hit[2] = hz;
+                found = true;
             }
         }
     }
 
-    result.pBestTriId = pBestTriId ;
-    result.pointHit = hitpoint;
-    result.hitDist = sqrt(bestTriDist);
-
-    return result;
+    if (found)
+    {
+        face = m_bvh.getFaceIndices()[face];
+    }
+    return found;
 }
 
 template <typename PointT, typename NormalT>
-void BVHRaycaster<PointT, NormalT>::cast_rays_one_one(
-        const float* ray_origin,
-        const float* rays,
-        const unsigned int* clBVHindicesOrTriLists,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList,
-        float* result,
-        uint8_t* result_hits
-    )
+template <int P>
+void BVHRaycaster<PointT, NormalT>::tracePacket(
+    const float* origins,
+    size_t originStride,
+    const float* dirs,
+    size_t num,
+    StackEntry* stack,
+    float* hits,
+    uint8_t* hitFlags,
+    unsigned int* faceIds
+) const
 {
-     // get direction and origin of the ray for the current pose
-    NormalT ray_d = {rays[0], rays[1], rays[2]};
-    PointT ray_o = {ray_origin[0], ray_origin[1], ray_origin[2]};
-
-    // initialize result memory with zeros
-    result[0] = 0;
-    result[1] = 0;
-    result[2] = 0;
-    result_hits[0] = 0;
-
-    // precompute ray values to speed up intersection calculation
-    Ray ray;
-    ray.dir = ray_d;
-    ray.invDir = NormalT(1.0 / ray_d.x, 1.0 / ray_d.y, 1.0 / ray_d.z);
-    ray.rayDirSign.x = ray.invDir.x < 0;
-    ray.rayDirSign.y = ray.invDir.y < 0;
-    ray.rayDirSign.z = ray.invDir.z < 0;
-
-    // intersect all triangles stored in the BVH
-    TriangleIntersectionResult resultBVH = intersectTrianglesBVH(
-        clBVHindicesOrTriLists,
-        ray_o,
-        ray,
-        clBVHlimits,
-        clTriangleIntersectionData,
-        clTriIdxList
-    );
-
-    // if a triangle was hit, store the calculated hit point in the result at the current id
-    if (resultBVH.hit)
+    const float* triData = m_bvh.getTrianglesIntersectionData().data();
+    const uint32_t* triIdxList = m_bvh.getTriIndexList().data();
+
+    // Structure of arrays, one lane per ray
+    alignas(64) float ox[P], oy[P], oz[P];
+    alignas(64) float dx[P], dy[P], dz[P];
+    alignas(64) float ix[P], iy[P], iz[P];
+    alignas(64) float bestT[P];
+    alignas(64) uint32_t bestTri[P];
+
+    for(int r = 0; r < P; r++)
     {
-        result[0] = resultBVH.pointHit.x;
-        result[1] = resultBVH.pointHit.y;
-        result[2] = resultBVH.pointHit.z;
-        result_hits[0] = 1;
+        // unused lanes repeat the last ray and never hit anything
+        size_t src = std::min<size_t>(r, num - 1);
+        ox[r] = origins[originStride * src];
+        oy[r] = origins[originStride * src + 1];
+        oz[r] = origins[originStride * src + 2];
+        dx[r] = dirs[3 * src];
+        dy[r] = dirs[3 * src + 1];
+        dz[r] = dirs[3 * src + 2];
+        ix[r] = 1.0f / dx[r];
+        iy[r] = 1.0f / dy[r];
+        iz[r] = 1.0f / dz[r];
+        bestT[r] = (size_t)r < num ? std::numeric_limits<float>::max() : -1.0f;
+        bestTri[r] = 0;
     }
 
-}
+    int stackId = 0;
+    stack[stackId++] = {0, 0, 0.0f};
 
-template <typename PointT, typename NormalT>
-void BVHRaycaster<PointT, NormalT>::cast_rays_one_multi(
-        const float* ray_origin,
-        const float* rays,
-        size_t num_rays,
-        const unsigned int* clBVHindicesOrTriLists,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList,
-        float* result,
-        uint8_t* result_hits
-    )
-{
-     // get direction and origin of the ray for the current pose
-    PointT ray_o(ray_origin[0], ray_origin[1], ray_origin[2]);
+    while (stackId && !m_wideNodes.empty())
+    {
+        StackEntry entry = stack[--stackId];
+
+        float maxBest = bestT[0];
+        for(int r = 1; r < P; r++)
+        {
+            maxBest = std::max(maxBest, bestT[r]);
+        }
+        if(entry.tnear > maxBest)
+        {
+            continue;
+        }
+
+        if(entry.count == 0)
+        {
+            // inner node: a child is visited if any ray hits its box
+            const WideNode& node = m_wideNodes[entry.child];
+            int first = stackId;
+            for(int c = 0; c < BVH_NODE_WIDTH; c++)
+            {
+                if(!node.count[c] && node.bounds[0][c] > node.bounds[1][c])
+                {
+                    continue; // empty slot
+                }
+
+                const float minX = node.bounds[0][c], maxX = node.bounds[1][c];
+                const float minY = node.bounds[2][c], maxY = node.bounds[3][c];
+                const float minZ = node.bounds[4][c], maxZ = node.bounds[5][c];
+
+                float nearest = std::numeric_limits<float>::max();
+                int any = 0;
 
-    #pragma omp parallel for
-    for(size_t i=0; i< num_rays; i++)
+                #pragma omp simd reduction(min:nearest) reduction(|:any)
+                for(int r = 0; r < P; r++)
+                {
+                    float tx0 = (minX - ox[r]) * ix[r];
+                    float tx1 = (maxX - ox[r]) * ix[r];
+                    float ty0 = (minY - oy[r]) * iy[r];
+                    float ty1 = (maxY - oy[r]) * iy[r];
+                    float tz0 = (minZ - oz[r]) * iz[r];
+                    float tz1 = (maxZ - oz[r]) * iz[r];
+                    float tnear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)),
+                                           std::max(std::min(tz0, tz1), 0.0f));
+                    float tfar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)),
+                                          std::min(std::max(tz0, tz1), bestT[r]));
+                    int h = tnear <= tfar;
+                    any |= h;
+                    nearest = std::min(nearest, h ? tnear : std::numeric_limits<float>::max());
+                }
+
+                if(any)
+                {
+                    StackEntry e = {node.child[c], node.count[c], nearest};
+                    int j = stackId++;
+                    while(j > first && stack[j - 1].tnear < e.tnear)
+                    {
+                        stack[j] = stack[j - 1];
+                        j--;
+                    }
+                    stack[j] = e;
+                }
+            }
+        }
+        else
+        {
+            // leaf node: intersect all triangles with all rays
+            for(uint32_t i = entry.child; i < entry.child + entry.count; i++)
+            {
+                const uint32_t idx = triIdxList[i];
+                const float* t = triData + 16 * idx;
+
+                #pragma omp simd
+                for(int r = 0; r < P; r++)
+                {
+                    float k = t[0] * dx[r] + t[1] * dy[r] + t[2] * dz[r];
+                    float s = (t[3] - (t[0] * ox[r] + t[1] * oy[r] + t[2] * oz[r])) / k;
+                    float hx = dx[r] * s + ox[r];
+                    float hy = dy[r] * s + oy[r];
+                    float hz = dz[r] * s + oz[r];
+                    bool valid = k != 0.0f && s > EPSILON && s < bestT[r]
+                        && t[4] * hx + t[5] * hy + t[6] * hz - t[7] >= 0.0f
+                        && t[8] * hx + t[9] * hy + t[10] * hz - t[11] >= 0.0f
+                        && t[12] * hx + t[13] * hy + t[14] * hz - t[15] >= 0.0f;
+                    bestT[r] = valid ? s : bestT[r];
+                    bestTri[r] = valid ? idx : bestTri[r];
+                }
+            }
+        }
+    }
+
+    for(size_t r = 0; r < num; r++)
     {
-        NormalT ray_d(rays[i*3], rays[i*3+1], rays[i*3+2]);
-        // initialize result memory with zeros
-        result[i*3] = 0;
-        result[i*3+1] = 0;
-        result[i*3+2] = 0;
-        result_hits[i] = 0;
-
-        // precompute ray values to speed up intersection calculation
-        Ray ray;
-        ray.dir = ray_d;
-        ray.invDir = NormalT(1.0 / ray_d.x, 1.0 / ray_d.y, 1.0 / ray_d.z);
-        ray.rayDirSign.x = ray.invDir.x < 0;
-        ray.rayDirSign.y = ray.invDir.y < 0;
-        ray.rayDirSign.z = ray.invDir.z < 0;
-
-        // intersect all triangles stored in the BVH
-        TriangleIntersectionResult resultBVH = intersectTrianglesBVH(
-            clBVHindicesOrTriLists,
-            ray_o,
-            ray,
-            clBVHlimits,
-            clTriangleIntersectionData,
-            clTriIdxList
-        );
-
-        // if a triangle was hit, store the calculated hit point in the result at the current id
-        if (resultBVH.hit)
+        if(bestT[r] < std::numeric_limits<float>::max())
         {
-            result[i*3] = resultBVH.pointHit.x;
-            result[i*3+1] = resultBVH.pointHit.y;
-            result[i*3+2] = resultBVH.pointHit.z;
-            result_hits[i] = 1;
+            hits[3 * r]     = dx[r] * bestT[r] + ox[r];
+            hits[3 * r + 1] = dy[r] * bestT[r] + oy[r];
+            hits[3 * r + 2] = dz[r] * bestT[r] + oz[r];
+            hitFlags[r] = 1;
+            if(faceIds)
+            {
+                faceIds[r] = m_bvh.getFaceIndices()[bestTri[r]];
+            }
+        }
+        else
+        {
+            hits[3 * r] = hits[3 * r + 1] = hits[3 * r + 2] = 0.0f;
+            hitFlags[r] = 0;
+            if(faceIds)
+            {
+                faceIds[r] = std::numeric_limits<unsigned int>::max();
+            }
         }
     }
 }
 
-
 template <typename PointT, typename NormalT>
-void BVHRaycaster<PointT, NormalT>::cast_rays_multi_multi(
-        const float* ray_origin,
-        const float* rays,
-        size_t num_rays,
-        const unsigned int* clBVHindicesOrTriLists,
-        const float* clBVHlimits,
-        const float* clTriangleIntersectionData,
-        const unsigned int* clTriIdxList,
-        float* result,
-        uint8_t* result_hits
-    )
+void BVHRaycaster<PointT, NormalT>::castRaysWide(
+    const float* origins,
+    size_t originStride,
+    const float* dirs,
+    size_t num_rays,
+    float* result,
+    uint8_t* result_hits,
+    unsigned int* result_faces
+) const
 {
-     // get direction and origin of the ray for the current pose
-    #pragma omp parallel for
-    for(size_t i=0; i< num_rays; i++)
+    const long P = m_packetSize;
+    const long num_packets = (num_rays + P - 1) / P;
+
+    #pragma omp parallel
     {
-        NormalT ray_d(rays[i*3], rays[i*3+1], rays[i*3+2]);
-        PointT ray_o(ray_origin[i*3], ray_origin[i*3+1], ray_origin[i*3+2]);
-
-        // initialize result memory with zeros
-        result[i*3] = 0;
-        result[i*3+1] = 0;
-        result[i*3+2] = 0;
-        result_hits[i] = 0;
-
-        // precompute ray values to speed up intersection calculation
-        Ray ray;
-        ray.dir = ray_d;
-        ray.invDir = NormalT(1.0 / ray_d.x, 1.0 / ray_d.y, 1.0 / ray_d.z);
-        ray.rayDirSign.x = ray.invDir.x < 0;
-        ray.rayDirSign.y = ray.invDir.y < 0;
-        ray.rayDirSign.z = ray.invDir.z < 0;
-
-        // intersect all triangles stored in the BVH
-        TriangleIntersectionResult resultBVH = intersectTrianglesBVH(
-            clBVHindicesOrTriLists,
-            ray_o,
-            ray,
-            clBVHlimits,
-            clTriangleIntersectionData,
-            clTriIdxList
-        );
-
-        // if a triangle was hit, store the calculated hit point in the result at the current id
-        if (resultBVH.hit)
+        std::vector<StackEntry> stack(m_stackSize);
+
+        #pragma omp for schedule(dynamic, 64)
+        for(long p = 0; p < num_packets; p++)
         {
-            result[i*3] = resultBVH.pointHit.x;
-            result[i*3+1] = resultBVH.pointHit.y;
-            result[i*3+2] = resultBVH.pointHit.z;
-            result_hits[i] = 1;
+            size_t first = p * P;
+            size_t num = std::min<size_t>(P, num_rays - first);
+            const float* o = origins + originStride * first;
+            const float* d = dirs + 3 * first;
+            float* res = result + 3 * first;
+            uint8_t* flags = result_hits + first;
+            unsigned int* faces = result_faces ? result_faces + first : nullptr;
+
+            switch(P)
+            {
+                case 4:  tracePacket<4>(o, originStride, d, num, stack.data(), res, flags, faces); break;
+                case 8:  tracePacket<8>(o, originStride, d, num, stack.data(), res, flags, faces); break;
+                case 16: tracePacket<16>(o, originStride, d, num, stack.data(), res, flags, faces); break;
+                default:
+                {
+                    uint32_t face = std::numeric_limits<uint32_t>::max();
+                    res[0] = res[1] = res[2] = 0.0f;
+                    flags[0] = traceRay(o, d, stack.data(), res, face);
+                    if(faces)
+                    {
+                        faces[0] = flags[0] ? face : std::numeric_limits<unsigned int>::max();
+                    }
+                    break;
+                }
+            }
         }
     }
-
 }
 
-} // namespace lvr2
\ No newline at end of file
+} // namespace lvr2
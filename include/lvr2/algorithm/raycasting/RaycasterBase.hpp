@@ -34,7 +34,9 @@
 
 #pragma once
 
+#include <limits>
 #include <memory>
+#include <vector>
 #include "lvr2/io/MeshBuffer.hpp"
 #include "lvr2/geometry/BaseVector.hpp"
 #include "lvr2/geometry/Normal.hpp"
@@ -74,6 +76,33 @@ public:
         std::vector<uint8_t>& hits
     ) = 0;
 
+    /**
+     * @brief Casts rays from one origin and additionally reports the index
+     *        of the face that was hit by each ray.
+     *
+     * Raycasters that do not know which face was hit use this default
+     * implementation, which marks all face ids as invalid
+     * (std::numeric_limits<unsigned int>::max()).
+     *
+     * @param origin        Origin of all rays
+     * @param directions    Directions of the rays
+     * @param intersections Intersection points
+     * @param faceIds       Index of the hit face for each ray
+     * @param hits          Hit flags
+     */
+    virtual void castRaysWithFaceIds(
+        const PointT& origin,
+        const std::vector<NormalT >& directions,
+        std::vector<PointT >& intersections,
+        std::vector<unsigned int>& faceIds,
+        std::vector<uint8_t>& hits
+    );
+
+    /**
+     * @brief Returns the mesh rays are cast against
+     */
+    const MeshBufferPtr mesh() const { return m_mesh; }
+
 private:
     const MeshBufferPtr m_mesh;
 };
@@ -36,5 +36,16 @@ RaycasterBase<PointT, NormalT>::RaycasterBase(const MeshBufferPtr mesh)
 
 }
 
+template <typename PointT, typename NormalT>
+void RaycasterBase<PointT, NormalT>::castRaysWithFaceIds(
+    const PointT& origin,
+    const std::vector<NormalT >& directions,
+    std::vector<PointT >& intersections,
+    std::vector<unsigned int>& faceIds,
+    std::vector<uint8_t>& hits)
+{
+    castRays(origin, directions, intersections, hits);
+    faceIds.assign(directions.size(), std::numeric_limits<unsigned int>::max());
+}
 
 } // namespace lvr2
\ No newline at end of file
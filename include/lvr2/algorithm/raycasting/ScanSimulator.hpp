@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * ScanSimulator.hpp
+ */
+
+#pragma once
+#ifndef LVR2_ALGORITHM_RAYCASTING_SCANSIMULATOR
+#define LVR2_ALGORITHM_RAYCASTING_SCANSIMULATOR
+
+#include <functional>
+#include <vector>
+
+#include "lvr2/algorithm/raycasting/RaycasterBase.hpp"
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/types/ScanTypes.hpp"
+#include "lvr2/util/Util.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Simulates a laser scanner by casting the rays of its scan pattern
+ *        against a mesh.
+ *
+ * The scan pattern is derived from the field of view and the resolution of
+ * a Scan (thetaMin/Max, phiMin/Max, hResolution, vResolution, all in
+ * degrees). The scanner rotates around its z axis: theta is the horizontal
+ * angle in the xy plane and phi the elevation above it. Rays are cast
+ * column by column, like a rotating scanner head, from the pose given by
+ * Scan::registration.
+ *
+ * Rays are generated and traced in batches of a fixed size, so the complete
+ * set of rays is never held in memory. The hits of each batch are reported
+ * as a PointBuffer in scanner coordinates with the channels
+ *
+ *  - "ranges":            Distance to the scanner (float)
+ *  - "face_ids":          Index of the hit face (unsigned int)
+ *  - "incidence_angles":  Angle between ray and face normal in degrees (float)
+ *
+ * Face ids and incidence angles are only available if the raycaster reports
+ * face ids (e.g. BVHRaycaster). Otherwise the ids are
+ * std::numeric_limits<unsigned int>::max() and the angles NaN.
+ */
+template<typename PointT, typename NormalT>
+class ScanSimulator
+{
+public:
+
+    /**
+     * @brief Receives the hits of one batch.
+     *
+     * @param points    Hits of the batch (may be empty)
+     * @param firstRay  Index of the first ray of the batch in the scan pattern
+     */
+    using BatchCallback = std::function<void(PointBufferPtr points, size_t firstRay)>;
+
+    /**
+     * @brief Creates a simulator that casts rays with the given raycaster
+     *
+     * @param raycaster     Raycaster containing the mesh to scan
+     * @param batchSize     Number of rays that are traced at once
+     */
+    ScanSimulator(RaycasterBasePtr<PointT, NormalT> raycaster, size_t batchSize = 1 << 18);
+
+    /**
+     * @brief Sets the number of rays that are traced at once
+     */
+    void setBatchSize(size_t batchSize) { m_batchSize = std::max<size_t>(batchSize, 1); }
+
+    /**
+     * @brief Discards hits that are closer than minRange or farther away
+     *        than maxRange
+     */
+    void setRangeLimits(float minRange, float maxRange);
+
+    /**
+     * @brief Returns the number of horizontal (theta) steps of the pattern
+     *
+     * Both thetaMin and thetaMax are sampled. A range with thetaMax <
+     * thetaMin wraps around 360 degrees. A range of a full turn or more is
+     * sampled once, without the end that coincides with the start.
+     *
+     * @throws std::invalid_argument if hResolution is not > 0
+     */
+    static size_t numColumns(const Scan& scan);
+
+    /**
+     * @brief Returns the number of vertical (phi) steps of the pattern
+     *
+     * Both phiMin and phiMax are sampled.
+     *
+     * @throws std::invalid_argument if vResolution is not > 0 or
+     *         phiMax < phiMin
+     */
+    static size_t numRows(const Scan& scan);
+
+    /**
+     * @brief Simulates the given scan and reports the hits batch by batch
+     *
+     * @param scan      Pose, field of view and resolution of the scanner
+     * @param callback  Called once for every batch, in the order of the rays
+     */
+    void simulate(const Scan& scan, const BatchCallback& callback) const;
+
+    /**
+     * @brief Simulates the given scan and returns all hits in one buffer
+     */
+    PointBufferPtr simulate(const Scan& scan) const;
+
+private:
+
+    /// Converts the hits of a batch into a point buffer in scanner coordinates
+    PointBufferPtr createBuffer(
+        const std::vector<NormalT>& localDirections,
+        const PointT& origin,
+        const std::vector<PointT>& intersections,
+        const std::vector<unsigned int>& faceIds,
+        const std::vector<uint8_t>& hits,
+        const std::vector<NormalT>& directions) const;
+
+    RaycasterBasePtr<PointT, NormalT>   m_raycaster;
+    size_t                              m_batchSize;
+    float                               m_minRange;
+    float                               m_maxRange;
+};
+
+} // namespace lvr2
+
+#include "lvr2/algorithm/raycasting/ScanSimulator.tcc"
+
+#endif // LVR2_ALGORITHM_RAYCASTING_SCANSIMULATOR
@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace lvr2
+{
+
+template<typename PointT, typename NormalT>
+ScanSimulator<PointT, NormalT>::ScanSimulator(
+    RaycasterBasePtr<PointT, NormalT> raycaster,
+    size_t batchSize)
+    : m_raycaster(raycaster),
+      m_batchSize(std::max<size_t>(batchSize, 1)),
+      m_minRange(0.0f),
+      m_maxRange(std::numeric_limits<float>::max())
+{
+
+}
+
+template<typename PointT, typename NormalT>
+void ScanSimulator<PointT, NormalT>::setRangeLimits(float minRange, float maxRange)
+{
+    m_minRange = minRange;
+    m_maxRange = maxRange;
+}
+
+namespace scan_simulator_detail
+{
+
+/// Number of samples start, start + step, ... that are <= start + span
+inline size_t numSteps(double span, double step)
+{
+    // Tolerate rounding errors of spans that are a multiple of the step
+    return static_cast<size_t>(std::floor(span / step + 1e-6)) + 1;
+}
+
+} // namespace scan_simulator_detail
+
+template<typename PointT, typename NormalT>
+size_t ScanSimulator<PointT, NormalT>::numColumns(const Scan& scan)
+{
+    if (!(scan.hResolution > 0) || !std::isfinite(scan.hResolution))
+    {
+        throw std::invalid_argument("ScanSimulator: Horizontal resolution has to be > 0");
+    }
+
+    // A range with thetaMax < thetaMin wraps around 360 degrees
+    double span = scan.thetaMax - scan.thetaMin;
+    if (span < 0)
+    {
+        span += 360.0;
+    }
+
+    // A full turn ends where it started, so the end is left out
+    if (span >= 360.0)
+    {
+        return std::max<size_t>(1, std::lround(360.0 / scan.hResolution));
+    }
+
+    return scan_simulator_detail::numSteps(span, scan.hResolution);
+}
+
+template<typename PointT, typename NormalT>
+size_t ScanSimulator<PointT, NormalT>::numRows(const Scan& scan)
+{
+    if (!(scan.vResolution > 0) || !std::isfinite(scan.vResolution))
+    {
+        throw std::invalid_argument("ScanSimulator: Vertical resolution has to be > 0");
+    }
+
+    if (!(scan.phiMax >= scan.phiMin))
+    {
+        throw std::invalid_argument("ScanSimulator: phiMax has to be >= phiMin");
+    }
+
+    return scan_simulator_detail::numSteps(scan.phiMax - scan.phiMin, scan.vResolution);
+}
+
+template<typename PointT, typename NormalT>
+void ScanSimulator<PointT, NormalT>::simulate(const Scan& scan, const BatchCallback& callback) const
+{
+    const size_t cols = numColumns(scan);
+    const size_t rows = numRows(scan);
+    const size_t numRays = cols * rows;
+
+    const double toRad = M_PI / 180.0;
+
+    // Scanner pose in world coordinates
+    const Eigen::Matrix3d R = scan.registration.template block<3, 3>(0, 0);
+    const Eigen::Vector3d t = scan.registration.template block<3, 1>(0, 3);
+    const PointT origin(t.x(), t.y(), t.z());
+
+    std::vector<NormalT> localDirections;
+    std::vector<NormalT> directions;
+    std::vector<PointT> intersections;
+    std::vector<unsigned int> faceIds;
+    std::vector<uint8_t> hits;
+
+    for (size_t first = 0; first < numRays; first += m_batchSize)
+    {
+        const long num = std::min(m_batchSize, numRays - first);
+        localDirections.resize(num);
+        directions.resize(num);
+
+        // Generate the rays of this batch, column by column
+        #pragma omp parallel for
+        for (long i = 0; i < num; i++)
+        {
+            size_t ray = first + i;
+            double theta = (scan.thetaMin + (ray / rows) * scan.hResolution) * toRad;
+            double phi = (scan.phiMin + (ray % rows) * scan.vResolution) * toRad;
+
+            Eigen::Vector3d d(cos(phi) * cos(theta), cos(phi) * sin(theta), sin(phi));
+            Eigen::Vector3d w = R * d;
+            localDirections[i] = NormalT(d.x(), d.y(), d.z());
+            directions[i] = NormalT(w.x(), w.y(), w.z());
+        }
+
+        m_raycaster->castRaysWithFaceIds(origin, directions, intersections, faceIds, hits);
+
+        callback(createBuffer(localDirections, origin, intersections, faceIds, hits, directions), first);
+    }
+}
+
+template<typename PointT, typename NormalT>
+PointBufferPtr ScanSimulator<PointT, NormalT>::simulate(const Scan& scan) const
+{
+    std::vector<PointBufferPtr> batches;
+    size_t total = 0;
+
+    simulate(scan, [&](PointBufferPtr points, size_t firstRay)
+    {
+        total += points->numPoints();
+        batches.push_back(points);
+    });
+
+    floatArr points(new float[3 * total]);
+    floatArr ranges(new float[total]);
+    indexArray faces(new unsigned int[total]);
+    floatArr angles(new float[total]);
+
+    size_t offset = 0;
+    for (auto& batch : batches)
+    {
+        const size_t n = batch->numPoints();
+        size_t cn, w;
+        std::copy_n(batch->getPointArray().get(), 3 * n, points.get() + 3 * offset);
+        std::copy_n(batch->getFloatArray("ranges", cn, w).get(), n, ranges.get() + offset);
+        std::copy_n(batch->getIndexArray("face_ids", cn, w).get(), n, faces.get() + offset);
+        std::copy_n(batch->getFloatArray("incidence_angles", cn, w).get(), n, angles.get() + offset);
+        offset += n;
+
+        // Release the batch as soon as it is copied
+        batch.reset();
+    }
+
+    PointBufferPtr buffer(new PointBuffer(points, total));
+    buffer->addFloatChannel(ranges, "ranges", total, 1);
+    buffer->addIndexChannel(faces, "face_ids", total, 1);
+    buffer->addFloatChannel(angles, "incidence_angles", total, 1);
+    return buffer;
+}
+
+template<typename PointT, typename NormalT>
+PointBufferPtr ScanSimulator<PointT, NormalT>::createBuffer(
+    const std::vector<NormalT>& localDirections,
+    const PointT& origin,
+    const std::vector<PointT>& intersections,
+    const std::vector<unsigned int>& faceIds,
+    const std::vector<uint8_t>& hits,
+    const std::vector<NormalT>& directions) const
+{
+    const long num = hits.size();
+    const MeshBufferPtr mesh = m_raycaster->mesh();
+    const floatArr vertices = mesh->getVertices();
+    const indexArray faces = mesh->getFaceIndices();
+    const size_t numFaces = mesh->numFaces();
+
+    // Keep the hits within the range limits
+    std::vector<float> range(num);
+    std::vector<size_t> offsets(num);
+
+    #pragma omp parallel for
+    for (long i = 0; i < num; i++)
+    {
+        range[i] = hits[i] ? (intersections[i] - origin).length() : 0.0f;
+        offsets[i] = hits[i] && range[i] >= m_minRange && range[i] <= m_maxRange;
+    }
+    const size_t n = Util::parallel_exclusive_scan(offsets);
+
+    floatArr points(new float[3 * n]);
+    floatArr ranges(new float[n]);
+    indexArray ids(new unsigned int[n]);
+    floatArr angles(new float[n]);
+
+    #pragma omp parallel for
+    for (long i = 0; i < num; i++)
+    {
+        if (!hits[i] || range[i] < m_minRange || range[i] > m_maxRange)
+        {
+            continue;
+        }
+
+        const size_t j = offsets[i];
+        const NormalT& d = localDirections[i];
+        points[3 * j]     = d.x * range[i];
+        points[3 * j + 1] = d.y * range[i];
+        points[3 * j + 2] = d.z * range[i];
+        ranges[j] = range[i];
+        ids[j] = faceIds[i];
+        angles[j] = std::numeric_limits<float>::quiet_NaN();
+
+        if (faceIds[i] < numFaces)
+        {
+            const float* v0 = vertices.get() + 3 * faces[3 * faceIds[i]];
+            const float* v1 = vertices.get() + 3 * faces[3 * faceIds[i] + 1];
+            const float* v2 = vertices.get() + 3 * faces[3 * faceIds[i] + 2];
+            PointT e1(v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]);
+            PointT e2(v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]);
+            PointT normal = e1.cross(e2);
+
+            float length = normal.length();
+            if (length > 0)
+            {
+                const NormalT& w = directions[i];
+                float c = std::fabs(normal.x * w.x + normal.y * w.y + normal.z * w.z) / length;
+                angles[j] = std::acos(std::min(c, 1.0f)) * 180.0 / M_PI;
+            }
+        }
+    }
+
+    PointBufferPtr buffer(new PointBuffer(points, n));
+    buffer->addFloatChannel(ranges, "ranges", n, 1);
+    buffer->addIndexChannel(ids, "face_ids", n, 1);
+    buffer->addFloatChannel(angles, "incidence_angles", n, 1);
+    return buffer;
+}
+
+} // namespace lvr2
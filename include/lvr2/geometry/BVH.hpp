@@ -62,26 +62,41 @@ class BVHTree
 {
 public:
 
+    /**
+     * @brief Algorithms to build the hierarchy
+     */
+    enum BuildMethod
+    {
+        /// Binned surface area heuristic. Slower to build, fastest to trace.
+        BINNED_SAH,
+
+        /// Linear BVH from sorted Morton codes. Very fast to build, but the
+        /// trees are slower to trace. Meant for scenes that change often.
+        MORTON
+    };
+
     /**
      * @brief Constructs the tree itself and it's cache friendly representation
      *
      * @param vertices Vertices of mesh to create tree for
      * @param faces Faces of mesh to create tree for
+     * @param method Algorithm used to build the hierarchy
      */
-    BVHTree(const vector<float>& vertices, const vector<uint32_t>& faces);
+    BVHTree(const vector<float>& vertices, const vector<uint32_t>& faces, BuildMethod method = BINNED_SAH);
 
     /**
-     * @brief 
+     * @brief Constructs the tree from raw vertex and face arrays
      */
     BVHTree(
         const floatArr vertices, size_t n_vertices,
-        const indexArray faces, size_t n_faces
+        const indexArray faces, size_t n_faces,
+        BuildMethod method = BINNED_SAH
     );
 
     /**
-     * @brief
+     * @brief Constructs the tree from the vertices and faces of a mesh
      */
-    BVHTree(const MeshBufferPtr mesh);
+    BVHTree(const MeshBufferPtr mesh, BuildMethod method = BINNED_SAH);
 
     /**
      * @return Index list (for getTrianglesIntersectionData) of triangles in the leaf nodes
@@ -121,6 +136,13 @@ public:
      */
     const vector<float>& getTrianglesIntersectionData() const;
 
+    /**
+     * @return Index of the input face of each triangle. Malformed faces are
+     *         skipped during construction, so triangle and face indices
+     *         differ in general.
+     */
+    const vector<uint32_t>& getFaceIndices() const;
+
 private:
 
     // Internal triangle representation
@@ -145,14 +167,6 @@ private:
         BoundingBox<BaseVecT> bb;
     };
 
-    // Internal AABB representation
-    struct AABB {
-        BoundingBox<BaseVecT> bb;
-
-        // Triangles corresponding to this AABB
-        vector<size_t> triangles;
-    };
-
     // Abstract tree node
     struct BVHNode {
         BoundingBox<BaseVecT> bb;
@@ -181,9 +195,52 @@ private:
     };
     using BVHLeafPtr = unique_ptr<BVHLeaf>;
 
+    // Axis aligned bounds used during construction. Cheaper to expand than
+    // BoundingBox, which updates its centroid with every point.
+    struct Bounds {
+        Bounds();
+        void expand(const Bounds& b);
+        float area() const;
+        float centroid(int axis) const { return 0.5f * (min[axis] + max[axis]); }
+
+        float min[3];
+        float max[3];
+    };
+
+    // Subtree whose construction is deferred to the parallel build phase
+    struct BuildJob {
+        BVHNodePtr* slot;
+        size_t begin;
+        size_t end;
+    };
+
+    // State shared by all nodes during construction
+    struct BuildState {
+        BuildMethod method;
+
+        // Triangle indices, partitioned in place while the tree is built
+        vector<uint32_t> prims;
+
+        // Morton codes in the order of prims (MORTON only)
+        vector<uint32_t> codes;
+
+        // Bounds of all triangles
+        vector<Bounds> bounds;
+
+        // Subtrees that are built in parallel after the top levels
+        vector<BuildJob> jobs;
+
+        // Inner nodes of the top levels in creation order (MORTON only)
+        vector<BVHInner*> topNodes;
+
+        // Subtrees with at most this many triangles become jobs
+        size_t jobSize;
+    };
+
     // working variables for tree construction
     BVHNodePtr m_root;
     vector<Triangle> m_triangles;
+    vector<uint32_t> m_faceIndices;
 
     // cache friendly data for the SIMD device
     vector<uint32_t> m_triIndexList;
@@ -192,17 +249,17 @@ private:
     vector<float> m_trianglesIntersectionData;
 
     /**
-     * @brief Builds the tree without it's cache friendly representation. Utilizes the buildTreeRecursive method.
+     * @brief Builds the tree without it's cache friendly representation. Utilizes the buildHierarchy method.
      *
      * @param vertices Vertices of mesh to create tree for
      * @param faces Faces of mesh to create tree for
      *
      * @return Root node of the tree
      */
-    BVHNodePtr buildTree(const vector<float>& vertices, const vector<uint32_t>& faces);
+    BVHNodePtr buildTree(const vector<float>& vertices, const vector<uint32_t>& faces, BuildMethod method);
 
     /**
-     * @brief Builds the tree without it's cache friendly representation. Utilizes the buildTreeRecursive method.
+     * @brief Builds the tree without it's cache friendly representation. Utilizes the buildHierarchy method.
      *
      * @param vertices Vertices of mesh to create tree for
      * @param faces Faces of mesh to create tree for
@@ -211,18 +268,61 @@ private:
      */
     BVHNodePtr buildTree(
         const floatArr vertices, size_t n_vertices,
-        const indexArray faces, size_t n_faces
+        const indexArray faces, size_t n_faces,
+        BuildMethod method
     );
 
     /**
-     * @brief Recursive method to build the tree.
+     * @brief Builds the hierarchy over all triangles in m_triangles.
+     *
+     * The top levels are built one node at a time, computing the bounds and
+     * SAH bins of large nodes in parallel. The remaining subtrees are then
+     * built in parallel, one subtree per thread.
+     *
+     * @param method Algorithm used to build the hierarchy
+     *
+     * @return Root node of the tree
+     */
+    BVHNodePtr buildHierarchy(BuildMethod method);
+
+    /**
+     * @brief Builds the node for the triangles state.prims[begin, end).
+     *
+     * @param state The construction state
+     * @param begin First triangle of the node in state.prims
+     * @param end   End of the triangles of the node in state.prims
+     * @param top   True while building the top levels. Small subtrees
+     *              are deferred to state.jobs then.
+     *
+     * @return The new node
+     */
+    BVHNodePtr buildNode(BuildState& state, size_t begin, size_t end, bool top);
+
+    /**
+     * @brief Builds a child node into the given slot or defers it to the
+     *        parallel build phase.
+     */
+    void buildChild(BuildState& state, BVHNodePtr& slot, size_t begin, size_t end, bool top);
+
+    /**
+     * @brief Finds the best split of a node using 16 SAH bins per axis and
+     *        partitions its triangles accordingly.
+     *
+     * @param bb        Bounds of the node
+     * @param parallel  Bin the triangles in parallel
      *
-     * @param work The current work queue to generate the tree from
-     * @param depth The current depth of the tree
+     * @return Position of the split in state.prims or begin, if creating a
+     *         leaf is cheaper
+     */
+    size_t splitBinned(BuildState& state, size_t begin, size_t end, const Bounds& bb, bool parallel);
+
+    /**
+     * @brief Splits a node at the highest differing bit of the Morton codes
+     *        of its triangles.
      *
-     * @return Root node of the current tree
+     * @return Position of the split in state.prims
      */
-    BVHNodePtr buildTreeRecursive(vector<AABB>& work, uint32_t depth = 0);
+    size_t splitMorton(const BuildState& state, size_t begin, size_t end);
 
     /**
      * @brief Creates the cache friendly representation of the tree. Needs the tree itself!
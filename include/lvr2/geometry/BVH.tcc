@@ -32,8 +32,11 @@
  *  @author Johan M. von Behren <johan@vonbehren.eu>
  */
 
+#include <algorithm>
 #include <limits>
 
+#include "lvr2/config/lvropenmp.hpp"
+
 using std::make_unique;
 using std::transform;
 using std::move;
@@ -59,26 +62,28 @@ BVHTree<BaseVecT>::Triangle::Triangle()
 {}
 
 template<typename BaseVecT>
-BVHTree<BaseVecT>::BVHTree(const vector<float>& vertices, const vector<uint32_t>& faces)
+BVHTree<BaseVecT>::BVHTree(const vector<float>& vertices, const vector<uint32_t>& faces, BuildMethod method)
 {
-    m_root = buildTree(vertices, faces);
+    m_root = buildTree(vertices, faces, method);
     createCFTree();
 }
 
 template<typename BaseVecT>
 BVHTree<BaseVecT>::BVHTree(
     const floatArr vertices, size_t n_vertices,
-    const indexArray faces, size_t n_faces)
+    const indexArray faces, size_t n_faces,
+    BuildMethod method)
 {
-    m_root = buildTree(vertices, n_vertices, faces, n_faces);
+    m_root = buildTree(vertices, n_vertices, faces, n_faces, method);
     createCFTree();
 }
 
 template<typename BaseVecT>
-BVHTree<BaseVecT>::BVHTree(const MeshBufferPtr mesh)
+BVHTree<BaseVecT>::BVHTree(const MeshBufferPtr mesh, BuildMethod method)
 :BVHTree<BaseVecT>(
     mesh->getVertices(), mesh->numVertices(),
-    mesh->getFaceIndices(), mesh->numFaces()
+    mesh->getFaceIndices(), mesh->numFaces(),
+    method
     )
 {
 
@@ -87,12 +92,12 @@ BVHTree<BaseVecT>::BVHTree(const MeshBufferPtr mesh)
 template<typename BaseVecT>
 typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTree(
     const vector<float>& vertices,
-    const vector<uint32_t>& faces
+    const vector<uint32_t>& faces,
+    BuildMethod method
 )
 {
-    vector<AABB> work;
-    work.reserve(faces.size() / 3);
     m_triangles.reserve(faces.size() / 3);
+    m_faceIndices.reserve(faces.size() / 3);
 
     BoundingBox<BaseVecT> outerBb;
 
@@ -169,25 +174,13 @@ typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTree(
         triangle.e3 = Normal<typename BaseVecT::CoordType>(triangle.normal.cross(vc3));
         triangle.d3 = triangle.e3.dot(point3);
 
-        // Create AABB and add current triangle (face) to it
-        AABB aabb;
-        aabb.bb = faceBb;
-        aabb.triangles.push_back(m_triangles.size());
         m_triangles.push_back(triangle);
-
+        m_faceIndices.push_back(i / 3);
         outerBb.expand(faceBb);
-        work.push_back(aabb);
     }
 
-    // Create the tree recursively from the list of AABBs
-
-    BVHTree<BaseVecT>::BVHNodePtr out;
-
-    #pragma omp parallel
-    #pragma omp single nowait
-    out = buildTreeRecursive(work);
-    
-    std::cout << "end building." << std::endl;
+    // Create the tree from the list of triangles
+    BVHTree<BaseVecT>::BVHNodePtr out = buildHierarchy(method);
     out->bb = outerBb;
 
     return out;
@@ -197,12 +190,12 @@ typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTree(
 template<typename BaseVecT>
 typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTree(
     const floatArr vertices, size_t n_vertices,
-    const indexArray faces, size_t n_faces
+    const indexArray faces, size_t n_faces,
+    BuildMethod method
 )
 {
-    vector<AABB> work;
-    work.reserve(n_faces);
     m_triangles.reserve(n_faces);
+    m_faceIndices.reserve(n_faces);
 
     BoundingBox<BaseVecT> outerBb;
     // Iterate over all faces and create an AABB for all of them
@@ -279,22 +272,14 @@ typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTree(
         triangle.e3 = Normal<typename BaseVecT::CoordType>(triangle.normal.cross(vc3));
         triangle.d3 = triangle.e3.dot(point3);
 
-        // Create AABB and add current triangle (face) to it
-        AABB aabb;
-        aabb.bb = faceBb;
-        aabb.triangles.push_back(m_triangles.size());
         m_triangles.push_back(triangle);
-
+        m_faceIndices.push_back(i / 3);
         outerBb.expand(faceBb);
-        work.push_back(aabb);
     }
 
 
-    // Create the tree recursively from the list of AABBs
-    BVHTree<BaseVecT>::BVHNodePtr out;
-    #pragma omp parallel
-    #pragma omp single nowait
-    out = buildTreeRecursive(work);
+    // Create the tree from the list of triangles
+    BVHTree<BaseVecT>::BVHNodePtr out = buildHierarchy(method);
 
     out->bb = outerBb;
 
@@ -302,203 +287,421 @@ typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTree(
 }
 
 template<typename BaseVecT>
-typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildTreeRecursive(vector<AABB>& work, uint32_t depth)
+BVHTree<BaseVecT>::Bounds::Bounds()
 {
-    // terminate recursion, if work size is small enough
-    if (work.size() < 4)
+    for (int a = 0; a < 3; a++)
     {
-        // Create a leaf node and add all remaining triangles into it
-        auto leaf = make_unique<BVHLeaf>();
-        for (auto aabb: work)
-        {
-            leaf->triangles.reserve(aabb.triangles.size());
-            for (auto triangle: aabb.triangles)
-            {
-                leaf->triangles.push_back(triangle);
-            }
-        }
-        return move(leaf);
+        min[a] = numeric_limits<float>::max();
+        max[a] = numeric_limits<float>::lowest();
+    }
+}
+
+template<typename BaseVecT>
+void BVHTree<BaseVecT>::Bounds::expand(const Bounds& b)
+{
+    for (int a = 0; a < 3; a++)
+    {
+        min[a] = std::min(min[a], b.min[a]);
+        max[a] = std::max(max[a], b.max[a]);
     }
+}
 
-    // divide node into smaller nodes
-    BoundingBox<BaseVecT> bb;
-    for (auto aabb: work)
+template<typename BaseVecT>
+float BVHTree<BaseVecT>::Bounds::area() const
+{
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+    if (dx < 0 || dy < 0 || dz < 0)
     {
-        bb.expand(aabb.bb);
+        return 0.0f;
     }
+    return dx * dy + dy * dz + dz * dx;
+}
 
-    // SAH, surface area heuristic calculation
-    float minCost =
-        work.size() * (bb.getXSize() * bb.getYSize() + bb.getYSize() * bb.getZSize() + bb.getZSize() * bb.getXSize());
+template<typename BaseVecT>
+typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildHierarchy(BuildMethod method)
+{
+    BuildState state;
+    state.method = method;
 
-    auto bestSplit = numeric_limits<typename BaseVecT::CoordType>::max();
-    int bestAxis = -1;
+    const long n = m_triangles.size();
+    state.prims.resize(n);
+    state.bounds.resize(n);
 
-    // try all 3 axises X = 0, Y = 1, Z = 2
-    for (uint8_t j = 0; j < 3; j++)
+    #pragma omp parallel for
+    for (long i = 0; i < n; i++)
     {
-        auto axis = j;
-        float start, stop, step;
+        const auto& bb = m_triangles[i].bb;
+        Bounds& b = state.bounds[i];
+        b.min[0] = bb.getMin().x;
+        b.min[1] = bb.getMin().y;
+        b.min[2] = bb.getMin().z;
+        b.max[0] = bb.getMax().x;
+        b.max[1] = bb.getMax().y;
+        b.max[2] = bb.getMax().z;
+        state.prims[i] = i;
+    }
 
-        if (axis == 0)
+    if (method == MORTON && n > 0)
+    {
+        // Quantize the triangle centroids to a 1024^3 grid and sort the
+        // triangles along the resulting Z-order curve
+        Bounds cb;
+        for (long i = 0; i < n; i++)
         {
-            start = bb.getMin().x;
-            stop = bb.getMax().x;
+            for (int a = 0; a < 3; a++)
+            {
+                float c = state.bounds[i].centroid(a);
+                cb.min[a] = std::min(cb.min[a], c);
+                cb.max[a] = std::max(cb.max[a], c);
+            }
         }
-        else if(axis == 1)
+
+        float scale[3];
+        for (int a = 0; a < 3; a++)
         {
-            start = bb.getMin().y;
-            stop = bb.getMax().y;
+            float extent = cb.max[a] - cb.min[a];
+            scale[a] = extent > 0 ? 1023.0f / extent : 0.0f;
         }
-        else
+
+        // Spreads the lower 10 bits of v, so that there are two zero bits between each
+        auto spreadBits3 = [](uint32_t v)
         {
-            start = bb.getMin().z;
-            stop = bb.getMax().z;
+            v &= 0x3ff;
+            v = (v | (v << 16)) & 0x030000ff;
+            v = (v | (v <<  8)) & 0x0300f00f;
+            v = (v | (v <<  4)) & 0x030c30c3;
+            v = (v | (v <<  2)) & 0x09249249;
+            return v;
+        };
+
+        vector<uint64_t> keys(n);
+        #pragma omp parallel for
+        for (long i = 0; i < n; i++)
+        {
+            uint32_t code = 0;
+            for (int a = 0; a < 3; a++)
+            {
+                uint32_t q = static_cast<uint32_t>((state.bounds[i].centroid(a) - cb.min[a]) * scale[a]);
+                code |= spreadBits3(q) << a;
+            }
+            keys[i] = (static_cast<uint64_t>(code) << 32) | static_cast<uint64_t>(i);
         }
+        std::sort(keys.begin(), keys.end());
 
-        if (fabs(stop - start) < 1e-4)
+        state.codes.resize(n);
+        for (long i = 0; i < n; i++)
         {
-            // bb side along this axis too short, we must move to a different axis
-            continue;
+            state.prims[i] = static_cast<uint32_t>(keys[i] & 0xffffffff);
+            state.codes[i] = static_cast<uint32_t>(keys[i] >> 32);
         }
+    }
 
-        step = (stop - start) / (1024.0f / (depth + 1.0f));
-
-        for (float testSplit = start + step; testSplit < stop - step; testSplit += step)
-        {
-            // create left and right bb
-            BoundingBox<BaseVecT> lBb;
-            BoundingBox<BaseVecT> rBb;
+    // Build the top levels until there are enough subtrees to keep all
+    // threads busy, then build those subtrees in parallel
+    state.jobSize = std::max<size_t>(256, n / (16 * OpenMPConfig::getNumThreads()));
 
-            int countLeft = 0, countRight = 0;
+    BVHNodePtr root;
+    buildChild(state, root, 0, n, true);
 
-            for (size_t i = 0; i < work.size(); i++)
-            {
-                auto& v = work[i];
+    #pragma omp parallel for schedule(dynamic)
+    for (long j = 0; j < (long)state.jobs.size(); j++)
+    {
+        const BuildJob& job = state.jobs[j];
+        *job.slot = buildNode(state, job.begin, job.end, false);
+    }
 
-                float value;
-                if (axis == 0)
-                {
-                    value = v.bb.getCentroid().x;
-                }
-                else if (axis == 1)
-                {
-                    value = v.bb.getCentroid().y;
-                }
-                else
-                {
-                    value = v.bb.getCentroid().z;
-                }
+    // Morton nodes get their bounds from their children, which are only
+    // complete now. Children were created after their parents.
+    for (auto it = state.topNodes.rbegin(); it != state.topNodes.rend(); ++it)
+    {
+        BVHInner* inner = *it;
+        inner->bb = BoundingBox<BaseVecT>();
+        inner->bb.expand(inner->left->bb);
+        inner->bb.expand(inner->right->bb);
+    }
 
-                if (value < testSplit)
-                {
-                    lBb.expand(v.bb);
-                    countLeft++;
-                }
-                else
-                {
-                    rBb.expand(v.bb);
-                    countRight++;
-                }
-            }
+    return root;
+}
 
-            // Skipt to small values
-            if (countLeft <= 1 || countRight <= 1)
-            {
-                continue;
-            }
+template<typename BaseVecT>
+void BVHTree<BaseVecT>::buildChild(BuildState& state, BVHNodePtr& slot, size_t begin, size_t end, bool top)
+{
+    if (top && end - begin <= state.jobSize)
+    {
+        state.jobs.push_back({&slot, begin, end});
+    }
+    else
+    {
+        slot = buildNode(state, begin, end, top);
+    }
+}
 
-            // Calc surface for left and right box
-            float surfaceLeft =
-                lBb.getXSize() * lBb.getYSize() + lBb.getYSize() * lBb.getZSize() + lBb.getZSize() * lBb.getXSize();
-            float surfaceRight =
-                lBb.getXSize() * rBb.getYSize() + rBb.getYSize() * rBb.getZSize() + rBb.getZSize() * rBb.getXSize();
+template<typename BaseVecT>
+typename BVHTree<BaseVecT>::BVHNodePtr BVHTree<BaseVecT>::buildNode(
+    BuildState& state,
+    size_t begin,
+    size_t end,
+    bool top)
+{
+    const size_t count = end - begin;
+    const bool parallel = top && count >= (1 << 14);
+    const bool morton = state.method == MORTON;
+
+    // Morton codes already define the split, so inner nodes only need
+    // bounds for the binned SAH
+    Bounds bb;
+    if (parallel && !morton)
+    {
+        #pragma omp parallel
+        {
+            Bounds local;
 
-            // Check if new best split was found
-            float totalCost = surfaceLeft * countLeft + surfaceRight * countRight;
-            if (totalCost < minCost)
+            #pragma omp for nowait
+            for (long i = begin; i < (long)end; i++)
             {
-                minCost = totalCost;
-                bestSplit = testSplit;
-                bestAxis = axis;
+                local.expand(state.bounds[state.prims[i]]);
             }
+
+            #pragma omp critical
+            bb.expand(local);
+        }
+    }
+    else if (!morton || count < 4)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            bb.expand(state.bounds[state.prims[i]]);
         }
     }
 
-    // If no good split was found, create a leaf node and copy all remaining triangles into it
-    if (bestAxis == -1)
+    // terminate recursion, if node size is small enough
+    size_t mid = begin;
+    if (count >= 4)
+    {
+        mid = morton ? splitMorton(state, begin, end) : splitBinned(state, begin, end, bb, parallel);
+    }
+
+    if (mid == begin)
     {
+        // Create a leaf node and add all remaining triangles into it
         auto leaf = make_unique<BVHLeaf>();
-        for (auto aabb: work)
+        leaf->triangles.assign(state.prims.begin() + begin, state.prims.begin() + end);
+        if (count > 0)
         {
-            leaf->triangles.reserve(aabb.triangles.size());
-            for (auto triangle: aabb.triangles)
-            {
-                leaf->triangles.push_back(triangle);
-            }
+            leaf->bb = BoundingBox<BaseVecT>(
+                BaseVecT(bb.min[0], bb.min[1], bb.min[2]),
+                BaseVecT(bb.max[0], bb.max[1], bb.max[2]));
         }
-        return move(leaf);
+        return leaf;
+    }
+
+    // Recursively split new sub trees into further inner or leaf nodes
+    auto inner = make_unique<BVHInner>();
+    if (morton && top)
+    {
+        state.topNodes.push_back(inner.get());
+    }
+
+    buildChild(state, inner->left, begin, mid, top);
+    buildChild(state, inner->right, mid, end, top);
+
+    if (!morton)
+    {
+        inner->bb = BoundingBox<BaseVecT>(
+            BaseVecT(bb.min[0], bb.min[1], bb.min[2]),
+            BaseVecT(bb.max[0], bb.max[1], bb.max[2]));
     }
+    else if (!top)
+    {
+        inner->bb.expand(inner->left->bb);
+        inner->bb.expand(inner->right->bb);
+    }
+
+    return inner;
+}
 
-    vector<AABB> leftWork;
-    vector<AABB> rightWork;
-    BoundingBox<BaseVecT> lBb;
-    BoundingBox<BaseVecT> rBb;
+template<typename BaseVecT>
+size_t BVHTree<BaseVecT>::splitBinned(
+    BuildState& state,
+    size_t begin,
+    size_t end,
+    const Bounds& bb,
+    bool parallel)
+{
+    const int numBins = 16;
+    const size_t maxLeafSize = 8;
+    const size_t count = end - begin;
 
-    // Use the found split to split the current node into two new inner nodes
-    for (size_t i = 0; i < work.size(); i++)
+    struct Bin
     {
-        auto& v = work[i];
+        Bounds bounds;
+        size_t count = 0;
+    };
 
-        // Get the best axis centroid value
-        float value;
-        if (bestAxis == 0)
+    // Bins are spread over the bounds of the triangle centroids
+    Bounds cb;
+    for (size_t i = begin; i < end; i++)
+    {
+        const Bounds& b = state.bounds[state.prims[i]];
+        for (int a = 0; a < 3; a++)
         {
-            value = v.bb.getCentroid().x;
+            cb.min[a] = std::min(cb.min[a], b.centroid(a));
+            cb.max[a] = std::max(cb.max[a], b.centroid(a));
         }
-        else if (bestAxis == 1)
+    }
+
+    float scale[3];
+    for (int a = 0; a < 3; a++)
+    {
+        float extent = cb.max[a] - cb.min[a];
+        scale[a] = extent > 1e-7f ? numBins * (1.0f - 1e-5f) / extent : 0.0f;
+    }
+
+    auto binOf = [&](const Bounds& b, int axis)
+    {
+        int k = static_cast<int>((b.centroid(axis) - cb.min[axis]) * scale[axis]);
+        return std::min(std::max(k, 0), numBins - 1);
+    };
+
+    auto addToBins = [&](Bin (&target)[3][numBins], size_t i)
+    {
+        const Bounds& b = state.bounds[state.prims[i]];
+        for (int a = 0; a < 3; a++)
         {
-            value = v.bb.getCentroid().y;
+            Bin& bin = target[a][binOf(b, a)];
+            bin.bounds.expand(b);
+            bin.count++;
         }
-        else
+    };
+
+    Bin bins[3][numBins];
+    if (parallel)
+    {
+        #pragma omp parallel
         {
-            value = v.bb.getCentroid().z;
+            Bin local[3][numBins];
+
+            #pragma omp for nowait
+            for (long i = begin; i < (long)end; i++)
+            {
+                addToBins(local, i);
+            }
+
+            #pragma omp critical
+            for (int a = 0; a < 3; a++)
+            {
+                for (int k = 0; k < numBins; k++)
+                {
+                    bins[a][k].bounds.expand(local[a][k].bounds);
+                    bins[a][k].count += local[a][k].count;
+                }
+            }
+        }
+    }
+    else
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            addToBins(bins, i);
+        }
+    }
+
+    // SAH, surface area heuristic calculation: sweep the bins from both
+    // sides and evaluate the split behind each bin
+    float minCost = numeric_limits<float>::max();
+    int bestAxis = -1;
+    int bestBin = 0;
+
+    for (int a = 0; a < 3; a++)
+    {
+        if (scale[a] == 0.0f)
+        {
+            // bb side along this axis too short, we must move to a different axis
+            continue;
         }
 
-        // Create queues for left and right sub trees
-        if (value < bestSplit)
+        float rightArea[numBins];
+        size_t rightCount[numBins];
+        Bounds r;
+        size_t rc = 0;
+        for (int k = numBins - 1; k > 0; k--)
         {
-            leftWork.push_back(v);
-            lBb.expand(v.bb);
+            r.expand(bins[a][k].bounds);
+            rc += bins[a][k].count;
+            rightArea[k] = r.area();
+            rightCount[k] = rc;
         }
-        else
+
+        Bounds l;
+        size_t lc = 0;
+        for (int k = 0; k < numBins - 1; k++)
         {
-            rightWork.push_back(v);
-            rBb.expand(v.bb);
+            l.expand(bins[a][k].bounds);
+            lc += bins[a][k].count;
+            if (lc == 0 || rightCount[k + 1] == 0)
+            {
+                continue;
+            }
+            float cost = l.area() * lc + rightArea[k + 1] * rightCount[k + 1];
+            if (cost < minCost)
+            {
+                minCost = cost;
+                bestAxis = a;
+                bestBin = k;
+            }
         }
     }
 
-    // Recursively split new sub trees into further inner or leaf nodes
-    
-    auto inner = make_unique<BVHInner>();
+    if (bestAxis == -1)
+    {
+        // All centroids coincide, split in the middle to keep leaves small
+        return count <= maxLeafSize ? begin : begin + count / 2;
+    }
 
-    // #pragma omp parallel
-    // #pragma omp single nowait
-    // {
-    #pragma omp task shared(inner)
+    if (minCost >= count * bb.area() && count <= maxLeafSize)
     {
-        inner->left = buildTreeRecursive(leftWork, depth + 1);
-        inner->left->bb = lBb;
+        return begin;
     }
-    #pragma omp task shared(inner)
+
+    auto first = state.prims.begin() + begin;
+    auto last = state.prims.begin() + end;
+    auto mid = std::partition(first, last, [&](uint32_t p)
+    {
+        return binOf(state.bounds[p], bestAxis) <= bestBin;
+    });
+
+    return mid - state.prims.begin();
+}
+
+template<typename BaseVecT>
+size_t BVHTree<BaseVecT>::splitMorton(const BuildState& state, size_t begin, size_t end)
+{
+    uint32_t first = state.codes[begin];
+    uint32_t last = state.codes[end - 1];
+
+    if (first == last)
     {
-        inner->right = buildTreeRecursive(rightWork, depth + 1);
-        inner->right->bb = rBb;
+        // identical codes, split in the middle
+        return begin + (end - begin) / 2;
     }
-    #pragma omp taskwait
-    // }
-    
-    return move(inner);
+
+    // All codes of the node share the bits above the highest differing
+    // bit. Since they are sorted, the split is where this bit changes.
+    uint32_t diff = first ^ last;
+    uint32_t mask = 1u;
+    while (diff >>= 1)
+    {
+        mask <<= 1;
+    }
+
+    auto it = std::partition_point(
+        state.codes.begin() + begin,
+        state.codes.begin() + end,
+        [mask](uint32_t c) { return !(c & mask); });
+
+    return it - state.codes.begin();
 }
 
 template<typename BaseVecT>
@@ -626,4 +829,10 @@ const vector<float>& BVHTree<BaseVecT>::getTrianglesIntersectionData() const
     return m_trianglesIntersectionData;
 }
 
+template<typename BaseVecT>
+const vector<uint32_t>& BVHTree<BaseVecT>::getFaceIndices() const
+{
+    return m_faceIndices;
+}
+
 } /* namespace lvr2 */
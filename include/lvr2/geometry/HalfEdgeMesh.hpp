@@ -75,6 +75,14 @@ public:
     using Vertex = HalfEdgeVertex<BaseVecT>;
 
     HalfEdgeMesh();
+
+    /**
+     * @brief Creates a mesh from the vertices and face indices of the given
+     *        buffer.
+     *
+     * The mesh is built in bulk (see `buildFromIndexedTriangles()`) instead
+     * of calling `addFace()` for every face.
+     */
     HalfEdgeMesh(MeshBufferPtr ptr);
 
     // ========================================================================
@@ -183,6 +191,34 @@ private:
      */
     HalfEdgeHandle findOrCreateEdgeBetween(VertexHandle fromH, VertexHandle toH);
 
+    /**
+     * @brief Builds the mesh from an indexed triangle list. The mesh has to be
+     *        empty.
+     *
+     * Instead of calling `addFace()` for each face (which has to search for
+     * existing edges around the vertices), all directed edges are grouped by
+     * their (min, max) vertex key with a parallel counting sort. Twins are
+     * then paired in one pass and all half edges are allocated at once. The
+     * `next` handles of boundary edges are linked by circulating around each
+     * vertex in parallel.
+     *
+     * Faces which can't be handled this way (degenerated faces, invalid
+     * indices, non-manifold edges and vertices) are added with `addFace()`
+     * afterwards in their original order, so they are treated exactly like
+     * before: if `addFace()` fails, the face is omitted with a warning.
+     *
+     * @param vertices      Vertex positions (x, y, z)
+     * @param numVertices   Number of vertices
+     * @param indices       Vertex indices of the faces (3 per face)
+     * @param numFaces      Number of faces
+     */
+    void buildFromIndexedTriangles(
+        const floatArr& vertices,
+        size_t numVertices,
+        const indexArray& indices,
+        size_t numFaces
+    );
+
     /**
      * @brief Adds a new, incomplete edge-pair.
      *
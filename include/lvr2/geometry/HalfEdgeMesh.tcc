@@ -34,12 +34,14 @@
 
 #include <algorithm>
 #include <array>
+#include <limits>
 #include <utility>
 #include <iostream>
 
 #include "lvr2/attrmaps/AttrMaps.hpp"
 #include "lvr2/util/Panic.hpp"
 #include "lvr2/util/Debug.hpp"
+#include "lvr2/util/Util.hpp"
 
 
 namespace lvr2
@@ -53,27 +55,466 @@ HalfEdgeMesh<BaseVecT>::HalfEdgeMesh()
 template<typename BaseVecT>
 HalfEdgeMesh<BaseVecT>::HalfEdgeMesh(MeshBufferPtr ptr)
 {
-    size_t numFaces = ptr->numFaces();
-    size_t numVertices = ptr->numVertices();
+    buildFromIndexedTriangles(
+        ptr->getVertices(),
+        ptr->numVertices(),
+        ptr->getFaceIndices(),
+        ptr->numFaces()
+    );
+}
+
+template<typename BaseVecT>
+void HalfEdgeMesh<BaseVecT>::buildFromIndexedTriangles(
+    const floatArr& vertices,
+    size_t numVertices,
+    const indexArray& indices,
+    size_t numFaces
+)
+{
+    const Index none = std::numeric_limits<Index>::max();
+
+    // A corner is the i-th vertex of a face. Each corner `c` is the source of
+    // the inner half edge from `indices[c]` to the next vertex of the face.
+    auto sourceOf = [&](size_t corner)
+    {
+        return indices[corner];
+    };
+    auto targetOf = [&](size_t corner)
+    {
+        return indices[corner - corner % 3 + (corner + 1) % 3];
+    };
+
+    // =======================================================================
+    // = Add all vertices at once
+    // =======================================================================
+    m_vertices = StableVector<VertexHandle, Vertex>(numVertices, Vertex());
 
-    floatArr vertices = ptr->getVertices();
-    indexArray indices = ptr->getFaceIndices();
+    #pragma omp parallel for
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        m_vertices[VertexHandle(i)].pos = BaseVecT(
+            vertices[3 * i],
+            vertices[3 * i + 1],
+            vertices[3 * i + 2]
+        );
+    }
 
-    for(size_t i = 0; i < numVertices; i++)
+    // Faces that are not added in bulk, but with `addFace()` afterwards
+    // (value 1). Faces with non-manifold edges and vertices are added to
+    // this set when they are detected. Degenerated faces and faces with
+    // invalid indices are omitted completely (value 2), since `addFace()`
+    // can't handle them either.
+    vector<uint8_t> deferred(numFaces, 0);
+
+    #pragma omp parallel for
+    for (size_t f = 0; f < numFaces; f++)
     {
-        size_t pos = 3 * i;
-        this->addVertex(BaseVecT(
-                            vertices[pos],
-                            vertices[pos + 1],
-                            vertices[pos + 2]));
+        Index a = indices[3 * f];
+        Index b = indices[3 * f + 1];
+        Index c = indices[3 * f + 2];
+        if (a >= numVertices || b >= numVertices || c >= numVertices
+            || a == b || b == c || a == c)
+        {
+            deferred[f] = 2;
+        }
     }
 
-    for(size_t i = 0; i < numFaces; i++)
+    // Corners grouped by the smaller vertex index of their edge ("bucket").
+    // Within each bucket they are sorted by the larger vertex index, so that
+    // all half edges between the same two vertices are next to each other.
+    vector<size_t> bucketOffsets(numVertices + 1);
+    vector<size_t> bucketCorners;
+
+    // Half edge of each corner and the face handle of each face
+    vector<Index> cornerEdge(3 * numFaces, none);
+    vector<Index> faceIndex(numFaces);
+
+    // Per vertex data to link the boundary edges around each vertex
+    vector<Index> degree(numVertices);
+    vector<size_t> anyCorner(numVertices);
+    vector<Index> boundaryOffsets(numVertices + 1);
+    vector<Index> boundaryEdges;
+    vector<uint8_t> badVertex(numVertices);
+
+    bool restart = true;
+    while (restart)
     {
-        size_t pos = 3 * i;
+        restart = false;
+
+        // ===================================================================
+        // = Group all half edges by their (min, max) vertex key
+        // ===================================================================
+        bool edgesChanged = true;
+        while (edgesChanged)
+        {
+            edgesChanged = false;
+
+            // Counting sort by the smaller vertex index
+            std::fill(bucketOffsets.begin(), bucketOffsets.end(), 0);
+
+            #pragma omp parallel for
+            for (size_t corner = 0; corner < 3 * numFaces; corner++)
+            {
+                if (!deferred[corner / 3])
+                {
+                    Index key = std::min(sourceOf(corner), targetOf(corner));
+                    #pragma omp atomic
+                    bucketOffsets[key]++;
+                }
+            }
+
+            const size_t numCorners = Util::parallel_exclusive_scan(bucketOffsets);
+            bucketCorners.resize(numCorners);
+
+            vector<size_t> cursor(bucketOffsets.begin(), bucketOffsets.end() - 1);
+
+            #pragma omp parallel for
+            for (size_t corner = 0; corner < 3 * numFaces; corner++)
+            {
+                if (!deferred[corner / 3])
+                {
+                    Index key = std::min(sourceOf(corner), targetOf(corner));
+                    size_t pos;
+                    #pragma omp atomic capture
+                    pos = cursor[key]++;
+                    bucketCorners[pos] = corner;
+                }
+            }
+            bucketOffsets[numVertices] = numCorners;
+
+            // Sort each bucket by the larger vertex index. The corner index
+            // is used as tie breaker to make the result deterministic.
+            #pragma omp parallel for schedule(dynamic, 1024)
+            for (size_t v = 0; v < numVertices; v++)
+            {
+                std::sort(
+                    bucketCorners.begin() + bucketOffsets[v],
+                    bucketCorners.begin() + bucketOffsets[v + 1],
+                    [&](size_t c1, size_t c2)
+                    {
+                        Index max1 = std::max(sourceOf(c1), targetOf(c1));
+                        Index max2 = std::max(sourceOf(c2), targetOf(c2));
+                        return max1 < max2 || (max1 == max2 && c1 < c2);
+                    }
+                );
+            }
+
+            // Check all edges: an edge can have at most two half edges which
+            // have to point in opposite directions. Otherwise the edge is
+            // non-manifold and its faces have to be added via `addFace()`.
+            #pragma omp parallel for schedule(dynamic, 1024) reduction(||:edgesChanged)
+            for (size_t v = 0; v < numVertices; v++)
+            {
+                size_t i = bucketOffsets[v];
+                while (i < bucketOffsets[v + 1])
+                {
+                    size_t c1 = bucketCorners[i];
+                    Index max1 = std::max(sourceOf(c1), targetOf(c1));
+                    size_t j = i + 1;
+                    while (j < bucketOffsets[v + 1]
+                        && std::max(sourceOf(bucketCorners[j]), targetOf(bucketCorners[j])) == max1)
+                    {
+                        j++;
+                    }
+
+                    bool valid = (j - i == 1)
+                        || (j - i == 2 && sourceOf(c1) == targetOf(bucketCorners[i + 1]));
+                    if (!valid)
+                    {
+                        for (size_t k = i; k < j; k++)
+                        {
+                            #pragma omp atomic write
+                            deferred[bucketCorners[k] / 3] = 1;
+                        }
+                        edgesChanged = true;
+                    }
+                    i = j;
+                }
+            }
+        }
+
+        // ===================================================================
+        // = Assign half edge handles
+        // ===================================================================
+        // Each edge gets two consecutive half edge handles. First count the
+        // edges in each bucket to get the first handle of each bucket.
+        vector<size_t> edgeOffsets(numVertices);
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            size_t count = 0;
+            Index lastMax = none;
+            for (size_t i = bucketOffsets[v]; i < bucketOffsets[v + 1]; i++)
+            {
+                size_t c = bucketCorners[i];
+                Index maxIdx = std::max(sourceOf(c), targetOf(c));
+                if (maxIdx != lastMax)
+                {
+                    count++;
+                    lastMax = maxIdx;
+                }
+            }
+            edgeOffsets[v] = count;
+        }
+        const size_t numEdges = Util::parallel_exclusive_scan(edgeOffsets);
+        if (2 * numEdges >= none)
+        {
+            panic("buildFromIndexedTriangles(): too many edges for 32 bit handles");
+        }
+
+        #pragma omp parallel for
+        for (size_t f = 0; f < numFaces; f++)
+        {
+            faceIndex[f] = deferred[f] ? 0 : 1;
+        }
+        const Index numBulkFaces = Util::parallel_exclusive_scan(faceIndex);
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            Index edge = static_cast<Index>(edgeOffsets[v]);
+            size_t i = bucketOffsets[v];
+            while (i < bucketOffsets[v + 1])
+            {
+                cornerEdge[bucketCorners[i]] = 2 * edge;
+                if (i + 1 < bucketOffsets[v + 1])
+                {
+                    size_t c1 = bucketCorners[i];
+                    size_t c2 = bucketCorners[i + 1];
+                    if (std::max(sourceOf(c1), targetOf(c1)) == std::max(sourceOf(c2), targetOf(c2)))
+                    {
+                        cornerEdge[c2] = 2 * edge + 1;
+                        i++;
+                    }
+                }
+                edge++;
+                i++;
+            }
+        }
+
+        // ===================================================================
+        // = Create all half edges and faces at once
+        // ===================================================================
+        m_edges = StableVector<HalfEdgeHandle, Edge>(2 * numEdges, Edge());
+        m_faces = StableVector<FaceHandle, Face>(numBulkFaces, Face(HalfEdgeHandle(0)));
+
+        // Inner edges
+        #pragma omp parallel for
+        for (size_t f = 0; f < numFaces; f++)
+        {
+            if (deferred[f])
+            {
+                continue;
+            }
+
+            FaceHandle faceH(faceIndex[f]);
+            m_faces[faceH].edge = HalfEdgeHandle(cornerEdge[3 * f]);
+
+            for (size_t i = 0; i < 3; i++)
+            {
+                size_t corner = 3 * f + i;
+                HalfEdgeHandle eH(cornerEdge[corner]);
+                auto& e = m_edges[eH];
+                e.face = faceH;
+                e.target = VertexHandle(targetOf(corner));
+                e.next = HalfEdgeHandle(cornerEdge[3 * f + (i + 1) % 3]);
+                e.twin = HalfEdgeHandle(eH.idx() ^ 1);
+            }
+        }
+
+        // Boundary edges: the second half of each edge that only has one
+        // face. Their `next` handle is set below.
+        std::fill(boundaryOffsets.begin(), boundaryOffsets.end(), 0);
+
+        #pragma omp parallel for schedule(dynamic, 1024)
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            for (size_t i = bucketOffsets[v]; i < bucketOffsets[v + 1]; i++)
+            {
+                size_t corner = bucketCorners[i];
+                Index eIdx = cornerEdge[corner];
+                if (eIdx % 2 == 0 && (i + 1 == bucketOffsets[v + 1]
+                    || cornerEdge[bucketCorners[i + 1]] != eIdx + 1))
+                {
+                    auto& e = m_edges[HalfEdgeHandle(eIdx + 1)];
+                    e.face = OptionalFaceHandle();
+                    e.target = VertexHandle(sourceOf(corner));
+                    e.twin = HalfEdgeHandle(eIdx);
+
+                    #pragma omp atomic
+                    boundaryOffsets[targetOf(corner)]++;
+                }
+            }
+        }
+
+        // Sort the boundary edges by the vertex they start at
+        const Index numBoundaryEdges = Util::parallel_exclusive_scan(boundaryOffsets);
+        boundaryOffsets[numVertices] = numBoundaryEdges;
+        boundaryEdges.resize(numBoundaryEdges);
+        {
+            vector<Index> cursor(boundaryOffsets.begin(), boundaryOffsets.end() - 1);
+
+            #pragma omp parallel for
+            for (size_t edge = 0; edge < numEdges; edge++)
+            {
+                const auto& e = m_edges[HalfEdgeHandle(2 * edge + 1)];
+                if (!e.face)
+                {
+                    Index source = m_edges[e.twin].target.idx();
+                    Index pos;
+                    #pragma omp atomic capture
+                    pos = cursor[source]++;
+                    boundaryEdges[pos] = 2 * edge + 1;
+                }
+            }
+
+            #pragma omp parallel for schedule(dynamic, 1024)
+            for (size_t v = 0; v < numVertices; v++)
+            {
+                std::sort(
+                    boundaryEdges.begin() + boundaryOffsets[v],
+                    boundaryEdges.begin() + boundaryOffsets[v + 1]
+                );
+            }
+        }
+
+        // Number of faces around each vertex and one (arbitrary) corner
+        std::fill(degree.begin(), degree.end(), 0);
+
+        #pragma omp parallel for
+        for (size_t corner = 0; corner < 3 * numFaces; corner++)
+        {
+            if (!deferred[corner / 3])
+            {
+                #pragma omp atomic
+                degree[sourceOf(corner)]++;
+                #pragma omp atomic write
+                anyCorner[sourceOf(corner)] = corner;
+            }
+        }
+
+        // ===================================================================
+        // = Link the fans around each vertex
+        // ===================================================================
+        // Circulating around a vertex over its ingoing edges (e -> e.next.twin)
+        // visits one fan of faces until a boundary edge is reached. The
+        // boundary edge at the end of each fan is linked to the outgoing
+        // boundary edge at the start of the next fan. If not all faces of a
+        // vertex are reached this way, it has more than one closed fan, which
+        // a half edge mesh can't represent.
+        bool foundBadVertex = false;
+
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(||:foundBadVertex)
+        for (size_t v = 0; v < numVertices; v++)
+        {
+            badVertex[v] = 0;
+            m_vertices[VertexHandle(v)].outgoing = OptionalHalfEdgeHandle();
+            if (degree[v] == 0)
+            {
+                continue;
+            }
+
+            // Like `addFace()`, we use the edge of the first face as
+            // outgoing edge.
+            Index visited = 0;
+            OptionalHalfEdgeHandle outgoing;
+            Index firstFace = none;
+
+            auto visitFan = [&](HalfEdgeHandle startH)
+            {
+                auto eH = startH;
+                while (visited <= degree[v])
+                {
+                    visited++;
+                    auto nextH = m_edges[eH].next;
+                    Index faceIdx = m_edges[eH].face.unwrap().idx();
+                    if (faceIdx < firstFace)
+                    {
+                        firstFace = faceIdx;
+                        outgoing = nextH;
+                    }
+
+                    eH = m_edges[nextH].twin;
+                    if (!m_edges[eH].face || eH == startH)
+                    {
+                        break;
+                    }
+                }
+                return eH;
+            };
+
+            Index begin = boundaryOffsets[v];
+            Index end = boundaryOffsets[v + 1];
+            if (begin == end)
+            {
+                // A single closed fan: start with the edge pointing to `v`
+                // in any of its faces
+                size_t corner = anyCorner[v];
+                visitFan(HalfEdgeHandle(cornerEdge[corner - corner % 3 + (corner + 2) % 3]));
+            }
+            else
+            {
+                for (Index i = begin; i < end; i++)
+                {
+                    HalfEdgeHandle fanStartH(boundaryEdges[i]);
+                    auto fanEndH = visitFan(m_edges[fanStartH].twin);
+                    Index nextFan = (i + 1 < end) ? i + 1 : begin;
+                    m_edges[fanEndH].next = HalfEdgeHandle(boundaryEdges[nextFan]);
+                }
+            }
+
+            if (visited != degree[v])
+            {
+                badVertex[v] = 1;
+                foundBadVertex = true;
+            }
+            else
+            {
+                m_vertices[VertexHandle(v)].outgoing = outgoing;
+            }
+        }
+
+        // Faces around non-manifold vertices are added with `addFace()`,
+        // which has its own rules for them. As this changes the edges of the
+        // remaining faces, we have to start over. This only happens for
+        // broken meshes.
+        if (foundBadVertex)
+        {
+            #pragma omp parallel for
+            for (size_t f = 0; f < numFaces; f++)
+            {
+                if (!deferred[f] && (badVertex[indices[3 * f]]
+                    || badVertex[indices[3 * f + 1]] || badVertex[indices[3 * f + 2]]))
+                {
+                    deferred[f] = 1;
+                }
+            }
+            restart = true;
+        }
+    }
+
+    // =======================================================================
+    // = Add the remaining faces one by one
+    // =======================================================================
+    for (size_t f = 0; f < numFaces; f++)
+    {
+        if (!deferred[f])
+        {
+            continue;
+        }
+
+        size_t pos = 3 * f;
         VertexHandle v1(indices[pos]);
         VertexHandle v2(indices[pos + 1]);
         VertexHandle v3(indices[pos + 2]);
+        if (deferred[f] == 2)
+        {
+            std::cerr << timestamp << "Warning: degenerated face. Omitting face "
+                      << v1.idx() << " " << v2.idx() << " " << v3.idx() << std::endl;
+            continue;
+        }
+
         try
         {
             this->addFace(v1, v2, v3);
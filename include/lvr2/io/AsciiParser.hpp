@@ -0,0 +1,117 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * AsciiParser.hpp
+ */
+
+#ifndef LVR2_IO_ASCIIPARSER_HPP
+#define LVR2_IO_ASCIIPARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Destination of one column of a point cloud in a text file.
+ *
+ * The value of the k-th parsed line is written to `data + k * stride`
+ * (stride in bytes). This allows to write into separate channels as well as
+ * into interleaved point structs.
+ */
+struct AsciiColumn
+{
+    enum Type
+    {
+        FLOAT,
+        UCHAR
+    };
+
+    /// Index of the column within a line (starting at 0)
+    int         column;
+
+    /// Type of the destination
+    Type        type;
+
+    /// Destination of the value of the first line
+    char*       data;
+
+    /// Distance between the values of two lines in bytes
+    size_t      stride;
+};
+
+/**
+ * @brief Parser for point clouds stored as text with one point per line.
+ *
+ * Large files are parsed in parallel: The text is split into chunks at line
+ * boundaries, each chunk is parsed by one thread directly into the
+ * destination buffers. Numbers are converted with a fast path for the
+ * common case of decimal numbers with few digits. Columns may be separated
+ * by whitespace or commas. Lines that don't contain all requested columns
+ * (e.g. empty lines or comments) are skipped.
+ */
+class AsciiParser
+{
+public:
+
+    /**
+     * @brief Returns the number of lines in [begin, end). A last line without
+     *        line break is counted as well.
+     */
+    static size_t countLines(const char* begin, const char* end);
+
+    /**
+     * @brief Returns the position after the first `n` lines in [begin, end)
+     *        or `end` if there are less lines.
+     */
+    static const char* skipLines(const char* begin, const char* end, size_t n);
+
+    /**
+     * @brief Parses all lines in [begin, end) into the given columns.
+     *
+     * The destination buffers have to be large enough for
+     * `countLines(begin, end)` lines.
+     *
+     * @return The number of parsed lines (lines with all columns)
+     */
+    static size_t parse(const char* begin, const char* end, const std::vector<AsciiColumn>& columns);
+
+    /**
+     * @brief Parses a floating point number at `p` and advances `p` behind
+     *        it. Returns false if there is no number at `p`.
+     *
+     * The result is correctly rounded to float, i.e. the same as strtof.
+     */
+    static bool parseFloat(const char*& p, const char* end, float& value);
+};
+
+} // namespace lvr2
+
+#endif // LVR2_IO_ASCIIPARSER_HPP
@@ -48,6 +48,19 @@ public:
      */
     GeoTIFFIO(std::string filename, int cols, int rows, int bands);
 
+    /**
+     * @brief Creates a tiled GeoTIFF file. Tiles are stored band by band, so
+     *        bands can be written independently in blocks of rows.
+     *
+     * @param filename filename of output GeoTIFF file
+     * @param cols number of columns / width of the image
+     * @param rows number of rows / length of the image
+     * @param bands number of bands
+     * @param tileSize width and height of the tiles, 0 for a striped file
+     * @param compression GDAL compression (e.g. DEFLATE, LZW, ZSTD), empty for none
+     */
+    GeoTIFFIO(std::string filename, int cols, int rows, int bands, int tileSize, std::string compression = "");
+
     /**
      * @param filename
      */
@@ -61,6 +74,26 @@ public:
      */
     int writeBand(cv::Mat *mat, int band);
 
+    /**
+     * @brief Writes a window of a band into the open GeoTIFF file. Windows
+     *        that are aligned to the tiles are written without reading back
+     *        tiles from the file.
+     *
+     * @param data row major band data of the window
+     * @param band number of band to be written
+     * @param x column of the upper left corner of the window
+     * @param y row of the upper left corner of the window
+     * @param width width of the window
+     * @param height height of the window
+     * @return standard C++ return value
+     */
+    int writeBlock(const uint16_t *data, int band, int x, int y, int width, int height);
+
+    /**
+     * @return number of rows of the tiles (or strips) of the dataset
+     */
+    int getBlockHeight();
+
     /**
      * @return width of dataset in number of pixels
      */
@@ -33,6 +33,7 @@
 
 #include "lvr2/geometry/BaseVector.hpp"
 #include "lvr2/io/AttributeMeshIOBase.hpp"
+#include "lvr2/io/hdf5/CompressionProfile.hpp"
 // #include "lvr2/types/Hyperspectral.hpp"
 #include "lvr2/types/MatrixTypes.hpp"
 #include "lvr2/types/ScanTypes.hpp"
@@ -113,6 +114,19 @@ class HDF5IO : public BaseIO, public AttributeMeshIOBase
 
     ScanPtr getSingleRawScan(int nr, bool load_points = true);
 
+    /**
+     * @brief Returns the level of detail pyramid of the preview of a scan.
+     *        Entry i is the number of preview points up to and including
+     *        level i. Empty if the scan has no preview.
+     */
+    std::vector<size_t> getPreviewLevels(int nr);
+
+    /**
+     * @brief Reads the preview points [first, last) of a scan. Reading
+     *        up to the end of a level results in a uniform subsample.
+     */
+    PointBufferPtr getPreviewPoints(int nr, size_t first, size_t last);
+
     ScanImage getSingleRawCamData(int scan_id, int img_id, bool load_image_data = true);
 
     std::vector<ScanPtr> getRawScans(bool load_points = true);
@@ -142,6 +156,18 @@ class HDF5IO : public BaseIO, public AttributeMeshIOBase
 
     void setCompress(bool compress);
     void setChunkSize(const size_t& size);
+
+    /**
+     * @brief Sets the chunking and compression profile used for new datasets.
+     *        setCompress(false) still disables compression.
+     */
+    void setCompression(const Hdf5CompressionProfile& profile);
+
+    /**
+     * @brief Returns the effective profile, i.e., the configured profile
+     *        combined with the compress flag and the chunk size limit.
+     */
+    Hdf5CompressionProfile compression() const;
     void setPreviewReductionFactor(const unsigned int factor);
     void setUsePreviews(bool use);
 
@@ -318,6 +344,7 @@ class HDF5IO : public BaseIO, public AttributeMeshIOBase
 
     bool                    m_compress;
     size_t                  m_chunkSize;
+    Hdf5CompressionProfile  m_compression;
     bool                    m_usePreviews;
     unsigned int            m_previewReductionFactor;
     std::string             m_part_name;
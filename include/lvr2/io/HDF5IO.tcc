@@ -36,27 +36,7 @@ void HDF5IO::addArray(HighFive::Group& g,
         boost::shared_array<T>& data)
 {
     HighFive::DataSpace dataSpace(dim);
-    HighFive::DataSetCreateProps properties;
-
-    if(m_chunkSize)
-    {
-        // We have to check explicitly if chunk size
-        // is < dimensionality to avoid errors from
-        // the HDF5 lib
-        for(size_t i = 0; i < chunkSizes.size(); i++)
-        {
-            if(chunkSizes[i] > dim[i])
-            {
-                chunkSizes[i] = dim[i];
-            }
-        }
-        properties.add(HighFive::Chunking(chunkSizes));
-    }
-    if(m_compress)
-    {
-        //properties.add(HighFive::Shuffle());
-        properties.add(HighFive::Deflate(9));
-    }
+    HighFive::DataSetCreateProps properties = compression().template properties<T>(dim, chunkSizes);
     HighFive::DataSet dataset = g.createDataSet<T>(datasetName, dataSpace, properties);
     const T* ptr = data.get();
     dataset.write(ptr);
@@ -82,14 +62,8 @@ void HDF5IO::addArray(
 {
     HighFive::Group g = getGroup(groupName);
 
-    // Compute chunk size vector, i.e., set the chunk size in
-    // each dimension to default size. Add float array will
-    // trim this values if chunkSize > dim.
+    // Let the compression profile choose the chunk shape
     std::vector<hsize_t> chunks;
-    for(auto i: dimensions)
-    {
-            chunks.push_back(i);
-    }
     addArray(g, datasetName, dimensions, chunks, data);
 }
 
@@ -101,7 +75,7 @@ void HDF5IO::addArray(
     if(m_hdf5_file)
     {
         std::vector<size_t> dim = {size, 1};
-        std::vector<hsize_t> chunks {m_chunkSize, 1};
+        std::vector<hsize_t> chunks;
         HighFive::Group g = getGroup(group);
         addArray(g, name, dim, chunks, data);
     }
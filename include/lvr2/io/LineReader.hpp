@@ -117,6 +117,9 @@ public:
   };
 
 private:
+  /// Parses the next points of the current ascii file
+  boost::shared_ptr<void> getNextAsciiPoints(size_t &return_amount, size_t amount);
+
   std::vector<std::string> m_filePaths;
   std::vector<size_t> m_filePos;
   size_t m_elementAmount;
@@ -41,6 +41,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
+#include <memory>
 
 #include <boost/shared_ptr.hpp>
 
@@ -48,6 +50,10 @@
 namespace lvr2
 {
 
+class PointCloudWriter;
+struct PointCloudLayout;
+using PointCloudWriterPtr = std::shared_ptr<PointCloudWriter>;
+
 /**
  * @brief Factory class extract point cloud and mesh information
  *        from supported file formats. The instantiated MeshLoader
@@ -63,8 +69,36 @@ class ModelFactory
 
         static void saveModel( ModelPtr m, std::string file);
 
+        /**
+         * @brief Reads the point cloud of the given file in batches of at
+         *        most batchSize points.
+         *
+         * Only binary PLY point clouds are currently streamed from disk.
+         * Returns false without calling the callback if the file does not
+         * support this. The caller has to fall back to readModel() then.
+         */
+        static bool readPointCloudBatches(
+            std::string filename,
+            size_t batchSize,
+            const std::function<void(PointBufferPtr)>& callback);
+
+        /**
+         * @brief Creates a writer that appends point clouds batch by batch
+         *        to the given file. Supported formats are .ply, .las and
+         *        .h5. Returns an empty pointer for other formats or if the
+         *        file could not be created.
+         */
+        static PointCloudWriterPtr openPointCloudWriter(
+            std::string filename,
+            const PointCloudLayout& layout);
+
         static CoordinateTransform<float> m_transform;
 
+    private:
+
+        /// Applies m_transform to the points and normals of the buffer
+        static void transformPointBuffer(PointBufferPtr points);
+
 };
 
 typedef boost::shared_ptr<ModelFactory> ModelFactoryPtr;
@@ -47,6 +47,7 @@
 #include <stdint.h>
 #include <cstdio>
 #include <vector>
+#include <functional>
 
 #include <locale.h>
 
@@ -162,6 +163,25 @@ class PLYIO : public BaseIO
         ModelPtr read( string filename );
 
 
+        /**
+         * \brief Read the point cloud of a PLY file in batches.
+         *
+         * The file is mapped into memory and only the points of the current
+         * batch are decoded, so the needed memory does not depend on the
+         * size of the file. Only binary little endian files without faces
+         * are supported. Points, colors, normals and intensities are read.
+         *
+         * \param filename        Filename of file to read.
+         * \param batchSize       Maximum number of points per batch.
+         * \param callback        Called with the points of each batch.
+         *
+         * \return false if the file can not be read this way. The callback
+         *         is not called in this case.
+         **/
+        static bool readPointBatches( string filename, size_t batchSize,
+                const std::function<void(PointBufferPtr)>& callback );
+
+
     private:
 
 
@@ -0,0 +1,212 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PointCloudWriter.hpp
+ */
+
+#ifndef LVR2_IO_POINTCLOUDWRITER_HPP
+#define LVR2_IO_POINTCLOUDWRITER_HPP
+
+#include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/io/hdf5/CompressionProfile.hpp"
+
+#include <highfive/H5File.hpp>
+#include <highfive/H5DataSet.hpp>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+class LASheader;
+class LASpoint;
+class LASwriter;
+
+namespace lvr2
+{
+
+/**
+ * @brief The channels that are written by a PointCloudWriter in addition
+ *        to the point coordinates.
+ */
+struct PointCloudLayout
+{
+    PointCloudLayout(bool colors = false, bool normals = false, bool intensities = false)
+        : colors(colors), normals(normals), intensities(intensities) {}
+
+    /// Creates the layout of all supported channels of the given buffer
+    explicit PointCloudLayout(const PointBuffer& buffer);
+
+    bool colors;
+    bool normals;
+    bool intensities;
+};
+
+/**
+ * @brief Incremental writer for point clouds that don't fit into memory.
+ *
+ * The file is opened with a fixed layout, afterwards the points are appended
+ * in batches of arbitrary size. Channels of a batch that are not part of the
+ * layout are ignored, channels of the layout that are missing in a batch are
+ * filled with zeros. The file is complete after close() was called, which
+ * also happens on destruction.
+ */
+class PointCloudWriter
+{
+public:
+    PointCloudWriter() : m_numPoints(0), m_open(false) {}
+
+    virtual ~PointCloudWriter() = default;
+
+    /**
+     * @brief Creates the given file. Returns false on error.
+     */
+    virtual bool open(const std::string& filename, const PointCloudLayout& layout) = 0;
+
+    /**
+     * @brief Appends the points of the given buffer to the file.
+     */
+    virtual void append(PointBufferPtr batch) = 0;
+
+    /**
+     * @brief Writes all pending data and closes the file.
+     */
+    virtual void close() = 0;
+
+    /// Returns the number of points that were appended so far
+    size_t numPoints() const { return m_numPoints; }
+
+    /// Returns the layout the file was opened with
+    const PointCloudLayout& layout() const { return m_layout; }
+
+    bool isOpen() const { return m_open; }
+
+protected:
+
+    /**
+     * @brief Channel data of a batch. Missing channels are replaced by zeros.
+     */
+    struct BatchData
+    {
+        BatchData(const PointCloudLayout& layout, PointBufferPtr batch);
+
+        size_t      n;
+        floatArr    points;
+        ucharArr    colors;
+        size_t      colorWidth;
+        floatArr    normals;
+        floatArr    intensities;
+    };
+
+    size_t              m_numPoints;
+    PointCloudLayout    m_layout;
+    bool                m_open;
+};
+
+using PointCloudWriterPtr = std::shared_ptr<PointCloudWriter>;
+
+/**
+ * @brief Writes binary little endian PLY files. The number of points in the
+ *        header is filled in on close.
+ */
+class PLYPointCloudWriter : public PointCloudWriter
+{
+public:
+    ~PLYPointCloudWriter();
+
+    bool open(const std::string& filename, const PointCloudLayout& layout) override;
+    void append(PointBufferPtr batch) override;
+    void close() override;
+
+private:
+    std::ofstream           m_out;
+    std::streampos          m_countPos;
+    std::vector<char>       m_buffer;
+};
+
+/**
+ * @brief Writes LAS files. The coordinates are stored with millimeter
+ *        precision relative to the first appended point, colors are scaled
+ *        to 16 bit and intensities are clamped to 16 bit. Normals are not
+ *        supported by the format and ignored.
+ */
+class LasPointCloudWriter : public PointCloudWriter
+{
+public:
+    LasPointCloudWriter();
+    ~LasPointCloudWriter();
+
+    bool open(const std::string& filename, const PointCloudLayout& layout) override;
+    void append(PointBufferPtr batch) override;
+    void close() override;
+
+private:
+    std::string                 m_filename;
+    std::unique_ptr<LASheader>  m_header;
+    std::unique_ptr<LASpoint>   m_point;
+    LASwriter*                  m_writer;
+};
+
+/**
+ * @brief Writes the points as a single scan into the raw scan structure of
+ *        an HDF5 file (see HDF5IO). The datasets are chunked and extended
+ *        with every batch.
+ */
+class HDF5PointCloudWriter : public PointCloudWriter
+{
+public:
+    HDF5PointCloudWriter(
+        size_t chunkSize = 1 << 16,
+        const Hdf5CompressionProfile& compression = Hdf5CompressionProfile::fast())
+        : m_chunkSize(chunkSize), m_compression(compression) {}
+    ~HDF5PointCloudWriter();
+
+    bool open(const std::string& filename, const PointCloudLayout& layout) override;
+    void append(PointBufferPtr batch) override;
+    void close() override;
+
+private:
+    template<typename T>
+    std::unique_ptr<HighFive::DataSet> createDataSet(const std::string& name, size_t width);
+
+    template<typename T>
+    void appendRows(HighFive::DataSet& dataset, size_t width, const T* data, size_t n);
+
+    size_t                              m_chunkSize;
+    Hdf5CompressionProfile              m_compression;
+    std::unique_ptr<HighFive::File>     m_file;
+    std::unique_ptr<HighFive::Group>    m_group;
+    std::unique_ptr<HighFive::DataSet>  m_points;
+    std::unique_ptr<HighFive::DataSet>  m_colors;
+    std::unique_ptr<HighFive::DataSet>  m_normals;
+    std::unique_ptr<HighFive::DataSet>  m_intensities;
+    float                               m_bb[6];
+};
+
+} // namespace lvr2
+
+#endif // LVR2_IO_POINTCLOUDWRITER_HPP
@@ -43,6 +43,17 @@ class ScanDataManager
 
         void loadPointCloudData(ScanPtr &sd, bool preview = false);
 
+        /**
+         * @brief Loads the preview of a scan up to the given level of detail.
+         *        Points of coarser levels that are already loaded are kept,
+         *        so refining a preview level by level reads every point only
+         *        once. Levels beyond the pyramid load the full scan.
+         */
+        void loadPointCloudPreview(ScanPtr &sd, size_t level);
+
+        /// Returns the number of levels of detail in the preview of a scan
+        size_t numPreviewLevels(ScanPtr &sd);
+
         std::vector<ScanPtr> getScans();
 
         std::vector<std::vector<ScanImage> > getCameraData();
@@ -65,7 +65,18 @@ public:
 
     void parseDirectory();
 
+    /**
+     * @brief Writes a random sample of each scan, transformed with its pose,
+     *        to "<scan>_reduced.ply". The scans contribute to targetSize
+     *        points according to their size; a target size of 0 keeps all
+     *        points. Scans are streamed in batches if their format allows it.
+     */
     PointBufferPtr randomSubSample(const size_t& targetSize);
+
+    /**
+     * @brief Like randomSubSample(), but reduces each scan with an octree.
+     *        Each scan is loaded as a whole.
+     */
     PointBufferPtr octreeSubSample(const double& voxelSize, const size_t& minPoints = 5);
     
     ~ScanDirectoryParser() = default;
@@ -76,9 +76,26 @@ bool loadScanImage(
     const std::string& cameraDirectory,
     const size_t& imageNumber);
 
+/**
+ * @brief Loads all images in the given data directory.
+ *
+ * @param images    The loaded images are appended here
+ * @param dataPath  Directory with the numbered .yaml and .png files
+ * @param loadData  If false, only the meta data is read and the image
+ *                  files are decoded on demand by loadScanImageData()
+ */
 void loadScanImages(
     vector<ScanImagePtr>& images,
-    boost::filesystem::path dataPath);
+    boost::filesystem::path dataPath,
+    bool loadData = true);
+
+/**
+ * @brief Decodes the image file of a ScanImage that was loaded without
+ *        data. Does nothing if the image is already present.
+ *
+ * @return true if the image is available afterwards
+ */
+bool loadScanImageData(ScanImage& image);
 
 //////////////////////////////////////////////////////////////////////////////////
 /// SCANCAMERA
@@ -106,19 +123,22 @@ bool loadScanCamera(
     const boost::filesystem::path& root,
     ScanCamera& image,
     const std::string& positionDirectory,
-    const std::string& cameraDirectory);
+    const std::string& cameraDirectory,
+    bool loadData = true);
 
 bool loadScanCamera(
     const boost::filesystem::path& root,
     ScanCamera& image,
     const std::string& positionDirectory,
-    const size_t& cameraNumber);
+    const size_t& cameraNumber,
+    bool loadData = true);
 
 bool loadScanCamera(
     const boost::filesystem::path& root,
     ScanCamera& image,
     const size_t& positionNumber,
-    const size_t& cameraNumber);
+    const size_t& cameraNumber,
+    bool loadData = true);
 
 //////////////////////////////////////////////////////////////////////////////////
 /// SCAN
@@ -153,12 +173,25 @@ void saveScan(
     const size_t& positionNumber,
     const size_t& scanNumber);
 
+/**
+ * @brief Loads a Scan struct.
+ *
+ * @param root                  Project root directory
+ * @param scan                  The loaded scan
+ * @param positionDirectory     The name of the scan position
+ * @param scanDirectory         The name of the scan directory
+ * @param scanName              The name of the scan file without extension
+ * @param loadData              If false, only the meta data is read. The
+ *                              points are loaded by loadScanData() and
+ *                              Scan::pointsLoaded is false until then.
+ */
 bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const std::string& positionDirectory,
     const std::string& scanDirectory,
-    const std::string& scanName);
+    const std::string& scanName,
+    bool loadData = true);
 
 bool loadScan(
     const boost::filesystem::path& root,
@@ -171,7 +204,17 @@ bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const size_t& positionNumber,
-    const size_t& scanNumber);
+    const size_t& scanNumber,
+    bool loadData = true);
+
+/**
+ * @brief Loads the points of a scan that was loaded without data, i.e.,
+ *        reads Scan::scanFile and sets Scan::pointsLoaded. Does nothing
+ *        if the points are already loaded.
+ *
+ * @return true if the points are available afterwards
+ */
+bool loadScanData(Scan& scan);
 
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -200,12 +243,24 @@ void saveScanPosition(
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const std::string& positionDirectory);
+    const std::string& positionDirectory,
+    bool loadData = true);
 
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const size_t& positionNumber);
+    const size_t& positionNumber,
+    bool loadData = true);
+
+/**
+ * @brief Loads the points of all scans and the images of all cameras of
+ *        a scan position that was loaded without data.
+ *
+ * @param scanPos   The scan position
+ * @param parallel  Decode the files in parallel
+ * @return true if all payloads could be loaded
+ */
+bool loadScanPositionData(ScanPosition& scanPos, bool parallel = true);
 
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -222,9 +277,29 @@ void saveScanProject(
     const boost::filesystem::path& root,
     const ScanProject& scanProj);
 
+/**
+ * @brief Loads a ScanProject struct. The meta data of the scan positions
+ *        is read in parallel.
+ *
+ * @param root                  Project root directory
+ * @param scanProj              The loaded scan project
+ * @param loadData              If false, only the meta data is read and
+ *                              points and images are loaded on demand,
+ *                              see loadScanData() and loadScanProjectData()
+ */
 bool loadScanProject(
     const boost::filesystem::path& root,
-    ScanProject& scanProj);
+    ScanProject& scanProj,
+    bool loadData = true);
+
+/**
+ * @brief Loads all payloads of a scan project that was loaded without data.
+ *
+ * @param scanProj  The scan project
+ * @param parallel  Decode the files in parallel
+ * @return true if all payloads could be loaded
+ */
+bool loadScanProjectData(ScanProject& scanProj, bool parallel = true);
 
 
 // std::set<size_t> loadPositionIdsFromDirectory(
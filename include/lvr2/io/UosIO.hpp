@@ -174,6 +174,63 @@ private:
     void readOldFormat(ModelPtr &m, string dir, int first, int last, size_t &n);
 
 
+    /**
+     * @brief A scan file in new UOS format
+     */
+    struct UosScanFile
+    {
+        /// Number of the scan
+        int             number;
+
+        /// Path of the .3d file
+        string          fileName;
+
+        /// Pose of the scan
+        Matrix4<Vec>    transform;
+
+        /// Number of points (lines without header)
+        size_t          numPoints = 0;
+
+        /// Index of the first point of the scan in the combined point cloud
+        size_t          offset = 0;
+
+        /// The file contains colors
+        bool            hasColor = false;
+
+        /// The file contains remission values
+        bool            hasIntensity = false;
+    };
+
+
+    /**
+     * @brief Reads the pose of a scan from its .frames file or, if not
+     *        present, from its .pose file.
+     */
+    Matrix4<Vec> readScanTransform(string dir, int scan);
+
+
+    /**
+     * @brief Parses a scan in new UOS format into preallocated buffers and
+     *        transforms the points with the pose of the scan.
+     *
+     * @param scan          The scan to read
+     * @param points        Buffer for scan.numPoints points
+     * @param colors        Buffer for scan.numPoints colors or nullptr
+     * @param intensities   Buffer for scan.numPoints remission values or nullptr
+     * @return              The number of read points
+     */
+    size_t parseNewFormatScan(const UosScanFile& scan, float* points, unsigned char* colors, float* intensities);
+
+
+    /**
+     * @brief Reads a single scan directory in old UOS format and appends
+     *        the transformed points to the given vector.
+     *
+     * @return          False if the scan directory contains no pose
+     */
+    bool readOldFormatScan(string dir, int scan, std::vector<float>& points);
+
+
     inline std::string to_string(const int& t, int width)
     {
       stringstream ss;
@@ -38,6 +38,45 @@ public:
         std::vector<size_t>& dim
     );
 
+    /**
+     * @brief Loads the rows [offset, offset + count) of an array. The
+     *        range is clamped to the array, \p dim returns the
+     *        dimensions of the loaded part.
+     */
+    template<typename T>
+    boost::shared_array<T> loadArrayRange(
+        HighFive::Group& g,
+        std::string datasetName,
+        size_t offset,
+        size_t count,
+        std::vector<size_t>& dim);
+
+    template<typename T>
+    boost::shared_array<T> loadArrayRange(
+        std::string groupName,
+        std::string datasetName,
+        size_t offset,
+        size_t count,
+        std::vector<size_t>& dim);
+
+    /**
+     * @brief Loads the rows with the given indices of an array. \p dim
+     *        returns the dimensions of the loaded part.
+     */
+    template<typename T>
+    boost::shared_array<T> loadArrayIndices(
+        HighFive::Group& g,
+        std::string datasetName,
+        const std::vector<size_t>& indices,
+        std::vector<size_t>& dim);
+
+    template<typename T>
+    boost::shared_array<T> loadArrayIndices(
+        std::string groupName,
+        std::string datasetName,
+        const std::vector<size_t>& indices,
+        std::vector<size_t>& dim);
+
     template<typename T>
     void save(
         std::string groupName,
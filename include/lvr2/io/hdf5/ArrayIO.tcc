@@ -87,6 +87,118 @@ boost::shared_array<T> ArrayIO<Derived>::load(
     return ret;
 }
 
+template<typename Derived>
+template<typename T>
+boost::shared_array<T> ArrayIO<Derived>::loadArrayRange(
+    HighFive::Group& g,
+    std::string datasetName,
+    size_t offset,
+    size_t count,
+    std::vector<size_t>& dim)
+{
+    boost::shared_array<T> ret;
+
+    if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
+    {
+        if (g.exist(datasetName))
+        {
+            HighFive::DataSet dataset = g.getDataSet(datasetName);
+            dim = dataset.getSpace().getDimensions();
+
+            if(!dim.empty() && offset < dim[0])
+            {
+                dim[0] = std::min(count, dim[0] - offset);
+
+                size_t elementCount = 1;
+                for (auto e : dim)
+                    elementCount *= e;
+
+                ret = boost::shared_array<T>(new T[elementCount]);
+                hdf5util::readRows(dataset, offset, dim[0], ret.get());
+            }
+            else
+            {
+                dim.clear();
+            }
+        }
+    } else {
+        throw std::runtime_error("[Hdf5 - ArrayIO]: Hdf5 file not open.");
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+template<typename T>
+boost::shared_array<T> ArrayIO<Derived>::loadArrayRange(
+    std::string groupName,
+    std::string datasetName,
+    size_t offset,
+    size_t count,
+    std::vector<size_t>& dim)
+{
+    HighFive::Group g = hdf5util::getGroup(
+        m_file_access->m_hdf5_file,
+        groupName,
+        false
+    );
+
+    return loadArrayRange<T>(g, datasetName, offset, count, dim);
+}
+
+template<typename Derived>
+template<typename T>
+boost::shared_array<T> ArrayIO<Derived>::loadArrayIndices(
+    HighFive::Group& g,
+    std::string datasetName,
+    const std::vector<size_t>& indices,
+    std::vector<size_t>& dim)
+{
+    boost::shared_array<T> ret;
+
+    if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
+    {
+        if (g.exist(datasetName))
+        {
+            HighFive::DataSet dataset = g.getDataSet(datasetName);
+            dim = dataset.getSpace().getDimensions();
+
+            if(!dim.empty())
+            {
+                dim[0] = indices.size();
+
+                size_t elementCount = 1;
+                for (auto e : dim)
+                    elementCount *= e;
+
+                ret = boost::shared_array<T>(new T[elementCount]);
+                hdf5util::readRows(dataset, indices, ret.get());
+            }
+        }
+    } else {
+        throw std::runtime_error("[Hdf5 - ArrayIO]: Hdf5 file not open.");
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+template<typename T>
+boost::shared_array<T> ArrayIO<Derived>::loadArrayIndices(
+    std::string groupName,
+    std::string datasetName,
+    const std::vector<size_t>& indices,
+    std::vector<size_t>& dim)
+{
+    HighFive::Group g = hdf5util::getGroup(
+        m_file_access->m_hdf5_file,
+        groupName,
+        false
+    );
+
+    return loadArrayIndices<T>(g, datasetName, indices, dim);
+}
+
 template<typename Derived>
 template<typename T>
 void ArrayIO<Derived>::save(
@@ -96,7 +208,7 @@ void ArrayIO<Derived>::save(
     boost::shared_array<T> data)
 {
     std::vector<size_t> dim = {size, 1};
-    std::vector<hsize_t> chunks {m_file_access->m_chunkSize, 1};
+    std::vector<hsize_t> chunks;
     HighFive::Group g = hdf5util::getGroup(m_file_access->m_hdf5_file, groupName);
     save(g, datasetName, dim, chunks, data);
 }
@@ -111,14 +223,8 @@ void ArrayIO<Derived>::save(
 {
     HighFive::Group g = hdf5util::getGroup(m_file_access->m_hdf5_file, groupName);
 
-    // Compute chunk size vector, i.e., set the chunk size in
-    // each dimension to default size. Add float array will
-    // trim this values if chunkSize > dim.
+    // Let the compression profile choose the chunk shape
     std::vector<hsize_t> chunks;
-    for(auto i: dimensions)
-    {
-            chunks.push_back(i);
-    }
     save(g, datasetName, dimensions, chunks, data);
 }
 
@@ -147,27 +253,8 @@ void ArrayIO<Derived>::save(HighFive::Group& g,
     {
 
         HighFive::DataSpace dataSpace(dim);
-        HighFive::DataSetCreateProps properties;
-
-        if(m_file_access->m_chunkSize)
-        {
-            // We have to check explicitly if chunk size
-            // is < dimensionality to avoid errors from
-            // the HDF5 lib
-            for(size_t i = 0; i < chunkSizes.size(); i++)
-            {
-                if(chunkSizes[i] > dim[i])
-                {
-                    chunkSizes[i] = dim[i];
-                }
-            }
-            properties.add(HighFive::Chunking(chunkSizes));
-        }
-        if(m_file_access->m_compress)
-        {
-            //properties.add(HighFive::Shuffle());
-            properties.add(HighFive::Deflate(9));
-        }
+        HighFive::DataSetCreateProps properties =
+            m_file_access->template datasetProperties<T>(dim, chunkSizes);
         
         std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<T>(
             g, datasetName, dataSpace, properties
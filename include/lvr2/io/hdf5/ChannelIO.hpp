@@ -33,6 +33,38 @@ public:
     ChannelOptional<T> loadChannel(std::string groupName,
         std::string datasetName);
 
+    /**
+     * @brief Loads the elements [offset, offset + count) of a channel.
+     *        The range is clamped to the size of the channel.
+     */
+    template<typename T>
+    ChannelOptional<T> loadChannelRange(
+        HighFive::Group& g,
+        std::string datasetName,
+        size_t offset,
+        size_t count);
+
+    template<typename T>
+    ChannelOptional<T> loadChannelRange(std::string groupName,
+        std::string datasetName,
+        size_t offset,
+        size_t count);
+
+    /**
+     * @brief Loads the elements with the given indices of a channel. The
+     *        i-th element of the result is the element indices[i].
+     */
+    template<typename T>
+    ChannelOptional<T> loadChannelIndices(
+        HighFive::Group& g,
+        std::string datasetName,
+        const std::vector<size_t>& indices);
+
+    template<typename T>
+    ChannelOptional<T> loadChannelIndices(std::string groupName,
+        std::string datasetName,
+        const std::vector<size_t>& indices);
+
     template<typename T>
     void save(std::string groupName,
         std::string datasetName,
@@ -59,6 +59,101 @@ ChannelOptional<T> ChannelIO<Derived>::loadChannel(std::string groupName,
     return load<T>(groupName, datasetName);
 }
 
+template<typename Derived>
+template<typename T>
+ChannelOptional<T> ChannelIO<Derived>::loadChannelRange(
+    HighFive::Group& g,
+    std::string datasetName,
+    size_t offset,
+    size_t count)
+{
+    ChannelOptional<T> ret;
+
+    if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
+    {
+        if(g.exist(datasetName))
+        {
+            HighFive::DataSet dataset = g.getDataSet(datasetName);
+            std::vector<size_t> dim = dataset.getSpace().getDimensions();
+
+            if(dim.size() == 2 && offset < dim[0])
+            {
+                count = std::min(count, dim[0] - offset);
+                ret = Channel<T>(count, dim[1]);
+                hdf5util::readRows(dataset, offset, count, ret->dataPtr().get());
+            }
+        }
+    } else {
+        throw std::runtime_error("[Hdf5 - ChannelIO]: Hdf5 file not open.");
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+template<typename T>
+ChannelOptional<T> ChannelIO<Derived>::loadChannelRange(std::string groupName,
+    std::string datasetName,
+    size_t offset,
+    size_t count)
+{
+    ChannelOptional<T> ret;
+
+    if(hdf5util::exist(m_file_access->m_hdf5_file, groupName))
+    {
+        HighFive::Group g = hdf5util::getGroup(m_file_access->m_hdf5_file, groupName, false);
+        ret = loadChannelRange<T>(g, datasetName, offset, count);
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+template<typename T>
+ChannelOptional<T> ChannelIO<Derived>::loadChannelIndices(
+    HighFive::Group& g,
+    std::string datasetName,
+    const std::vector<size_t>& indices)
+{
+    ChannelOptional<T> ret;
+
+    if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
+    {
+        if(g.exist(datasetName))
+        {
+            HighFive::DataSet dataset = g.getDataSet(datasetName);
+            std::vector<size_t> dim = dataset.getSpace().getDimensions();
+
+            if(dim.size() == 2)
+            {
+                ret = Channel<T>(indices.size(), dim[1]);
+                hdf5util::readRows(dataset, indices, ret->dataPtr().get());
+            }
+        }
+    } else {
+        throw std::runtime_error("[Hdf5 - ChannelIO]: Hdf5 file not open.");
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+template<typename T>
+ChannelOptional<T> ChannelIO<Derived>::loadChannelIndices(std::string groupName,
+    std::string datasetName,
+    const std::vector<size_t>& indices)
+{
+    ChannelOptional<T> ret;
+
+    if(hdf5util::exist(m_file_access->m_hdf5_file, groupName))
+    {
+        HighFive::Group g = hdf5util::getGroup(m_file_access->m_hdf5_file, groupName, false);
+        ret = loadChannelIndices<T>(g, datasetName, indices);
+    }
+
+    return ret;
+}
+
 template<typename Derived>
 template<typename T>
 void ChannelIO<Derived>::save(std::string groupName,
@@ -75,7 +170,7 @@ void ChannelIO<Derived>::save(HighFive::Group& g,
     std::string datasetName,
     const Channel<T>& channel)
 {
-    std::vector<hsize_t> chunks = {channel.numElements(), channel.width()};
+    std::vector<hsize_t> chunks;
     save(g, datasetName, channel, chunks);
 }
 
@@ -91,24 +186,8 @@ void ChannelIO<Derived>::save(HighFive::Group& g,
         std::vector<size_t > dims = {channel.numElements(), channel.width()};
 
         HighFive::DataSpace dataSpace(dims);
-        HighFive::DataSetCreateProps properties;
-
-        if(m_file_access->m_chunkSize)
-        {
-            for(size_t i = 0; i < chunkSizes.size(); i++)
-            {
-                if(chunkSizes[i] > dims[i])
-                {
-                    chunkSizes[i] = dims[i];
-                }
-            }
-            properties.add(HighFive::Chunking(chunkSizes));
-        }
-        if(m_file_access->m_compress)
-        {
-            //properties.add(HighFive::Shuffle());
-            properties.add(HighFive::Deflate(9));
-        }
+        HighFive::DataSetCreateProps properties =
+            m_file_access->template datasetProperties<T>(dims, chunkSizes);
    
         std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<T>(
             g, datasetName, dataSpace, properties
@@ -161,18 +240,10 @@ bool ChannelIO<Derived>::addChannel(const std::string group, const std::string n
 {
     if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
     {
-        HighFive::DataSpace dataSpace({channel.numElements(), channel.width()});
-        HighFive::DataSetCreateProps properties;
-
-        if(m_file_access->m_chunkSize)
-        {
-            properties.add(HighFive::Chunking({channel.numElements(), channel.width()}));
-        }
-        if(m_file_access->m_compress)
-        {
-            //properties.add(HighFive::Shuffle());
-            properties.add(HighFive::Deflate(9));
-        }
+        std::vector<size_t> dims = {channel.numElements(), channel.width()};
+        HighFive::DataSpace dataSpace(dims);
+        HighFive::DataSetCreateProps properties =
+            m_file_access->template datasetProperties<T>(dims);
 
         // TODO check group for vertex / face attribute and set flag in hdf5 channel
         HighFive::Group g = hdf5util::getGroup(m_file_access->m_hdf5_file, "channels");
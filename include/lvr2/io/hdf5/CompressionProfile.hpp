@@ -0,0 +1,235 @@
+#pragma once
+#ifndef LVR2_IO_HDF5_COMPRESSIONPROFILE_HPP
+#define LVR2_IO_HDF5_COMPRESSIONPROFILE_HPP
+
+#include <H5Ppublic.h>
+#include <H5Zpublic.h>
+#include <highfive/H5PropertyList.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Describes how datasets are chunked and compressed.
+ *
+ * The chunk shape is derived from the dataset dimensions: Chunks always
+ * span complete rows (e.g. all coordinates of a point or all channels of an
+ * image row) and contain as many rows as fit into \ref chunkBytes. Small
+ * chunks allow HDF5 to compress and decompress partial reads without
+ * touching the whole dataset.
+ *
+ * LZ4 and Zstd are only used if the corresponding HDF5 filter plugins are
+ * available at runtime. Otherwise Deflate with a level matching the profile
+ * is used, so files written with any profile can be read everywhere the
+ * plugins are installed.
+ */
+struct Hdf5CompressionProfile
+{
+    enum Level
+    {
+        NONE,       ///< Chunking only
+        FAST,       ///< Cheapest compression, for acquisition speed
+        BALANCED,   ///< Good ratio at reasonable speed
+        MAX         ///< Best ratio, slow
+    };
+
+    enum Codec
+    {
+        DEFLATE,
+        LZ4,
+        ZSTD
+    };
+
+    /// Registered HDF5 filter ids of the optional codecs
+    static constexpr H5Z_filter_t LZ4_FILTER  = 32004;
+    static constexpr H5Z_filter_t ZSTD_FILTER = 32015;
+
+    Hdf5CompressionProfile(
+        Level level = BALANCED,
+        bool shuffle = true,
+        Codec codec = DEFLATE,
+        size_t chunkBytes = 1 << 18)
+        : level(level), shuffle(shuffle), codec(codec),
+          chunkBytes(chunkBytes), maxChunkRows(0)
+    {
+    }
+
+    static Hdf5CompressionProfile none()     { return Hdf5CompressionProfile(NONE, false); }
+    static Hdf5CompressionProfile fast()     { return Hdf5CompressionProfile(FAST, true, LZ4); }
+    static Hdf5CompressionProfile balanced() { return Hdf5CompressionProfile(BALANCED, true, DEFLATE); }
+    static Hdf5CompressionProfile max()      { return Hdf5CompressionProfile(MAX, true, DEFLATE); }
+
+    /**
+     * @brief Returns the profile with the given name (none, fast, balanced
+     *        or max). Unknown names result in the balanced profile.
+     */
+    static Hdf5CompressionProfile fromName(const std::string& name)
+    {
+        if(name == "none")
+        {
+            return none();
+        }
+        if(name == "fast")
+        {
+            return fast();
+        }
+        if(name == "max")
+        {
+            return max();
+        }
+        return balanced();
+    }
+
+    /// Returns true if the filter plugin of the given codec is available
+    static bool available(Codec codec)
+    {
+        switch(codec)
+        {
+            case LZ4:  return H5Zfilter_avail(LZ4_FILTER) > 0;
+            case ZSTD: return H5Zfilter_avail(ZSTD_FILTER) > 0;
+            default:   return H5Zfilter_avail(H5Z_FILTER_DEFLATE) > 0;
+        }
+    }
+
+    /**
+     * @brief Computes the chunk shape for a dataset with the given
+     *        dimensions and element size.
+     */
+    std::vector<hsize_t> chunkShape(const std::vector<size_t>& dims, size_t elementSize) const
+    {
+        std::vector<hsize_t> chunks(dims.begin(), dims.end());
+        if(chunks.empty())
+        {
+            return chunks;
+        }
+
+        size_t rowBytes = elementSize;
+        for(size_t i = 1; i < dims.size(); i++)
+        {
+            rowBytes *= std::max<size_t>(dims[i], 1);
+        }
+
+        size_t rows = std::max<size_t>(chunkBytes / std::max<size_t>(rowBytes, 1), 1);
+        if(maxChunkRows)
+        {
+            rows = std::min(rows, maxChunkRows);
+        }
+        chunks[0] = std::min<size_t>(rows, dims[0]);
+
+        // HDF5 does not accept empty chunk dimensions
+        for(auto& c : chunks)
+        {
+            c = std::max<hsize_t>(c, 1);
+        }
+        return chunks;
+    }
+
+    /**
+     * @brief Creates the dataset creation properties for a dataset with
+     *        the given dimensions.
+     *
+     * @param dims          Dimensions of the dataset
+     * @param chunks        Explicit chunk shape. Computed with chunkShape()
+     *                      if empty, clamped to the dimensions otherwise.
+     */
+    template<typename T>
+    HighFive::DataSetCreateProps properties(
+        const std::vector<size_t>& dims,
+        std::vector<hsize_t> chunks = std::vector<hsize_t>()) const
+    {
+        HighFive::DataSetCreateProps props;
+        if(dims.empty())
+        {
+            return props;
+        }
+
+        if(chunks.size() != dims.size())
+        {
+            chunks = chunkShape(dims, sizeof(T));
+        }
+        else
+        {
+            for(size_t i = 0; i < chunks.size(); i++)
+            {
+                chunks[i] = std::max<hsize_t>(std::min<hsize_t>(chunks[i], dims[i]), 1);
+            }
+        }
+        props.add(HighFive::Chunking(chunks));
+
+        if(level == NONE)
+        {
+            return props;
+        }
+
+        // Shuffling is useless for single byte types
+        if(shuffle && sizeof(T) > 1)
+        {
+            props.add(HighFive::Shuffle());
+        }
+
+        if(codec == LZ4 && available(LZ4))
+        {
+            props.add(Filter(LZ4_FILTER, {}));
+        }
+        else if(codec == ZSTD && available(ZSTD))
+        {
+            const unsigned int zstdLevels[] = { 0, 1, 3, 19 };
+            props.add(Filter(ZSTD_FILTER, { zstdLevels[level] }));
+        }
+        else
+        {
+            const int deflateLevels[] = { 0, 1, 4, 9 };
+            props.add(HighFive::Deflate(deflateLevels[level]));
+        }
+        return props;
+    }
+
+    /// Compression level
+    Level   level;
+
+    /// Shuffle the bytes of the elements before compression
+    bool    shuffle;
+
+    /// Preferred codec
+    Codec   codec;
+
+    /// Target size of a chunk in bytes
+    size_t  chunkBytes;
+
+    /// Upper bound for the rows per chunk (0 = unbounded)
+    size_t  maxChunkRows;
+
+private:
+
+    /**
+     * @brief Dataset creation property for a filter plugin.
+     */
+    class Filter
+    {
+    public:
+        Filter(H5Z_filter_t id, std::vector<unsigned int> values)
+            : m_id(id), m_values(values) {}
+
+        void apply(hid_t hid) const
+        {
+            if(H5Pset_filter(hid, m_id, H5Z_FLAG_OPTIONAL, m_values.size(),
+                             m_values.empty() ? nullptr : m_values.data()) < 0)
+            {
+                HighFive::HDF5ErrMapper::ToException<HighFive::PropertyException>(
+                    "Error setting filter property");
+            }
+        }
+
+    private:
+        H5Z_filter_t                m_id;
+        std::vector<unsigned int>   m_values;
+    };
+};
+
+} // namespace lvr2
+
+#endif // LVR2_IO_HDF5_COMPRESSIONPROFILE_HPP
@@ -7,6 +7,7 @@
 #include <type_traits>
 
 #include "lvr2/io/hdf5/Hdf5Util.hpp"
+#include "lvr2/io/hdf5/CompressionProfile.hpp"
 
 #include <H5Tpublic.h>
 #include <hdf5_hl.h>
@@ -151,6 +152,32 @@ public:
     template<template<typename> typename F>
     F<Hdf5IO>* dcast();
 
+    /**
+     * @brief Sets the compression profile that is used for all datasets
+     *        written afterwards.
+     */
+    void setCompression(const Hdf5CompressionProfile& profile);
+
+    /**
+     * @brief Returns the effective compression profile. m_compress = false
+     *        disables compression, m_chunkSize limits the rows per chunk.
+     */
+    Hdf5CompressionProfile compression() const;
+
+    /**
+     * @brief Returns the creation properties for a new dataset with the
+     *        given dimensions according to the compression profile.
+     *
+     * @param dims      Dimensions of the dataset
+     * @param chunks    Explicit chunk shape or empty to let the profile
+     *                  choose one
+     */
+    template<typename T>
+    HighFive::DataSetCreateProps datasetProperties(
+        const std::vector<size_t>& dims,
+        const std::vector<hsize_t>& chunks = std::vector<hsize_t>()) const;
+
+    Hdf5CompressionProfile  m_compression;
     bool                    m_compress;
     size_t                  m_chunkSize;
     bool                    m_usePreviews;
@@ -13,6 +13,34 @@ void Hdf5IO<Features...>::open(std::string filename) {
     }
 }
 
+template<template<typename> typename ...Features>
+void Hdf5IO<Features...>::setCompression(const Hdf5CompressionProfile& profile)
+{
+    m_compression = profile;
+    m_compress = profile.level != Hdf5CompressionProfile::NONE;
+}
+
+template<template<typename> typename ...Features>
+Hdf5CompressionProfile Hdf5IO<Features...>::compression() const
+{
+    Hdf5CompressionProfile profile = m_compression;
+    if(!m_compress)
+    {
+        profile.level = Hdf5CompressionProfile::NONE;
+    }
+    profile.maxChunkRows = m_chunkSize;
+    return profile;
+}
+
+template<template<typename> typename ...Features>
+template<typename T>
+HighFive::DataSetCreateProps Hdf5IO<Features...>::datasetProperties(
+    const std::vector<size_t>& dims,
+    const std::vector<hsize_t>& chunks) const
+{
+    return compression().template properties<T>(dims, chunks);
+}
+
 template<template<typename> typename ...Features>
 template<template<typename> typename F>
 bool Hdf5IO<Features...>::has() {
@@ -6,6 +6,7 @@
 #include "lvr2/geometry/Matrix4.hpp"
 
 #include <H5Tpublic.h>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <chrono>
 #include <hdf5_hl.h>
@@ -13,6 +14,7 @@
 #include <highfive/H5DataSpace.hpp>
 #include <highfive/H5File.hpp>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -299,6 +301,122 @@ std::unique_ptr<HighFive::DataSet> createDataset(HighFive::Group& g,
     return std::move(dataset);
 }
 
+/**
+ * @brief Reads the rows [offset, offset + count) of a dataset into \p data.
+ *        Only the chunks overlapping the range are read from the file.
+ *
+ * @param dataset   Dataset with the rows in the first dimension
+ * @param offset    First row
+ * @param count     Number of rows
+ * @param data      Output buffer with space for count complete rows
+ */
+template <typename T>
+void readRows(const HighFive::DataSet& dataset, size_t offset, size_t count, T* data)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    std::vector<size_t> start(dataset.getSpace().getDimensions().size(), 0);
+    std::vector<size_t> size = dataset.getSpace().getDimensions();
+    start[0] = offset;
+    size[0] = count;
+    dataset.select(start, size).read(data);
+}
+
+/**
+ * @brief Reads the given rows of a dataset into \p data. The i-th
+ *        requested row is stored at the i-th row of \p data.
+ *
+ * The rows are sorted and neighbouring rows are merged into hyperslabs.
+ * Rows in the same chunk and gaps of at most \p maxGap rows are read
+ * together and skipped in memory. This is much cheaper than issuing a
+ * separate read for each row, which would decompress a chunk per row.
+ *
+ * @param dataset   Dataset with the rows in the first dimension
+ * @param rows      Row indices, may be unsorted and contain duplicates
+ * @param data      Output buffer with space for rows.size() complete rows
+ * @param maxGap    Maximum number of unused rows inside a single read
+ */
+template <typename T>
+void readRows(const HighFive::DataSet& dataset,
+              const std::vector<size_t>& rows,
+              T* data,
+              size_t maxGap = 64)
+{
+    if (rows.empty())
+    {
+        return;
+    }
+
+    std::vector<size_t> dims = dataset.getSpace().getDimensions();
+    size_t width = 1;
+    for (size_t i = 1; i < dims.size(); i++)
+    {
+        width *= dims[i];
+    }
+
+    // Visit the requested rows in file order
+    std::vector<size_t> order(rows.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    if (!std::is_sorted(rows.begin(), rows.end()))
+    {
+        std::stable_sort(order.begin(), order.end(), [&rows](size_t a, size_t b) {
+            return rows[a] < rows[b];
+        });
+    }
+
+    // Rows per chunk of chunked datasets
+    size_t chunkRows = 1;
+    hid_t props = H5Dget_create_plist(dataset.getId());
+    if (props >= 0)
+    {
+        if (H5Pget_layout(props) == H5D_CHUNKED)
+        {
+            std::vector<hsize_t> chunks(dims.size());
+            H5Pget_chunk(props, chunks.size(), chunks.data());
+            chunkRows = std::max<hsize_t>(chunks[0], 1);
+        }
+        H5Pclose(props);
+    }
+
+    std::vector<T> buffer;
+    size_t i = 0;
+    while (i < order.size())
+    {
+        // Collect all requests that fit into one hyperslab
+        size_t first = rows[order[i]];
+        size_t last = first;
+        size_t j = i + 1;
+        while (j < order.size()
+               && (rows[order[j]] / chunkRows == last / chunkRows
+                   || rows[order[j]] <= last + maxGap + 1))
+        {
+            last = rows[order[j]];
+            j++;
+        }
+
+        if (first >= dims[0] || last >= dims[0])
+        {
+            throw std::out_of_range("[Hdf5Util - readRows] Row index out of range.");
+        }
+
+        buffer.resize((last - first + 1) * width);
+        readRows(dataset, first, last - first + 1, buffer.data());
+
+        for (size_t k = i; k < j; k++)
+        {
+            const T* src = buffer.data() + (rows[order[k]] - first) * width;
+            std::copy(src, src + width, data + order[k] * width);
+        }
+        i = j;
+    }
+}
+
 template <typename T>
 void setAttribute(HighFive::Group& g, const std::string& attr_name, T& data)
 {
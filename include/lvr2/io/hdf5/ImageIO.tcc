@@ -40,32 +40,13 @@ void ImageIO<Derived>::save(HighFive::Group& group,
             // Couldnt write as H5Image, write as blob
 
             std::vector<size_t> dims = {static_cast<size_t>(img.rows), static_cast<size_t>(img.cols)};
-            std::vector<hsize_t> chunkSizes = {static_cast<hsize_t>(img.rows), static_cast<hsize_t>(img.cols)};
 
             if(img.channels() > 1)
             {
                 dims.push_back(img.channels());
-                chunkSizes.push_back(img.channels());
             }
 
             HighFive::DataSpace dataSpace(dims);
-            HighFive::DataSetCreateProps properties;
-
-            if(m_file_access->m_chunkSize)
-            {
-                for(size_t i = 0; i < chunkSizes.size(); i++)
-                {
-                    if(chunkSizes[i] > dims[i])
-                    {
-                        chunkSizes[i] = dims[i];
-                    }
-                }
-                properties.add(HighFive::Chunking(chunkSizes));
-            }
-            if(m_file_access->m_compress)
-            {
-                properties.add(HighFive::Deflate(9));
-            }
 
             // Single Channel Type
             const int SCTYPE = img.type() % 8;
@@ -73,43 +54,50 @@ void ImageIO<Derived>::save(HighFive::Group& group,
 
             if(SCTYPE == CV_8U) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<unsigned char>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<unsigned char>(dims)
                 );
                 const unsigned char* ptr = reinterpret_cast<unsigned char*>(img.data);
                 dataset->write(ptr);
             } else if(SCTYPE == CV_8S) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<char>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<char>(dims)
                 );
                 const char* ptr = reinterpret_cast<char*>(img.data);
                 dataset->write(ptr);
             } else if(SCTYPE == CV_16U) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<unsigned short>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<unsigned short>(dims)
                 );
                 const unsigned short* ptr = reinterpret_cast<unsigned short*>(img.data);
                 dataset->write(ptr);
             } else if(SCTYPE == CV_16S) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<short>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<short>(dims)
                 );
                 const short* ptr = reinterpret_cast<short*>(img.data);
                 dataset->write(ptr);
             } else if(SCTYPE == CV_32S) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<int>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<int>(dims)
                 );
                 const int* ptr = reinterpret_cast<int*>(img.data);
                 dataset->write(ptr);
             } else if(SCTYPE == CV_32F) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<float>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<float>(dims)
                 );
                 const float* ptr = reinterpret_cast<float*>(img.data);
                 dataset->write(ptr);
             } else if(SCTYPE == CV_64F) {
                 std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<double>(
-                    group, datasetName, dataSpace, properties
+                    group, datasetName, dataSpace,
+                    m_file_access->template datasetProperties<double>(dims)
                 );
                 const double* ptr = reinterpret_cast<double*>(img.data);
                 dataset->write(ptr);
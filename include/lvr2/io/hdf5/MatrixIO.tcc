@@ -21,27 +21,10 @@ void MatrixIO<Derived>::save(HighFive::Group& group,
 {
     if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
     {
-        std::vector<hsize_t> chunkSizes = {_Rows, _Cols};
         std::vector<size_t > dims = {_Rows, _Cols};
         HighFive::DataSpace dataSpace(dims);
-        HighFive::DataSetCreateProps properties;
-
-        if(m_file_access->m_chunkSize)
-        {
-            for(size_t i = 0; i < chunkSizes.size(); i++)
-            {
-                if(chunkSizes[i] > dims[i])
-                {
-                    chunkSizes[i] = dims[i];
-                }
-            }
-            properties.add(HighFive::Chunking(chunkSizes));
-        }
-        if(m_file_access->m_compress)
-        {
-            //properties.add(HighFive::Shuffle());
-            properties.add(HighFive::Deflate(9));
-        }
+        HighFive::DataSetCreateProps properties =
+            m_file_access->template datasetProperties<_Scalar>(dims);
 
         std::unique_ptr<HighFive::DataSet> dataset = hdf5util::createDataset<_Scalar>(
             group, datasetName, dataSpace, properties
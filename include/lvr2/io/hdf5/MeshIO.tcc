@@ -408,18 +408,10 @@ bool MeshIO<Derived>::addChannel(const std::string group, const std::string name
 {
     if(m_file_access->m_hdf5_file && m_file_access->m_hdf5_file->isValid())
     {
-        HighFive::DataSpace dataSpace({channel.numElements(), channel.width()});
-        HighFive::DataSetCreateProps properties;
-
-        if(m_file_access->m_chunkSize)
-        {
-            properties.add(HighFive::Chunking({channel.numElements(), channel.width()}));
-        }
-        if(m_file_access->m_compress)
-        {
-            //properties.add(HighFive::Shuffle());
-            properties.add(HighFive::Deflate(9));
-        }
+        std::vector<size_t> dims = {channel.numElements(), channel.width()};
+        HighFive::DataSpace dataSpace(dims);
+        HighFive::DataSetCreateProps properties =
+            m_file_access->template datasetProperties<T>(dims);
 
         HighFive::Group meshGroup = hdf5util::getGroup(m_file_access->m_hdf5_file, m_mesh_name, true);
         if (!meshGroup.exist("channels"))
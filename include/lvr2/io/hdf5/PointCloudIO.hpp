@@ -5,7 +5,14 @@
 
 #include <boost/optional.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 #include "lvr2/io/PointBuffer.hpp"
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/BoundingBox.hpp"
 
 // Dependencies
 #include "ChannelIO.hpp"
@@ -32,8 +39,18 @@ namespace hdf5features {
  * 
  * // reading
  * pointcloud_in = io.loadPointCloud("apointcloud");
+ *
+ * // reading the points inside a box
+ * BoundingBox<BaseVector<float> > bb(BaseVector<float>(0, 0, 0), BaseVector<float>(1, 1, 1));
+ * pointcloud_in = io.loadPointCloud("apointcloud", bb);
  * 
  * @endcode
+ *
+ * Saving a point cloud also stores a uniform grid over its points in the
+ * subgroup "spatial_index": The dataset "cells" holds the offsets of each
+ * cell into "points", which holds the point indices sorted by cell. Box
+ * queries only read the cells overlapping the box and the rows of the
+ * points in these cells.
  * 
  * Generates attributes at hdf5 group:
  * - IO: PointCloudIO
@@ -53,16 +70,54 @@ public:
     PointBufferPtr load(HighFive::Group& group);
     PointBufferPtr loadPointCloud(std::string name);
 
+    /**
+     * @brief Loads all points inside the given bounding box together with
+     *        their per point channels.
+     *
+     * The group only needs a "points" dataset, so this also works for scan
+     * groups. Without a spatial index all points are read and filtered.
+     *
+     * @return The points inside the box, nullptr if there are none
+     */
+    PointBufferPtr load(HighFive::Group& group, const BoundingBox<BaseVector<float> >& bb);
+    PointBufferPtr load(std::string name, const BoundingBox<BaseVector<float> >& bb);
+    PointBufferPtr loadPointCloud(std::string name, const BoundingBox<BaseVector<float> >& bb);
+
+    /**
+     * @brief Returns the sorted indices of the points inside the bounding box.
+     */
+    std::vector<size_t> findPoints(HighFive::Group& group, const BoundingBox<BaseVector<float> >& bb);
+
+    /**
+     * @brief Builds the spatial index over the given points and stores it
+     *        in the group. Called by save().
+     *
+     * @param group         The group containing the "points" dataset
+     * @param points        Point array with 3 floats per point
+     * @param numPoints     Number of points
+     */
+    void saveSpatialIndex(HighFive::Group& group, floatArr points, size_t numPoints);
+
 protected:
 
     bool isPointCloud(HighFive::Group& group);
 
+    /// Candidate points of the cells overlapping bb, sorted
+    bool indexedCandidates(HighFive::Group& group,
+        const BoundingBox<BaseVector<float> >& bb,
+        std::vector<size_t>& candidates);
+
     Derived* m_file_access = static_cast<Derived*>(this);
     // dependencies
     VariantChannelIO<Derived>* m_vchannel_io = static_cast<VariantChannelIO<Derived>*>(m_file_access);
+    ChannelIO<Derived>* m_channel_io = static_cast<ChannelIO<Derived>*>(m_file_access);
 
     static constexpr const char* ID = "PointCloudIO";
     static constexpr const char* OBJID = "PointBuffer";
+    static constexpr const char* INDEX = "spatial_index";
+
+    /// Average number of points per cell of the spatial index
+    static constexpr size_t INDEX_POINTS_PER_CELL = 1024;
 };
 
 } // hdf5features
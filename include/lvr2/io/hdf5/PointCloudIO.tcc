@@ -26,6 +26,125 @@ void PointCloudIO<Derived>::save(HighFive::Group& group, const PointBufferPtr& b
     {
         m_vchannel_io->save(group, elem.first, elem.second);
     }
+
+    if(buffer->numPoints())
+    {
+        saveSpatialIndex(group, buffer->getPointArray(), buffer->numPoints());
+    }
+}
+
+template<typename Derived>
+void PointCloudIO<Derived>::saveSpatialIndex(HighFive::Group& group, floatArr points, size_t numPoints)
+{
+    if(!points || numPoints == 0)
+    {
+        return;
+    }
+
+    if(numPoints > std::numeric_limits<unsigned int>::max())
+    {
+        std::cout << "[Hdf5IO - PointCloudIO] WARNING: Too many points for a spatial index." << std::endl;
+        return;
+    }
+
+    // Bounds of the points
+    float bounds[6] = {
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::max(),
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest()
+    };
+    for(size_t i = 0; i < numPoints; i++)
+    {
+        for(int a = 0; a < 3; a++)
+        {
+            bounds[a] = std::min(bounds[a], points[3 * i + a]);
+            bounds[3 + a] = std::max(bounds[3 + a], points[3 * i + a]);
+        }
+    }
+
+    // Choose a cubic cell size that results in about INDEX_POINTS_PER_CELL
+    // points per cell. Flat axes get at least a small extent so that planar
+    // clouds are still subdivided along the other axes.
+    float extent[3];
+    float maxExtent = 0;
+    for(int a = 0; a < 3; a++)
+    {
+        extent[a] = bounds[3 + a] - bounds[a];
+        maxExtent = std::max(maxExtent, extent[a]);
+    }
+
+    size_t targetCells = std::min<size_t>(std::max<size_t>(numPoints / INDEX_POINTS_PER_CELL, 1), 1 << 22);
+    unsigned int res[3] = {1, 1, 1};
+    if(maxExtent > 0)
+    {
+        float e[3];
+        for(int a = 0; a < 3; a++)
+        {
+            e[a] = std::max(extent[a], maxExtent * 1e-3f);
+        }
+        float edge = std::cbrt(e[0] * e[1] * e[2] / targetCells);
+        size_t numCells;
+        do
+        {
+            numCells = 1;
+            for(int a = 0; a < 3; a++)
+            {
+                res[a] = static_cast<unsigned int>(std::min(std::max(std::ceil(extent[a] / edge), 1.0f), 1024.0f));
+                numCells *= res[a];
+            }
+            edge *= 1.25f;
+        } while(numCells > 2 * targetCells);
+    }
+    size_t numCells = static_cast<size_t>(res[0]) * res[1] * res[2];
+
+    float scale[3];
+    for(int a = 0; a < 3; a++)
+    {
+        scale[a] = extent[a] > 0 ? res[a] / extent[a] : 0;
+    }
+
+    // Counting sort of the points by cell
+    std::vector<unsigned int> cellOf(numPoints);
+    Channel<size_t> cells(numCells + 1, 1);
+    size_t* offsets = cells.dataPtr().get();
+    std::fill(offsets, offsets + numCells + 1, 0);
+
+    for(size_t i = 0; i < numPoints; i++)
+    {
+        size_t c[3];
+        for(int a = 0; a < 3; a++)
+        {
+            c[a] = std::min<size_t>((points[3 * i + a] - bounds[a]) * scale[a], res[a] - 1);
+        }
+        cellOf[i] = (c[2] * res[1] + c[1]) * res[0] + c[0];
+        offsets[cellOf[i] + 1]++;
+    }
+    for(size_t c = 0; c < numCells; c++)
+    {
+        offsets[c + 1] += offsets[c];
+    }
+
+    Channel<unsigned int> ids(numPoints, 1);
+    unsigned int* idPtr = ids.dataPtr().get();
+    std::vector<size_t> next(offsets, offsets + numCells);
+    for(size_t i = 0; i < numPoints; i++)
+    {
+        idPtr[next[cellOf[i]]++] = i;
+    }
+
+    Channel<float> boundsChannel(2, 3);
+    std::copy(bounds, bounds + 6, boundsChannel.dataPtr().get());
+    Channel<unsigned int> resChannel(1, 3);
+    std::copy(res, res + 3, resChannel.dataPtr().get());
+
+    HighFive::Group indexGroup = hdf5util::getGroup(group, INDEX);
+    m_channel_io->save(indexGroup, "bounds", boundsChannel);
+    m_channel_io->save(indexGroup, "resolution", resChannel);
+    m_channel_io->save(indexGroup, "cells", cells);
+    m_channel_io->save(indexGroup, "points", ids);
 }
 
 
@@ -63,6 +182,11 @@ PointBufferPtr PointCloudIO<Derived>::load(HighFive::Group& group)
 
     for(auto name : group.listObjectNames() )
     {
+        if(name == INDEX)
+        {
+            continue;
+        }
+
         std::unique_ptr<HighFive::DataSet> dataset;
 
         try {
@@ -98,6 +222,250 @@ PointBufferPtr PointCloudIO<Derived>::load(HighFive::Group& group)
     return ret;
 }
 
+template<typename Derived>
+PointBufferPtr PointCloudIO<Derived>::load(std::string name, const BoundingBox<BaseVector<float> >& bb)
+{
+    PointBufferPtr ret;
+
+    if(hdf5util::exist(m_file_access->m_hdf5_file, name))
+    {
+        HighFive::Group g = hdf5util::getGroup(m_file_access->m_hdf5_file, name, false);
+        ret = load(g, bb);
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+PointBufferPtr PointCloudIO<Derived>::loadPointCloud(std::string name, const BoundingBox<BaseVector<float> >& bb)
+{
+    return load(name, bb);
+}
+
+template<typename Derived>
+PointBufferPtr PointCloudIO<Derived>::load(HighFive::Group& group, const BoundingBox<BaseVector<float> >& bb)
+{
+    PointBufferPtr ret;
+
+    std::vector<size_t> indices = findPoints(group, bb);
+    if(indices.empty())
+    {
+        return ret;
+    }
+
+    size_t numPoints = group.getDataSet("points").getSpace().getDimensions()[0];
+
+    for(auto name : group.listObjectNames())
+    {
+        if(name == INDEX)
+        {
+            continue;
+        }
+
+        std::unique_ptr<HighFive::DataSet> dataset;
+
+        try {
+            dataset = std::make_unique<HighFive::DataSet>(
+                group.getDataSet(name)
+            );
+        } catch(HighFive::DataSetException& ex) {
+
+        }
+
+        // Only per point channels can be selected
+        if(!dataset)
+        {
+            continue;
+        }
+        std::vector<size_t> dim = dataset->getSpace().getDimensions();
+        if(dim.size() != 2 || dim[0] != numPoints)
+        {
+            continue;
+        }
+
+        boost::optional<PointBuffer::val_type> opt_vchannel
+            = m_vchannel_io->template loadVariantChannelIndices<PointBuffer::val_type>(group, name, indices);
+
+        if(opt_vchannel)
+        {
+            if(!ret)
+            {
+                ret.reset(new PointBuffer);
+            }
+            ret->insert({name, *opt_vchannel});
+        }
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+std::vector<size_t> PointCloudIO<Derived>::findPoints(
+    HighFive::Group& group,
+    const BoundingBox<BaseVector<float> >& bb)
+{
+    std::vector<size_t> ret;
+
+    if(!group.exist("points"))
+    {
+        return ret;
+    }
+
+    HighFive::DataSet dataset = group.getDataSet("points");
+    std::vector<size_t> dim = dataset.getSpace().getDimensions();
+    if(dim.size() != 2 || dim[1] != 3)
+    {
+        std::cout << "[Hdf5IO - PointCloudIO] WARNING: Wrong point dimensions." << std::endl;
+        return ret;
+    }
+
+    BaseVector<float> min = bb.getMin();
+    BaseVector<float> max = bb.getMax();
+    auto inside = [&min, &max](const float* p) {
+        return p[0] >= min.x && p[0] <= max.x
+            && p[1] >= min.y && p[1] <= max.y
+            && p[2] >= min.z && p[2] <= max.z;
+    };
+
+    std::vector<size_t> candidates;
+    if(indexedCandidates(group, bb, candidates))
+    {
+        std::vector<float> buffer(candidates.size() * 3);
+        hdf5util::readRows(dataset, candidates, buffer.data());
+        for(size_t i = 0; i < candidates.size(); i++)
+        {
+            if(inside(buffer.data() + 3 * i))
+            {
+                ret.push_back(candidates[i]);
+            }
+        }
+    }
+    else
+    {
+        // No index, scan all points block by block
+        const size_t blockSize = 1 << 20;
+        std::vector<float> buffer(blockSize * 3);
+        for(size_t offset = 0; offset < dim[0]; offset += blockSize)
+        {
+            size_t count = std::min(blockSize, dim[0] - offset);
+            hdf5util::readRows(dataset, offset, count, buffer.data());
+            for(size_t i = 0; i < count; i++)
+            {
+                if(inside(buffer.data() + 3 * i))
+                {
+                    ret.push_back(offset + i);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+template<typename Derived>
+bool PointCloudIO<Derived>::indexedCandidates(
+    HighFive::Group& group,
+    const BoundingBox<BaseVector<float> >& bb,
+    std::vector<size_t>& candidates)
+{
+    if(!group.exist(INDEX))
+    {
+        return false;
+    }
+
+    HighFive::Group g = hdf5util::getGroup(group, INDEX, false);
+    ChannelOptional<float> bounds = m_channel_io->template load<float>(g, "bounds");
+    ChannelOptional<unsigned int> res = m_channel_io->template load<unsigned int>(g, "resolution");
+    if(!bounds || !res || !g.exist("cells") || bounds->numElements() != 2 || res->width() != 3)
+    {
+        return false;
+    }
+
+    const float* b = bounds->dataPtr().get();
+    const unsigned int* r = res->dataPtr().get();
+
+    // The cell offsets are only read for the cells overlapping the box
+    HighFive::DataSet cells = g.getDataSet("cells");
+    size_t numCells = static_cast<size_t>(r[0]) * r[1] * r[2];
+    if(numCells == 0 || cells.getSpace().getDimensions()[0] != numCells + 1)
+    {
+        return false;
+    }
+
+    // Range of cells overlapping the box in each dimension
+    BaseVector<float> min = bb.getMin();
+    BaseVector<float> max = bb.getMax();
+    size_t lo[3];
+    size_t hi[3];
+    for(unsigned int a = 0; a < 3; a++)
+    {
+        if(max[a] < b[a] || min[a] > b[3 + a])
+        {
+            return true;
+        }
+
+        float extent = b[3 + a] - b[a];
+        float scale = extent > 0 ? r[a] / extent : 0;
+
+        // Clamp before converting, a float beyond the range of size_t
+        // has no defined conversion
+        float last = static_cast<float>(r[a] - 1);
+        lo[a] = static_cast<size_t>(std::min(std::max(0.0f, (min[a] - b[a]) * scale), last));
+        hi[a] = static_cast<size_t>(std::min(std::max(0.0f, (max[a] - b[a]) * scale), last));
+    }
+
+    // Each row of cells in x direction is a contiguous range of point
+    // indices, given by the offsets of its first cell and the cell behind
+    // its last one
+    std::vector<size_t> offsetRows;
+    for(size_t z = lo[2]; z <= hi[2]; z++)
+    {
+        for(size_t y = lo[1]; y <= hi[1]; y++)
+        {
+            size_t row = (z * r[1] + y) * r[0];
+            offsetRows.push_back(row + lo[0]);
+            offsetRows.push_back(row + hi[0] + 1);
+        }
+    }
+
+    std::vector<size_t> offsets(offsetRows.size());
+    hdf5util::readRows(cells, offsetRows, offsets.data());
+
+    // Neighbouring rows are merged if they touch
+    std::vector<std::pair<size_t, size_t> > ranges;
+    for(size_t i = 0; i < offsets.size(); i += 2)
+    {
+        size_t start = offsets[i];
+        size_t end = offsets[i + 1];
+        if(start == end)
+        {
+            continue;
+        }
+        if(!ranges.empty() && ranges.back().second == start)
+        {
+            ranges.back().second = end;
+        }
+        else
+        {
+            ranges.push_back({start, end});
+        }
+    }
+
+    for(auto& range : ranges)
+    {
+        ChannelOptional<unsigned int> ids =
+            m_channel_io->template loadChannelRange<unsigned int>(g, "points", range.first, range.second - range.first);
+        if(ids)
+        {
+            const unsigned int* ptr = ids->dataPtr().get();
+            candidates.insert(candidates.end(), ptr, ptr + ids->numElements());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    return true;
+}
+
 template<typename Derived>
 bool PointCloudIO<Derived>::isPointCloud(
     HighFive::Group& group)
@@ -5,6 +5,7 @@
 
 #include "ArrayIO.hpp"
 #include "MatrixIO.hpp"
+#include "PointCloudIO.hpp"
 #include "lvr2/types/ScanTypes.hpp"
 
 namespace lvr2
@@ -24,16 +25,26 @@ class ScanIO
     ScanPtr load(uint scanPos, uint scanNr);
     ScanPtr load(HighFive::Group& group, uint scanNr);
     ScanPtr load(HighFive::Group& group);
+
+    /**
+     * @brief Loads a scan with only the points inside the given bounding
+     *        box. Uses the spatial index stored with the scan points.
+     */
+    ScanPtr load(HighFive::Group& group, const BoundingBox<BaseVector<float> >& bb);
+    ScanPtr load(uint scanPos, uint scanNr, const BoundingBox<BaseVector<float> >& bb);
     // ScanPtr loadScan(HighFive::Group& group, std::string name);
 
   protected:
     bool isScan(HighFive::Group& group);
 
+    ScanPtr loadScan(HighFive::Group& group, const BoundingBox<BaseVector<float> >* bb);
+
     Derived* m_file_access = static_cast<Derived*>(this);
 
     // dependencies
     ArrayIO<Derived>* m_arrayIO = static_cast<ArrayIO<Derived>*>(m_file_access);
     MatrixIO<Derived>* m_matrixIO = static_cast<MatrixIO<Derived>*>(m_file_access);
+    PointCloudIO<Derived>* m_pointCloudIO = static_cast<PointCloudIO<Derived>*>(m_file_access);
 
     static constexpr const char* ID = "ScanIO";
     static constexpr const char* OBJID = "Scan";
@@ -44,7 +55,7 @@ class ScanIO
 /**
  *
  * @brief Hdf5Construct Specialization for hdf5features::ScanIO
- * - Constructs dependencies (ArrayIO, MatrixIO)
+ * - Constructs dependencies (ArrayIO, MatrixIO, PointCloudIO)
  * - Sets type variable
  *
  */
@@ -55,7 +66,8 @@ struct Hdf5Construct<hdf5features::ScanIO, Derived>
     // DEPS
     using dep1 = typename Hdf5Construct<hdf5features::ArrayIO, Derived>::type;
     using dep2 = typename Hdf5Construct<hdf5features::MatrixIO, Derived>::type;
-    using deps = typename dep1::template Merge<dep2>;
+    using dep3 = typename Hdf5Construct<hdf5features::PointCloudIO, Derived>::type;
+    using deps = typename dep1::template Merge<dep2>::template Merge<dep3>;
 
     // ADD THE FEATURE ITSELF
     using type = typename deps::template add_features<hdf5features::ScanIO>::type;
@@ -46,9 +46,10 @@ void ScanIO<Derived>::save(HighFive::Group& group, const ScanPtr& scanPtr)
 
     // save points
     std::vector<size_t> scanDim = {scanPtr->points->numPoints(), 3};
-    std::vector<hsize_t> scanChunk = {scanPtr->points->numPoints(), 3};
+    std::vector<hsize_t> scanChunk;
     boost::shared_array<float> points = scanPtr->points->getPointArray();
     m_arrayIO->template save<float>(group, "points", scanDim, scanChunk, points);
+    m_pointCloudIO->saveSpatialIndex(group, points, scanPtr->points->numPoints());
 
     // saving estimated and registrated pose
     m_matrixIO->save(group, "poseEstimation", scanPtr->poseEstimation);
@@ -150,8 +151,44 @@ ScanPtr ScanIO<Derived>::load(HighFive::Group& group, uint scanNr)
 //     return ret;
 // }
 
+template <typename Derived>
+ScanPtr ScanIO<Derived>::load(uint scanPos, uint scanNr, const BoundingBox<BaseVector<float> >& bb)
+{
+    ScanPtr ret;
+
+    char scan_buffer[sizeof(int) * 5];
+    sprintf(scan_buffer, "%08d", scanPos);
+    string scanPos_str(scan_buffer);
+
+    char buffer[sizeof(int) * 5];
+    sprintf(buffer, "%08d", scanNr);
+    string nr_str(buffer);
+
+    std::string basePath = "raw/" + scanPos_str + "/scans/data/" + nr_str;
+
+    if (hdf5util::exist(m_file_access->m_hdf5_file, basePath))
+    {
+        HighFive::Group group = hdf5util::getGroup(m_file_access->m_hdf5_file, basePath);
+        ret = load(group, bb);
+    }
+
+    return ret;
+}
+
 template <typename Derived>
 ScanPtr ScanIO<Derived>::load(HighFive::Group& group)
+{
+    return loadScan(group, nullptr);
+}
+
+template <typename Derived>
+ScanPtr ScanIO<Derived>::load(HighFive::Group& group, const BoundingBox<BaseVector<float> >& bb)
+{
+    return loadScan(group, &bb);
+}
+
+template <typename Derived>
+ScanPtr ScanIO<Derived>::loadScan(HighFive::Group& group, const BoundingBox<BaseVector<float> >* bb)
 {
     ScanPtr ret(new Scan());
 
@@ -165,7 +202,23 @@ ScanPtr ScanIO<Derived>::load(HighFive::Group& group)
     std::cout << "    loading points" << std::endl;
 
     // read points
-    if (group.exist("points"))
+    if (bb)
+    {
+        std::vector<size_t> indices = m_pointCloudIO->findPoints(group, *bb);
+        if (!indices.empty())
+        {
+            std::vector<size_t> dimension;
+            floatArr pointArr = m_arrayIO->template loadArrayIndices<float>(group, "points", indices, dimension);
+            ret->points = PointBufferPtr(new PointBuffer(pointArr, indices.size()));
+        }
+        else
+        {
+            ret->points = PointBufferPtr(new PointBuffer);
+        }
+        ret->numPoints = indices.size();
+        ret->pointsLoaded = false;
+    }
+    else if (group.exist("points"))
     {
         std::vector<size_t> dimension;
         floatArr pointArr = m_arrayIO->template load<float>(group, "points", dimension);
@@ -74,12 +74,22 @@ public:
     template<typename VariantChannelT>
     boost::optional<VariantChannelT> loadVariantChannel(std::string groupName, std::string datasetName);
 
+    /**
+     * @brief Loads the elements with the given indices of a channel
+     *        with a type that is only known at runtime.
+     */
+    template<typename VariantChannelT>
+    boost::optional<VariantChannelT> loadVariantChannelIndices(HighFive::Group& group,
+        std::string datasetName,
+        const std::vector<size_t>& indices);
+
 protected:
 
     template<typename VariantChannelT>
     boost::optional<VariantChannelT> loadDynamic(HighFive::DataType dtype,
         HighFive::Group& group,
-        std::string name);
+        std::string name,
+        const std::vector<size_t>* indices = nullptr);
 
     template<typename ...Tp>
     void saveDynamic(HighFive::Group& group,
@@ -69,12 +69,15 @@ boost::optional<VariantChannelT> loadVChannel(
     HighFive::DataType dtype,
     ChannelIO<Derived>* channel_io,
     HighFive::Group& group,
-    std::string name)
+    std::string name,
+    const std::vector<size_t>* indices)
 {
     boost::optional<VariantChannelT> ret;
     if(dtype == HighFive::AtomicType<typename VariantChannelT::template type_of_index<R> >())
     {
-        auto channel = channel_io->template load<typename VariantChannelT::template type_of_index<R> >(group, name);
+        using T = typename VariantChannelT::template type_of_index<R>;
+        auto channel = indices ? channel_io->template loadChannelIndices<T>(group, name, *indices)
+                               : channel_io->template load<T>(group, name);
         if(channel) {
             ret = *channel;
         }
@@ -90,19 +93,22 @@ boost::optional<VariantChannelT> loadVChannel(
     HighFive::DataType dtype,
     ChannelIO<Derived>* channel_io,
     HighFive::Group& group,
-    std::string name)
+    std::string name,
+    const std::vector<size_t>* indices)
 {
     if(dtype == HighFive::AtomicType<typename VariantChannelT::template type_of_index<R> >())
     {
+        using T = typename VariantChannelT::template type_of_index<R>;
         boost::optional<VariantChannelT> ret;
-        auto loaded_channel = channel_io->template load<typename VariantChannelT::template type_of_index<R> >(group, name);
+        auto loaded_channel = indices ? channel_io->template loadChannelIndices<T>(group, name, *indices)
+                                      : channel_io->template load<T>(group, name);
         if(loaded_channel)
         {
             ret = *loaded_channel;
         }
         return ret;
     } else {
-        return loadVChannel<Derived, VariantChannelT, R-1>(dtype, channel_io, group, name);
+        return loadVChannel<Derived, VariantChannelT, R-1>(dtype, channel_io, group, name, indices);
     }
 }
 
@@ -111,10 +117,11 @@ template<typename VariantChannelT>
 boost::optional<VariantChannelT> VariantChannelIO<Derived>::loadDynamic(
     HighFive::DataType dtype,
     HighFive::Group& group,
-    std::string name)
+    std::string name,
+    const std::vector<size_t>* indices)
 {
     return loadVChannel<Derived, VariantChannelT, VariantChannelT::num_types-1>(
-        dtype, m_channel_io, group, name);
+        dtype, m_channel_io, group, name, indices);
 }
 
 template<typename Derived>
@@ -172,6 +179,32 @@ boost::optional<VariantChannelT> VariantChannelIO<Derived>::loadVariantChannel(
     return load<VariantChannelT>(groupName, datasetName);
 }
 
+template<typename Derived>
+template<typename VariantChannelT>
+boost::optional<VariantChannelT> VariantChannelIO<Derived>::loadVariantChannelIndices(
+    HighFive::Group& group,
+    std::string datasetName,
+    const std::vector<size_t>& indices)
+{
+    boost::optional<VariantChannelT> ret;
+
+    std::unique_ptr<HighFive::DataSet> dataset;
+
+    try {
+        dataset = std::make_unique<HighFive::DataSet>(
+            group.getDataSet(datasetName)
+        );
+    } catch(HighFive::DataSetException& ex) {
+        std::cout << "[VariantChannelIO] WARNING: Dataset " << datasetName << " not found." << std::endl;
+    }
+
+    if(dataset)
+    {
+        ret = loadDynamic<VariantChannelT>(dataset->getDataType(), group, datasetName, &indices);
+    }
+
+    return ret;
+}
 
 } // hdf5features
 
@@ -0,0 +1,156 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CpuSurface_H
+#define __CpuSurface_H
+
+#include "lvr2/reconstruction/LBKdTree.hpp"
+#include "lvr2/geometry/LBPointArray.hpp"
+#include "lvr2/io/DataStruct.hpp"
+
+#include <boost/shared_ptr.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * @brief Normal estimation on the CPU with the same interface as ClSurface.
+ *
+ *        The normals are computed by a PCA over the exact k nearest neighbors
+ *        found in a left-balanced LBKdTree and are interpolated over the ki
+ *        nearest neighbors afterwards. Instances share no state, so several
+ *        surfaces can be processed in one process.
+ */
+class CpuSurface {
+public:
+    CpuSurface(floatArr& points, size_t num_points);
+    ~CpuSurface();
+
+    /**
+    * @brief Starts calculation the normals on the CPU
+    *
+    */
+    void calculateNormals();
+
+    /**
+     * @brief Get the resulting normals of the normal calculation. After calling "calculateNormals".
+     *
+     * @param output_normals     Array for 3 * num_points floats as return value
+     */
+    void getNormals(floatArr output_normals);
+
+    /**
+     * @brief Set the number of k nearest neighbors
+     *        k-neighborhood
+     *
+     * @param k             The size of the used k-neighborhood
+     *
+     */
+    void setKn(int kn);
+
+    /**
+     * @brief Set the number of k nearest neighbors
+     *        k-neighborhood for interpolation
+     *
+     * @param k             The size of the used k-neighborhood
+     *
+     */
+    void setKi(int ki);
+
+    /**
+     * @brief Set the number of k nearest neighbors
+     *        k-neighborhood for distance
+     *
+     *        Only stored for compatibility with ClSurface. Neither surface
+     *        evaluates distances, so the value has no effect.
+     *
+     * @param k             The size of the used k-neighborhood
+     *
+     */
+    void setKd(int kd);
+
+    /**
+     * @brief Set the viewpoint to orientate the normals
+     *
+     * @param v_x     Coordinate X axis
+     * @param v_y     Coordinate Y axis
+     * @param v_z     Coordinate Z axis
+     *
+     */
+    void setFlippoint(float v_x, float v_y, float v_z);
+
+    /**
+     * @brief Set Method for normal calculation
+     *
+     * @param method   "PCA". "RANSAC" is accepted for compatibility
+     *                 with ClSurface and falls back to PCA.
+     *
+     */
+    void setMethod(std::string method);
+
+private:
+
+    /// Squared distance and index of a neighbor
+    using Neighbor = std::pair<float, unsigned int>;
+
+    void initKdTree();
+
+    /**
+     * @brief Finds the k nearest neighbors of a query point
+     *
+     * @param query         The query point
+     * @param k             Number of neighbors
+     * @param neighbors     Returns the neighbors as max-heap of squared distances
+     */
+    void searchNeighbors(const float* query, unsigned int k, std::vector<Neighbor>& neighbors) const;
+
+    void estimateNormals();
+
+    void interpolateNormals();
+
+    // V->points
+    floatArr m_points;
+    LBPointArray<float> V;
+
+    boost::shared_ptr<LBKdTree> kd_tree_gen;
+    boost::shared_ptr<LBPointArray<float> > kd_tree_values;
+    boost::shared_ptr<LBPointArray<unsigned char> > kd_tree_splits;
+    boost::shared_ptr<LBPointArray<unsigned int> > kd_tree_indices;
+
+    std::vector<float> m_normals;
+
+    float m_vx, m_vy, m_vz;
+    int m_k, m_ki, m_kd;
+};
+
+} /* namespace lvr2 */
+
+#endif // !__CpuSurface_H
@@ -42,7 +42,6 @@
 #include "lvr2/reconstruction/PointsetSurface.hpp"
 #include "lvr2/reconstruction/MCTable.hpp"
 #include "lvr2/io/Progress.hpp"
-#include "OctreeThreadPool.hpp"
 
 #include "Octree.hpp"
 #include "DualOctree.hpp"
@@ -120,15 +119,36 @@ protected:
         int levels);
 
     /**
-     * @brief Traverses the octree and insert for each leaf the getSurface-function into the thread pool.
+     * @brief Traverses the octree and reconstructs the surface in the dual
+     *        cells of all leaves.
+     *
+     * The leaves are processed in parallel in batches. Each batch collects
+     * its triangles in a local list, the lists are added to the mesh in
+     * batch order afterwards, so the result does not depend on the number
+     * of threads.
      *
      * @param mesh       The reconstructed mesh.
-     * @param node       Actually node.
-     * @param threadPool A thread pool.
+     * @param octree     The octree.
      */
     void traverseTree(BaseMesh<BaseVecT> &mesh,
+            C_Octree<BaseVecT, BoxT, my_dummy> &octree);
+
+    /**
+     * @brief Reconstructs the surface in the dual cells around the corners
+     *        of a leaf.
+     *
+     * @param octree       The octree.
+     * @param ch           A leaf of the octree.
+     * @param cells        Number of cells on each side of the octree.
+     * @param max_bb_width Longest side of the bounding box.
+     * @param triangles    The corners of the found triangles are appended here.
+     */
+    void extractLeaf(
             C_Octree<BaseVecT, BoxT, my_dummy> &octree,
-            OctreeThreadPool<BaseVecT, BoxT>* threadPool);
+            CellHandle ch,
+            int cells,
+            float max_bb_width,
+            vector<BaseVecT> &triangles);
 
     void detectVertexForDualCell(
             C_Octree<BaseVecT, BoxT, my_dummy> &octree,
@@ -141,15 +161,13 @@ protected:
     /**
      * @brief Performs a local reconstruction according to the standard Marching Cubes table from Paul Bourke.
      *
-     * @param mesh The reconstructed mesh
-     * @param leaf A octree leaf.
+     * @param leaf      A dual leaf.
+     * @param cells     Number of cells on each side of the octree.
+     * @param triangles The corners of the found triangles are appended here.
      */
-    //void getSurface(BaseMesh<BaseVecT, BoxT> &mesh,
-    //    OctreeLeaf<BaseVecT, BoxT> *leaf);
-
-    void getSurface(BaseMesh<BaseVecT> &mesh,
-        DualLeaf<BaseVecT, BoxT> *leaf,
-        int cells);
+    void getSurface(DualLeaf<BaseVecT, BoxT> &leaf,
+        int cells,
+        vector<BaseVecT> &triangles);
 
     // The voxelsize used for reconstruction
     float m_voxelSize;
@@ -190,20 +208,8 @@ protected:
     // Count of the faces.
     uint m_faces;
 
-    // Global mutex.
-    boost::mutex m_globalMutex;
-
-    // Mutex for adding faces to the mesh buffer.
-    boost::mutex m_addMutex;
-
-    // Global progress bar.
-    ProgressBar *m_progressBar;
-
     // Pointer to the new Octree
     C_Octree<BaseVecT, BoxT, my_dummy> *octree;
-
-    // Pointer to the thread pool.
-    OctreeThreadPool<BaseVecT, BoxT> *m_threadPool;
 };
 } // namespace lvr2
 
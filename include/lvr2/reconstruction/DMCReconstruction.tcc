@@ -33,6 +33,7 @@
  */
 
 #include "lvr2/geometry/BaseMesh.hpp"
+#include <algorithm>
 #include <vector>
 #include <random>
 using std::vector;
@@ -43,7 +44,7 @@ template<typename BaseVecT, typename BoxT>
 DMCReconstruction<BaseVecT, BoxT>::DMCReconstruction(
         PointsetSurfacePtr<BaseVecT> surface,
         BoundingBox<BaseVecT> bb,
-        bool extrude) : PointsetMeshGenerator<BaseVecT>(surface)
+        bool extrude) : PointsetMeshGenerator<BaseVecT>(surface), m_extrude(extrude)
 {
 
     bb_min = bb.getMin();
@@ -60,6 +61,9 @@ DMCReconstruction<BaseVecT, BoxT>::DMCReconstruction(
     }
 
     m_boundingBoxCenter = bb.getCentroid();
+    // m_voxelSize is never set, so start from a unit voxel instead of
+    // garbage (which made this loop spin forever for values <= 0)
+    m_voxelSize = 1.0;
     m_maxSize = m_voxelSize;
 
     // Calculate a maximum voxelsize that is divisible by 2
@@ -84,9 +88,6 @@ DMCReconstruction<BaseVecT, BoxT>::DMCReconstruction(
     octree = new C_Octree<BaseVecT, BoxT, my_dummy>();
     octree->initialize(MAX_LEVEL);
 
-    // Create thread pool
-    m_threadPool = new OctreeThreadPool<BaseVecT, BoxT>(boost::thread::hardware_concurrency());
-
     m_nodes = 0;
     m_nodesExtr = 0;
     m_leaves = 0;
@@ -106,8 +107,7 @@ DMCReconstruction<BaseVecT, BoxT>::DMCReconstruction(
 template<typename BaseVecT, typename BoxT>
 DMCReconstruction<BaseVecT, BoxT>::~DMCReconstruction()
 {
-    delete m_threadPool;
-    delete m_progressBar;
+    delete octree;
 }
 
 template<typename BaseVecT, typename BoxT>
@@ -146,19 +146,13 @@ template<typename BaseVecT, typename BoxT>
 void DMCReconstruction<BaseVecT, BoxT>::getMesh(BaseMesh<BaseVecT> &mesh)
 {
     m_globalIndex = 0;
-    string comment = timestamp.getElapsedTime() + "Creating Mesh ";
-    m_progressBar = new ProgressBar(m_leaves, comment);
-    m_threadPool->startPool();
-    traverseTree(mesh, *octree, m_threadPool);
-    m_threadPool->stopPool();
-    cout << endl;
+    traverseTree(mesh, *octree);
 }
 
 template<typename BaseVecT, typename BoxT>
 void DMCReconstruction<BaseVecT, BoxT>::traverseTree(
         BaseMesh<BaseVecT> &mesh,
-        C_Octree<BaseVecT, BoxT, my_dummy> &octree,
-        OctreeThreadPool<BaseVecT, BoxT>* threadPool)
+        C_Octree<BaseVecT, BoxT, my_dummy> &octree)
 {
     CellHandle ch_end = octree.end();
     int cells = 2;
@@ -166,72 +160,108 @@ void DMCReconstruction<BaseVecT, BoxT>::traverseTree(
     {
         cells *= 2;
     }
+    float max_bb_width = *std::max_element(bb_size, bb_size+3);
 
+    vector<CellHandle> leaves;
     for (CellHandle ch = octree.root(); ch != ch_end; ++ch)
     {
         if (octree.is_leaf(ch))
         {
-            // start building dual Leaf
-            BaseVecT corners[8];
-            float* max_bb_width = std::max_element(bb_size, bb_size+3);
+            leaves.push_back(ch);
+        }
+    }
 
-            for(unsigned char c = 0; c < 8; c++)
-            {
-                bool outside = false;
+    // Neighboring leaves share most of their neighbor lookups, so batches
+    // of consecutive leaves are handed to the threads
+    const size_t batchSize = 64;
+    size_t numBatches = (leaves.size() + batchSize - 1) / batchSize;
+    vector<vector<BaseVecT> > triangles(numBatches);
 
-                // get all neighbors
-                std::vector<CellHandle> cellHandles = octree.all_corner_neighbors(ch, c);
+    string comment = timestamp.getElapsedTime() + "Creating Mesh ";
+    ProgressBar progress(numBatches, comment);
 
-                // find vertex of each cell
-                unsigned char i = 0;
-                while(i < 8 && !outside)
-                {
-                    BaseVecT tmp;
-                    detectVertexForDualCell(octree, cellHandles[i], cells, *max_bb_width, i, tmp);
-
-                    corners[i] = tmp;
-                    for(unsigned char j = 0; j < 3; j++)
-                    {
-                        if(corners[i][j] > bb_max[j])
-                        {
-                            outside = true;
-                        }
-                    }
-                    i++;
-                }
+    #pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < (long)numBatches; b++)
+    {
+        size_t end = std::min(leaves.size(), (b + 1) * batchSize);
+        for (size_t i = b * batchSize; i < end; i++)
+        {
+            extractLeaf(octree, leaves[i], cells, max_bb_width, triangles[b]);
+        }
+        ++progress;
+    }
+    cout << endl;
+
+    // Merge the triangles of all batches into the mesh
+    for (auto& batch : triangles)
+    {
+        for (size_t i = 0; i < batch.size(); i += 3)
+        {
+            VertexHandle v0 = mesh.addVertex(batch[i]);
+            VertexHandle v1 = mesh.addVertex(batch[i + 1]);
+            VertexHandle v2 = mesh.addVertex(batch[i + 2]);
+            mesh.addFace(v0, v1, v2);
+            m_globalIndex += 3;
+        }
+        vector<BaseVecT>().swap(batch);
+    }
+}
+
+template<typename BaseVecT, typename BoxT>
+void DMCReconstruction<BaseVecT, BoxT>::extractLeaf(
+        C_Octree<BaseVecT, BoxT, my_dummy> &octree,
+        CellHandle ch,
+        int cells,
+        float max_bb_width,
+        vector<BaseVecT> &triangles)
+{
+    // start building dual Leaf
+    BaseVecT corners[8];
+    CellHandle cellHandles[8];
+
+    for(unsigned char c = 0; c < 8; c++)
+    {
+        bool outside = false;
+
+        // get all neighbors
+        octree.all_corner_neighbors(ch, c, cellHandles);
+
+        // find vertex of each cell
+        unsigned char i = 0;
+        while(i < 8 && !outside)
+        {
+            BaseVecT tmp;
+            detectVertexForDualCell(octree, cellHandles[i], cells, max_bb_width, i, tmp);
 
-                if(!outside)
+            corners[i] = tmp;
+            for(unsigned char j = 0; j < 3; j++)
+            {
+                if(corners[i][j] > bb_max[j])
                 {
-                    // resort the vertices to needed coordinate system
-                    //        6------7         7------6
-                    //       /|     /|        /|     /|
-                    //      2------3 |       3------2 |
-                    // FROM | 4----|-5  ===> | 4----|-5
-                    //      |/     |/        |/     |/
-                    //      0------1         0------1
-                    //
-                    BaseVecT tmp = corners[2];
-                    corners[2] = corners[3];
-                    corners[3] = tmp;
-                    tmp = corners[6];
-                    corners[6] = corners[7];
-                    corners[7] = tmp;
-
-                    // generate dual leaf
-                    DualLeaf<BaseVecT, BoxT> *dualLeaf = new DualLeaf<BaseVecT, BoxT>(corners);
-
-                    threadPool->insertTask((boost::function<void()>)boost::bind(
-                            &lvr2::DMCReconstruction<BaseVecT, BoxT>::getSurface,
-                            this,
-                            boost::ref(mesh),
-                            dualLeaf,
-                            cells));
+                    outside = true;
                 }
             }
-            ++(*m_progressBar);
+            i++;
+        }
+
+        if(!outside)
+        {
+            // resort the vertices to needed coordinate system
+            //        6------7         7------6
+            //       /|     /|        /|     /|
+            //      2------3 |       3------2 |
+            // FROM | 4----|-5  ===> | 4----|-5
+            //      |/     |/        |/     |/
+            //      0------1         0------1
+            //
+            std::swap(corners[2], corners[3]);
+            std::swap(corners[6], corners[7]);
+
+            // generate dual leaf
+            DualLeaf<BaseVecT, BoxT> dualLeaf(corners);
+            getSurface(dualLeaf, cells, triangles);
         }
     }
-    return;
 }
 
 template<typename BaseVecT, typename BoxT>
@@ -377,25 +407,17 @@ void DMCReconstruction<BaseVecT, BoxT>::detectVertexForDualCell(
 
 template<typename BaseVecT, typename BoxT>
 void DMCReconstruction<BaseVecT, BoxT>::getSurface(
-        BaseMesh<BaseVecT> &mesh,
-        DualLeaf<BaseVecT, BoxT> *leaf,
-        int cells)
+        DualLeaf<BaseVecT, BoxT> &leaf,
+        int cells,
+        vector<BaseVecT> &triangles)
 {
     BaseVecT edges[8];
     float distances[8];
     BaseVecT vertex_positions[12];
-    float projectedDistance;
-    float euklideanDistance;
-    HalfEdgeMesh<BaseVecT> *meshCast;
-
-    if (m_reconstructionType == "PMC")
-    {
-        meshCast = static_cast<HalfEdgeMesh<BaseVecT>* >(&mesh);
-    }
 
+    leaf.getVertices(edges);
     for (unsigned char i = 0; i < 8; i++)
     {
-        leaf->getVertices(edges);
         // die distance-values kommen nicht aus dem Octree sondern aus dem KD-Tree
         float projectedDistance;
         float euklideanDistance;
@@ -403,14 +425,12 @@ void DMCReconstruction<BaseVecT, BoxT>::getSurface(
         distances[i] = projectedDistance;
     }
     // lediglich setzen der distanzwerte, bzw markieren, wo vorzeichenwechsel stattfinden
-    leaf->getIntersections(edges, distances, vertex_positions);
+    leaf.getIntersections(edges, distances, vertex_positions);
 
     // check whether the distances are close enough or not
+    float length = edges[1][0] - edges[0][0];
     for(unsigned char a = 0; a < 8; a++)
     {
-        float *max = std::max_element(bb_size, bb_size+3);
-        float length = edges[1][0] - edges[0][0];
-
         // Distanzen auf zulaessige Laenge pruefen
         if(distances[a] > (length * 1.7) || distances[a] < (length * (-1.7)))
         {
@@ -419,35 +439,14 @@ void DMCReconstruction<BaseVecT, BoxT>::getSurface(
     }
 
     // index is for mc-table
-    int index = leaf->getIndex(distances);
-    uint edge_index = 0;
+    int index = leaf.getIndex(distances);
 
-    //int triangle_indices[3];
     for(unsigned char a = 0; MCTable[index][a] != -1; a+= 3)
     {
-        vector<VertexHandle> triangle_vertices;
         for(unsigned char b = 0; b < 3; b++)
         {
-            edge_index = MCTable[index][a + b];
-            boost::unique_lock<boost::mutex> globalLock(m_globalMutex);
-            if(leaf->getIntersection(edge_index) == numeric_limits<uint>::max())
-            {
-                leaf->setIntersection(edge_index, m_globalIndex);
-                BaseVecT v = vertex_positions[edge_index];
-                VertexHandle vh = mesh.addVertex(v);
-                triangle_vertices.push_back(vh);
-                ++m_globalIndex;
-            }
-            else {
-                BaseVecT v = vertex_positions[edge_index];
-                VertexHandle vh = mesh.addVertex(v);
-                triangle_vertices.push_back(vh);
-            }
-            globalLock.unlock();
+            triangles.push_back(vertex_positions[MCTable[index][a + b]]);
         }
-        boost::unique_lock<boost::mutex> addLock(m_addMutex);
-        mesh.addFace(triangle_vertices[0], triangle_vertices[1], triangle_vertices[2]);
-        addLock.unlock();
     }
 }
 
@@ -31,12 +31,9 @@
 
 #include "lvr2/geometry/LBPointArray.hpp"
 
-#include <ctpl.h>
-
 #include <stdlib.h>
 #include <math.h>
-#include <list>
-#include <unordered_set>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -47,60 +44,87 @@ namespace lvr2
  * @brief The LBKdTree class implements a left-balanced array-based index kd-tree.
  *          Left-Balanced: minimum memory
  *          Array-Based: Good for GPU - Usage
+ *
+ *        The tree is built level by level with one nth_element partition per
+ *        node. All nodes of a level are partitioned in parallel. The upper
+ *        levels with fewer nodes than threads use a parallel selection
+ *        inside each node instead. The builder keeps no global state, so
+ *        several trees can be built concurrently. The memory needed besides
+ *        the tree itself is one copy of the points, plus a second one while
+ *        the upper levels are built with more than one thread. Splits are
+ *        made in the first three dimensions.
  */
 class LBKdTree {
 public:
 
+    /**
+     * @brief Builds the tree for the given vertices
+     *
+     * @param vertices      The points, vertices.dim floats per point
+     * @param num_threads   Number of OpenMP threads used for the construction
+     */
     LBKdTree( LBPointArray<float>& vertices , int num_threads=8);
 
     ~LBKdTree();
 
     void generateKdTree( LBPointArray<float>& vertices );
 
+    /**
+     * @brief Returns the node values. The first getKdTreeSplits()->width
+     *        entries are the split values of the inner nodes, the remaining
+     *        entries are the point indices of the leaves stored as float.
+     */
     boost::shared_ptr<LBPointArray<float> > getKdTreeValues();
 
+    /**
+     * @brief Returns the split dimension of every inner node
+     */
     boost::shared_ptr<LBPointArray<unsigned char> > getKdTreeSplits();
 
-private:
-
-    void generateKdTreeArray(LBPointArray<float>& V,
-            LBPointArray<unsigned int>* sorted_indices,
-            int max_dim);
-
-    boost::shared_ptr<LBPointArray<float> > m_values;
+    /**
+     * @brief Returns the point indices of the leaves as integers. Entry i
+     *        belongs to the node at position getKdTreeSplits()->width + i.
+     *        Unlike the float leaves of getKdTreeValues() these are exact
+     *        for more than 2^24 points.
+     */
+    boost::shared_ptr<LBPointArray<unsigned int> > getKdTreeIndices();
 
-    // split dim 4 dims per split_dim
-    boost::shared_ptr<LBPointArray<unsigned char> > m_splits;
+private:
 
-    // Static member
+    /// A point and its index, partitioned in place while building
+    struct BuildPoint
+    {
+        float coords[3];
+        unsigned int index;
+    };
 
-    static int st_num_threads;
-    static int st_depth_threads;
+    /// A node of the level that is currently partitioned
+    struct BuildNode
+    {
+        /// Position of the node in the tree arrays
+        unsigned int position;
 
-    static ctpl::thread_pool *pool;
+        /// Range of the node in the point array
+        unsigned int begin;
+        unsigned int end;
+    };
 
-    static void fillCriticalIndices(const LBPointArray<float>& V,
-            LBPointArray<unsigned int>& sorted_indices,
-            unsigned int current_dim,
-            float split_value, unsigned int split_index,
-            std::list<unsigned int>& critical_indices_left,
-            std::list<unsigned int>& critical_indices_right);
+    void generateKdTreeArray(std::vector<BuildPoint>& points);
 
-    static void fillCriticalIndicesSet(const LBPointArray<float>& V,
-            LBPointArray<unsigned int>& sorted_indices,
-            unsigned int current_dim,
-            float split_value, unsigned int split_index,
-            std::unordered_set<unsigned int>& critical_indices_left,
-            std::unordered_set<unsigned int>& critical_indices_right);
+    void partitionNode(std::vector<BuildPoint>& points,
+            std::vector<BuildPoint>& scratch,
+            const BuildNode& node,
+            bool parallel,
+            BuildNode* children);
 
+    boost::shared_ptr<LBPointArray<float> > m_values;
 
-    static void generateKdTreeRecursive(int id, LBPointArray<float>& V,
-            LBPointArray<unsigned int>* sorted_indices, int current_dim, int max_dim,
-            LBPointArray<float> *values, LBPointArray<unsigned char> *splits,
-            int size, int max_tree_depth, int position, int current_depth);
+    // split dim 4 dims per split_dim
+    boost::shared_ptr<LBPointArray<unsigned char> > m_splits;
 
-    static void test(int id, LBPointArray<float>* sorted_indices);
+    boost::shared_ptr<LBPointArray<unsigned int> > m_indices;
 
+    int m_numThreads;
 
 };
 
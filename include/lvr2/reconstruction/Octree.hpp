@@ -102,8 +102,9 @@ public:
         inline CellHandle face_neighbor  ( CellHandle _ch, int _idx ) const;
         inline CellHandle edge_neighbor  ( CellHandle _ch, int _idx ) const;
         inline std::vector<CellHandle> all_corner_neighbors( CellHandle _ch, int _idx ) const;
+        inline void all_corner_neighbors( CellHandle _ch, int _idx, CellHandle _neighbors[8] ) const;
         inline CellHandle corner_neighbor( CellHandle _ch, int _idx ) const;
-        inline std::vector<Location*> calc_neighbor_locations(Location locinfo, int _idx) const;
+        inline void calc_neighbor_locations(const Location& locinfo, int _idx, Location _locations[8]) const;
 
         //! Moving the picked cell, i.e. picking one of the neighbouring cells (if possible)
         void MovePickedCell(int _key, double* _mvm);
@@ -735,62 +736,27 @@ CellHandle C_Octree< BaseVecT, BoxT, T_CellData >::edge_neighbor( CellHandle _ch
 template <typename BaseVecT, typename BoxT, typename T_CellData>
 std::vector<CellHandle> C_Octree< BaseVecT, BoxT, T_CellData >::all_corner_neighbors(CellHandle _ch, int _idx) const
 {
-    std::vector<CellHandle> cellHandles;
-    std::vector<Location*> locations;
-    // get lower left back corner of given cell
-    Location locinfo = location( _ch );
-    LocCode loc_x = locinfo.loc_x();
-    LocCode loc_y = locinfo.loc_y();
-    LocCode loc_z = locinfo.loc_z();
-    LocCode binary_cell_size = 1 << locinfo.level();
-    int extent = ( 1 << m_rootLevel );
+    CellHandle neighbors[8];
+    all_corner_neighbors(_ch, _idx, neighbors);
+    return std::vector<CellHandle>(neighbors, neighbors + 8);
+}
 
-    // calculate the corner positions
-    for(unsigned char i = 0; i < 8; i++)
-    {
-        int new_loc_x = loc_x;
-        int new_loc_y = loc_y;
-        int new_loc_z = loc_z;
-        if ( loc_x > 0)
-        {
-            new_loc_x = loc_x + (octreeCornerNeighborTable[8 * _idx + i][0] * binary_cell_size);
-            if ( new_loc_x >= extent )
-            {
-                new_loc_x = loc_x;
-            }
-        }
-        if ( loc_y > 0)
-        {
-            new_loc_y = loc_y + (octreeCornerNeighborTable[8 * _idx + i][1] * binary_cell_size);
-            if ( new_loc_y >= extent )
-            {
-                new_loc_y = loc_y;
-            }
-        }
-        if ( loc_z > 0)
-        {
-            new_loc_z = loc_z + (octreeCornerNeighborTable[8 * _idx + i][2] * binary_cell_size);
-            if ( new_loc_z >= extent )
-            {
-                new_loc_z = loc_z;
-            }
-        }
-        locations.push_back(new Location(new_loc_x, new_loc_y, new_loc_z, locinfo.level(), locinfo.parent()));
-    }
+template <typename BaseVecT, typename BoxT, typename T_CellData>
+void C_Octree< BaseVecT, BoxT, T_CellData >::all_corner_neighbors(CellHandle _ch, int _idx, CellHandle _neighbors[8]) const
+{
+    // get the locations of the cells around the corner
+    Location locations[8];
+    calc_neighbor_locations(location( _ch ), _idx, locations);
 
-    for(Location * location : locations)
+    for(unsigned char i = 0; i < 8; i++)
     {
-        cellHandles.push_back(traverse(root(), location->loc_x(), location->loc_y(), location->loc_z()));
+        _neighbors[i] = traverse(root(), locations[i].loc_x(), locations[i].loc_y(), locations[i].loc_z());
     }
-    locations.clear();
-
-    return cellHandles;
 }
 
 template <typename BaseVecT, typename BoxT, typename T_CellData>
-std::vector<Location*> C_Octree< BaseVecT, BoxT, T_CellData >::calc_neighbor_locations(Location locinfo, int _idx) const
+void C_Octree< BaseVecT, BoxT, T_CellData >::calc_neighbor_locations(const Location& locinfo, int _idx, Location _locations[8]) const
 {
-    std::vector<Location*> locations;
     // get lower left back corner of given cell
     LocCode loc_x = locinfo.loc_x();
     LocCode loc_y = locinfo.loc_y();
@@ -798,12 +764,15 @@ std::vector<Location*> C_Octree< BaseVecT, BoxT, T_CellData >::calc_neighbor_loc
     LocCode binary_cell_size = 1 << locinfo.level();
     int extent = ( 1 << m_rootLevel );
 
+    // calculate the corner positions
     for(unsigned char i = 0; i < 8; i++)
     {
-        uint new_loc_x, new_loc_y, new_loc_z;
+        int new_loc_x = loc_x;
+        int new_loc_y = loc_y;
+        int new_loc_z = loc_z;
         if ( loc_x > 0)
         {
-            new_loc_x = loc_x + (octreeCornerNeighborTable[_idx + i][0] * binary_cell_size);
+            new_loc_x = loc_x + (octreeCornerNeighborTable[8 * _idx + i][0] * binary_cell_size);
             if ( new_loc_x >= extent )
             {
                 new_loc_x = loc_x;
@@ -811,7 +780,7 @@ std::vector<Location*> C_Octree< BaseVecT, BoxT, T_CellData >::calc_neighbor_loc
         }
         if ( loc_y > 0)
         {
-            new_loc_y = loc_y + (octreeCornerNeighborTable[_idx + i][1] * binary_cell_size);
+            new_loc_y = loc_y + (octreeCornerNeighborTable[8 * _idx + i][1] * binary_cell_size);
             if ( new_loc_y >= extent )
             {
                 new_loc_y = loc_y;
@@ -819,16 +788,14 @@ std::vector<Location*> C_Octree< BaseVecT, BoxT, T_CellData >::calc_neighbor_loc
         }
         if ( loc_z > 0)
         {
-            new_loc_z = loc_z + (octreeCornerNeighborTable[_idx + i][2] * binary_cell_size);
+            new_loc_z = loc_z + (octreeCornerNeighborTable[8 * _idx + i][2] * binary_cell_size);
             if ( new_loc_z >= extent )
             {
                 new_loc_z = loc_z;
             }
         }
-        locations.push_back(new Location(new_loc_x, new_loc_y, new_loc_z, locinfo.level(), locinfo.parent()));
+        _locations[i] = Location(new_loc_x, new_loc_y, new_loc_z, locinfo.level(), locinfo.parent());
     }
-
-    return locations;
 }
 
 //-----------------------------------------------------------------------------
@@ -35,6 +35,7 @@
 #ifndef LVR2_RECONSTRUCTION_SEARCHTREE_H_
 #define LVR2_RECONSTRUCTION_SEARCHTREE_H_
 
+#include <limits>
 #include <vector>
 
 namespace lvr2
@@ -96,6 +97,30 @@ public:
         std::vector<size_t>& indices
     ) const;
 
+    /**
+     * @brief Performs a k-next-neighbor search for many query points at once.
+     *
+     * The default implementation calls `kSearch` for each point. Search trees
+     * that can process batches more efficiently should override it.
+     *
+     * @param query       The query points.
+     * @param n           The number of query points.
+     * @param k           The number of neighbours that should be searched.
+     * @param indices     Array of n * k entries that receives the indices of
+     *                    the neighbours of each query point. If less than k
+     *                    neighbours are found, the remaining entries are set
+     *                    to `std::numeric_limits<size_t>::max()`.
+     * @param distances   Array of n * k entries that receives the distances
+     *                    reported by `kSearch`.
+     */
+    virtual void kSearchMany(
+        const BaseVecT* query,
+        int n,
+        int k,
+        size_t* indices,
+        CoordT* distances
+    ) const;
+
     // /**
     //  * @brief Set the number of neighbours used to estimate and interpolate normals.
     //  */
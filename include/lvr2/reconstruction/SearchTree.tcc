@@ -35,6 +35,7 @@
 
 #include "lvr2/io/Timestamp.hpp"
 
+#include <algorithm>
 #include <iostream>
 using std::cout;
 using std::endl;
@@ -53,6 +54,38 @@ int SearchTree<BaseVecT>::kSearch(
     return this->kSearch(qp, neighbours, indices, distances);
 }
 
+template<typename BaseVecT>
+void SearchTree<BaseVecT>::kSearchMany(
+    const BaseVecT* query,
+    int n,
+    int k,
+    size_t* indices,
+    CoordT* distances
+) const
+{
+    std::vector<size_t> ind;
+    std::vector<CoordT> dist;
+    for (size_t i = 0; i < (size_t)n; i++)
+    {
+        this->kSearch(query[i], k, ind, dist);
+
+        const size_t found = std::min<size_t>(std::min(ind.size(), dist.size()), k);
+        for (size_t j = 0; j < (size_t)k; j++)
+        {
+            if (j < found)
+            {
+                indices[i * k + j] = ind[j];
+                distances[i * k + j] = dist[j];
+            }
+            else
+            {
+                indices[i * k + j] = std::numeric_limits<size_t>::max();
+                distances[i * k + j] = std::numeric_limits<CoordT>::max();
+            }
+        }
+    }
+}
+
 // template<typename BaseVecT>
 // void SearchTree<BaseVecT>::setKi(int ki)
 // {
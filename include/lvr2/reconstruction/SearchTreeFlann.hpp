@@ -86,13 +86,14 @@ public:
         vector<size_t>& indices
     ) const override;
 
-    void kSearchMany(
+    /// See interface documentation.
+    virtual void kSearchMany(
         const BaseVecT* query,
         int n,
         int k,
         size_t* indices,
         CoordT* distances
-    ) const;
+    ) const override;
 
 protected:
 
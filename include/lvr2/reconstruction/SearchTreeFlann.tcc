@@ -38,6 +38,9 @@
 
 #include "lvr2/util/Panic.hpp"
 
+#include <algorithm>
+#include <limits>
+
 #ifndef __APPLE__
 #include <omp.h>
 #endif
@@ -99,7 +102,20 @@ void SearchTreeFlann<BaseVecT>::radiusSearch(
     vector<size_t>& indices
 ) const
 {
-    panic_unimplemented("radiusSearch() is not implemented for FLANN yet");
+    CoordT point[3] = { qp.x, qp.y, qp.z };
+    flann::Matrix<CoordT> query_point(point, 1, 3);
+
+    // FLANN's L2 distances are squared, so the radius has to be as well.
+    // The results don't need to be sorted, which saves a heap operation
+    // per found neighbour.
+    flann::SearchParams params;
+    params.sorted = false;
+
+    std::vector<std::vector<size_t>> ind;
+    std::vector<std::vector<CoordT>> dist;
+    m_tree->radiusSearch(query_point, ind, dist, r * r, params);
+
+    indices.assign(ind[0].begin(), ind[0].end());
 }
 
 template<typename BaseVecT>
@@ -111,28 +127,29 @@ void SearchTreeFlann<BaseVecT>::kSearchMany(
     CoordT* distances
 ) const
 {
-    CoordT* queries = new CoordT[n * 3];
-    flann::Matrix<CoordT> queries_mat(queries, n, 3);
-    flann::Matrix<size_t> indices_mat(indices, n, 1);
-    flann::Matrix<CoordT> distances_mat(distances, n, 1);
-
-    #pragma omp parallel for
-    for (size_t i = 0; i < n; i++)
+    vector<CoordT> queries((size_t)n * 3);
+    for (size_t i = 0; i < (size_t)n; i++)
     {
-        queries_mat[i][0] = query[i].x;
-        queries_mat[i][1] = query[i].y;
-        queries_mat[i][2] = query[i].z;
+        queries[i * 3 + 0] = query[i].x;
+        queries[i * 3 + 1] = query[i].y;
+        queries[i * 3 + 2] = query[i].z;
     }
 
+    flann::Matrix<CoordT> queries_mat(queries.data(), n, 3);
+    flann::Matrix<size_t> indices_mat(indices, n, k);
+    flann::Matrix<CoordT> distances_mat(distances, n, k);
+
+    // Entries that FLANN leaves untouched mark missing neighbours
+    std::fill(indices, indices + (size_t)n * k, std::numeric_limits<size_t>::max());
+
     flann::SearchParams params;
     #ifndef __APPLE__
-    params.cores = omp_get_max_threads();
+    // Batches issued from parallel code are searched by the calling thread
+    params.cores = omp_in_parallel() ? 1 : omp_get_max_threads();
     #else
     params.cores = 4;
     #endif
-    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, 1, params);
-
-    delete[] queries;
+    m_tree->knnSearch(queries_mat, indices_mat, distances_mat, k, params);
 }
 
 
@@ -0,0 +1,108 @@
+//
+// DynamicVertexGrid.hpp
+//
+
+#ifndef LAS_VEGAS_DYNAMICVERTEXGRID_HPP
+#define LAS_VEGAS_DYNAMICVERTEXGRID_HPP
+
+#include "lvr2/geometry/BoundingBox.hpp"
+#include "lvr2/geometry/Handles.hpp"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lvr2
+{
+
+/**
+ * Spatial index for the vertices of a growing mesh. The vertices are hashed into a regular grid,
+ * so inserting, moving and removing a vertex takes constant time and the index never degenerates
+ * like a kd-tree that is modified in place. Whenever the average number of vertices per occupied
+ * cell exceeds a limit, the cell size is halved and the grid is rebuilt.
+ *
+ * findNearest() does not modify the grid and may be called from several threads at once.
+ *
+ * @tparam BaseVecT - the vector type used
+ */
+template <typename BaseVecT>
+class DynamicVertexGrid
+{
+  public:
+    /**
+     * Creates an empty grid
+     * @param bb - bounding box of the region the vertices will be in, used for the initial cell size
+     * @param maxPerCell - average number of vertices per occupied cell that triggers a refinement
+     */
+    explicit DynamicVertexGrid(const BoundingBox<BaseVecT>& bb, size_t maxPerCell = 8);
+
+    /**
+     * Adds a vertex to the grid
+     */
+    void insert(VertexHandle vH, const BaseVecT& point);
+
+    /**
+     * Sets the new position of a vertex, that is already in the grid
+     */
+    void update(VertexHandle vH, const BaseVecT& point);
+
+    /**
+     * Removes a vertex from the grid
+     */
+    void remove(VertexHandle vH);
+
+    /**
+     * Finds the vertex closest to the given point
+     * @return the closest vertex, none if the grid is empty
+     */
+    OptionalVertexHandle findNearest(const BaseVecT& point) const;
+
+    /**
+     * @return the number of vertices in the grid
+     */
+    size_t size() const { return m_size; }
+
+    /**
+     * @return the current edge length of the cells
+     */
+    float cellSize() const { return m_cellSize; }
+
+  private:
+    using Key = uint64_t;
+    using Cell = std::array<int, 3>;
+
+    Cell cellOf(const BaseVecT& point) const;
+
+    static Key key(const Cell& c);
+
+    void addToCell(Index idx);
+
+    void removeFromCell(Index idx);
+
+    void rebuild(float cellSize);
+
+    // vertex indices per occupied cell
+    std::unordered_map<Key, std::vector<Index>> m_cells;
+
+    // positions and cells of the vertices, indexed by the vertex handle
+    std::vector<BaseVecT> m_points;
+    std::vector<Cell> m_vertexCells;
+    std::vector<uint8_t> m_contained;
+
+    BaseVecT m_origin;
+    float m_cellSize;
+    float m_minCellSize;
+    size_t m_maxPerCell;
+    size_t m_size;
+
+    // bounds of the cells, that were occupied since the last rebuild
+    Cell m_min;
+    Cell m_max;
+};
+
+} // namespace lvr2
+
+#include "DynamicVertexGrid.tcc"
+
+#endif // LAS_VEGAS_DYNAMICVERTEXGRID_HPP
@@ -0,0 +1,252 @@
+//
+// DynamicVertexGrid.tcc
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace lvr2
+{
+
+    template <typename BaseVecT>
+    DynamicVertexGrid<BaseVecT>::DynamicVertexGrid(const BoundingBox<BaseVecT>& bb, size_t maxPerCell)
+        : m_maxPerCell(std::max<size_t>(maxPerCell, 1)), m_size(0)
+    {
+        float extent = bb.isValid() ? bb.getLongestSide() : 1.0f;
+        if(extent <= 0)
+        {
+            extent = 1.0f;
+        }
+
+        //start with 16 cells along the longest side. cells are never made so small, that the
+        //cell coordinates of the bounding box exceed the range of the keys
+        m_origin = bb.isValid() ? bb.getMin() : BaseVecT(0, 0, 0);
+        m_cellSize = extent / 16;
+        m_minCellSize = extent / (1 << 18);
+
+        m_min = {std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+        m_max = {std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min()};
+    }
+
+    template <typename BaseVecT>
+    typename DynamicVertexGrid<BaseVecT>::Cell DynamicVertexGrid<BaseVecT>::cellOf(const BaseVecT& point) const
+    {
+        const BaseVecT rel = point - m_origin;
+        Cell c;
+        c[0] = static_cast<int>(std::floor(rel.x / m_cellSize));
+        c[1] = static_cast<int>(std::floor(rel.y / m_cellSize));
+        c[2] = static_cast<int>(std::floor(rel.z / m_cellSize));
+        return c;
+    }
+
+    template <typename BaseVecT>
+    typename DynamicVertexGrid<BaseVecT>::Key DynamicVertexGrid<BaseVecT>::key(const Cell& c)
+    {
+        //21 bits per coordinate, shifted to be positive
+        const Key mask = (1 << 21) - 1;
+        return  ((Key)(c[0] + (1 << 20)) & mask)
+             | (((Key)(c[1] + (1 << 20)) & mask) << 21)
+             | (((Key)(c[2] + (1 << 20)) & mask) << 42);
+    }
+
+    template <typename BaseVecT>
+    void DynamicVertexGrid<BaseVecT>::addToCell(Index idx)
+    {
+        const Cell c = cellOf(m_points[idx]);
+        m_vertexCells[idx] = c;
+        m_cells[key(c)].push_back(idx);
+
+        for(int a = 0; a < 3; a++)
+        {
+            m_min[a] = std::min(m_min[a], c[a]);
+            m_max[a] = std::max(m_max[a], c[a]);
+        }
+    }
+
+    template <typename BaseVecT>
+    void DynamicVertexGrid<BaseVecT>::removeFromCell(Index idx)
+    {
+        auto it = m_cells.find(key(m_vertexCells[idx]));
+        if(it == m_cells.end())
+        {
+            return;
+        }
+
+        std::vector<Index>& indices = it->second;
+        auto pos = std::find(indices.begin(), indices.end(), idx);
+        if(pos != indices.end())
+        {
+            *pos = indices.back();
+            indices.pop_back();
+        }
+
+        if(indices.empty())
+        {
+            m_cells.erase(it);
+        }
+    }
+
+    template <typename BaseVecT>
+    void DynamicVertexGrid<BaseVecT>::insert(VertexHandle vH, const BaseVecT& point)
+    {
+        const Index idx = vH.idx();
+        if(idx >= m_points.size())
+        {
+            m_points.resize(idx + 1);
+            m_vertexCells.resize(idx + 1);
+            m_contained.resize(idx + 1, 0);
+        }
+
+        if(m_contained[idx])
+        {
+            update(vH, point);
+            return;
+        }
+
+        m_points[idx] = point;
+        m_contained[idx] = 1;
+        m_size++;
+        addToCell(idx);
+
+        //refine the grid, if the cells get too crowded
+        if(m_size > m_maxPerCell * m_cells.size() && m_cellSize / 2 >= m_minCellSize)
+        {
+            rebuild(m_cellSize / 2);
+        }
+    }
+
+    template <typename BaseVecT>
+    void DynamicVertexGrid<BaseVecT>::update(VertexHandle vH, const BaseVecT& point)
+    {
+        const Index idx = vH.idx();
+        if(idx >= m_contained.size() || !m_contained[idx])
+        {
+            insert(vH, point);
+            return;
+        }
+
+        m_points[idx] = point;
+
+        //most updates are small moves, which keep the vertex in its cell
+        if(cellOf(point) != m_vertexCells[idx])
+        {
+            removeFromCell(idx);
+            addToCell(idx);
+        }
+    }
+
+    template <typename BaseVecT>
+    void DynamicVertexGrid<BaseVecT>::remove(VertexHandle vH)
+    {
+        const Index idx = vH.idx();
+        if(idx >= m_contained.size() || !m_contained[idx])
+        {
+            return;
+        }
+
+        removeFromCell(idx);
+        m_contained[idx] = 0;
+        m_size--;
+    }
+
+    template <typename BaseVecT>
+    void DynamicVertexGrid<BaseVecT>::rebuild(float cellSize)
+    {
+        m_cellSize = cellSize;
+        m_cells.clear();
+        m_min = {std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+        m_max = {std::numeric_limits<int>::min(), std::numeric_limits<int>::min(), std::numeric_limits<int>::min()};
+
+        for(Index idx = 0; idx < m_points.size(); idx++)
+        {
+            if(m_contained[idx])
+            {
+                addToCell(idx);
+            }
+        }
+    }
+
+    template <typename BaseVecT>
+    OptionalVertexHandle DynamicVertexGrid<BaseVecT>::findNearest(const BaseVecT& point) const
+    {
+        if(m_size == 0)
+        {
+            return OptionalVertexHandle();
+        }
+
+        const Cell center = cellOf(point);
+
+        //rings beyond this one don't contain any cells that were occupied
+        int maxRing = 0;
+        for(int a = 0; a < 3; a++)
+        {
+            maxRing = std::max(maxRing, std::max(std::abs(center[a] - m_min[a]), std::abs(m_max[a] - center[a])));
+        }
+
+        Index best = std::numeric_limits<Index>::max();
+        float bestDist = std::numeric_limits<float>::infinity();
+
+        auto visit = [&](int x, int y, int z)
+        {
+            auto it = m_cells.find(key({center[0] + x, center[1] + y, center[2] + z}));
+            if(it == m_cells.end())
+            {
+                return;
+            }
+            for(Index idx : it->second)
+            {
+                float dist = (m_points[idx] - point).length2();
+                if(dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = idx;
+                }
+            }
+        };
+
+        //search the cells in rings of growing size around the cell of the point. all cells of
+        //ring r are at least (r - 1) cell sizes away from the point. the rings are clipped to
+        //the occupied cells
+        const int lo[3] = {m_min[0] - center[0], m_min[1] - center[1], m_min[2] - center[2]};
+        const int hi[3] = {m_max[0] - center[0], m_max[1] - center[1], m_max[2] - center[2]};
+
+        for(int r = 0; r <= maxRing; r++)
+        {
+            const float ringDist = (r - 1) * m_cellSize;
+            if(r > 1 && ringDist * ringDist >= bestDist)
+            {
+                break;
+            }
+
+            for(int x = std::max(-r, lo[0]); x <= std::min(r, hi[0]); x++)
+            {
+                for(int y = std::max(-r, lo[1]); y <= std::min(r, hi[1]); y++)
+                {
+                    if(std::abs(x) == r || std::abs(y) == r)
+                    {
+                        for(int z = std::max(-r, lo[2]); z <= std::min(r, hi[2]); z++)
+                        {
+                            visit(x, y, z);
+                        }
+                    }
+                    else
+                    {
+                        //inner columns only touch the ring at its top and bottom
+                        if(-r >= lo[2] && -r <= hi[2])
+                        {
+                            visit(x, y, -r);
+                        }
+                        if(r > 0 && r >= lo[2] && r <= hi[2])
+                        {
+                            visit(x, y, r);
+                        }
+                    }
+                }
+            }
+        }
+
+        return OptionalVertexHandle(VertexHandle(best));
+    }
+
+} // namespace lvr2
@@ -9,9 +9,12 @@
 #include "lvr2/config/BaseOption.hpp"
 #include "lvr2/geometry/HalfEdgeMesh.hpp"
 #include "lvr2/reconstruction/PointsetSurface.hpp"
-#include "lvr2/reconstruction/gs2/DynamicKDTree.hpp"
+#include "lvr2/reconstruction/gs2/DynamicVertexGrid.hpp"
 #include "lvr2/reconstruction/gs2/TumbleTree.hpp"
 
+#include <algorithm>
+#include <vector>
+
 namespace lvr2
 {
 
@@ -58,6 +61,8 @@ class GrowingCellStructure
 
     bool isInterior() const { return m_interior; }
 
+    int getBatchSize() const { return m_batchSize; }
+
     void setRuntime(int m_runtime) { GrowingCellStructure::m_runtime = m_runtime; }
 
     void setBasicSteps(int m_basicSteps) { GrowingCellStructure::m_basicSteps = m_basicSteps; }
@@ -104,6 +109,14 @@ class GrowingCellStructure
 
     void setNumBalances(int m_balances) { GrowingCellStructure::m_balances = m_balances; }
 
+    /**
+     * Sets the number of samples, which are adapted to at once. The basic steps between two
+     * vertex splits are processed in mini-batches of this size: the winners of all samples are
+     * searched in parallel, samples whose neighbourhoods don't overlap move the mesh in parallel.
+     * 1 (default) adapts to one sample after the other.
+     */
+    void setBatchSize(int m_batchSize) { GrowingCellStructure::m_batchSize = std::max(m_batchSize, 1); }
+
   private:
     PointsetSurfacePtr<BaseVecT>* m_surface; // helper-surface
     HalfEdgeMesh<BaseVecT>* m_mesh;
@@ -119,11 +132,12 @@ class GrowingCellStructure
     bool m_filterChain; // should a filter chain be applied?
     bool m_interior;    // should the interior be reconstructed or the exterior?
     int m_balances;
+    int m_batchSize = 1; // samples per mini-batch
     float m_avgSignalCounter = 0;
 
     // "GCS" related members
     TumbleTree* tumble_tree;
-    DynamicKDTree<BaseVecT>* kd_tree;
+    DynamicVertexGrid<BaseVecT>* vertex_grid; // spatial index of the mesh vertices
     std::vector<Cell*> cellArr; // TODO: OUTSOURCE IT INTO THE TUMBLETREE CLASS, NEW PARAMETER FOR
                                 // THE TUMBLE TREE CONSTRUCTOR
                                 // CONTAINING THE MAXMIMUM SIZE OF THE MESH
@@ -150,6 +164,14 @@ class GrowingCellStructure
 
     void executeBasicStep(PacmanProgressBar& progress_bar);
 
+    void executeBasicSteps(int numSamples, PacmanProgressBar& progress_bar);
+
+    void adaptToSample(VertexHandle winnerH, const std::vector<VertexHandle>& neighborsOfWinner, BaseVecT sample);
+
+    void updateSignalCounter(VertexHandle winnerH);
+
+    void updateVertexGrid(VertexHandle winnerH, const std::vector<VertexHandle>& neighborsOfWinner);
+
     void executeVertexSplit();
 
     void executeEdgeCollapse();
@@ -158,7 +180,7 @@ class GrowingCellStructure
 
     BaseVecT getRandomPointFromPointcloud();
 
-    VertexHandle getClosestPointInMesh(BaseVecT point, PacmanProgressBar& progress_bar);
+    VertexHandle getClosestPointInMesh(BaseVecT point);
 
     void initTestMesh(); // test
 
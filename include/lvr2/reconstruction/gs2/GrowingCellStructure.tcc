@@ -27,7 +27,7 @@ namespace lvr2 {
         m_surface = &surface;
         m_mesh = 0;
         tumble_tree = new TumbleTree(); //create tumble tree
-        kd_tree = new DynamicKDTree<BaseVecT>(3); // create 3-dimensional kd-tree for distance evaluation
+        vertex_grid = NULL; // created with the initial mesh, when the size of the pointcloud is known
     }
 
     /**
@@ -52,9 +52,8 @@ namespace lvr2 {
         //get initial tetrahedron mesh
         getInitialMesh();
 
-        //progress bar
-        size_t runtime_length = (size_t)((((size_t)m_runtime*(size_t)m_numSplits)
-                                          *(((size_t)m_numSplits*(size_t)m_runtime)+1)/(size_t)2) * (size_t)m_basicSteps);
+        //progress bar, counts the basic steps
+        size_t runtime_length = (size_t)m_runtime * (size_t)m_numSplits * (size_t)m_basicSteps;
         PacmanProgressBar progress_bar(runtime_length);
 
         //algorithm
@@ -69,9 +68,9 @@ namespace lvr2 {
 
             for(int j = 0; j < getNumSplits(); j++)
             {
-                for(int k = 0; k < getBasicSteps(); k++)
+                for(int k = 0; k < getBasicSteps(); k += m_batchSize)
                 {
-                    executeBasicStep(progress_bar);
+                    executeBasicSteps(std::min(m_batchSize, getBasicSteps() - k), progress_bar);
                 }
                 executeVertexSplit(); //TODO: execute vertex split after a specific number of basic steps
 
@@ -109,7 +108,7 @@ namespace lvr2 {
         cout << "Max depth of tt: " << (m_balances != 0 ? max_depth : tumble_tree->maxDepth()) << endl;
         cout << "Not Deleted in TT: " << tumble_tree->notDeleted << endl;
         cout << "Tumble Tree size: " << tumble_tree->size() << endl;
-        cout << "KD-Tree size: " << kd_tree->size() << endl;
+        cout << "Vertex grid size: " << vertex_grid->size() << endl;
         cout << "Cell array size: " << cellVecSize() << endl;
         cout << "Not found counter: " << notFoundCounter << endl;
         cout << endl;
@@ -120,6 +119,8 @@ namespace lvr2 {
         cout << "Valances >= 10: " << numVertexValences(10) << endl;
         cout << "Valances >= 15: " << numVertexValences(15) << endl;
         delete tumble_tree;
+        delete vertex_grid;
+        vertex_grid = NULL;
     }
 
 
@@ -141,70 +142,240 @@ namespace lvr2 {
         //cout << "basic step" << endl;
         if(!m_useGSS) //if only gcs is used (gcs basic step)
         {
-            VertexHandle winnerH = this->getClosestPointInMesh(random_point, progress_bar); //TODO: better runtime efficency(kd-tree)
-            /*Index winnerIndex = kd_tree->findNearest(random_point);
-            VertexHandle winnerH(winnerIndex);*/
-
-            //smooth the winning vertex
-            BaseVecT &winner = m_mesh->getVertexPosition(winnerH);
-            //kd_tree->deleteNode(winner);
-            winner += (random_point - winner) * getLearningRate();
-            //kd_tree->insert(winner, winnerH);
-
-            //smooth the winning vertices' neighbors (laplacian smoothing)
+            VertexHandle winnerH = this->getClosestPointInMesh(random_point);
 
             vector<VertexHandle> neighborsOfWinner;
             m_mesh->getNeighboursOfVertex(winnerH, neighborsOfWinner);
 
-            //perform laplacian smoothing on all the neighbors of the winning vertex
-            for(auto v : neighborsOfWinner)
+            //move the winner and its neighbors towards the random point
+            adaptToSample(winnerH, neighborsOfWinner, random_point);
+            updateVertexGrid(winnerH, neighborsOfWinner);
+            updateSignalCounter(winnerH);
+
+            ++progress_bar;
+        }
+        else //GSS TODO: INCLUDE GSS ADDITIONS
+        {
+            std::cout << "Using GSS" << endl;
+            //find closest structure
+
+            //set approx error(s) and age of faces (using HashMap)
+
+            //smoothing
+
+            //coalescing
+
+            //filter chain
+        }
+    }
+
+
+    /**
+     * Executes numSamples basic steps as one mini-batch (GCS).
+     *
+     * The winners of all samples are searched in parallel, using the positions of the mesh
+     * vertices at the start of the batch. Then the samples are adapted to in phases: a sample
+     * joins the current phase if the vertices it moves are neither moved nor read by another sample
+     * of the phase, and if the vertices it reads aren't moved by another one. The samples of a
+     * phase are adapted to in parallel, all others are deferred to the next phase. The signal
+     * counters and the vertex grid are updated sequentially after each phase.
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param numSamples number of random points in the batch
+     * @param progress_bar progress of the algorithm
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::executeBasicSteps(int numSamples, PacmanProgressBar& progress_bar)
+    {
+        if(numSamples <= 1 || m_useGSS)
+        {
+            for(int i = 0; i < numSamples; i++)
             {
-                BaseVecT& nb = m_mesh->getVertexPosition(v);
-                //kd_tree->deleteNode(nb);
+                executeBasicStep(progress_bar);
+            }
+            return;
+        }
+
+        //rand() is not thread safe, draw the samples up front
+        vector<BaseVecT> samples(numSamples);
+        for(int i = 0; i < numSamples; i++)
+        {
+            samples[i] = getRandomPointFromPointcloud();
+        }
+
+        //the laplacian smoothing of the neighbors reads their neighbors as well
+        const bool smoothing = m_mesh->numVertices() > 100;
 
-                nb += (random_point - winner) * getNeighborLearningRate();
-                if(m_mesh->numVertices() > 100) performLaplacianSmoothing(v, random_point, getNeighborLearningRate());
+        vector<VertexHandle> winners(numSamples, VertexHandle(0));
+        vector<vector<VertexHandle>> neighbors(numSamples); // moved by the sample (without the winner)
+        vector<vector<VertexHandle>> reads(numSamples);     // only read by the sample
+
+        #pragma omp parallel for schedule(dynamic)
+        for(long i = 0; i < numSamples; i++)
+        {
+            winners[i] = getClosestPointInMesh(samples[i]);
+            m_mesh->getNeighboursOfVertex(winners[i], neighbors[i]);
 
-                //kd_tree->insert(nb, v);
+            if(smoothing)
+            {
+                vector<VertexHandle> ring;
+                for(VertexHandle nb : neighbors[i])
+                {
+                    ring.clear();
+                    m_mesh->getNeighboursOfVertex(nb, ring);
+                    reads[i].insert(reads[i].end(), ring.begin(), ring.end());
+                }
             }
+        }
 
+        //stamps of the phase, in which a vertex was moved or read last
+        vector<int> moved(cellArr.size(), -1);
+        vector<int> read(cellArr.size(), -1);
 
-            Cell* winnerNode = cellArr[winnerH.idx()];
+        vector<long> pending(numSamples);
+        for(long i = 0; i < numSamples; i++)
+        {
+            pending[i] = i;
+        }
 
-            //TODO: determine mistake in remove operation in basic step. why on earth is there a prob here
+        vector<long> accepted;
+        vector<long> deferred;
+        int phase = 0;
 
-            //we need to remove the winner before updating.
-            double winnerSC = tumble_tree->remove(winnerNode, winnerH); //remove the winning vertex from the tumble tree, get the real sc
+        while(!pending.empty())
+        {
+            accepted.clear();
+            deferred.clear();
 
-            //decrease signal counter of others by a fraction according to hennings implementation
-            if(m_decreaseFactor == 1.0)
+            for(long i : pending)
             {
-                size_t n = m_allowMiss * m_mesh->numVertices();
-                float dynamicDecrease = 1 - (float)pow(m_collapseThreshold, (1 / n));
-                tumble_tree->updateSC(dynamicDecrease);
+                bool conflict = moved[winners[i].idx()] == phase || read[winners[i].idx()] == phase;
+                for(auto it = neighbors[i].begin(); !conflict && it != neighbors[i].end(); ++it)
+                {
+                    conflict = moved[it->idx()] == phase || read[it->idx()] == phase;
+                }
+                for(auto it = reads[i].begin(); !conflict && it != reads[i].end(); ++it)
+                {
+                    conflict = moved[it->idx()] == phase;
+                }
+
+                if(conflict)
+                {
+                    deferred.push_back(i);
+                    continue;
+                }
 
+                accepted.push_back(i);
+                moved[winners[i].idx()] = phase;
+                for(VertexHandle vH : neighbors[i])
+                {
+                    moved[vH.idx()] = phase;
+                }
+                for(VertexHandle vH : reads[i])
+                {
+                    read[vH.idx()] = phase;
+                }
             }
-            else
+
+            #pragma omp parallel for schedule(dynamic)
+            for(long j = 0; j < (long)accepted.size(); j++)
             {
-                tumble_tree->updateSC(m_decreaseFactor);
+                const long i = accepted[j];
+                adaptToSample(winners[i], neighbors[i], samples[i]);
+            }
 
+            for(long i : accepted)
+            {
+                updateVertexGrid(winners[i], neighbors[i]);
+                updateSignalCounter(winners[i]);
+                ++progress_bar;
             }
-            //reinsert the winner's vH with updated sc
-            cellArr[winnerH.idx()] = tumble_tree->insert(winnerSC + 1, winnerH);
 
+            pending.swap(deferred);
+            phase++;
         }
-        else //GSS TODO: INCLUDE GSS ADDITIONS
+    }
+
+    /**
+     * Moves the winner and its neighbors towards the sample and smoothes the neighbors (GCS).
+     * Only the positions of the winner and its neighbors are changed.
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param winnerH vertex closest to the sample
+     * @param neighborsOfWinner neighbors of the winner
+     * @param sample random point of the pointcloud
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::adaptToSample(
+        VertexHandle winnerH,
+        const std::vector<VertexHandle>& neighborsOfWinner,
+        BaseVecT sample)
+    {
+        //smooth the winning vertex
+        BaseVecT &winner = m_mesh->getVertexPosition(winnerH);
+        winner += (sample - winner) * getLearningRate();
+
+        //perform laplacian smoothing on all the neighbors of the winning vertex
+        for(auto v : neighborsOfWinner)
         {
-            std::cout << "Using GSS" << endl;
-            //find closest structure
+            BaseVecT& nb = m_mesh->getVertexPosition(v);
 
-            //set approx error(s) and age of faces (using HashMap)
+            nb += (sample - winner) * getNeighborLearningRate();
+            if(m_mesh->numVertices() > 100) performLaplacianSmoothing(v, sample, getNeighborLearningRate());
+        }
+    }
 
-            //smoothing
+    /**
+     * Increments the signal counter of the winner and decreases all others (GCS)
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param winnerH vertex closest to the last sample
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::updateSignalCounter(VertexHandle winnerH)
+    {
+        Cell* winnerNode = cellArr[winnerH.idx()];
 
-            //coalescing
+        //we need to remove the winner before updating.
+        double winnerSC = tumble_tree->remove(winnerNode, winnerH); //remove the winning vertex from the tumble tree, get the real sc
+
+        //decrease signal counter of others by a fraction according to hennings implementation
+        if(m_decreaseFactor == 1.0)
+        {
+            size_t n = m_allowMiss * m_mesh->numVertices();
+            float dynamicDecrease = 1 - (float)pow(m_collapseThreshold, (1 / n));
+            tumble_tree->updateSC(dynamicDecrease);
 
-            //filter chain
+        }
+        else
+        {
+            tumble_tree->updateSC(m_decreaseFactor);
+
+        }
+        //reinsert the winner's vH with updated sc
+        cellArr[winnerH.idx()] = tumble_tree->insert(winnerSC + 1, winnerH);
+    }
+
+    /**
+     * Moves the winner and its neighbors to their new positions in the vertex grid
+     *
+     * @tparam BaseVecT
+     * @tparam NormalT
+     * @param winnerH vertex closest to the last sample
+     * @param neighborsOfWinner neighbors of the winner
+     */
+    template <typename BaseVecT, typename NormalT>
+    void GrowingCellStructure<BaseVecT, NormalT>::updateVertexGrid(
+        VertexHandle winnerH,
+        const std::vector<VertexHandle>& neighborsOfWinner)
+    {
+        vertex_grid->update(winnerH, m_mesh->getVertexPosition(winnerH));
+        for(VertexHandle vH : neighborsOfWinner)
+        {
+            vertex_grid->update(vH, m_mesh->getVertexPosition(vH));
         }
     }
 
@@ -239,9 +410,8 @@ namespace lvr2 {
             cellArr[highestSC.idx()] = tumble_tree->insert(actual_sc / 2, highestSC);
             cellArr[newVH.idx()] = tumble_tree->insert(actual_sc / 2, newVH);
 
-
-            /*BaseVecT kdInsert = m_mesh->getVertexPosition(newVH);
-            kd_tree->insert(kdInsert, newVH);*/
+            vertex_grid->insert(newVH, m_mesh->getVertexPosition(newVH));
+            vertex_grid->update(highestSC, m_mesh->getVertexPosition(highestSC));
 
         }
         else //GSS TODO: INCLUDE GSS ADDITIONS
@@ -347,6 +517,8 @@ namespace lvr2 {
                         EdgeCollapseResult result = m_mesh->collapseEdge(eToSixVal.unwrap());
                         tumble_tree->remove(cellArr[result.removedPoint.idx()], result.removedPoint);
                         cellArr[result.removedPoint.idx()] = NULL;
+                        vertex_grid->remove(result.removedPoint);
+                        vertex_grid->update(result.midPoint, m_mesh->getVertexPosition(result.midPoint));
                         std::cout << "Collapsed an Edge!" << endl;
                     }
                 }
@@ -391,47 +563,17 @@ namespace lvr2 {
 
     /**
      * Gets the closest point to the given point using the euclidean distance
-     * runtime: O(n) //TODO: make it better. kd-tree? KD-TREE IMPLEMENTATION IN GS2 NOT GOOD.
+     * runtime: O(1) on average, using the vertex grid
      *
      * @tparam BaseVecT
      * @tparam NormalT
      * @param point - point of the pointcloud
-     * @param progress_bar - needed to print the progress of the algorithm
      * @return a handle pointing to the closest point of the mesh to the point in the parameters
      */
     template <typename BaseVecT, typename NormalT>
-    VertexHandle GrowingCellStructure<BaseVecT, NormalT>::getClosestPointInMesh(BaseVecT point, PacmanProgressBar& progress_bar)
+    VertexHandle GrowingCellStructure<BaseVecT, NormalT>::getClosestPointInMesh(BaseVecT point)
     {
-        //search the closest point of the mesh
-        auto vertices = m_mesh->vertices();
-
-        VertexHandle closestVertexToRandomPoint(numeric_limits<int>::max());
-        float smallestDistance = numeric_limits<float>::infinity();
-        float avg_counter = 0;
-
-        for(auto vertexH : vertices)
-        {
-            /*if(m_mesh->numVertices() != 4) TODO: PRINT NUMBER OF VERTICES WHILE ALSO PRINTING THE PROGRESS BAR...
-            {
-                cout << "\33[2K\r" << endl;
-            }*/
-            ++progress_bar;
-            //cout << "Vertices in Mesh: " << m_mesh->numVertices() << endl;
-
-            BaseVecT vertex = m_mesh->getVertexPosition(vertexH); //get Vertex from Handle
-            BaseVecT distanceVector = point - vertex;
-            float length = distanceVector.length2();
-
-            if(length < smallestDistance)
-            {
-
-                closestVertexToRandomPoint = vertexH;
-                smallestDistance = length;
-
-            }
-        }
-
-        return closestVertexToRandomPoint;
+        return vertex_grid->findNearest(point).unwrap();
     }
 
     /**
@@ -599,10 +741,12 @@ namespace lvr2 {
             cellArr[vH3.idx()] = tumble_tree->insert(1, vH3);
             cellArr[vH4.idx()] = tumble_tree->insert(1, vH4);
 
-            kd_tree->insert(top, vH1);
-            kd_tree->insert(left, vH2);
-            kd_tree->insert(right, vH3);
-            kd_tree->insert(back, vH4);
+            delete vertex_grid;
+            vertex_grid = new DynamicVertexGrid<BaseVecT>(bounding_box);
+            vertex_grid->insert(vH1, top);
+            vertex_grid->insert(vH2, left);
+            vertex_grid->insert(vH3, right);
+            vertex_grid->insert(vH4, back);
         }
     }
 
@@ -747,6 +891,7 @@ namespace lvr2 {
         cout << "Aggressive Cutout..." << endl;
         auto faces = m_mesh->getFacesOfVertex(vH);
         tumble_tree->remove(cellArr[vH.idx()], vH);
+        vertex_grid->remove(vH);
         for(auto face : faces)
         {
             m_mesh->removeFace(face);
@@ -104,6 +104,23 @@ namespace lvr2{
     }
 
 
+    /**
+     * unlinks the cell with the smallest signal counter from the subtree without deleting it
+     * @param c - root of the subtree
+     * @return the new root of the subtree
+     */
+    Cell* TumbleTree::detachMin(Cell* c)
+    {
+        if(c->left == NULL)
+        {
+            return c->right;
+        }
+
+        c->left = detachMin(c->left);
+        if(c->left) c->left->parent = c;
+        return c;
+    }
+
     /**
      * remove sepcific data from the subtree
      * @param sc - the signal counter of the cell, where a value is supposed to be deleted
@@ -178,17 +195,19 @@ namespace lvr2{
             //two subtrees
             else
             {
-                struct Cell *tmp = findMin(c->right); //inorder successor
-                c->signal_counter = tmp->signal_counter;
-                c->alpha = 1;
-                c->duplicateMap.clear();
+                //replace the cell by its inorder successor. the successor cell itself is moved
+                //instead of copying its content, so the cell pointers of its vertices stay valid
+                struct Cell *tmp = findMin(c->right); //inorder successor, propagates the alphas on the way
+                tmp->right = detachMin(c->right);
+                tmp->left = c->left;
+                tmp->parent = c->parent;
+                tmp->alpha = 1;
 
-                for(auto iter = tmp->duplicateMap.begin(); iter != tmp->duplicateMap.end(); ++iter)
-                {
-                    c->duplicateMap.insert(*iter, tmp->signal_counter);
-                }
+                if(tmp->right) tmp->right->parent = tmp;
+                if(tmp->left) tmp->left->parent = tmp;
 
-                c->right = remove(tmp->signal_counter, *tmp->duplicateMap.begin(), c->right, true);
+                delete c;
+                return tmp;
             }
 
         }
@@ -38,9 +38,14 @@
 
 #include "lvr2/geometry/Handles.hpp"
 
+#include <array>
+#include <iostream>
 #include <vector>
 #include <utility>
 
+#include <boost/optional.hpp>
+
+using std::array;
 using std::vector;
 using std::pair;
 
@@ -97,7 +102,7 @@ public:
     {
         if (m_len == m_mapping.size())
         {
-            cout << "Error: Overflow in ClusterTexCoordMapping" << endl;
+            std::cout << "Error: Overflow in ClusterTexCoordMapping" << std::endl;
         }
         else
         {
@@ -92,6 +92,8 @@ public:
 
     Texture & operator=(const Texture &other);
 
+    Texture & operator=(Texture &&other);
+
     /**
      * @brief Destructor
      */
@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * TextureAtlas.hpp
+ */
+
+#ifndef LVR2_TEXTURE_TEXTUREATLAS_HPP_
+#define LVR2_TEXTURE_TEXTUREATLAS_HPP_
+
+#include <deque>
+#include <vector>
+
+#include "lvr2/texture/ClusterTexCoordMapping.hpp"
+#include "lvr2/texture/Texture.hpp"
+
+namespace lvr2
+{
+
+/**
+ * @brief Placement of a single texture in a page of a TextureAtlas
+ */
+struct AtlasRegion
+{
+    /// Index of the page that contains the texture
+    int page;
+
+    /// Position of the upper left texel of the texture in the page
+    unsigned short int x, y;
+
+    /// Dimensions of the texture
+    unsigned short int width, height;
+
+    /// Dimensions of the page
+    unsigned short int pageWidth, pageHeight;
+
+    /**
+     * @brief Converts texture coordinates relative to the placed texture into
+     *        texture coordinates relative to the page
+     */
+    TexCoords toPage(const TexCoords& coords) const
+    {
+        // Texture rows are stored top down, while v points upwards
+        float u = (x + coords.u * width) / pageWidth;
+        float v = 1.0f - (y + (1.0f - coords.v) * height) / pageHeight;
+        return TexCoords(u, v);
+    }
+};
+
+/**
+ * @class TextureAtlas
+ * @brief Packs many small textures into a few large pages
+ *
+ * Textures are placed with a skyline bottom-left heuristic. A few pages are
+ * kept open, so that later textures can fill the gaps left by earlier ones.
+ * If a texture fits into none of them, the oldest open page is finished and
+ * a new page is started. Finished pages never change again and are handed
+ * out in the order of their index, which allows writing them to disk while
+ * more textures are added.
+ *
+ * Textures are packed best if they are inserted with decreasing height.
+ * This class is not thread-safe.
+ */
+class TextureAtlas
+{
+public:
+
+    /**
+     * @brief Constructor
+     *
+     * @param pageWidth Width of a page in texels
+     * @param pageHeight Height of a page in texels
+     * @param padding Number of texels around each texture that repeat its border
+     *                to avoid color bleeding when the texture is filtered
+     * @param maxOpenPages Maximum number of pages new textures are packed into
+     */
+    TextureAtlas(
+        unsigned short int pageWidth = 4096,
+        unsigned short int pageHeight = 4096,
+        unsigned short int padding = 2,
+        size_t maxOpenPages = 4
+    );
+
+    /**
+     * @brief Copies a texture into a page
+     *
+     * A texture that does not fit into an empty page gets a page of its own.
+     * Textures are only packed into pages with the same number of channels and
+     * bytes per channel.
+     *
+     * @param texture The texture
+     *
+     * @return The placement of the texture
+     */
+    AtlasRegion insert(const Texture& texture);
+
+    /**
+     * @brief Finishes all open pages
+     */
+    void finish();
+
+    /**
+     * @brief Takes the next finished page out of the atlas
+     *
+     * @param[out] page The page. Its index is the page index used in the regions.
+     *
+     * @return false, if there is no finished page left
+     */
+    bool takeFinishedPage(Texture& page);
+
+    /**
+     * @brief Returns the number of pages created so far
+     */
+    size_t numPages() const;
+
+private:
+
+    /// A horizontal segment of the upper outline of the texels used in a page
+    struct SkylineNode
+    {
+        unsigned short int x, y, width;
+    };
+
+    /// A page that still accepts textures
+    struct Page
+    {
+        Texture texture;
+        std::vector<SkylineNode> skyline;
+    };
+
+    /// Finds the lowest position for a rectangle in a page, returns false if it does not fit
+    bool findPosition(
+        const Page& page,
+        unsigned short int width,
+        unsigned short int height,
+        size_t& node,
+        unsigned short int& x,
+        unsigned short int& y
+    ) const;
+
+    /// Adds a rectangle at the position found by findPosition to the skyline of a page
+    void addToSkyline(
+        Page& page,
+        size_t node,
+        unsigned short int x,
+        unsigned short int y,
+        unsigned short int width,
+        unsigned short int height
+    );
+
+    /// Copies a texture into a page and repeats its border texels in the padding
+    void copyTexels(const Texture& texture, Texture& page, unsigned short int x, unsigned short int y);
+
+    /// Starts a new page, which is at least as large as the given dimensions
+    void openPage(const Texture& texture, unsigned short int width, unsigned short int height);
+
+    /// Moves the oldest open page to the finished pages
+    void finishOldestPage();
+
+    unsigned short int m_pageWidth;
+    unsigned short int m_pageHeight;
+    unsigned short int m_padding;
+    size_t m_maxOpenPages;
+
+    /// Number of pages created so far
+    int m_numPages;
+
+    /// Pages still accepting textures, oldest first
+    std::deque<Page> m_openPages;
+
+    /// Finished pages that were not taken yet, oldest first
+    std::deque<Texture> m_finishedPages;
+};
+
+} // namespace lvr2
+
+#endif /* LVR2_TEXTURE_TEXTUREATLAS_HPP_ */
@@ -32,12 +32,16 @@
 #ifndef LVR2_UTIL_MEAP_H_
 #define LVR2_UTIL_MEAP_H_
 
+#include <algorithm>
 #include <vector>
 #include <utility>
+#include <limits>
+#include <type_traits>
 #include <unordered_map>
 
 #include <boost/optional.hpp>
 
+#include "lvr2/geometry/Handles.hpp"
 #include "lvr2/attrmaps/AttributeMap.hpp"
 
 using std::unordered_map;
@@ -83,7 +87,79 @@ private:
 };
 
 /**
- * @brief A map combined with a binary heap.
+ * @brief Maps each key of a meap to the position of its element in the heap.
+ *
+ * For arbitrary keys, a hash map is used. Handles are dense indices, so they
+ * get a specialization below that stores the positions in a flat vector.
+ */
+template<typename KeyT, typename Enable = void>
+class MeapIndexMap
+{
+public:
+    /// Returned by `find()` if the key is not contained.
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    void reserve(size_t capacity) { m_indices.reserve(capacity); }
+
+    inline size_t find(const KeyT& key) const
+    {
+        auto it = m_indices.find(key);
+        return it == m_indices.end() ? npos : it->second;
+    }
+
+    inline void set(const KeyT& key, size_t idx) { m_indices[key] = idx; }
+    inline void erase(const KeyT& key) { m_indices.erase(key); }
+
+private:
+    unordered_map<KeyT, size_t> m_indices;
+};
+
+/**
+ * @brief Specialization of `MeapIndexMap` for handles: the position of the
+ *        handle with index `i` is stored at `m_positions[i]`.
+ *
+ * Lookups don't need to hash anything. The vector only grows, so a cleared
+ * meap can be reused without allocating again.
+ */
+template<typename HandleT>
+class MeapIndexMap<
+    HandleT,
+    typename std::enable_if<std::is_base_of<BaseHandle<Index>, HandleT>::value>::type
+>
+{
+public:
+    static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+    void reserve(size_t capacity)
+    {
+        if (capacity > m_positions.size())
+        {
+            m_positions.resize(capacity, npos);
+        }
+    }
+
+    inline size_t find(const HandleT& key) const
+    {
+        return key.idx() < m_positions.size() ? m_positions[key.idx()] : npos;
+    }
+
+    inline void set(const HandleT& key, size_t idx)
+    {
+        if (key.idx() >= m_positions.size())
+        {
+            m_positions.resize(std::max<size_t>(key.idx() + 1, 2 * m_positions.size()), npos);
+        }
+        m_positions[key.idx()] = idx;
+    }
+
+    inline void erase(const HandleT& key) { m_positions[key.idx()] = npos; }
+
+private:
+    std::vector<size_t> m_positions;
+};
+
+/**
+ * @brief A map combined with a d-ary heap.
  *
  * The elements in the meap are pairs of `KeyT` and `ValueT`. Only the latter
  * is used for sorting the heap. The former can be used to lookup the value, as
@@ -143,18 +219,33 @@ public:
      */
     void updateValue(const KeyT& key, const ValueT& newValue);
 
+    /**
+     * @brief Inserts `key` with `value` if the key is not contained yet.
+     *        Otherwise the value of `key` is lowered to `value` if `value`
+     *        is smaller than the current value (decrease-key).
+     *
+     * This is the typical operation of Dijkstra-like algorithms.
+     *
+     * @return `true` if the meap was changed.
+     */
+    bool insertOrDecrease(const KeyT& key, const ValueT& value);
+
     /**
      * @brief Returns `true` iff the meap is empty.
      */
     bool isEmpty() const;
 
 private:
+    /// Number of children of each node. A 4-ary heap is flatter than a
+    /// binary heap and all children of a node share a cache line.
+    static constexpr size_t Arity = 4;
+
     // This is the main heap which stores the costs as well as all keys.
     std::vector<MeapPair<KeyT, ValueT>> m_heap;
 
     // This is a map to quickly look up the index within `m_heap` at which a
     // specific key lives.
-    unordered_map<KeyT, size_t> m_indices;
+    MeapIndexMap<KeyT> m_indices;
 
     /**
      * @brief Returns the index of the father of the child at index `child`.
@@ -162,22 +253,22 @@ private:
     size_t father(size_t child) const;
 
     /**
-     * @brief Returns the index of the left child of the father at index
-     *        `father`.
+     * @brief Returns the index of the first child of the father at index
+     *        `father`. The other children follow directly after it.
      */
-    size_t leftChild(size_t father) const;
+    size_t firstChild(size_t father) const;
 
     /**
-     * @brief Returns the index of the right child of the father at index
-     *        `father`.
+     * @brief Moves `element` to index `idx` of the heap and updates the
+     *        index map accordingly.
      */
-    size_t rightChild(size_t father) const;
+    void place(size_t idx, MeapPair<KeyT, ValueT>&& element);
 
     /**
      * @brief Performs the `bubbleUp` heap operation on the node at `idx`.
      *
      * As long as the father of the node at `idx` still has a greater value
-     * than the value of `idx`, both are swapped.
+     * than the value of `idx`, the father is moved down.
      */
     void bubbleUp(size_t idx);
 
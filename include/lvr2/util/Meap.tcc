@@ -29,6 +29,8 @@
  * Meap.tcc
  */
 
+#include <iostream>
+
 #include "lvr2/util/Panic.hpp"
 
 using std::move;
@@ -41,23 +43,22 @@ template<typename KeyT, typename ValueT>
 Meap<KeyT, ValueT>::Meap(size_t capacity)
 {
     m_heap.reserve(capacity);
-    // TODO: maybe add `reserve()` to the attribute map interface and add this
     m_indices.reserve(capacity);
 }
 
 template<typename KeyT, typename ValueT>
 bool Meap<KeyT, ValueT>::containsKey(KeyT key) const
 {
-    return m_indices.find(key) != m_indices.end();
+    return m_indices.find(key) != MeapIndexMap<KeyT>::npos;
 }
 
 template<typename KeyT, typename ValueT>
 boost::optional<ValueT> Meap<KeyT, ValueT>::insert(KeyT key, const ValueT& value)
 {
     auto previous = m_indices.find(key);
-    if (previous != m_indices.end())
+    if (previous != MeapIndexMap<KeyT>::npos)
     {
-        auto prevValue = m_heap[previous->second].value();
+        auto prevValue = m_heap[previous].value();
         updateValue(key, value);
         return prevValue;
     }
@@ -66,7 +67,7 @@ boost::optional<ValueT> Meap<KeyT, ValueT>::insert(KeyT key, const ValueT& value
         // Insert to the back of the vector
         auto idx = m_heap.size();
         m_heap.push_back({ key, value });
-        m_indices.insert({key, idx});
+        m_indices.set(key, idx);
 
         // Correct heap by bubbling up
         bubbleUp(idx);
@@ -74,26 +75,52 @@ boost::optional<ValueT> Meap<KeyT, ValueT>::insert(KeyT key, const ValueT& value
     }
 }
 
+template<typename KeyT, typename ValueT>
+bool Meap<KeyT, ValueT>::insertOrDecrease(const KeyT& key, const ValueT& value)
+{
+    auto idx = m_indices.find(key);
+    if (idx == MeapIndexMap<KeyT>::npos)
+    {
+        idx = m_heap.size();
+        m_heap.push_back({ key, value });
+        m_indices.set(key, idx);
+        bubbleUp(idx);
+        return true;
+    }
+    else if (value < m_heap[idx].value())
+    {
+        m_heap[idx].value() = value;
+        bubbleUp(idx);
+        return true;
+    }
+    return false;
+}
+
 template<typename KeyT, typename ValueT>
 void Meap<KeyT, ValueT>::clear()
 {
+    // Only the keys in the heap have an entry in the index map. Removing them
+    // one by one keeps this O(numValues()) for the flat handle index.
+    for (const auto& e: m_heap)
+    {
+        m_indices.erase(e.key());
+    }
     m_heap.clear();
-    m_indices.clear();
 }
 
 template<typename KeyT, typename ValueT>
 size_t Meap<KeyT, ValueT>::numValues() const
 {
-    return m_indices.size();
+    return m_heap.size();
 }
 
 template<typename KeyT, typename ValueT>
 boost::optional<const ValueT&> Meap<KeyT, ValueT>::get(KeyT key) const
 {
-    auto maybeIndex = m_indices.get(key);
-    if (maybeIndex)
+    auto index = m_indices.find(key);
+    if (index != MeapIndexMap<KeyT>::npos)
     {
-        return m_heap[*maybeIndex].value();
+        return m_heap[index].value();
     }
     else
     {
@@ -120,14 +147,13 @@ MeapPair<KeyT, ValueT> Meap<KeyT, ValueT>::popMin()
         panic("attempt to peek at min in an empty heap");
     }
 
-    // Swap the minimal element with the last element in the vector
-    swap(m_heap[0], m_heap.back());
-    swap(m_indices[m_heap[0].key()], m_indices[m_heap.back().key()]);
+    // Move the minimal element out of the heap and the last element of the
+    // vector into the root
+    auto out = move(m_heap[0]);
+    m_indices.erase(out.key());
 
-    // Move (minimum) element out of the vector
-    const auto out = move(m_heap.back());
+    auto last = move(m_heap.back());
     m_heap.pop_back();
-    m_indices.erase(out.key());
 
     // We only need to repair if there is more than one element left, because
     // after removing the one element, this heap doesn't contain any elements.
@@ -136,6 +162,7 @@ MeapPair<KeyT, ValueT> Meap<KeyT, ValueT>::popMin()
     {
         // At the root of the heap, there might be an element which is too big,
         // thus we need to bubble it down.
+        place(0, move(last));
         bubbleDown(0);
     }
 
@@ -145,7 +172,12 @@ MeapPair<KeyT, ValueT> Meap<KeyT, ValueT>::popMin()
 template<typename KeyT, typename ValueT>
 void Meap<KeyT, ValueT>::updateValue(const KeyT& key, const ValueT& newValue)
 {
-    auto idx = m_indices[key];
+    auto idx = m_indices.find(key);
+    if (idx == MeapIndexMap<KeyT>::npos)
+    {
+        panic("attempt to update the value of a key which is not in the meap");
+    }
+
     if (newValue > m_heap[idx].value())
     {
         m_heap[idx].value() = newValue;
@@ -161,34 +193,30 @@ void Meap<KeyT, ValueT>::updateValue(const KeyT& key, const ValueT& newValue)
 template<typename KeyT, typename ValueT>
 boost::optional<ValueT> Meap<KeyT, ValueT>::erase(KeyT key)
 {
-    const auto maybeIndex = m_indices.find(key);
-    if (maybeIndex == m_indices.end())
+    const auto index = m_indices.find(key);
+    if (index == MeapIndexMap<KeyT>::npos)
     {
         return boost::none;
     }
 
-    auto index = maybeIndex->second;
-
-    // Swap the element to remove with the last element in the vector
-    auto swapKey = m_heap.back().key();
-    swap(m_heap[index], m_heap.back());
-    swap(m_indices[key], m_indices[swapKey]);
-
     // Move element out of the vector
-    const auto out = move(m_heap.back()).value();
-    m_heap.pop_back();
+    const auto out = move(m_heap[index].value());
     m_indices.erase(key);
 
+    auto last = move(m_heap.back());
+    m_heap.pop_back();
+
     // If the removed element was the last one in the meap, we don't have to
     // do any cleanup. Otherwise we have to put the previous last element into
     // the correct position.
-    if (!m_heap.empty())
+    if (index < m_heap.size())
     {
+        place(index, move(last));
+
         // If the element was deleted from the root (=> there is no father) or
         // if the father is already smaller than the current value, we attempt
         // to bubble the value down (which will do nothing if the position
         // is already correct). Otherwise it has to bubble up.
-        
         if (index == 0 || m_heap[father(index)].value() < m_heap[index].value())
         {
             bubbleDown(index);
@@ -213,71 +241,83 @@ bool Meap<KeyT, ValueT>::isEmpty() const
 template<typename KeyT, typename ValueT>
 size_t Meap<KeyT, ValueT>::father(size_t child) const
 {
-    return (child - 1) / 2;
+    return (child - 1) / Arity;
 }
 
 template<typename KeyT, typename ValueT>
-size_t Meap<KeyT, ValueT>::leftChild(size_t father) const
+size_t Meap<KeyT, ValueT>::firstChild(size_t father) const
 {
-    return 2 * father + 1;
+    return Arity * father + 1;
 }
 
 template<typename KeyT, typename ValueT>
-size_t Meap<KeyT, ValueT>::rightChild(size_t father) const
+void Meap<KeyT, ValueT>::place(size_t idx, MeapPair<KeyT, ValueT>&& element)
 {
-    return 2 * father + 2;
+    m_indices.set(element.key(), idx);
+    m_heap[idx] = move(element);
 }
 
 template<typename KeyT, typename ValueT>
 void Meap<KeyT, ValueT>::bubbleUp(size_t idx)
 {
-    // Bubble new element up until the order is correct
-    while (idx != 0 && m_heap[idx].value() < m_heap[father(idx)].value())
+    // Instead of swapping at each level, the new element is held aside and
+    // the fathers are moved down until the right position is found.
+    if (idx == 0 || !(m_heap[idx].value() < m_heap[father(idx)].value()))
+    {
+        return;
+    }
+
+    auto element = move(m_heap[idx]);
+    while (idx != 0 && element.value() < m_heap[father(idx)].value())
     {
-        swap(m_heap[idx], m_heap[father(idx)]);
-        swap(m_indices[m_heap[idx].key()], m_indices[m_heap[father(idx)].key()]);
-        idx = father(idx);
+        auto fatherIdx = father(idx);
+        place(idx, move(m_heap[fatherIdx]));
+        idx = fatherIdx;
     }
+    place(idx, move(element));
 }
 
 template<typename KeyT, typename ValueT>
 void Meap<KeyT, ValueT>::bubbleDown(size_t idx)
 {
-    // Checks if there exists a child of `father` which has a smaller value
-    // than the value at `father`.
-    const auto hasSmallerChildren = [this](size_t father)
-    {
-        const auto len = m_heap.size();
-        const auto left = leftChild(father);
-        const auto right = rightChild(father);
-        const auto& disc = m_heap[father].value();
-        return (left < len && m_heap[left].value() < disc)
-            || (right < len && m_heap[right].value() < disc);
-    };
+    const auto len = m_heap.size();
 
-    // Returns the index of the child of `father` with the smaller value. This
-    // function assumes that there exists at least one (the left) child.
-    const auto smallerChildOf = [this](size_t father)
+    // Returns the index of the child of `father` with the smallest value.
+    // This function assumes that there exists at least one child.
+    const auto smallestChildOf = [&](size_t father)
     {
-        const auto left = leftChild(father);
-        const auto right = rightChild(father);
-
-        // In case there exists only one child
-        if (right >= m_heap.size())
+        const auto first = firstChild(father);
+        const auto last = std::min(first + Arity, len);
+        auto smallest = first;
+        for (auto child = first + 1; child < last; child++)
         {
-            return left;
+            if (m_heap[child].value() < m_heap[smallest].value())
+            {
+                smallest = child;
+            }
         }
-        return m_heap[left].value() > m_heap[right].value() ? right : left;
+        return smallest;
     };
 
-    // Repair the heap by sifting down the element
-    while (hasSmallerChildren(idx))
+    if (firstChild(idx) >= len)
     {
-        const auto smallerChild = smallerChildOf(idx);
-        swap(m_heap[smallerChild], m_heap[idx]);
-        swap(m_indices[m_heap[smallerChild].key()], m_indices[m_heap[idx].key()]);
-        idx = smallerChild;
+        return;
     }
+
+    // Repair the heap by sifting down the element. Like in `bubbleUp()`, the
+    // element is only written once it reached its final position.
+    auto element = move(m_heap[idx]);
+    while (firstChild(idx) < len)
+    {
+        const auto smallestChild = smallestChildOf(idx);
+        if (!(m_heap[smallestChild].value() < element.value()))
+        {
+            break;
+        }
+        place(idx, move(m_heap[smallestChild]));
+        idx = smallestChild;
+    }
+    place(idx, move(element));
 }
 
 template<typename KeyT, typename ValueT>
@@ -286,36 +326,34 @@ void Meap<KeyT, ValueT>::debugOutput() const
     size_t levelWidth = 1;
     size_t levelCount = 0;
     size_t totalCount = 0;
-    unordered_set<KeyT> keys;
 
-    cout << "HEAP:" << endl;
+    std::cout << "HEAP:" << std::endl;
     for (auto& e: m_heap)
     {
-        cout << "(" << e.key() << " -> " << e.value() << ")[" << totalCount << "], ";
-        keys.insert(e.key());
+        std::cout << "(" << e.key() << " -> " << e.value() << ")[" << totalCount << "], ";
 
         levelCount += 1;
         totalCount += 1;
         if (levelCount == levelWidth)
         {
-            levelWidth *= 2;
+            levelWidth *= Arity;
             levelCount = 0;
-            cout << endl;
+            std::cout << std::endl;
         }
     }
 
-    cout << endl << "MAP:" << endl;
-    for (auto k: keys)
+    std::cout << std::endl << "MAP:" << std::endl;
+    for (auto& e: m_heap)
     {
-        cout << k << " -> ";
-        auto idx = m_indices.get(k);
-        if (idx)
+        std::cout << e.key() << " -> ";
+        auto idx = m_indices.find(e.key());
+        if (idx != MeapIndexMap<KeyT>::npos)
         {
-            cout << *idx << endl;
+            std::cout << idx << std::endl;
         }
         else
         {
-            cout << "!! NONE !!" << endl;
+            std::cout << "!! NONE !!" << std::endl;
         }
     }
 }
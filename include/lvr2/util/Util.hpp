@@ -35,9 +35,14 @@
 #ifndef LVR2_UTIL_HPP
 #define LVR2_UTIL_HPP
 
+#include <algorithm>
 #include <vector>
 #include <boost/shared_array.hpp>
 
+#ifdef LVR2_USE_OPEN_MP
+#include <omp.h>
+#endif
+
 #include "lvr2/types/MatrixTypes.hpp"
 #include "lvr2/io/PointBuffer.hpp"
 #include "lvr2/geometry/BaseVector.hpp"
@@ -113,6 +118,63 @@ public:
         return ret;
     }
 
+    /**
+     * @brief Replaces each element of the given vector by the sum of all
+     *        elements before it (exclusive prefix sum).
+     *
+     * The sum is computed in parallel in two passes over equally sized
+     * blocks: first each block is summed up, then each block is scanned
+     * starting with the sum of all previous blocks. This is typically used
+     * to compute the output offsets for a parallel compaction.
+     *
+     * @param   values    The values to scan. Will be overwritten with the
+     *                    exclusive prefix sums.
+     *
+     * @return  The sum of all values
+     */
+    template<typename T>
+    static T parallel_exclusive_scan(std::vector<T>& values)
+    {
+        const size_t n = values.size();
+#ifdef LVR2_USE_OPEN_MP
+        const size_t numBlocks = std::max<size_t>(1, std::min<size_t>(omp_get_max_threads(), n / 4096));
+#else
+        const size_t numBlocks = 1;
+#endif
+        const size_t blockSize = (n + numBlocks - 1) / std::max<size_t>(1, numBlocks);
+        std::vector<T> blockSums(numBlocks + 1, T(0));
+
+        #pragma omp parallel for if(numBlocks > 1)
+        for (size_t b = 0; b < numBlocks; b++)
+        {
+            T sum = T(0);
+            for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); i++)
+            {
+                sum += values[i];
+            }
+            blockSums[b + 1] = sum;
+        }
+
+        for (size_t b = 0; b < numBlocks; b++)
+        {
+            blockSums[b + 1] += blockSums[b];
+        }
+
+        #pragma omp parallel for if(numBlocks > 1)
+        for (size_t b = 0; b < numBlocks; b++)
+        {
+            T sum = blockSums[b];
+            for (size_t i = b * blockSize; i < std::min(n, (b + 1) * blockSize); i++)
+            {
+                T value = values[i];
+                values[i] = sum;
+                sum += value;
+            }
+        }
+
+        return blockSums[numBlocks];
+    }
+
     /**
      * @brief Converts a transformation matrix that is used in riegl coordinate system into
      *        a transformation matrix that is used in slam6d coordinate system.
@@ -39,8 +39,10 @@
 using std::ifstream;
 
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "lvr2/io/AsciiIO.hpp"
+#include "lvr2/io/AsciiParser.hpp"
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
@@ -62,8 +64,23 @@ ModelPtr AsciiIO::read(
         cout << "»" << extension << "« is not a valid file extension." << endl;
         return ModelPtr();
     }
+    // Map file into memory. The data is parsed in parallel directly from
+    // the mapping.
+    boost::iostreams::mapped_file_source file;
+    try
+    {
+        file.open(filename);
+    }
+    catch (std::exception& e)
+    {
+        cout << timestamp << "AsciiIO: Unable to open file '" << filename << "': " << e.what() << endl;
+        return ModelPtr();
+    }
+    const char* fileBegin = file.data();
+    const char* fileEnd = file.data() + file.size();
+
     // Count lines in file to estimate the number of present points
-    size_t lines_in_file = countLines(filename);
+    size_t lines_in_file = AsciiParser::countLines(fileBegin, fileEnd);
 
     if ( lines_in_file < 2 )
     {
@@ -71,25 +88,9 @@ ModelPtr AsciiIO::read(
         return ModelPtr();
     }
 
-    // Open file
-    ifstream in;
-    in.open(filename.c_str());
-
-    // Read first two lines, ignore the first one
-    char buffer[2048];
-    in.getline(buffer, 2048);
-    in.getline(buffer, 2048);
-
     // Get number of entries in test line and analize
     int num_columns  = AsciiIO::getEntriesInLine(filename);
 
-    // Reopen file and read data
-    in.close();
-    in.open(filename.c_str());
-
-    // Again skip first line
-    in.getline(buffer, 2048);
-
     // Buffer related variables
     size_t numPoints = 0;
 
@@ -115,87 +116,37 @@ ModelPtr AsciiIO::read(
     bool has_color = (rPos > -1 && gPos > -1 && bPos > -1);
     bool has_intensity = (iPos > -1);
 
+    // Setup the column mapping of the parser
+    std::vector<AsciiColumn> columns = {
+        { xPos, AsciiColumn::FLOAT, reinterpret_cast<char*>(points.get()),     3 * sizeof(float) },
+        { yPos, AsciiColumn::FLOAT, reinterpret_cast<char*>(points.get() + 1), 3 * sizeof(float) },
+        { zPos, AsciiColumn::FLOAT, reinterpret_cast<char*>(points.get() + 2), 3 * sizeof(float) }
+    };
+
     // Alloc buffer memory for additional attributes
     if ( has_color )
     {
         pointColors = ucharArr( new uint8_t[ numPoints * 3 ] );
+        columns.push_back({ rPos, AsciiColumn::UCHAR, reinterpret_cast<char*>(pointColors.get()),     3 });
+        columns.push_back({ gPos, AsciiColumn::UCHAR, reinterpret_cast<char*>(pointColors.get() + 1), 3 });
+        columns.push_back({ bPos, AsciiColumn::UCHAR, reinterpret_cast<char*>(pointColors.get() + 2), 3 });
     }
 
     if ( has_intensity )
     {
         pointIntensities = floatArr( new float[ numPoints ] );
+        columns.push_back({ iPos, AsciiColumn::FLOAT, reinterpret_cast<char*>(pointIntensities.get()), sizeof(float) });
     }
 
-    // Read data form file
-    size_t c = 0;
-    while (in.good() && c < numPoints)
-    {
-        float x, y, z, intensity, dummy;
-        unsigned int r, g, b;
-
-        for(int i = 0; i < num_columns; i++)
-        {
-            if(i == xPos)
-            {
-                in >> x;
-            }
-            else if(i == yPos)
-            {
-                in >> y;
-            }
-            else if(i == zPos)
-            {
-                in >> z;
-            }
-            else if(i == rPos)
-            {
-                in >> r;
-            }
-            else if(i == gPos)
-            {
-                in >> g;
-            }
-            else if(i == bPos)
-            {
-                in >> b;
-            }
-            else if(i == iPos)
-            {
-                in >> intensity;
-            }
-            else
-            {
-                in >> dummy;
-            }
-
-        }
-
-        // Read according to determined format
-        if(has_color)
-        {
-            pointColors[ c * 3     ] = (unsigned char) r;
-            pointColors[ c * 3 + 1 ] = (unsigned char) g;
-            pointColors[ c * 3 + 2 ] = (unsigned char) b;
-
-        }
-
-        if (has_intensity)
-        {
-            pointIntensities[c] = intensity;
-
-        }
-
-        points[ c * 3     ] = x;
-        points[ c * 3 + 1 ] = y;
-        points[ c * 3 + 2 ] = z;
-        c++;
-    }
+    // Read data form file, ignore the first line
+    size_t c = AsciiParser::parse(AsciiParser::skipLines(fileBegin, fileEnd, 1), fileEnd, columns);
 
     // Sanity check
     if(c != numPoints)
     {
         cout << timestamp << "Warning: Point count / line count mismatch: "
              << numPoints << " / " << c << endl;
+        numPoints = c;
     }
 
     // Assign buffers
@@ -0,0 +1,376 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * AsciiParser.cpp
+ */
+
+#include "lvr2/io/AsciiParser.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#ifdef LVR2_USE_OPEN_MP
+#include <omp.h>
+#endif
+
+namespace lvr2
+{
+
+namespace
+{
+
+/// Minimal size of the chunks that are parsed by one thread
+const size_t minChunkSize = 1 << 20;
+
+inline bool isSeparator(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == '\r';
+}
+
+/// Returns true if the double lies exactly halfway between two adjacent
+/// normal floats, i.e. the 29 mantissa bits below float precision are 100...0
+inline bool isFloatMidpoint(double d)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return (bits & ((uint64_t(1) << 29) - 1)) == (uint64_t(1) << 28);
+}
+
+inline const char* nextLine(const char* p, const char* end)
+{
+    const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return lineEnd ? lineEnd + 1 : end;
+}
+
+/**
+ * @brief Parses the lines in [begin, end) and writes the values of line k to
+ *        the columns with offset `first + k`.
+ */
+size_t parseChunk(const char* begin, const char* end, const std::vector<AsciiColumn>& columns,
+                  int maxColumn, size_t first)
+{
+    // Maps the column index to the index in `columns`
+    std::vector<int> targets(maxColumn + 1, -1);
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        targets[columns[i].column] = i;
+    }
+    std::vector<float> values(columns.size());
+
+    size_t count = 0;
+    const char* p = begin;
+    while (p < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd)
+        {
+            lineEnd = end;
+        }
+
+        // Read all columns up to the last requested one
+        int column = 0;
+        bool valid = true;
+        while (column <= maxColumn)
+        {
+            while (p < lineEnd && isSeparator(*p))
+            {
+                p++;
+            }
+            if (p == lineEnd)
+            {
+                valid = false;
+                break;
+            }
+
+            if (targets[column] >= 0)
+            {
+                if (!AsciiParser::parseFloat(p, lineEnd, values[targets[column]]))
+                {
+                    valid = false;
+                    break;
+                }
+            }
+            else
+            {
+                while (p < lineEnd && !isSeparator(*p))
+                {
+                    p++;
+                }
+            }
+            column++;
+        }
+
+        if (valid)
+        {
+            const size_t line = first + count;
+            for (size_t i = 0; i < columns.size(); i++)
+            {
+                char* dst = columns[i].data + line * columns[i].stride;
+                if (columns[i].type == AsciiColumn::FLOAT)
+                {
+                    std::memcpy(dst, &values[i], sizeof(float));
+                }
+                else
+                {
+                    *reinterpret_cast<unsigned char*>(dst) = static_cast<unsigned char>(static_cast<long>(values[i]));
+                }
+            }
+            count++;
+        }
+
+        p = lineEnd + 1;
+    }
+    return count;
+}
+
+} // anonymous namespace
+
+size_t AsciiParser::countLines(const char* begin, const char* end)
+{
+    size_t count = 0;
+    const char* p = begin;
+    while (p < end)
+    {
+        p = nextLine(p, end);
+        count++;
+    }
+    return count;
+}
+
+const char* AsciiParser::skipLines(const char* begin, const char* end, size_t n)
+{
+    const char* p = begin;
+    for (size_t i = 0; i < n && p < end; i++)
+    {
+        p = nextLine(p, end);
+    }
+    return p;
+}
+
+bool AsciiParser::parseFloat(const char*& p, const char* end, float& value)
+{
+    // Powers of ten that are exactly representable as double
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* start = p;
+    const char* s = p;
+    bool negative = false;
+    if (s < end && (*s == '-' || *s == '+'))
+    {
+        negative = *s == '-';
+        s++;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+
+    while (s < end && *s >= '0' && *s <= '9')
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa)
+            {
+                digits++;
+            }
+        }
+        else
+        {
+            exponent++;
+        }
+        anyDigit = true;
+        s++;
+    }
+    if (s < end && *s == '.')
+    {
+        s++;
+        while (s < end && *s >= '0' && *s <= '9')
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa)
+                {
+                    digits++;
+                }
+                exponent--;
+            }
+            anyDigit = true;
+            s++;
+        }
+    }
+
+    if (!anyDigit)
+    {
+        // Not a number we can handle here (e.g. "nan" or "inf")
+        char* parsedEnd;
+        std::string token(start, std::find_if(start, end, isSeparator));
+        value = std::strtof(token.c_str(), &parsedEnd);
+        if (parsedEnd == token.c_str())
+        {
+            return false;
+        }
+        p = start + (parsedEnd - token.c_str());
+        return true;
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E'))
+    {
+        const char* e = s + 1;
+        bool negativeExp = false;
+        if (e < end && (*e == '-' || *e == '+'))
+        {
+            negativeExp = *e == '-';
+            e++;
+        }
+        if (e < end && *e >= '0' && *e <= '9')
+        {
+            int exp = 0;
+            while (e < end && *e >= '0' && *e <= '9')
+            {
+                exp = std::min(exp * 10 + (*e - '0'), 100000);
+                e++;
+            }
+            exponent += negativeExp ? -exp : exp;
+            s = e;
+        }
+    }
+
+    // Fast path: the mantissa and the power of ten are exact doubles, so the
+    // result is correctly rounded to double. Rounding that double to float
+    // gives the correctly rounded float unless it lies exactly halfway
+    // between two floats (double rounding) or outside the range of normal
+    // floats. Those rare cases and everything else are left to strtof.
+    if (mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double result = static_cast<double>(mantissa);
+        result = exponent < 0 ? result / powers[-exponent] : result * powers[exponent];
+
+        if (result == 0.0 || (result >= std::numeric_limits<float>::min()
+                              && result <= std::numeric_limits<float>::max()
+                              && !isFloatMidpoint(result)))
+        {
+            value = static_cast<float>(negative ? -result : result);
+            p = s;
+            return true;
+        }
+    }
+
+    std::string token(start, s);
+    value = std::strtof(token.c_str(), nullptr);
+    p = s;
+    return true;
+}
+
+size_t AsciiParser::parse(const char* begin, const char* end, const std::vector<AsciiColumn>& columns)
+{
+    if (columns.empty() || begin >= end)
+    {
+        return 0;
+    }
+
+    int maxColumn = 0;
+    for (auto& c: columns)
+    {
+        maxColumn = std::max(maxColumn, c.column);
+    }
+
+    // Split the text into chunks at line boundaries
+    size_t numChunks = 1;
+#ifdef LVR2_USE_OPEN_MP
+    numChunks = std::max<size_t>(1, std::min<size_t>(4 * omp_get_max_threads(),
+                                                     (end - begin) / minChunkSize));
+#endif
+    std::vector<const char*> bounds(numChunks + 1, end);
+    bounds[0] = begin;
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        const char* p = begin + (end - begin) * i / numChunks;
+        bounds[i] = std::max(bounds[i - 1], nextLine(std::max(p - 1, begin), end));
+    }
+
+    if (numChunks == 1)
+    {
+        return parseChunk(begin, end, columns, maxColumn, 0);
+    }
+
+    // Count the lines of each chunk to find the first output line of each
+    // chunk
+    std::vector<size_t> firstLine(numChunks + 1, 0);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < (long)numChunks; i++)
+    {
+        firstLine[i + 1] = countLines(bounds[i], bounds[i + 1]);
+    }
+    for (size_t i = 0; i < numChunks; i++)
+    {
+        firstLine[i + 1] += firstLine[i];
+    }
+
+    std::vector<size_t> parsed(numChunks);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (long i = 0; i < (long)numChunks; i++)
+    {
+        parsed[i] = parseChunk(bounds[i], bounds[i + 1], columns, maxColumn, firstLine[i]);
+    }
+
+    // Close the gaps left by skipped lines
+    size_t count = parsed[0];
+    for (size_t i = 1; i < numChunks; i++)
+    {
+        if (count != firstLine[i])
+        {
+            for (auto& c: columns)
+            {
+                // The values of the chunk are moved line by line, since the
+                // columns might be interleaved
+                const size_t size = c.type == AsciiColumn::FLOAT ? sizeof(float) : 1;
+                for (size_t k = 0; k < parsed[i]; k++)
+                {
+                    std::memmove(c.data + (count + k) * c.stride,
+                                 c.data + (firstLine[i] + k) * c.stride, size);
+                }
+            }
+        }
+        count += parsed[i];
+    }
+    return count;
+}
+
+} // namespace lvr2
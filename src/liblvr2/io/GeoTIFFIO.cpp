@@ -2,6 +2,7 @@
 // Created by ndettmer on 07.02.19.
 //
 
+#include <algorithm>
 #include <iostream>
 
 #include "lvr2/io/GeoTIFFIO.hpp"
@@ -18,6 +19,34 @@ GeoTIFFIO::GeoTIFFIO(std::string filename, int cols, int rows, int bands) : m_co
     m_gtif_dataset = m_gtif_driver->Create(filename.c_str(), m_cols, m_rows, m_bands, GDT_UInt16, NULL);
 }
 
+GeoTIFFIO::GeoTIFFIO(std::string filename, int cols, int rows, int bands, int tileSize, std::string compression)
+    : m_cols(cols), m_rows(rows), m_bands(bands)
+{
+    GDALAllRegister();
+    m_gtif_driver = GetGDALDriverManager()->GetDriverByName("GTiff");
+
+    char **options = NULL;
+    options = CSLSetNameValue(options, "INTERLEAVE", "BAND");
+    options = CSLSetNameValue(options, "BIGTIFF", "IF_SAFER");
+    if (tileSize > 0)
+    {
+        // GeoTIFF tiles have to be multiples of 16
+        std::string size = std::to_string(std::max(16, tileSize / 16 * 16));
+        options = CSLSetNameValue(options, "TILED", "YES");
+        options = CSLSetNameValue(options, "BLOCKXSIZE", size.c_str());
+        options = CSLSetNameValue(options, "BLOCKYSIZE", size.c_str());
+    }
+    if (!compression.empty())
+    {
+        options = CSLSetNameValue(options, "COMPRESS", compression.c_str());
+        options = CSLSetNameValue(options, "PREDICTOR", "2");
+        options = CSLSetNameValue(options, "NUM_THREADS", "ALL_CPUS");
+    }
+
+    m_gtif_dataset = m_gtif_driver->Create(filename.c_str(), m_cols, m_rows, m_bands, GDT_UInt16, options);
+    CSLDestroy(options);
+}
+
 GeoTIFFIO::GeoTIFFIO(std::string filename)
 {
     GDALAllRegister();
@@ -32,20 +61,47 @@ int GeoTIFFIO::writeBand(cv::Mat *mat, int band)
         return -1;
     }
 
-    uint16_t *rowBuff = (uint16_t *) CPLMalloc(sizeof(uint16_t) * m_cols);
-    for (int row = 0; row < m_rows; row++)
+    if (mat->type() != CV_16UC1 || mat->rows != m_rows || mat->cols != m_cols)
+    {
+        std::cout << timestamp << "Band " << band << " does not match the GeoTIFF dataset." << std::endl;
+        return -1;
+    }
+
+    // Write the whole band at once, GDAL handles the row stride of the matrix
+    if (m_gtif_dataset->GetRasterBand(band)->RasterIO(
+            GF_Write, 0, 0, m_cols, m_rows, mat->data, m_cols, m_rows, GDT_UInt16, 0, mat->step[0]) != CE_None)
+    {
+        std::cout << timestamp << "An error occurred in GDAL while writing band " << band << "." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int GeoTIFFIO::writeBlock(const uint16_t *data, int band, int x, int y, int width, int height)
+{
+    if (!m_gtif_dataset)
+    {
+        std::cout << timestamp << "GeoTIFF dataset not initialized!" << std::endl;
+        return -1;
+    }
+
+    if (m_gtif_dataset->GetRasterBand(band)->RasterIO(
+            GF_Write, x, y, width, height, const_cast<uint16_t *>(data), width, height, GDT_UInt16, 0, 0) != CE_None)
+    {
+        std::cout << timestamp << "An error occurred in GDAL while writing band "
+            << band << " in rows " << y << " to " << y + height << "." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int GeoTIFFIO::getBlockHeight()
+{
+    if (m_gtif_dataset)
     {
-        for (int col = 0; col < m_cols; col++)
-        {
-            rowBuff[col] = mat->at<uint16_t>(row, col);
-        }
-        if (m_gtif_dataset->GetRasterBand(band)->RasterIO(
-                GF_Write, 0, row, m_cols, 1, rowBuff, m_cols, 1, GDT_UInt16, 0, 0) != CPLE_None)
-        {
-            std::cout << timestamp << "An error occurred in GDAL while writing band "
-                << band << " in row " << row << "." << std::endl;
-            return -1;
-        }
+        int x, y;
+        m_gtif_dataset->GetRasterBand(1)->GetBlockSize(&x, &y);
+        return y;
     }
     return 0;
 }
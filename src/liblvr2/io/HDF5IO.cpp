@@ -26,16 +26,154 @@
  */
 
 #include "lvr2/io/HDF5IO.hpp"
+#include "lvr2/io/hdf5/Hdf5Util.hpp"
 
 #include <boost/filesystem.hpp>
 
 #include <chrono>
 #include <ctime>
 #include <algorithm>
+#include <cstdint>
+#include <numeric>
 
 namespace lvr2
 {
 
+namespace
+{
+
+/// Spreads the lower 21 bits of v so that there are two zero bits between each bit
+uint64_t spreadBits(uint64_t v)
+{
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffff;
+    v = (v | v << 16) & 0x1f0000ff0000ff;
+    v = (v | v << 8)  & 0x100f00f00f00f00f;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3;
+    v = (v | v << 2)  & 0x1249249249249249;
+    return v;
+}
+
+/**
+ * @brief Selects a level of detail pyramid from the given points.
+ *
+ * Level d contains one point of each octree cell of depth d that holds no
+ * point of a coarser level, so the first k levels are a uniform subsample
+ * of the scan at the resolution of depth k - 1. Within a level, the points
+ * are sorted along a Morton curve.
+ *
+ * @param points        Point array
+ * @param n             Number of points
+ * @param maxPoints     Only complete levels with at most maxPoints points
+ *                      in total are selected (but at least level 0)
+ * @param levels        Returns the number of selected points up to and
+ *                      including each level
+ * @return The indices of the selected points, coarse to fine
+ */
+std::vector<size_t> lodOrder(const floatArr& points, size_t n, size_t maxPoints, std::vector<size_t>& levels)
+{
+    const int maxDepth = 21;
+
+    std::vector<size_t> ret;
+    levels.clear();
+    if(n == 0)
+    {
+        return ret;
+    }
+
+    // Quantize in a cube so that the octree cells are cubic
+    float min[3] = {points[0], points[1], points[2]};
+    float extent = 0;
+    for(size_t i = 1; i < n; i++)
+    {
+        for(int a = 0; a < 3; a++)
+        {
+            min[a] = std::min(min[a], points[3 * i + a]);
+        }
+    }
+    for(size_t i = 0; i < n; i++)
+    {
+        for(int a = 0; a < 3; a++)
+        {
+            extent = std::max(extent, points[3 * i + a] - min[a]);
+        }
+    }
+    double scale = extent > 0 ? ((1 << maxDepth) - 1) / (double)extent : 0;
+
+    std::vector<uint64_t> codes(n);
+    #pragma omp parallel for
+    for(size_t i = 0; i < n; i++)
+    {
+        uint64_t code = 0;
+        for(int a = 0; a < 3; a++)
+        {
+            code |= spreadBits((uint64_t)((points[3 * i + a] - min[a]) * scale)) << a;
+        }
+        codes[i] = code;
+    }
+
+    std::vector<size_t> sorted(n);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::sort(sorted.begin(), sorted.end(), [&codes](size_t a, size_t b) {
+        return codes[a] < codes[b] || (codes[a] == codes[b] && a < b);
+    });
+
+    // In Morton order, the points of a cell are a contiguous run. A cell
+    // gets a new point if none of its points was taken by a coarser level.
+    std::vector<bool> taken(n, false);
+    for(int depth = 0; depth <= maxDepth; depth++)
+    {
+        int shift = 3 * (maxDepth - depth);
+        std::vector<size_t> level;
+
+        size_t start = 0;
+        while(start < n)
+        {
+            uint64_t cell = codes[sorted[start]] >> shift;
+            size_t end = start;
+            bool occupied = false;
+            while(end < n && (codes[sorted[end]] >> shift) == cell)
+            {
+                occupied = occupied || taken[end];
+                end++;
+            }
+            if(!occupied)
+            {
+                level.push_back(start);
+            }
+            start = end;
+        }
+
+        if(level.empty() || (depth > 0 && ret.size() + level.size() > maxPoints))
+        {
+            break;
+        }
+
+        for(size_t pos : level)
+        {
+            taken[pos] = true;
+            ret.push_back(sorted[pos]);
+        }
+        levels.push_back(ret.size());
+    }
+
+    return ret;
+}
+
+/// Copies the given rows of a row-major array
+template<typename T>
+boost::shared_array<T> selectRows(const boost::shared_array<T>& data, size_t width, const std::vector<size_t>& rows)
+{
+    boost::shared_array<T> ret(new T[rows.size() * width]);
+    for(size_t i = 0; i < rows.size(); i++)
+    {
+        std::copy(data.get() + rows[i] * width, data.get() + (rows[i] + 1) * width, ret.get() + i * width);
+    }
+    return ret;
+}
+
+} // anonymous namespace
+
 const std::string HDF5IO::vertices_name = "vertices";
 const std::string HDF5IO::indices_name = "indices";
 const std::string HDF5IO::meshes_group = "meshes";
@@ -85,6 +223,23 @@ void HDF5IO::setChunkSize(const size_t& size)
     m_chunkSize = size;
 }
 
+void HDF5IO::setCompression(const Hdf5CompressionProfile& profile)
+{
+    m_compression = profile;
+    m_compress = (profile.level != Hdf5CompressionProfile::NONE);
+}
+
+Hdf5CompressionProfile HDF5IO::compression() const
+{
+    Hdf5CompressionProfile profile = m_compression;
+    if(!m_compress)
+    {
+        profile.level = Hdf5CompressionProfile::NONE;
+    }
+    profile.maxChunkRows = m_chunkSize;
+    return profile;
+}
+
 void HDF5IO::setPreviewReductionFactor(const unsigned int factor)
 {
     if (factor >= 1)
@@ -588,6 +743,79 @@ ScanPtr HDF5IO::getSingleRawScan(int nr, bool load_points)
 }
 
 
+std::vector<size_t> HDF5IO::getPreviewLevels(int nr)
+{
+    std::vector<size_t> ret;
+
+    if (m_hdf5_file)
+    {
+        char buffer[128];
+        sprintf(buffer, "position_%05d", nr);
+        std::string groupName = "/preview/" + std::string(buffer);
+
+        if (exist(groupName))
+        {
+            HighFive::Group g = getGroup(groupName, false);
+            if (g.exist("levels"))
+            {
+                std::vector<size_t> dim;
+                boost::shared_array<size_t> levels = getArray<size_t>(g, "levels", dim);
+                ret.assign(levels.get(), levels.get() + dim[0]);
+            }
+            else if (g.exist("points"))
+            {
+                // Previews of older files are a single level
+                ret.push_back(g.getDataSet("points").getSpace().getDimensions()[0]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+PointBufferPtr HDF5IO::getPreviewPoints(int nr, size_t first, size_t last)
+{
+    PointBufferPtr ret;
+
+    if (m_hdf5_file && first < last)
+    {
+        char buffer[128];
+        sprintf(buffer, "position_%05d", nr);
+        std::string groupName = "/preview/" + std::string(buffer);
+
+        if (exist(groupName))
+        {
+            HighFive::Group g = getGroup(groupName, false);
+            if (g.exist("points"))
+            {
+                HighFive::DataSet points = g.getDataSet("points");
+                last = std::min(last, points.getSpace().getDimensions()[0]);
+                if (first >= last)
+                {
+                    return ret;
+                }
+
+                floatArr pointData(new float[(last - first) * 3]);
+                hdf5util::readRows(points, first, last - first, pointData.get());
+                ret = PointBufferPtr(new PointBuffer(pointData, last - first));
+
+                if (g.exist("spectral"))
+                {
+                    HighFive::DataSet spectral = g.getDataSet("spectral");
+                    size_t width = spectral.getSpace().getDimensions()[1];
+                    ucharArr spectralData(new unsigned char[(last - first) * width]);
+                    hdf5util::readRows(spectral, first, last - first, spectralData.get());
+                    ret->addUCharChannel(spectralData, "spectral_channels", last - first, width);
+                    ret->addIntAtomic(400, "spectral_wavelength_min");
+                    ret->addIntAtomic(400 + 4 * width, "spectral_wavelength_max");
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
 ScanImage HDF5IO::getSingleRawCamData(int scan_id, int img_id, bool load_image_data)
 {
     ScanImage ret;
@@ -898,26 +1126,31 @@ void HDF5IO::addRawScan(int nr, ScanPtr scan)
                 std::string previewGroupName = "/preview/" + nr_str;
 
 
-                // Add point preview
+                // Add point preview as level of detail pyramid. Every
+                // prefix of the preview that ends at a level boundary is
+                // a uniform subsample of the scan.
                 floatArr points = scan->points->getPointArray();
                 if (points)
                 {
-                    size_t numPreview;
-                    floatArr previewData = reduceData(points, scan->points->numPoints(), 3, m_previewReductionFactor, &numPreview);
+                    size_t numPoints = scan->points->numPoints();
+                    std::vector<size_t> levels;
+                    std::vector<size_t> order = lodOrder(
+                            points, numPoints, std::max<size_t>(numPoints / m_previewReductionFactor, 1), levels);
 
-                    std::vector<size_t> previewDim = {numPreview, 3};
-                    addArray(previewGroupName, "points", previewDim, previewData);
-                }
+                    std::vector<size_t> previewDim = {order.size(), 3};
+                    addArray(previewGroupName, "points", previewDim, selectRows(points, 3, order));
 
+                    std::vector<size_t> levelDim = {levels.size(), 1};
+                    boost::shared_array<size_t> levelData(new size_t[levels.size()]);
+                    std::copy(levels.begin(), levels.end(), levelData.get());
+                    addArray(previewGroupName, "levels", levelDim, levelData);
 
-                // Add spectral preview
-                if (spectral)
-                {
-
-                    size_t numPreview;
-                    ucharArr previewData = reduceData(spectral, an, aw, m_previewReductionFactor, &numPreview);
-                    std::vector<size_t> previewDim = {numPreview, aw};
-                    addArray(previewGroupName, "spectral", previewDim, previewData);
+                    // Add spectral preview
+                    if (spectral)
+                    {
+                        std::vector<size_t> spectralDim = {order.size(), aw};
+                        addArray(previewGroupName, "spectral", spectralDim, selectRows(spectral, aw, order));
+                    }
                 }
             }
         }
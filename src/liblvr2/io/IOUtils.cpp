@@ -411,7 +411,7 @@ PointBufferPtr subSamplePointBuffer(PointBufferPtr src, const size_t& n)
     // Setup random device and distribution
     std::random_device dev;
     std::mt19937 rng(dev());
-    std::uniform_int_distribution<std::mt19937::result_type> dist(0, numSrcPts);
+    std::uniform_int_distribution<std::mt19937::result_type> dist(0, std::max<size_t>(numSrcPts, 1) - 1);
 
     // Check buffer size
     if(n <= numSrcPts)
@@ -33,6 +33,8 @@
  */
 
 #include <boost/algorithm/string.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <algorithm>
 #include <cerrno>
 #include <exception>
 #include <fstream>
@@ -42,6 +44,7 @@
 #include <stdio.h>
 
 #include "lvr2/io/LineReader.hpp"
+#include "lvr2/io/AsciiParser.hpp"
 
 namespace lvr2
 {
@@ -312,182 +315,8 @@ boost::shared_ptr<void> LineReader::getNextPoints(size_t& return_amount, size_t
         }
         else
         {
-            fseek(pFile, m_fileAttributes[m_currentReadFile].m_filePos, SEEK_SET);
-            size_t readCount = 0;
-            if (m_fileAttributes[m_currentReadFile].m_fileType == XYZ &&
-                m_fileAttributes[m_currentReadFile].m_line_element_amount != 3)
-            {
-
-                std::vector<float> input;
-                input.reserve(amount * 3);
-                boost::shared_ptr<void> pArray(
-                    new char[amount * m_fileAttributes[m_currentReadFile].m_PointBlockSize],
-                    std::default_delete<char[]>());
-                float ax, ay, az;
-                char lineBuffer[1024];
-                while ((fgets(lineBuffer, 1024, pFile) != NULL) && readCount < amount)
-                {
-                    sscanf(lineBuffer, "%f %f %f", &ax, &ay, &az);
-                    readCount++;
-                    input.push_back(ax);
-                    input.push_back(ay);
-                    input.push_back(az);
-                }
-
-                memcpy(pArray.get(),
-                       input.data(),
-                       m_fileAttributes[m_currentReadFile].m_PointBlockSize * readCount);
-                return_amount = readCount;
-                if (return_amount < amount)
-                    m_openNextFile = true;
-                m_fileAttributes[m_currentReadFile].m_filePos = ftell(pFile);
-                fclose(pFile);
-                return pArray;
-            }
-            if (m_fileAttributes[m_currentReadFile].m_fileType == XYZ)
-            {
-                std::vector<float> input;
-                input.reserve(amount * 3);
-                boost::shared_ptr<void> pArray(
-                    new char[amount * m_fileAttributes[m_currentReadFile].m_PointBlockSize],
-                    std::default_delete<char[]>());
-                float ax, ay, az;
-                while ((fscanf(pFile, "%f %f %f", &ax, &ay, &az) != EOF) && readCount < amount)
-                {
-                    readCount++;
-                    input.push_back(ax);
-                    input.push_back(ay);
-                    input.push_back(az);
-                }
-
-                memcpy(pArray.get(),
-                       input.data(),
-                       m_fileAttributes[m_currentReadFile].m_PointBlockSize * readCount);
-                return_amount = readCount;
-                if (return_amount < amount)
-                {
-                    m_openNextFile = true;
-                }
-                else
-                {
-                    m_openNextFile = false;
-                }
-                m_fileAttributes[m_currentReadFile].m_filePos = ftell(pFile);
-                fclose(pFile);
-                return pArray;
-            }
-            else if (m_fileAttributes[m_currentReadFile].m_fileType == XYZN)
-            {
-                std::vector<float> input;
-                input.reserve(amount * 6);
-                boost::shared_ptr<void> pArray(
-                    new char[amount * m_fileAttributes[m_currentReadFile].m_PointBlockSize],
-                    std::default_delete<char[]>());
-                float ax, ay, az, nx, ny, nz;
-                while ((fscanf(pFile, "%f %f %f %f %f %f", &ax, &ay, &az, &nx, &ny, &nz) != EOF) &&
-                       readCount < amount)
-                {
-                    readCount++;
-                    input.push_back(ax);
-                    input.push_back(ay);
-                    input.push_back(az);
-                }
-                memcpy(pArray.get(),
-                       input.data(),
-                       m_fileAttributes[m_currentReadFile].m_PointBlockSize * readCount);
-                return_amount = readCount;
-                if (return_amount < amount)
-                    m_openNextFile = true;
-                m_fileAttributes[m_currentReadFile].m_filePos = ftell(pFile);
-                fclose(pFile);
-                return pArray;
-            }
-            else if (m_fileAttributes[m_currentReadFile].m_fileType == XYZRGB)
-            {
-                std::vector<xyzc> input;
-                input.reserve(amount * 6);
-                boost::shared_ptr<void> pArray(
-                    new char[amount * m_fileAttributes[m_currentReadFile].m_PointBlockSize],
-                    std::default_delete<char[]>());
-                xyzc pc;
-                float tmp_x, tmp_y, tmp_z;
-                unsigned char tmp_r, tmp_g, tmp_b;
-                while ((fscanf(pFile,
-                               "%f %f %f %hhu %hhu %hhu",  // don't read directly in to struct!
-                               &tmp_x,
-                               &tmp_y,
-                               &tmp_z,
-                               &tmp_r,
-                               &tmp_g,
-                               &tmp_b) != EOF) &&
-                       readCount < amount)
-                {
-                    pc.point.x = tmp_x;
-                    pc.point.y = tmp_y;
-                    pc.point.z = tmp_z;
-                    pc.color.r = tmp_r;
-                    pc.color.g = tmp_g;
-                    pc.color.b = tmp_b;
-                    readCount++;
-                    input.push_back(pc);
-                }
-                memcpy(pArray.get(),
-                       input.data(),
-                       m_fileAttributes[m_currentReadFile].m_PointBlockSize * readCount);
-                return_amount = readCount;
-                if (return_amount < amount)
-                    m_openNextFile = true;
-                m_fileAttributes[m_currentReadFile].m_filePos = ftell(pFile);
-                fclose(pFile);
-                return pArray;
-            }
-            else if (m_fileAttributes[m_currentReadFile].m_fileType == XYZNRGB)
-            {
-                std::vector<xyznc> input;
-                input.reserve(amount * 6);
-                boost::shared_ptr<void> pArray(
-                    new char[amount * m_fileAttributes[m_currentReadFile].m_PointBlockSize],
-                    std::default_delete<char[]>());
-                xyznc pc;
-                float tmp_x, tmp_y, tmp_z, tmp_nx, tmp_ny, tmp_nz;
-                unsigned char tmp_r, tmp_g, tmp_b;
-                while ((fscanf(pFile,
-                               "%f %f %f %hhu %hhu %hhu %f %f %f",
-                               &tmp_x,
-                               &tmp_y,
-                               &tmp_z,
-                               &tmp_r,
-                               &tmp_g,
-                               &tmp_b,
-                               &tmp_nx,
-                               &tmp_ny,
-                               &tmp_nz) != EOF) &&
-                       readCount < amount)
-                {
-                    pc.point.x = tmp_x;
-                    pc.point.y = tmp_y;
-                    pc.point.z = tmp_z;
-                    pc.color.r = tmp_r;
-                    pc.color.g = tmp_g;
-                    pc.color.b = tmp_b;
-                    pc.normal.x = tmp_nx;
-                    pc.normal.y = tmp_ny;
-                    pc.normal.z = tmp_nz;
-                    readCount++;
-                    input.push_back(pc);
-                }
-                memcpy(pArray.get(),
-                       input.data(),
-                       m_fileAttributes[m_currentReadFile].m_PointBlockSize * readCount);
-                return_amount = readCount;
-                m_fileAttributes[m_currentReadFile].m_filePos = ftell(pFile);
-                if (return_amount < amount)
-                {
-                    m_openNextFile = true;
-                }
-                fclose(pFile);
-                return pArray;
-            }
+            fclose(pFile);
+            return getNextAsciiPoints(return_amount, amount);
         }
         fclose(pFile);
     }
@@ -501,6 +330,73 @@ boost::shared_ptr<void> LineReader::getNextPoints(size_t& return_amount, size_t
     return tmp;
 }
 
+boost::shared_ptr<void> LineReader::getNextAsciiPoints(size_t& return_amount, size_t amount)
+{
+    fileAttribut& attr = m_fileAttributes[m_currentReadFile];
+
+    boost::iostreams::mapped_file_source file;
+    try
+    {
+        file.open(attr.m_filePath);
+    }
+    catch (std::exception& e)
+    {
+        std::cout << "Could not map file: " << e.what() << std::endl;
+        m_openNextFile = true;
+        return boost::shared_ptr<void>();
+    }
+
+    const char* fileEnd = file.data() + file.size();
+    const char* begin = file.data() + std::min(attr.m_filePos, file.size());
+    const char* end = AsciiParser::skipLines(begin, fileEnd, amount);
+
+    boost::shared_ptr<void> pArray(new char[amount * attr.m_PointBlockSize],
+                                   std::default_delete<char[]>());
+    char* data = static_cast<char*>(pArray.get());
+    const size_t stride = attr.m_PointBlockSize;
+
+    // Column layout of the supported formats and their position within the
+    // packed point structs
+    xyznc pc;
+    const size_t normalOffset = reinterpret_cast<char*>(&pc.normal) - reinterpret_cast<char*>(&pc);
+    const size_t colorOffset = attr.m_fileType == XYZNRGB
+        ? reinterpret_cast<char*>(&pc.color) - reinterpret_cast<char*>(&pc)
+        : sizeof(xyz);
+
+    std::vector<AsciiColumn> columns;
+    for (int i = 0; i < 3; i++)
+    {
+        columns.push_back({ i, AsciiColumn::FLOAT, data + i * sizeof(float), stride });
+    }
+    if (attr.m_fileType == XYZN)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            columns.push_back({ 3 + i, AsciiColumn::FLOAT, data + normalOffset + i * sizeof(float), stride });
+        }
+    }
+    else if (attr.m_fileType == XYZRGB || attr.m_fileType == XYZNRGB)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            columns.push_back({ 3 + i, AsciiColumn::UCHAR, data + colorOffset + i, stride });
+        }
+        if (attr.m_fileType == XYZNRGB)
+        {
+            for (int i = 0; i < 3; i++)
+            {
+                columns.push_back({ 6 + i, AsciiColumn::FLOAT, data + normalOffset + i * sizeof(float), stride });
+            }
+        }
+    }
+
+    return_amount = AsciiParser::parse(begin, end, columns);
+    attr.m_filePos = end - file.data();
+    m_openNextFile = end == fileEnd;
+
+    return pArray;
+}
+
 void LineReader::rewind()
 {
     std::vector<std::string> tmp;
@@ -40,6 +40,7 @@
 #include "lvr2/io/HDF5IO.hpp"
 #include "lvr2/io/BoctreeIO.hpp"
 #include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/io/PointCloudWriter.hpp"
 #include "lvr2/io/DatIO.hpp"
 #include "lvr2/io/STLIO.hpp"
 #include "lvr2/io/Timestamp.hpp"
@@ -171,55 +172,114 @@ ModelPtr ModelFactory::readModel( std::string filename )
     {
         m = io->read( filename );
 
-        if( m_transform.transforms())
+        if( m && m->m_pointCloud && m_transform.transforms())
         {
-            // Convert coordinates in model
-            PointBufferPtr points = m->m_pointCloud;
-            size_t n_points = points->numPoints();
-            size_t n_normals = 0;
-            size_t dummy;
+            transformPointBuffer(m->m_pointCloud);
+        }
 
-            floatArr p = points->getPointArray();
-            floatArr n = points->getFloatArray("normals", n_normals, dummy);
+        delete io;
+    }
 
-            // If normals are present every point should habe one
-            if(n_normals)
-            {
-                assert(n_normals == n_points);
-            }
+    return m;
 
-            // Convert coordinates
-            float point[3];
-            float normal[3];
+}
 
-            for(size_t i = 0; i < n_points; i++)
-            {
-                // Re-order and scale point coordinates
-                point[0] = p[3 * i + m_transform.x] * m_transform.sx;
-                point[1] = p[3 * i + m_transform.y] * m_transform.sy;
-                point[2] = p[3 * i + m_transform.z] * m_transform.sz;
-
-                p[3 * i]         = point[0];
-                p[3 * i + 1]    = point[1];
-                p[3 * i + 2]    = point[2];
-                if(n_normals)
-                {
-                    normal[0] = n[3 * i + m_transform.x] * m_transform.sx;
-                    normal[1] = n[3 * i + m_transform.y] * m_transform.sy;
-                    normal[2] = n[3 * i + m_transform.z] * m_transform.sz;
+void ModelFactory::transformPointBuffer(PointBufferPtr points)
+{
+    // Convert coordinates in model
+    size_t n_points = points->numPoints();
+    size_t n_normals = 0;
+    size_t dummy;
 
-                    n[3 * i]         = normal[0];
-                    n[3 * i + 1]    = normal[1];
-                    n[3 * i + 2]    = normal[2];
-                }
-            }
+    floatArr p = points->getPointArray();
+    floatArr n = points->getFloatArray("normals", n_normals, dummy);
+
+    // If normals are present every point should habe one
+    if(n_normals)
+    {
+        assert(n_normals == n_points);
+    }
+
+    // Convert coordinates
+    float point[3];
+    float normal[3];
+
+    for(size_t i = 0; i < n_points; i++)
+    {
+        // Re-order and scale point coordinates
+        point[0] = p[3 * i + m_transform.x] * m_transform.sx;
+        point[1] = p[3 * i + m_transform.y] * m_transform.sy;
+        point[2] = p[3 * i + m_transform.z] * m_transform.sz;
+
+        p[3 * i]         = point[0];
+        p[3 * i + 1]    = point[1];
+        p[3 * i + 2]    = point[2];
+        if(n_normals)
+        {
+            normal[0] = n[3 * i + m_transform.x] * m_transform.sx;
+            normal[1] = n[3 * i + m_transform.y] * m_transform.sy;
+            normal[2] = n[3 * i + m_transform.z] * m_transform.sz;
+
+            n[3 * i]         = normal[0];
+            n[3 * i + 1]    = normal[1];
+            n[3 * i + 2]    = normal[2];
         }
+    }
+}
 
-        delete io;
+bool ModelFactory::readPointCloudBatches(
+    std::string filename,
+    size_t batchSize,
+    const std::function<void(PointBufferPtr)>& callback)
+{
+    boost::filesystem::path selectedFile( filename );
+    std::string extension = selectedFile.extension().string();
+
+    if(extension != ".ply")
+    {
+        return false;
     }
 
-    return m;
+    return PLYIO::readPointBatches(filename, batchSize, [&](PointBufferPtr batch)
+    {
+        if(m_transform.transforms())
+        {
+            transformPointBuffer(batch);
+        }
+        callback(batch);
+    });
+}
+
+PointCloudWriterPtr ModelFactory::openPointCloudWriter(
+    std::string filename,
+    const PointCloudLayout& layout)
+{
+    boost::filesystem::path selectedFile( filename );
+    std::string extension = selectedFile.extension().string();
 
+    PointCloudWriterPtr writer;
+    if(extension == ".ply")
+    {
+        writer.reset(new PLYPointCloudWriter);
+    }
+    else if(extension == ".las")
+    {
+        writer.reset(new LasPointCloudWriter);
+    }
+    else if(extension == ".h5")
+    {
+        writer.reset(new HDF5PointCloudWriter);
+    }
+    else
+    {
+        return writer;
+    }
+
+    if(!writer->open(filename, layout))
+    {
+        writer.reset();
+    }
+    return writer;
 }
 
 void ModelFactory::saveModel( ModelPtr m, std::string filename)
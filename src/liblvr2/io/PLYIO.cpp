@@ -42,12 +42,16 @@
 #include "lvr2/io/PLYIO.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <ctime>
+#include <limits>
+#include <map>
 #include <sstream>
 #include <fstream>
 
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <opencv2/opencv.hpp>
 
 namespace lvr2
@@ -402,6 +406,550 @@ void PLYIO::save( string filename )
 }
 
 
+namespace
+{
+
+/**
+ * @brief Layout of a property in a binary PLY file.
+ */
+struct PlyPropertyLayout
+{
+    std::string     name;
+    e_ply_type      type;       // Scalar type or type of the list entries
+    e_ply_type      lengthType; // Type of the list length (lists only)
+    bool            isList;
+    size_t          offset;     // Byte offset within the record
+};
+
+/**
+ * @brief Layout of an element in a binary PLY file.
+ *
+ * Records of elements without lists have a fixed size. The only list that is
+ * supported is the vertex index list of faces, which is assumed to contain
+ * three indices. This is verified while decoding.
+ */
+struct PlyElementLayout
+{
+    std::string                     name;
+    size_t                          count;
+    std::vector<PlyPropertyLayout>  properties;
+    size_t                          stride;     // 0 if the record size is unknown
+    size_t                          offset;     // Byte offset of the first record
+};
+
+/**
+ * @brief A property that is decoded into a buffer.
+ *
+ * Value `i` of the property is written to `data[i * components + component]`.
+ * For the vertex index list, `components` consecutive values are written.
+ */
+struct PlyReadTarget
+{
+    const char*     element;
+    const char*     property;
+    void*           data;
+    e_ply_type      dataType;   // PLY_FLOAT, PLY_UCHAR, PLY_SHORT or PLY_UINT
+    size_t          components;
+    size_t          component;
+};
+
+bool parsePlyType(const std::string& name, e_ply_type& type)
+{
+    static const std::map<std::string, e_ply_type> types = {
+        { "char",  PLY_INT8 },  { "int8",    PLY_INT8 },
+        { "uchar", PLY_UINT8 }, { "uint8",   PLY_UINT8 },
+        { "short", PLY_INT16 }, { "int16",   PLY_INT16 },
+        { "ushort", PLY_UINT16 }, { "uint16", PLY_UINT16 },
+        { "int",   PLY_INT32 }, { "int32",   PLY_INT32 },
+        { "uint",  PLY_UIN32 }, { "uint32",  PLY_UIN32 },
+        { "float", PLY_FLOAT32 }, { "float32", PLY_FLOAT32 },
+        { "double", PLY_FLOAT64 }, { "float64", PLY_FLOAT64 }
+    };
+
+    auto it = types.find(name);
+    if (it == types.end())
+    {
+        return false;
+    }
+    type = it->second;
+    return true;
+}
+
+size_t plyTypeSize(e_ply_type type)
+{
+    switch (type)
+    {
+        case PLY_INT8:
+        case PLY_UINT8:     return 1;
+        case PLY_INT16:
+        case PLY_UINT16:    return 2;
+        case PLY_INT32:
+        case PLY_UIN32:
+        case PLY_FLOAT32:   return 4;
+        case PLY_FLOAT64:   return 8;
+        default:            return 0;
+    }
+}
+
+bool isFaceIndexList(const PlyPropertyLayout& prop)
+{
+    return prop.isList && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+}
+
+/**
+ * @brief Parses the header of a binary little endian PLY file and computes
+ *        the record layout of all elements.
+ *
+ * @return false if the file is not a binary little endian PLY file.
+ */
+bool parseBinaryPlyHeader(const char* data, size_t size, std::vector<PlyElementLayout>& elements)
+{
+    const std::string endHeader = "end_header";
+    const char* headerLimit = data + std::min<size_t>(size, 1 << 20);
+    const char* end = std::search(data, headerLimit, endHeader.begin(), endHeader.end());
+    if (end == headerLimit)
+    {
+        return false;
+    }
+
+    // The data starts after the line break following "end_header"
+    const char* dataStart = static_cast<const char*>(memchr(end, '\n', data + size - end));
+    if (!dataStart)
+    {
+        return false;
+    }
+    size_t offset = dataStart + 1 - data;
+
+    std::istringstream header(std::string(data, end));
+    std::string line;
+    bool littleEndian = false;
+    while (std::getline(header, line))
+    {
+        std::istringstream ls(line);
+        std::string keyword;
+        ls >> keyword;
+        if (keyword == "format")
+        {
+            std::string format;
+            ls >> format;
+            littleEndian = format == "binary_little_endian";
+        }
+        else if (keyword == "element")
+        {
+            PlyElementLayout elem;
+            ls >> elem.name >> elem.count;
+            elem.stride = 0;
+            elements.push_back(elem);
+        }
+        else if (keyword == "property" && !elements.empty())
+        {
+            PlyPropertyLayout prop;
+            std::string type;
+            ls >> type;
+            prop.isList = type == "list";
+            if (prop.isList)
+            {
+                std::string lengthType, valueType;
+                ls >> lengthType >> valueType;
+                if (!parsePlyType(lengthType, prop.lengthType) || !parsePlyType(valueType, prop.type))
+                {
+                    return false;
+                }
+            }
+            else if (!parsePlyType(type, prop.type))
+            {
+                return false;
+            }
+            ls >> prop.name;
+            elements.back().properties.push_back(prop);
+        }
+    }
+
+    if (!littleEndian)
+    {
+        return false;
+    }
+
+    // Compute the offsets of the properties and elements. The size of all
+    // elements after the first one with an unknown record size is unknown as
+    // well.
+    for (auto& elem: elements)
+    {
+        size_t stride = 0;
+        bool fixed = true;
+        for (auto& prop: elem.properties)
+        {
+            prop.offset = stride;
+            if (!prop.isList)
+            {
+                stride += plyTypeSize(prop.type);
+            }
+            else if (isFaceIndexList(prop))
+            {
+                stride += plyTypeSize(prop.lengthType) + 3 * plyTypeSize(prop.type);
+            }
+            else
+            {
+                fixed = false;
+            }
+        }
+
+        elem.offset = offset;
+        if (!fixed || offset == std::numeric_limits<size_t>::max())
+        {
+            offset = std::numeric_limits<size_t>::max();
+            continue;
+        }
+        elem.stride = stride;
+
+        // Do not multiply before checking, a huge count in the header would
+        // overflow. Elements that do not fit keep their stride, but fail
+        // elementFitsInFile() and make all following offsets unknown.
+        if (stride != 0 && elem.count > (size - offset) / stride)
+        {
+            offset = std::numeric_limits<size_t>::max();
+            continue;
+        }
+        offset += elem.count * stride;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns true if the element has a known record size and all of its
+ *        records lie within a file of the given size.
+ */
+bool elementFitsInFile(const PlyElementLayout& elem, size_t size)
+{
+    return elem.stride != 0
+        && elem.offset <= size
+        && elem.count <= (size - elem.offset) / elem.stride;
+}
+
+template<typename DestT, typename SrcT>
+inline void decodeValues(const char* src, size_t stride, size_t begin, size_t end,
+                         DestT* dest, size_t components, size_t component)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        SrcT value;
+        std::memcpy(&value, src + i * stride, sizeof(SrcT));
+        dest[i * components + component] = static_cast<DestT>(value);
+    }
+}
+
+template<typename DestT>
+void decodeValues(e_ply_type type, const char* src, size_t stride, size_t begin, size_t end,
+                  void* dest, size_t components, size_t component)
+{
+    DestT* out = static_cast<DestT*>(dest);
+    switch (type)
+    {
+        case PLY_INT8:    decodeValues<DestT, int8_t>(src, stride, begin, end, out, components, component); break;
+        case PLY_UINT8:   decodeValues<DestT, uint8_t>(src, stride, begin, end, out, components, component); break;
+        case PLY_INT16:   decodeValues<DestT, int16_t>(src, stride, begin, end, out, components, component); break;
+        case PLY_UINT16:  decodeValues<DestT, uint16_t>(src, stride, begin, end, out, components, component); break;
+        case PLY_INT32:   decodeValues<DestT, int32_t>(src, stride, begin, end, out, components, component); break;
+        case PLY_UIN32:   decodeValues<DestT, uint32_t>(src, stride, begin, end, out, components, component); break;
+        case PLY_FLOAT32: decodeValues<DestT, float>(src, stride, begin, end, out, components, component); break;
+        case PLY_FLOAT64: decodeValues<DestT, double>(src, stride, begin, end, out, components, component); break;
+        default: break;
+    }
+}
+
+void decodeValues(e_ply_type dataType, e_ply_type type, const char* src, size_t stride,
+                  size_t begin, size_t end, void* dest, size_t components, size_t component)
+{
+    switch (dataType)
+    {
+        case PLY_FLOAT: decodeValues<float>(type, src, stride, begin, end, dest, components, component); break;
+        case PLY_UCHAR: decodeValues<uint8_t>(type, src, stride, begin, end, dest, components, component); break;
+        case PLY_SHORT: decodeValues<short>(type, src, stride, begin, end, dest, components, component); break;
+        case PLY_UINT:  decodeValues<unsigned int>(type, src, stride, begin, end, dest, components, component); break;
+        default: break;
+    }
+}
+
+/**
+ * @brief Checks that all `count` face records starting at `src` have three
+ *        indices.
+ */
+bool checkTriangles(const PlyPropertyLayout& prop, const char* src, size_t stride, size_t count)
+{
+    std::vector<unsigned int> lengths(count);
+    decodeValues(PLY_UINT, prop.lengthType, src, stride, 0, count, lengths.data(), 1, 0);
+    return std::all_of(lengths.begin(), lengths.end(), [](unsigned int l) { return l == 3; });
+}
+
+/**
+ * @brief Reads the requested properties of a binary little endian PLY file
+ *        from a memory mapping of the file.
+ *
+ * The records of each element are decoded in parallel blocks directly into
+ * the target buffers.
+ *
+ * @return false if the file can't be read this way (other formats, unknown
+ *         record sizes, non-triangle faces). The caller has to fall back to
+ *         rply in that case.
+ */
+bool readMappedBinaryPly(const string& filename, const std::vector<PlyReadTarget>& targets)
+{
+    // The records are copied byte by byte, which requires a little endian
+    // host.
+    const uint16_t endianTest = 1;
+    if (*reinterpret_cast<const uint8_t*>(&endianTest) != 1)
+    {
+        return false;
+    }
+
+    boost::iostreams::mapped_file_source file;
+    try
+    {
+        file.open(filename);
+    }
+    catch (std::exception& e)
+    {
+        return false;
+    }
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    std::vector<PlyElementLayout> elements;
+    if (!parseBinaryPlyHeader(data, size, elements))
+    {
+        return false;
+    }
+
+    // Find the layout of each target and make sure that all needed records
+    // lie within the file
+    struct Column
+    {
+        const PlyElementLayout* element;
+        const PlyPropertyLayout* property;
+        const PlyReadTarget* target;
+    };
+    std::vector<Column> columns;
+    for (auto& target: targets)
+    {
+        for (auto& elem: elements)
+        {
+            if (elem.name != target.element)
+            {
+                continue;
+            }
+            for (auto& prop: elem.properties)
+            {
+                if (prop.name != target.property)
+                {
+                    continue;
+                }
+                if (!elementFitsInFile(elem, size)
+                    || (prop.isList && !isFaceIndexList(prop)))
+                {
+                    return false;
+                }
+                columns.push_back({ &elem, &prop, &target });
+            }
+        }
+    }
+
+    const size_t blockSize = 1 << 16;
+    for (auto& elem: elements)
+    {
+        std::vector<const Column*> elemColumns;
+        for (auto& c: columns)
+        {
+            if (c.element == &elem)
+            {
+                elemColumns.push_back(&c);
+            }
+        }
+        if (elemColumns.empty())
+        {
+            continue;
+        }
+
+        const char* records = data + elem.offset;
+        const long numBlocks = (elem.count + blockSize - 1) / blockSize;
+        bool triangles = true;
+
+        #pragma omp parallel for schedule(dynamic, 1) reduction(&&:triangles)
+        for (long block = 0; block < numBlocks; block++)
+        {
+            const size_t begin = block * blockSize;
+            const size_t end = std::min(elem.count, begin + blockSize);
+            for (auto c: elemColumns)
+            {
+                const auto& prop = *c->property;
+                const auto& target = *c->target;
+                if (prop.isList)
+                {
+                    triangles = triangles && checkTriangles(
+                        prop, records + begin * elem.stride + prop.offset, elem.stride, end - begin);
+
+                    const size_t first = prop.offset + plyTypeSize(prop.lengthType);
+                    for (size_t k = 0; k < 3; k++)
+                    {
+                        decodeValues(target.dataType, prop.type,
+                                     records + first + k * plyTypeSize(prop.type), elem.stride,
+                                     begin, end, target.data, 3, k);
+                    }
+                }
+                else
+                {
+                    decodeValues(target.dataType, prop.type, records + prop.offset, elem.stride,
+                                 begin, end, target.data, target.components, target.component);
+                }
+            }
+        }
+
+        if (!triangles)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+bool PLYIO::readPointBatches( string filename, size_t batchSize,
+        const std::function<void(PointBufferPtr)>& callback )
+{
+    const uint16_t endianTest = 1;
+    if (*reinterpret_cast<const uint8_t*>(&endianTest) != 1 || batchSize == 0)
+    {
+        return false;
+    }
+
+    boost::iostreams::mapped_file_source file;
+    try
+    {
+        file.open(filename);
+    }
+    catch (std::exception& e)
+    {
+        return false;
+    }
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    const char* data = file.data();
+    const size_t size = file.size();
+
+    std::vector<PlyElementLayout> elements;
+    if (!parseBinaryPlyHeader(data, size, elements))
+    {
+        return false;
+    }
+
+    // Points are stored in the point element or in the vertex element if
+    // there are no faces
+    const PlyElementLayout* points = nullptr;
+    const PlyElementLayout* vertices = nullptr;
+    for (auto& elem: elements)
+    {
+        if (elem.name == "point")
+        {
+            points = &elem;
+        }
+        else if (elem.name == "vertex")
+        {
+            vertices = &elem;
+        }
+        else if (elem.name == "face" && elem.count > 0)
+        {
+            return false;
+        }
+    }
+    const PlyElementLayout* elem = points ? points : vertices;
+    if (!elem || !elementFitsInFile(*elem, size))
+    {
+        return false;
+    }
+
+    auto findProperty = [&](const char* name) -> const PlyPropertyLayout*
+    {
+        for (auto& prop: elem->properties)
+        {
+            if (prop.name == name && !prop.isList)
+            {
+                return &prop;
+            }
+        }
+        return nullptr;
+    };
+
+    const PlyPropertyLayout* xyz[3] = { findProperty("x"), findProperty("y"), findProperty("z") };
+    const PlyPropertyLayout* rgb[3] = { findProperty("red"), findProperty("green"), findProperty("blue") };
+    const PlyPropertyLayout* normal[3] = { findProperty("nx"), findProperty("ny"), findProperty("nz") };
+    const PlyPropertyLayout* intensity = findProperty("intensity");
+
+    if (!xyz[0] || !xyz[1] || !xyz[2])
+    {
+        return false;
+    }
+    const bool hasColors = rgb[0] && rgb[1] && rgb[2];
+    const bool hasNormals = normal[0] && normal[1] && normal[2];
+
+    const char* records = data + elem->offset;
+    for (size_t begin = 0; begin < elem->count; begin += batchSize)
+    {
+        const size_t n = std::min(batchSize, elem->count - begin);
+        const char* batch = records + begin * elem->stride;
+
+        floatArr pointArr(new float[3 * n]);
+        for (size_t k = 0; k < 3; k++)
+        {
+            decodeValues(PLY_FLOAT, xyz[k]->type, batch + xyz[k]->offset, elem->stride, 0, n,
+                         pointArr.get(), 3, k);
+        }
+        PointBufferPtr buffer(new PointBuffer(pointArr, n));
+
+        if (hasColors)
+        {
+            ucharArr colorArr(new unsigned char[3 * n]);
+            for (size_t k = 0; k < 3; k++)
+            {
+                decodeValues(PLY_UCHAR, rgb[k]->type, batch + rgb[k]->offset, elem->stride, 0, n,
+                             colorArr.get(), 3, k);
+            }
+            buffer->setColorArray(colorArr, n);
+        }
+
+        if (hasNormals)
+        {
+            floatArr normalArr(new float[3 * n]);
+            for (size_t k = 0; k < 3; k++)
+            {
+                decodeValues(PLY_FLOAT, normal[k]->type, batch + normal[k]->offset, elem->stride, 0, n,
+                             normalArr.get(), 3, k);
+            }
+            buffer->setNormalArray(normalArr, n);
+        }
+
+        if (intensity)
+        {
+            floatArr intensityArr(new float[n]);
+            decodeValues(PLY_FLOAT, intensity->type, batch + intensity->offset, elem->stride, 0, n,
+                         intensityArr.get(), 1, 0);
+            buffer->addFloatChannel(intensityArr, "intensities", n, 1);
+        }
+
+        callback(buffer);
+    }
+
+    return true;
+}
+
 ModelPtr PLYIO::read( string filename )
 {
    return read( filename, true );
@@ -636,82 +1184,156 @@ ModelPtr PLYIO::read( string filename, bool readColor, bool readConfidence,
     short*          point_panorama_coords    = pointPanoramaCoords.get();
 
 
-    /* Set callbacks. */
+    /* Binary little endian files are decoded directly from a memory
+     * mapping of the file. Everything else is read with rply. */
+    std::vector<PlyReadTarget> targets;
     if ( vertex )
     {
-        ply_set_read_cb( ply, "vertex", "x", readVertexCb, &vertex, 0 );
-        ply_set_read_cb( ply, "vertex", "y", readVertexCb, &vertex, 0 );
-        ply_set_read_cb( ply, "vertex", "z", readVertexCb, &vertex, 1 );
+        targets.push_back( { "vertex", "x", vertex, PLY_FLOAT, 3, 0 } );
+        targets.push_back( { "vertex", "y", vertex, PLY_FLOAT, 3, 1 } );
+        targets.push_back( { "vertex", "z", vertex, PLY_FLOAT, 3, 2 } );
     }
     if ( vertex_color )
     {
-        ply_set_read_cb( ply, "vertex", "red",   readColorCb,  &vertex_color,  0 );
-        ply_set_read_cb( ply, "vertex", "green", readColorCb,  &vertex_color,  0 );
-        ply_set_read_cb( ply, "vertex", "blue",  readColorCb,  &vertex_color,  1 );
+        targets.push_back( { "vertex", "red",   vertex_color, PLY_UCHAR, 3, 0 } );
+        targets.push_back( { "vertex", "green", vertex_color, PLY_UCHAR, 3, 1 } );
+        targets.push_back( { "vertex", "blue",  vertex_color, PLY_UCHAR, 3, 2 } );
     }
     if ( vertex_confidence )
     {
-        ply_set_read_cb( ply, "vertex", "confidence", readVertexCb, &vertex_confidence, 1 );
+        targets.push_back( { "vertex", "confidence", vertex_confidence, PLY_FLOAT, 1, 0 } );
     }
     if ( vertex_intensity )
     {
-        ply_set_read_cb( ply, "vertex", "intensity", readVertexCb, &vertex_intensity, 1 );
+        targets.push_back( { "vertex", "intensity", vertex_intensity, PLY_FLOAT, 1, 0 } );
     }
     if ( vertex_normal )
     {
-        ply_set_read_cb( ply, "vertex", "nx", readVertexCb, &vertex_normal, 0 );
-        ply_set_read_cb( ply, "vertex", "ny", readVertexCb, &vertex_normal, 0 );
-        ply_set_read_cb( ply, "vertex", "nz", readVertexCb, &vertex_normal, 1 );
+        targets.push_back( { "vertex", "nx", vertex_normal, PLY_FLOAT, 3, 0 } );
+        targets.push_back( { "vertex", "ny", vertex_normal, PLY_FLOAT, 3, 1 } );
+        targets.push_back( { "vertex", "nz", vertex_normal, PLY_FLOAT, 3, 2 } );
     }
     if ( vertex_panorama_coords )
     {
-        ply_set_read_cb( ply, "vertex", "x_coords", readPanoramaCoordCB, &vertex_panorama_coords, 0 );
-        ply_set_read_cb( ply, "vertex", "y_coords", readPanoramaCoordCB, &vertex_panorama_coords, 1 );
+        targets.push_back( { "vertex", "x_coords", vertex_panorama_coords, PLY_SHORT, 2, 0 } );
+        targets.push_back( { "vertex", "y_coords", vertex_panorama_coords, PLY_SHORT, 2, 1 } );
     }
-
     if ( face )
     {
-        ply_set_read_cb( ply, "face", "vertex_indices", readFaceCb, &face, 0 );
-        ply_set_read_cb( ply, "face", "vertex_index", readFaceCb, &face, 0 );
+        targets.push_back( { "face", "vertex_indices", face, PLY_UINT, 3, 0 } );
+        targets.push_back( { "face", "vertex_index",   face, PLY_UINT, 3, 0 } );
     }
-
     if ( point )
     {
-        ply_set_read_cb( ply, "point", "x", readVertexCb, &point, 0 );
-        ply_set_read_cb( ply, "point", "y", readVertexCb, &point, 0 );
-        ply_set_read_cb( ply, "point", "z", readVertexCb, &point, 1 );
+        targets.push_back( { "point", "x", point, PLY_FLOAT, 3, 0 } );
+        targets.push_back( { "point", "y", point, PLY_FLOAT, 3, 1 } );
+        targets.push_back( { "point", "z", point, PLY_FLOAT, 3, 2 } );
     }
     if ( point_color )
     {
-        ply_set_read_cb( ply, "point", "red",   readColorCb,  &point_color,  0 );
-        ply_set_read_cb( ply, "point", "green", readColorCb,  &point_color,  0 );
-        ply_set_read_cb( ply, "point", "blue",  readColorCb,  &point_color,  1 );
+        targets.push_back( { "point", "red",   point_color, PLY_UCHAR, 3, 0 } );
+        targets.push_back( { "point", "green", point_color, PLY_UCHAR, 3, 1 } );
+        targets.push_back( { "point", "blue",  point_color, PLY_UCHAR, 3, 2 } );
     }
     if ( point_confidence )
     {
-        ply_set_read_cb( ply, "point", "confidence", readVertexCb, &point_confidence, 1 );
+        targets.push_back( { "point", "confidence", point_confidence, PLY_FLOAT, 1, 0 } );
     }
     if ( point_intensity )
     {
-        ply_set_read_cb( ply, "point", "intensity", readVertexCb, &point_intensity, 1 );
+        targets.push_back( { "point", "intensity", point_intensity, PLY_FLOAT, 1, 0 } );
     }
     if ( point_normal )
     {
-        ply_set_read_cb( ply, "point", "nx", readVertexCb, &point_normal, 0 );
-        ply_set_read_cb( ply, "point", "ny", readVertexCb, &point_normal, 0 );
-        ply_set_read_cb( ply, "point", "nz", readVertexCb, &point_normal, 1 );
+        targets.push_back( { "point", "nx", point_normal, PLY_FLOAT, 3, 0 } );
+        targets.push_back( { "point", "ny", point_normal, PLY_FLOAT, 3, 1 } );
+        targets.push_back( { "point", "nz", point_normal, PLY_FLOAT, 3, 2 } );
     }
     if ( point_panorama_coords )
     {
-        ply_set_read_cb( ply, "point", "x_coords", readPanoramaCoordCB, &point_panorama_coords, 0 );
-        ply_set_read_cb( ply, "point", "y_coords", readPanoramaCoordCB, &point_panorama_coords, 1 );
+        targets.push_back( { "point", "x_coords", point_panorama_coords, PLY_SHORT, 2, 0 } );
+        targets.push_back( { "point", "y_coords", point_panorama_coords, PLY_SHORT, 2, 1 } );
     }
 
-    /* Read ply file. */
-    if ( !ply_read( ply ) )
+    if ( !readMappedBinaryPly( filename, targets ) )
     {
-        std::cerr << timestamp << "Could not read »" << filename << "«."
-            << std::endl;
+        /* Set callbacks. */
+        if ( vertex )
+        {
+            ply_set_read_cb( ply, "vertex", "x", readVertexCb, &vertex, 0 );
+            ply_set_read_cb( ply, "vertex", "y", readVertexCb, &vertex, 0 );
+            ply_set_read_cb( ply, "vertex", "z", readVertexCb, &vertex, 1 );
+        }
+        if ( vertex_color )
+        {
+            ply_set_read_cb( ply, "vertex", "red",   readColorCb,  &vertex_color,  0 );
+            ply_set_read_cb( ply, "vertex", "green", readColorCb,  &vertex_color,  0 );
+            ply_set_read_cb( ply, "vertex", "blue",  readColorCb,  &vertex_color,  1 );
+        }
+        if ( vertex_confidence )
+        {
+            ply_set_read_cb( ply, "vertex", "confidence", readVertexCb, &vertex_confidence, 1 );
+        }
+        if ( vertex_intensity )
+        {
+            ply_set_read_cb( ply, "vertex", "intensity", readVertexCb, &vertex_intensity, 1 );
+        }
+        if ( vertex_normal )
+        {
+            ply_set_read_cb( ply, "vertex", "nx", readVertexCb, &vertex_normal, 0 );
+            ply_set_read_cb( ply, "vertex", "ny", readVertexCb, &vertex_normal, 0 );
+            ply_set_read_cb( ply, "vertex", "nz", readVertexCb, &vertex_normal, 1 );
+        }
+        if ( vertex_panorama_coords )
+        {
+            ply_set_read_cb( ply, "vertex", "x_coords", readPanoramaCoordCB, &vertex_panorama_coords, 0 );
+            ply_set_read_cb( ply, "vertex", "y_coords", readPanoramaCoordCB, &vertex_panorama_coords, 1 );
+        }
+
+        if ( face )
+        {
+            ply_set_read_cb( ply, "face", "vertex_indices", readFaceCb, &face, 0 );
+            ply_set_read_cb( ply, "face", "vertex_index", readFaceCb, &face, 0 );
+        }
+
+        if ( point )
+        {
+            ply_set_read_cb( ply, "point", "x", readVertexCb, &point, 0 );
+            ply_set_read_cb( ply, "point", "y", readVertexCb, &point, 0 );
+            ply_set_read_cb( ply, "point", "z", readVertexCb, &point, 1 );
+        }
+        if ( point_color )
+        {
+            ply_set_read_cb( ply, "point", "red",   readColorCb,  &point_color,  0 );
+            ply_set_read_cb( ply, "point", "green", readColorCb,  &point_color,  0 );
+            ply_set_read_cb( ply, "point", "blue",  readColorCb,  &point_color,  1 );
+        }
+        if ( point_confidence )
+        {
+            ply_set_read_cb( ply, "point", "confidence", readVertexCb, &point_confidence, 1 );
+        }
+        if ( point_intensity )
+        {
+            ply_set_read_cb( ply, "point", "intensity", readVertexCb, &point_intensity, 1 );
+        }
+        if ( point_normal )
+        {
+            ply_set_read_cb( ply, "point", "nx", readVertexCb, &point_normal, 0 );
+            ply_set_read_cb( ply, "point", "ny", readVertexCb, &point_normal, 0 );
+            ply_set_read_cb( ply, "point", "nz", readVertexCb, &point_normal, 1 );
+        }
+        if ( point_panorama_coords )
+        {
+            ply_set_read_cb( ply, "point", "x_coords", readPanoramaCoordCB, &point_panorama_coords, 0 );
+            ply_set_read_cb( ply, "point", "y_coords", readPanoramaCoordCB, &point_panorama_coords, 1 );
+        }
+
+        /* Read ply file. */
+        if ( !ply_read( ply ) )
+        {
+            std::cerr << timestamp << "Could not read »" << filename << "«."
+                << std::endl;
+        }
     }
 
     /* Check if we got only vertices and neither points nor faces. If that is
@@ -0,0 +1,499 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * PointCloudWriter.cpp
+ */
+
+#include "lvr2/io/PointCloudWriter.hpp"
+#include "lvr2/io/Timestamp.hpp"
+
+#include <lasdefinitions.hpp>
+#include <laswriter.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace lvr2
+{
+
+PointCloudLayout::PointCloudLayout(const PointBuffer& buffer)
+    : colors(buffer.hasColors()),
+      normals(buffer.hasNormals()),
+      intensities(buffer.hasChannel<float>("intensities"))
+{
+
+}
+
+PointCloudWriter::BatchData::BatchData(const PointCloudLayout& layout, PointBufferPtr batch)
+    : n(batch->numPoints()), colorWidth(3)
+{
+    points = batch->getPointArray();
+
+    if (layout.colors)
+    {
+        colors = batch->getColorArray(colorWidth);
+        if (!colors || colorWidth < 3)
+        {
+            colors = ucharArr(new unsigned char[3 * n]());
+            colorWidth = 3;
+        }
+    }
+
+    if (layout.normals)
+    {
+        normals = batch->getNormalArray();
+        if (!normals)
+        {
+            normals = floatArr(new float[3 * n]());
+        }
+    }
+
+    if (layout.intensities)
+    {
+        size_t num, width;
+        intensities = batch->getFloatArray("intensities", num, width);
+        if (!intensities || num != n || width != 1)
+        {
+            intensities = floatArr(new float[n]());
+        }
+    }
+}
+
+/****************************************************************************
+ * PLY
+ ***************************************************************************/
+
+PLYPointCloudWriter::~PLYPointCloudWriter()
+{
+    close();
+}
+
+bool PLYPointCloudWriter::open(const std::string& filename, const PointCloudLayout& layout)
+{
+    close();
+
+    m_out.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_out.good())
+    {
+        std::cout << timestamp << "PLYPointCloudWriter: Unable to open '" << filename << "'." << std::endl;
+        return false;
+    }
+
+    m_layout = layout;
+    m_numPoints = 0;
+    m_open = true;
+
+    // The number of points is not known yet. Reserve enough space to fill
+    // it in when the file is closed.
+    m_out << "ply\n";
+    m_out << "format binary_little_endian 1.0\n";
+    m_out << "element vertex ";
+    m_countPos = m_out.tellp();
+    m_out << std::string(20, ' ') << "\n";
+    m_out << "property float x\n";
+    m_out << "property float y\n";
+    m_out << "property float z\n";
+    if (m_layout.colors)
+    {
+        m_out << "property uchar red\n";
+        m_out << "property uchar green\n";
+        m_out << "property uchar blue\n";
+    }
+    if (m_layout.normals)
+    {
+        m_out << "property float nx\n";
+        m_out << "property float ny\n";
+        m_out << "property float nz\n";
+    }
+    if (m_layout.intensities)
+    {
+        m_out << "property float intensity\n";
+    }
+    m_out << "end_header\n";
+
+    return m_out.good();
+}
+
+void PLYPointCloudWriter::append(PointBufferPtr batch)
+{
+    if (!m_open || !batch || !batch->numPoints())
+    {
+        return;
+    }
+
+    BatchData b(m_layout, batch);
+
+    const size_t recordSize = 3 * sizeof(float)
+        + (m_layout.colors ? 3 : 0)
+        + (m_layout.normals ? 3 * sizeof(float) : 0)
+        + (m_layout.intensities ? sizeof(float) : 0);
+
+    m_buffer.resize(b.n * recordSize);
+
+    #pragma omp parallel for
+    for (long i = 0; i < (long)b.n; i++)
+    {
+        char* ptr = m_buffer.data() + i * recordSize;
+
+        std::memcpy(ptr, b.points.get() + 3 * i, 3 * sizeof(float));
+        ptr += 3 * sizeof(float);
+
+        if (m_layout.colors)
+        {
+            std::memcpy(ptr, b.colors.get() + b.colorWidth * i, 3);
+            ptr += 3;
+        }
+        if (m_layout.normals)
+        {
+            std::memcpy(ptr, b.normals.get() + 3 * i, 3 * sizeof(float));
+            ptr += 3 * sizeof(float);
+        }
+        if (m_layout.intensities)
+        {
+            std::memcpy(ptr, b.intensities.get() + i, sizeof(float));
+        }
+    }
+
+    m_out.write(m_buffer.data(), m_buffer.size());
+    m_numPoints += b.n;
+}
+
+void PLYPointCloudWriter::close()
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    m_out.seekp(m_countPos);
+    m_out << m_numPoints;
+    m_out.close();
+
+    m_buffer.clear();
+    m_buffer.shrink_to_fit();
+    m_open = false;
+}
+
+/****************************************************************************
+ * LAS
+ ***************************************************************************/
+
+LasPointCloudWriter::LasPointCloudWriter()
+    : m_writer(nullptr)
+{
+
+}
+
+LasPointCloudWriter::~LasPointCloudWriter()
+{
+    close();
+}
+
+bool LasPointCloudWriter::open(const std::string& filename, const PointCloudLayout& layout)
+{
+    close();
+
+    // The writer is created with the first batch, since the offset of the
+    // coordinates is derived from the data
+    m_filename = filename;
+    m_layout = layout;
+    m_numPoints = 0;
+    m_open = true;
+    return true;
+}
+
+void LasPointCloudWriter::append(PointBufferPtr batch)
+{
+    if (!m_open || !batch || !batch->numPoints())
+    {
+        return;
+    }
+
+    BatchData b(m_layout, batch);
+
+    if (!m_writer)
+    {
+        m_header.reset(new LASheader);
+        m_header->x_scale_factor = 0.001;
+        m_header->y_scale_factor = 0.001;
+        m_header->z_scale_factor = 0.001;
+        m_header->x_offset = std::round(b.points[0]);
+        m_header->y_offset = std::round(b.points[1]);
+        m_header->z_offset = std::round(b.points[2]);
+        m_header->point_data_format = m_layout.colors ? 2 : 0;
+        m_header->point_data_record_length = m_layout.colors ? 26 : 20;
+
+        LASwriteOpener opener;
+        opener.set_file_name(m_filename.c_str());
+        m_writer = opener.open(m_header.get());
+        if (!m_writer)
+        {
+            std::cout << timestamp << "LasPointCloudWriter: Unable to open '" << m_filename << "'." << std::endl;
+            m_open = false;
+            return;
+        }
+
+        m_point.reset(new LASpoint);
+        m_point->init(m_header.get(), m_header->point_data_format, m_header->point_data_record_length, 0);
+    }
+
+    for (size_t i = 0; i < b.n; i++)
+    {
+        m_point->set_x(b.points[3 * i]);
+        m_point->set_y(b.points[3 * i + 1]);
+        m_point->set_z(b.points[3 * i + 2]);
+
+        if (m_layout.colors)
+        {
+            // Scale 8 bit to 16 bit colors
+            for (size_t k = 0; k < 3; k++)
+            {
+                m_point->rgb[k] = b.colors[b.colorWidth * i + k] * 257;
+            }
+        }
+        if (m_layout.intensities)
+        {
+            m_point->intensity = static_cast<U16>(
+                std::min(std::max(b.intensities[i], 0.0f), 65535.0f));
+        }
+
+        m_writer->write_point(m_point.get());
+        m_writer->update_inventory(m_point.get());
+    }
+    m_numPoints += b.n;
+}
+
+void LasPointCloudWriter::close()
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    if (!m_writer)
+    {
+        // Nothing was appended. Create an empty file.
+        m_header.reset(new LASheader);
+        m_header->point_data_format = m_layout.colors ? 2 : 0;
+        m_header->point_data_record_length = m_layout.colors ? 26 : 20;
+
+        LASwriteOpener opener;
+        opener.set_file_name(m_filename.c_str());
+        m_writer = opener.open(m_header.get());
+    }
+
+    if (m_writer)
+    {
+        m_writer->update_header(m_header.get(), TRUE);
+        m_writer->close();
+        delete m_writer;
+        m_writer = nullptr;
+    }
+
+    m_point.reset();
+    m_header.reset();
+    m_open = false;
+}
+
+/****************************************************************************
+ * HDF5
+ ***************************************************************************/
+
+HDF5PointCloudWriter::~HDF5PointCloudWriter()
+{
+    close();
+}
+
+template<typename T>
+std::unique_ptr<HighFive::DataSet> HDF5PointCloudWriter::createDataSet(const std::string& name, size_t width)
+{
+    HighFive::DataSpace space({0, width}, {HighFive::DataSpace::UNLIMITED, width});
+    // The dataset grows, so the chunk shape is given explicitly
+    HighFive::DataSetCreateProps properties = m_compression.properties<T>(
+        {m_chunkSize, width}, {m_chunkSize, width});
+
+    return std::unique_ptr<HighFive::DataSet>(
+        new HighFive::DataSet(m_group->createDataSet<T>(name, space, properties)));
+}
+
+template<typename T>
+void HDF5PointCloudWriter::appendRows(HighFive::DataSet& dataset, size_t width, const T* data, size_t n)
+{
+    dataset.resize({m_numPoints + n, width});
+    dataset.select({m_numPoints, 0}, {n, width}).write(data);
+}
+
+bool HDF5PointCloudWriter::open(const std::string& filename, const PointCloudLayout& layout)
+{
+    close();
+
+    try
+    {
+        m_file.reset(new HighFive::File(filename,
+            HighFive::File::ReadWrite | HighFive::File::Create | HighFive::File::Truncate));
+
+        HighFive::Group raw = m_file->createGroup("raw");
+        HighFive::Group scans = raw.createGroup("scans");
+        m_group.reset(new HighFive::Group(scans.createGroup("position_00000")));
+
+        m_layout = layout;
+        m_points = createDataSet<float>("points", 3);
+        if (m_layout.colors)
+        {
+            m_colors = createDataSet<unsigned char>("colors", 3);
+        }
+        if (m_layout.normals)
+        {
+            m_normals = createDataSet<float>("normals", 3);
+        }
+        if (m_layout.intensities)
+        {
+            m_intensities = createDataSet<float>("intensities", 1);
+        }
+    }
+    catch (HighFive::Exception& e)
+    {
+        std::cout << timestamp << "HDF5PointCloudWriter: Unable to open '" << filename
+                  << "': " << e.what() << std::endl;
+        m_points.reset();
+        m_colors.reset();
+        m_normals.reset();
+        m_intensities.reset();
+        m_group.reset();
+        m_file.reset();
+        return false;
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        m_bb[i] = std::numeric_limits<float>::max();
+        m_bb[i + 3] = std::numeric_limits<float>::lowest();
+    }
+
+    m_numPoints = 0;
+    m_open = true;
+    return true;
+}
+
+void HDF5PointCloudWriter::append(PointBufferPtr batch)
+{
+    if (!m_open || !batch || !batch->numPoints())
+    {
+        return;
+    }
+
+    BatchData b(m_layout, batch);
+
+    appendRows(*m_points, 3, b.points.get(), b.n);
+    if (m_colors)
+    {
+        if (b.colorWidth != 3)
+        {
+            ucharArr rgb(new unsigned char[3 * b.n]);
+            for (size_t i = 0; i < b.n; i++)
+            {
+                std::copy_n(b.colors.get() + b.colorWidth * i, 3, rgb.get() + 3 * i);
+            }
+            b.colors = rgb;
+        }
+        appendRows(*m_colors, 3, b.colors.get(), b.n);
+    }
+    if (m_normals)
+    {
+        appendRows(*m_normals, 3, b.normals.get(), b.n);
+    }
+    if (m_intensities)
+    {
+        appendRows(*m_intensities, 1, b.intensities.get(), b.n);
+    }
+
+    for (size_t i = 0; i < b.n; i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            m_bb[k] = std::min(m_bb[k], b.points[3 * i + k]);
+            m_bb[k + 3] = std::max(m_bb[k + 3], b.points[3 * i + k]);
+        }
+    }
+
+    m_numPoints += b.n;
+}
+
+void HDF5PointCloudWriter::close()
+{
+    if (!m_open)
+    {
+        return;
+    }
+
+    // Meta data of the scan as written by HDF5IO::addRawScan()
+    std::vector<float> identity(16, 0.0f);
+    for (int i = 0; i < 4; i++)
+    {
+        identity[5 * i] = 1.0f;
+    }
+    std::vector<float> fov(2, 0.0f);
+    std::vector<float> res(2, 0.0f);
+
+    if (!m_numPoints)
+    {
+        std::fill_n(m_bb, 6, 0.0f);
+    }
+
+    try
+    {
+        const float* ptr = fov.data();
+        m_group->createDataSet<float>("fov", HighFive::DataSpace(2)).write(ptr);
+        ptr = res.data();
+        m_group->createDataSet<float>("resolution", HighFive::DataSpace(2)).write(ptr);
+        ptr = identity.data();
+        m_group->createDataSet<float>("initialPose", HighFive::DataSpace({4, 4})).write(ptr);
+        m_group->createDataSet<float>("finalPose", HighFive::DataSpace({4, 4})).write(ptr);
+        ptr = m_bb;
+        m_group->createDataSet<float>("boundingBox", HighFive::DataSpace(6)).write(ptr);
+        m_file->flush();
+    }
+    catch (HighFive::Exception& e)
+    {
+        std::cout << timestamp << "HDF5PointCloudWriter: Unable to write meta data: "
+                  << e.what() << std::endl;
+    }
+
+    m_points.reset();
+    m_colors.reset();
+    m_normals.reset();
+    m_intensities.reset();
+    m_group.reset();
+    m_file.reset();
+    m_open = false;
+}
+
+} // namespace lvr2
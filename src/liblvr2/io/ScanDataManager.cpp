@@ -16,6 +16,84 @@ void ScanDataManager::loadPointCloudData(ScanPtr& sd, bool preview)
     }
 }
 
+void ScanDataManager::loadPointCloudPreview(ScanPtr& sd, size_t level)
+{
+    std::vector<size_t> levels = m_io.getPreviewLevels(sd->positionNumber);
+    if (level >= levels.size())
+    {
+        loadPointCloudData(sd, false);
+        return;
+    }
+
+    // Points of the preview that are already in memory
+    size_t numLoaded = 0;
+    if (!sd->pointsLoaded && sd->points)
+    {
+        numLoaded = sd->points->numPoints();
+    }
+
+    size_t numPoints = levels[level];
+    if (numLoaded == numPoints)
+    {
+        return;
+    }
+
+    PointBufferPtr added;
+    if (numLoaded < numPoints)
+    {
+        added = m_io.getPreviewPoints(sd->positionNumber, numLoaded, numPoints);
+        if (!added)
+        {
+            return;
+        }
+        numPoints = numLoaded + added->numPoints();
+    }
+
+    // Keep the loaded prefix and append the missing part of the pyramid
+    floatArr points(new float[numPoints * 3]);
+    size_t numKept = std::min(numLoaded, numPoints);
+    if (numKept)
+    {
+        std::copy(sd->points->getPointArray().get(), sd->points->getPointArray().get() + numKept * 3, points.get());
+    }
+    if (added)
+    {
+        std::copy(added->getPointArray().get(), added->getPointArray().get() + added->numPoints() * 3, points.get() + numKept * 3);
+    }
+    PointBufferPtr buffer(new PointBuffer(points, numPoints));
+
+    // Same for the spectral channels
+    size_t n, width = 0;
+    ucharArr spectral = (added ? added : sd->points)->getUCharArray("spectral_channels", n, width);
+    if (spectral)
+    {
+        ucharArr channels(new unsigned char[numPoints * width]);
+        std::fill(channels.get(), channels.get() + numPoints * width, 0);
+
+        size_t oldWidth = 0;
+        ucharArr old = numKept ? sd->points->getUCharArray("spectral_channels", n, oldWidth) : ucharArr();
+        if (old && oldWidth == width)
+        {
+            std::copy(old.get(), old.get() + numKept * width, channels.get());
+        }
+        if (added)
+        {
+            std::copy(spectral.get(), spectral.get() + added->numPoints() * width, channels.get() + numKept * width);
+        }
+        buffer->addUCharChannel(channels, "spectral_channels", numPoints, width);
+        buffer->addIntAtomic(400, "spectral_wavelength_min");
+        buffer->addIntAtomic(400 + 4 * width, "spectral_wavelength_max");
+    }
+
+    sd->points = buffer;
+    sd->pointsLoaded = false;
+}
+
+size_t ScanDataManager::numPreviewLevels(ScanPtr& sd)
+{
+    return m_io.getPreviewLevels(sd->positionNumber).size();
+}
+
 std::vector<ScanPtr> ScanDataManager::getScans()
 {
     return m_io.getRawScans(false);
@@ -5,6 +5,7 @@
 #include "lvr2/io/ScanDirectoryParser.hpp"
 #include "lvr2/io/IOUtils.hpp"
 #include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/io/PointCloudWriter.hpp"
 #include "lvr2/registration/OctreeReduction.hpp"
 
 using namespace boost::filesystem;
@@ -12,6 +13,36 @@ using namespace boost::filesystem;
 namespace lvr2
 {
 
+namespace
+{
+
+/**
+ * @brief Transforms the points of a scan with its pose and appends them to
+ *        the "<scan>_reduced.ply" file of the scan, which is opened with the
+ *        layout of the first batch. Returns false if it can't be created.
+ */
+bool appendToReducedFile(PointBufferPtr batch, const ScanInfo& scan, PointCloudWriterPtr& writer)
+{
+    if(!writer)
+    {
+        std::string name = boost::filesystem::path(scan.m_filename).stem().string() + "_reduced.ply";
+        std::cout << timestamp << "Saving data to " << name << std::endl;
+        writer = ModelFactory::openPointCloudWriter(name, PointCloudLayout(*batch));
+        if(!writer)
+        {
+            std::cout << timestamp << "Unable to create " << name << std::endl;
+            return false;
+        }
+    }
+
+    ModelPtr model(new Model(batch));
+    transformPointCloud<double>(model, scan.m_pose);
+    writer->append(batch);
+    return true;
+}
+
+} // anonymous namespace
+
 ScanDirectoryParser::ScanDirectoryParser(const std::string& directory) noexcept
 {
     // Check if directory exists and save path
@@ -76,10 +107,9 @@ size_t ScanDirectoryParser::examineASCII(const std::string& filename)
 
 PointBufferPtr ScanDirectoryParser::octreeSubSample(const double& voxelSize, const size_t& minPoints)
 {
-    ModelPtr out_model(new Model);
-
     for(auto i : m_scans)
     {
+        // The octree needs all points of the scan
         std::cout << timestamp << "Reading " << i.m_filename << std::endl;
         ModelPtr model = ModelFactory::readModel(i.m_filename);
         if(model)
@@ -91,19 +121,12 @@ PointBufferPtr ScanDirectoryParser::octreeSubSample(const double& voxelSize, con
                 OctreeReduction oct(buffer, voxelSize, 5);
                 PointBufferPtr reduced = oct.getReducedPoints();
 
-                // Apply transformation
-                std::cout << timestamp << "Transforming reduced point cloud" << std::endl;
-                out_model->m_pointCloud = reduced;
-                transformPointCloud<double>(out_model, i.m_pose);
-
-                // Write reduced data
-                std::stringstream name_stream;
-                Path p(i.m_filename);
-                name_stream << p.stem().string() << "_reduced" << ".ply";
-                std::cout << timestamp << "Saving data to " << name_stream.str() << std::endl;
-                ModelFactory::saveModel(out_model, name_stream.str());
-
-                std::cout << timestamp << "Points written: " << reduced->numPoints() << std::endl;
+                PointCloudWriterPtr writer;
+                if(appendToReducedFile(reduced, i, writer))
+                {
+                    writer->close();
+                    std::cout << timestamp << "Points written: " << reduced->numPoints() << std::endl;
+                }
             }
         }
     }
@@ -112,59 +135,72 @@ PointBufferPtr ScanDirectoryParser::octreeSubSample(const double& voxelSize, con
 
 PointBufferPtr ScanDirectoryParser::randomSubSample(const size_t& tz)
 {
-    ModelPtr out_model(new Model);
-
-    // Compute global reduction ratio and clamp
     size_t actual_points = 0;
 
     for(auto i : m_scans)
     {
-        ModelPtr model = ModelFactory::readModel(i.m_filename);
-        if(model)
+        // Each scan contributes according to its share of all points
+        size_t target_size = 0;
+        if(tz > 0 && m_numPoints > 0)
         {
-            PointBufferPtr buffer = model->m_pointCloud;
-            if(buffer)
-            {
-                PointBufferPtr reduced = 0;
-                int target_size = 0;
-                if(tz > 0)
-                {
-                    // Calc number of points to sample
-                    float total_ratio = (float)i.m_numPoints / m_numPoints;
-                    float target_ratio = total_ratio * tz;
-
+            target_size = (size_t)((float)i.m_numPoints / m_numPoints * tz + 0.5);
+            std::cout << timestamp << "Sampling " << target_size << " points from " << i.m_filename << std::endl;
+        }
+        else
+        {
+            std::cout << timestamp << "Using orignal points from " << i.m_filename << std::endl;
+        }
 
-                    target_size = (int)(target_ratio + 0.5);
-                    std::cout << timestamp << "Sampling " << target_size << " points from " << i.m_filename << std::endl;
+        // Sample every batch in proportion to its size, so only one batch
+        // of the scan is held in memory
+        PointCloudWriterPtr writer;
+        bool failed = false;
+        size_t read = 0;
+        size_t sampled = 0;
+        auto reduceAndAppend = [&](PointBufferPtr batch)
+        {
+            if(failed)
+            {
+                return;
+            }
 
-                    // Sub-sample buffer
-                    reduced = subSamplePointBuffer(buffer, target_size);
+            if(tz > 0)
+            {
+                read += batch->numPoints();
+                size_t expected = target_size * read / std::max(read, i.m_numPoints);
+                size_t n = std::min(expected - std::min(expected, sampled), batch->numPoints());
+                if(n == 0)
+                {
+                    return;
                 }
-                else
+                if(n < batch->numPoints())
                 {
-                    std::cout << timestamp << "Using orignal points from " << i.m_filename << std::endl;
-                    reduced = buffer;
-                    target_size = buffer->numPoints();
+                    batch = subSamplePointBuffer(batch, n);
                 }
+                sampled += n;
+            }
 
-                // Apply transformation
-                std::cout << timestamp << "Transforming point cloud" << std::endl;
-                out_model->m_pointCloud = reduced;
-                transformPointCloud<double>(out_model, i.m_pose);
-
-                // Write reduced data
-                std::stringstream name_stream;
-                Path p(i.m_filename);
-                name_stream << p.stem().string() << "_reduced" << ".ply";
-                std::cout << timestamp << "Saving data to " << name_stream.str() << std::endl;
-                ModelFactory::saveModel(out_model, name_stream.str());
+            failed = !appendToReducedFile(batch, i, writer);
+        };
 
-                actual_points += target_size;
-                std::cout << timestamp << "Points written: " << actual_points << " / " << tz << std::endl;
+        if(!ModelFactory::readPointCloudBatches(i.m_filename, 1 << 22, reduceAndAppend))
+        {
+            // Formats that can't be streamed are read as a whole
+            ModelPtr model = ModelFactory::readModel(i.m_filename);
+            if(model && model->m_pointCloud)
+            {
+                reduceAndAppend(model->m_pointCloud);
             }
         }
+
+        if(writer)
+        {
+            writer->close();
+            actual_points += writer->numPoints();
+            std::cout << timestamp << "Points written: " << actual_points << " / " << tz << std::endl;
+        }
     }
-    return out_model->m_pointCloud;
+    return PointBufferPtr(new PointBuffer);
 }
 
 void ScanDirectoryParser::parseDirectory()
@@ -186,7 +186,8 @@ bool loadScanImage(
 
 void loadScanImages(
     std::vector<ScanImagePtr>& images,
-    boost::filesystem::path dataPath)
+    boost::filesystem::path dataPath,
+    bool loadData)
 {
     bool stop = false;
     size_t c = 0;
@@ -215,9 +216,11 @@ void loadScanImages(
             if(YAML::convert<ScanImage>::decode(meta, *image))
             {
                 // Load image data
-                std::cout << timestamp << "Loading " << pngPath << std::endl;
                 image->imageFile = pngPath;
-                image->image = cv::imread(pngPath.string());
+                if(loadData)
+                {
+                    loadScanImageData(*image);
+                }
 
                 // Store new image
                 images.push_back(ScanImagePtr(image));
@@ -236,6 +239,23 @@ void loadScanImages(
     }
 }
 
+bool loadScanImageData(ScanImage& image)
+{
+    if(!image.image.empty())
+    {
+        return true;
+    }
+
+    if(image.imageFile.empty())
+    {
+        return false;
+    }
+
+    std::cout << timestamp << "Loading " << image.imageFile << std::endl;
+    image.image = cv::imread(image.imageFile.string());
+    return !image.image.empty();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 /// SCANCAMERA
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -320,19 +340,21 @@ bool loadScanCamera(
     const boost::filesystem::path& root,
     ScanCamera& camera,
     const std::string& positionDirectory,
-    const size_t& cameraNumber)
+    const size_t& cameraNumber,
+    bool loadData)
 {
     std::stringstream camStr;
     camStr << std::setfill('0') << std::setw(8) << cameraNumber;
 
-    return loadScanCamera(root, camera, positionDirectory, camStr.str());
+    return loadScanCamera(root, camera, positionDirectory, camStr.str(), loadData);
 }
 
 bool loadScanCamera(
     const boost::filesystem::path& root,
     ScanCamera& camera,
     const size_t& positionNumber,
-    const size_t& cameraNumber)
+    const size_t& cameraNumber,
+    bool loadData)
 {
     std::stringstream posStr;
     posStr << std::setfill('0') << std::setw(8) << positionNumber;
@@ -340,14 +362,15 @@ bool loadScanCamera(
     std::stringstream camStr;
     camStr << std::setfill('0') << std::setw(8) << cameraNumber;
 
-    return loadScanCamera(root, camera, posStr.str(), camStr.str());
+    return loadScanCamera(root, camera, posStr.str(), camStr.str(), loadData);
 }
 
 bool loadScanCamera(
     const boost::filesystem::path& root,
     ScanCamera& camera,
     const std::string& positionDirectory,
-    const std::string& cameraDirectory)
+    const std::string& cameraDirectory,
+    bool loadData)
 {
     boost::filesystem::path cameraPath =
         getScanCameraDirectory(root, positionDirectory, cameraDirectory);
@@ -363,7 +386,7 @@ bool loadScanCamera(
         camera = meta.as<ScanCamera>();
 
         // Load all scan images
-        loadScanImages(camera.images, cameraPath / "data");
+        loadScanImages(camera.images, cameraPath / "data", loadData);
         return true;
     }
     else
@@ -489,7 +512,8 @@ bool loadScan(
     Scan& scan,
     const std::string& positionDirectory,
     const std::string& scanSubDirectory,
-    const std::string& scanName)
+    const std::string& scanName,
+    bool loadData)
 {
 
     boost::filesystem::path scanDirectoryPath = root / positionDirectory / scanSubDirectory;
@@ -511,27 +535,47 @@ bool loadScan(
         std::cout << timestamp << "Loading " << metaPath << std::endl;
         YAML::Node meta = YAML::LoadFile(metaPath.string());
         scan = meta.as<Scan>();
+        scan.scanRoot = scanDirectoryPath;
+        scan.scanFile = scanDataPath / (scanName + ".ply");
+        scan.pointsLoaded = false;
 
         // Load scan
-        boost::filesystem::path scanFile = scanDataPath / (scanName + ".ply");
-        std::cout << timestamp << "Loading " << scanFile << std::endl;
-        ModelPtr model = ModelFactory::readModel(scanFile.string());
-
-        if(model->m_pointCloud)
+        if(loadData)
         {
-            scan.points = model->m_pointCloud;
-        }
-        else
-        {
-            std::cout << timestamp
-                      << "Warning: Loading " << scanFile << " failed." << std::endl;
-            return false;
+            return loadScanData(scan);
         }
 
+        return true;
+    }
+
+    return false;
+}
+
+bool loadScanData(Scan& scan)
+{
+    if(scan.pointsLoaded && scan.points)
+    {
+        return true;
+    }
+
+    if(scan.scanFile.empty())
+    {
+        return false;
+    }
+
+    std::cout << timestamp << "Loading " << scan.scanFile << std::endl;
+    ModelPtr model = ModelFactory::readModel(scan.scanFile.string());
 
+    if(model && model->m_pointCloud)
+    {
+        scan.points = model->m_pointCloud;
+        scan.numPoints = scan.points->numPoints();
+        scan.pointsLoaded = true;
         return true;
     }
 
+    std::cout << timestamp
+              << "Warning: Loading " << scan.scanFile << " failed." << std::endl;
     return false;
 }
 
@@ -551,7 +595,8 @@ bool loadScan(
     const boost::filesystem::path& root,
     Scan& scan,
     const size_t& positionNumber,
-    const size_t& scanNumber)
+    const size_t& scanNumber,
+    bool loadData)
 {
     std::stringstream posStr;
     posStr << std::setfill('0') << std::setw(8) << positionNumber;
@@ -559,7 +604,7 @@ bool loadScan(
     std::stringstream scanStr;
     scanStr << std::setfill('0') << std::setw(8) << scanNumber;
 
-    return loadScan(root, scan, posStr.str(), "scans", scanStr.str());
+    return loadScan(root, scan, posStr.str(), "scans", scanStr.str(), loadData);
 }
 
 
@@ -951,7 +996,8 @@ void saveScanPosition(
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const std::string& positionDirectory)
+    const std::string& positionDirectory,
+    bool loadData)
 {
 
     boost::filesystem::path scanPosDir = root / positionDirectory;
@@ -991,7 +1037,7 @@ bool loadScanPosition(
                     std::string scanName = itScans->path().stem().string();
                     ScanPtr scan(new Scan);
 
-                    if(loadScan(root, *scan, positionDirectory, it->path().stem().string(), scanName))
+                    if(loadScan(root, *scan, positionDirectory, it->path().stem().string(), scanName, loadData))
                     {
                         scanPos.scans.push_back(scan);
                     }
@@ -1003,7 +1049,7 @@ bool loadScanPosition(
         {
             ScanCameraPtr cam(new ScanCamera);
 
-            if(loadScanCamera(root, *cam, positionDirectory, it->path().stem().string()))
+            if(loadScanCamera(root, *cam, positionDirectory, it->path().stem().string(), loadData))
             {
                 scanPos.cams.push_back(cam);
             } else {
@@ -1032,11 +1078,59 @@ bool loadScanPosition(
 bool loadScanPosition(
     const boost::filesystem::path& root,
     ScanPosition& scanPos,
-    const size_t& positionNumber)
+    const size_t& positionNumber,
+    bool loadData)
 {
     std::stringstream posStr;
     posStr << std::setfill('0') << std::setw(8) << positionNumber;
-    return loadScanPosition(root, scanPos, posStr.str());
+    return loadScanPosition(root, scanPos, posStr.str(), loadData);
+}
+
+/**
+ * @brief Loads the payload of the given scans and images. Decoding
+ *        dominates, so all files are loaded concurrently.
+ */
+static bool loadPayload(
+    const std::vector<ScanPtr>& scans,
+    const std::vector<ScanImagePtr>& images,
+    bool parallel)
+{
+    bool ok = true;
+
+    #pragma omp parallel for schedule(dynamic) reduction(&& : ok) if(parallel)
+    for(size_t i = 0; i < scans.size() + images.size(); i++)
+    {
+        if(i < scans.size())
+        {
+            ok = loadScanData(*scans[i]) && ok;
+        }
+        else
+        {
+            ok = loadScanImageData(*images[i - scans.size()]) && ok;
+        }
+    }
+
+    return ok;
+}
+
+static void collectPayload(
+    const ScanPosition& scanPos,
+    std::vector<ScanPtr>& scans,
+    std::vector<ScanImagePtr>& images)
+{
+    scans.insert(scans.end(), scanPos.scans.begin(), scanPos.scans.end());
+    for(ScanCameraPtr cam : scanPos.cams)
+    {
+        images.insert(images.end(), cam->images.begin(), cam->images.end());
+    }
+}
+
+bool loadScanPositionData(ScanPosition& scanPos, bool parallel)
+{
+    std::vector<ScanPtr> scans;
+    std::vector<ScanImagePtr> images;
+    collectPayload(scanPos, scans, images);
+    return loadPayload(scans, images, parallel);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -1074,7 +1168,7 @@ void saveScanProject(
     // Writing scan positions
     for(size_t i=0; i<scanProj.positions.size(); i++)
     {
-        saveScanPosition(root, *scanProj.positions[0], i);
+        saveScanPosition(root, *scanProj.positions[i], i);
     }
 
 
@@ -1082,7 +1176,8 @@ void saveScanProject(
 
 bool loadScanProject(
     const boost::filesystem::path& root,
-    ScanProject& scanProj)
+    ScanProject& scanProj,
+    bool loadData)
 {
     if(!boost::filesystem::exists(root))
     {
@@ -1105,24 +1200,49 @@ bool loadScanProject(
 
     std::copy(boost::filesystem::directory_iterator(root), boost::filesystem::directory_iterator(), back_inserter(paths));
     std::sort(paths.begin(), paths.end());
-    // boost::filesystem::directory_iterator it{root};
-    for (std::vector<boost::filesystem::path>::const_iterator it(paths.begin()), it_end(paths.end()); it != it_end; ++it)
+
+    // Positions are independent, so their meta data is read in parallel.
+    // The slots keep the directory order.
+    std::vector<ScanPositionPtr> positions(paths.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for(size_t i = 0; i < paths.size(); i++)
     {
-        if(getSensorType(*it) == ScanPosition::sensorType)
+        if(getSensorType(paths[i]) == ScanPosition::sensorType)
         {
-            std::cout << *it << '\n';
             ScanPositionPtr scanPos(new ScanPosition);
+            loadScanPosition(root, *scanPos, paths[i].filename().string(), false);
+            positions[i] = scanPos;
+        }
+    }
 
-            loadScanPosition(root, *scanPos, it->filename().string());
+    for(ScanPositionPtr scanPos : positions)
+    {
+        if(scanPos)
+        {
             scanProj.positions.push_back(scanPos);
         }
+    }
 
-        // ++it;
+    if(loadData)
+    {
+        loadScanProjectData(scanProj);
     }
 
     return true;
 }
 
+bool loadScanProjectData(ScanProject& scanProj, bool parallel)
+{
+    std::vector<ScanPtr> scans;
+    std::vector<ScanImagePtr> images;
+    for(ScanPositionPtr scanPos : scanProj.positions)
+    {
+        collectPayload(*scanPos, scans, images);
+    }
+    return loadPayload(scans, images, parallel);
+}
+
 
 
 
@@ -32,6 +32,7 @@
  *  @author Thomas Wiemann
  */
 
+#include <algorithm>
 #include <list>
 #include <vector>
 #include <string>
@@ -47,8 +48,10 @@ using std::ifstream;
 using std::stringstream;
 
 #include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "lvr2/io/UosIO.hpp"
+#include "lvr2/io/AsciiParser.hpp"
 #include "lvr2/io/Progress.hpp"
 #include "lvr2/io/Timestamp.hpp"
 
@@ -198,302 +201,291 @@ void UosIO::reduce(string dir, string target, int reduction)
 }
 
 
-void UosIO::readNewFormat(ModelPtr &model, string dir, int first, int last, size_t &n)
+Matrix4<Vec> UosIO::readScanTransform(string dir, int scan)
 {
-    list<Vec > allPoints;
-    list<BaseVector<int> > allColors;
+    // Try to get transformation from .frames file
+    boost::filesystem::path frame_path(
+            boost::filesystem::path(dir) /
+            boost::filesystem::path( "scan" + to_string( scan, 3 ) + ".frames" ) );
 
-    size_t point_counter = 0;
+    ifstream frame_in(frame_path.string().c_str());
+    if(frame_in.good())
+    {
+        // Use transformation from .frame files
+        return parseFrameFile(frame_in);
+    }
 
-    vector<indexPair> sub_clouds;
+    // Try to parse .pose file
+    boost::filesystem::path pose_path(
+            boost::filesystem::path(dir) /
+            boost::filesystem::path( "scan" + to_string( scan, 3 ) + ".pose" ) );
 
-    // Count points in all given files
-    size_t numPointsTotal = 0;
-    for(int fileCounter = first; fileCounter <= last; fileCounter++)
+    ifstream pose_in(pose_path.string().c_str());
+    if(pose_in.good())
     {
-        // Create scan file name
-        boost::filesystem::path scan_path(
-                boost::filesystem::path(dir) /
-                boost::filesystem::path( "scan" + to_string( fileCounter, 3 ) + ".3d" ) );
-        string scanFileName = "/" + scan_path.relative_path().string();
+        float euler[6];
+        for(int i = 0; i < 6; i++) pose_in >> euler[i];
 
-        // Count lines in scan
-        numPointsTotal += AsciiIO::countLines(scanFileName);
+        euler[3] *= 0.017453293;
+        euler[4] *= 0.017453293;
+        euler[5] *= 0.017453293;
+
+        Vec position(euler[0], euler[1], euler[2]);
+        Vec angle(euler[3], euler[4], euler[5]);
+
+        return Matrix4<Vec>(position, angle);
     }
 
-    // Calculate the number of points to skip when writing to disk
-    size_t skipPoints = 1;
+    cout << timestamp << "UOS Reader: Warning: No position information found for scan "
+         << scan << "." << endl;
+    return Matrix4<Vec>();
+}
 
-    if(m_reductionTarget > 1)
+size_t UosIO::parseNewFormatScan(
+        const UosScanFile& scan,
+        float* points,
+        unsigned char* colors,
+        float* intensities)
+{
+    boost::iostreams::mapped_file_source file;
+    try
     {
-        skipPoints = (int)numPointsTotal / m_reductionTarget;
+        file.open(scan.fileName);
+    }
+    catch(std::exception& e)
+    {
+        cout << timestamp << "UOS Reader: Unable to read scan " << scan.fileName << endl;
+        return 0;
     }
 
-    if(m_saveToDisk)
+    // Skip first line in scan file (maybe metadata)
+    const char* end = file.data() + file.size();
+    const char* begin = AsciiParser::skipLines(file.data(), end, 1);
+
+    std::vector<AsciiColumn> columns = {
+        { 0, AsciiColumn::FLOAT, reinterpret_cast<char*>(points),     3 * sizeof(float) },
+        { 1, AsciiColumn::FLOAT, reinterpret_cast<char*>(points + 1), 3 * sizeof(float) },
+        { 2, AsciiColumn::FLOAT, reinterpret_cast<char*>(points + 2), 3 * sizeof(float) }
+    };
+
+    // Colors follow the remission value if both are present
+    if(colors && scan.hasColor)
     {
-        cout << timestamp << "Reduction mode. Writing every " << skipPoints << "th point." << endl;
+        int c = scan.hasIntensity ? 4 : 3;
+        columns.push_back({ c,     AsciiColumn::UCHAR, reinterpret_cast<char*>(colors),     3 });
+        columns.push_back({ c + 1, AsciiColumn::UCHAR, reinterpret_cast<char*>(colors + 1), 3 });
+        columns.push_back({ c + 2, AsciiColumn::UCHAR, reinterpret_cast<char*>(colors + 2), 3 });
     }
 
-    for(int fileCounter = first; fileCounter <= last; fileCounter++)
+    if(intensities && scan.hasIntensity)
+    {
+        columns.push_back({ 3, AsciiColumn::FLOAT, reinterpret_cast<char*>(intensities), sizeof(float) });
+    }
+
+    size_t numPoints = std::min(AsciiParser::parse(begin, end, columns), scan.numPoints);
+
+    // Transform scan points with the pose of the scan while they are in cache
+    for(size_t i = 0; i < numPoints; i++)
     {
-        // New (unit) transformation matrix
-        Matrix4<Vec> tf;
+        Vec v(points[3 * i], points[3 * i + 1], points[3 * i + 2]);
+        v = scan.transform * v;
+        points[3 * i    ] = v[0];
+        points[3 * i + 1] = v[1];
+        points[3 * i + 2] = v[2];
+    }
 
-        // Input file streams for scan data, poses and frames
-        ifstream scan_in, pose_in, frame_in;
+    return numPoints;
+}
 
-        // Create scan file name
+void UosIO::readNewFormat(ModelPtr &model, string dir, int first, int last, size_t &n)
+{
+    // Collect the scans of the requested range. Files outside of the range
+    // are never opened.
+    vector<UosScanFile> scans;
+    for(int fileCounter = first; fileCounter <= last; fileCounter++)
+    {
         boost::filesystem::path scan_path(
                 boost::filesystem::path(dir) /
                 boost::filesystem::path( "scan" + to_string( fileCounter, 3 ) + ".3d" ) );
-        string scanFileName = scan_path.string();
-
-        // Count lines in scan
-        size_t points_in_file = AsciiIO::countLines(scanFileName);
 
-        int num_attributes = AsciiIO::getEntriesInLine(scanFileName) - 3;
-        bool has_color = (num_attributes == 3) || (num_attributes == 4);
-        bool has_intensity = (num_attributes == 1) || (num_attributes == 4);
-
-        if(has_color)
+        if(boost::filesystem::exists(scan_path))
         {
-            cout << timestamp << "Reading color information." << endl;
+            UosScanFile scan;
+            scan.number = fileCounter;
+            scan.fileName = scan_path.string();
+            scans.push_back(scan);
         }
-
-        if(has_intensity)
+        else
         {
-            cout << timestamp << "Reading intensity information." << endl;
+            cout << timestamp << "UOS Reader: Unable to read scan " << scan_path.string() << endl;
         }
+    }
 
-        // Read scan data
-        scan_in.open(scanFileName.c_str());
-        if(!scan_in.good())
+    // Count points, detect attributes and parse poses of all scans
+    #pragma omp parallel for schedule(dynamic)
+    for(long i = 0; i < (long)scans.size(); i++)
+    {
+        UosScanFile& scan = scans[i];
+
+        // Count exactly the lines parseNewFormatScan() will parse, i.e. with
+        // AsciiParser on the mapped file after skipping the first line
+        scan.numPoints = 0;
+        try
         {
-            // Continue with next file if the expected file couldn't be read
-            cout << timestamp << "UOS Reader: Unable to read scan " << scanFileName << endl;
-            scan_in.close();
-            scan_in.clear();
-            continue;
+            boost::iostreams::mapped_file_source file(scan.fileName);
+            const char* end = file.data() + file.size();
+            const char* begin = AsciiParser::skipLines(file.data(), end, 1);
+            scan.numPoints = AsciiParser::countLines(begin, end);
         }
-        else
+        catch(std::exception& e)
         {
-            // Tmp list of read points
-            list<Vec > tmp_points;
-
-
-            // Try to get fransformation from .frames file
-            boost::filesystem::path frame_path(
-                    boost::filesystem::path(dir) /
-                    boost::filesystem::path( "scan" + to_string( fileCounter, 3 ) + ".frames" ) );
-            string frameFileName = frame_path.string();
-
-            frame_in.open(frameFileName.c_str());
-            if(!frame_in.good())
-            {
-                // Try to parse .pose file
-                boost::filesystem::path pose_path(
-                        boost::filesystem::path(dir) /
-                        boost::filesystem::path( "scan" + to_string( fileCounter, 3 ) + ".pose" ) );
-                string poseFileName = pose_path.string();
-
-                pose_in.open(poseFileName.c_str());
-                if(pose_in.good())
-                {
-                    float euler[6];
-                    for(int i = 0; i < 6; i++) pose_in >> euler[i];
+            // Unreadable scans are reported when they are parsed
+        }
 
-                    euler[3] *= 0.017453293;
-                    euler[4] *= 0.017453293;
-                    euler[5] *= 0.017453293;
+        int num_attributes = AsciiIO::getEntriesInLine(scan.fileName) - 3;
+        scan.hasColor = (num_attributes == 3) || (num_attributes == 4);
+        scan.hasIntensity = (num_attributes == 1) || (num_attributes == 4);
 
-                    Vec position(euler[0], euler[1], euler[2]);
-                    Vec angle(euler[3], euler[4], euler[5]);
+        scan.transform = readScanTransform(dir, scan.number);
+    }
 
-                    tf = Matrix4<Vec>(position, angle);
-                }
-                else
-                {
-                    cout << timestamp << "UOS Reader: Warning: No position information found." << endl;
-                    tf = Matrix4<Vec>();
-                }
+    // Every scan gets a fixed slice of the point buffer
+    size_t numPointsTotal = 0;
+    bool has_color = false;
+    for(auto& scan : scans)
+    {
+        scan.offset = numPointsTotal;
+        numPointsTotal += scan.numPoints;
+        has_color = has_color || scan.hasColor;
+    }
 
-            }
-            else
-            {
-                // Use transformation from .frame files
-                tf = parseFrameFile(frame_in);
+    if(has_color)
+    {
+        cout << timestamp << "Reading color information." << endl;
+    }
 
-            }
+    if(m_saveToDisk)
+    {
+        // Calculate the number of points to skip when writing to disk
+        size_t skipPoints = 1;
 
-            // Print pose information
-            float euler[6];
-            tf.toPostionAngle(euler);
+        if(m_reductionTarget > 1)
+        {
+            skipPoints = std::max<size_t>(numPointsTotal / m_reductionTarget, 1);
+        }
 
-            cout << timestamp << "Processing " << scanFileName << " @ "
-                << euler[0] << " " << euler[1] << " " << euler[2] << " "
-                << euler[3] << " " << euler[4] << " " << euler[5] << endl;
+        cout << timestamp << "Reduction mode. Writing every " << skipPoints << "th point." << endl;
 
-            // Skip first line in scan file (maybe metadata)
-            char dummy[1024];
-            scan_in.getline(dummy, 1024);
+        // Scans are read one after another to keep memory usage low
+        size_t point_counter = 0;
+        for(auto& scan : scans)
+        {
+            std::vector<float> points(3 * scan.numPoints);
+            std::vector<unsigned char> colors(3 * scan.numPoints);
+            std::vector<float> intensities(scan.numPoints);
 
-            // Setup info output
-            string comment = timestamp.getElapsedTime() + "Reading file " + scanFileName;
-            ProgressBar progress(points_in_file, comment);
+            size_t numPoints = parseNewFormatScan(scan, points.data(), colors.data(), intensities.data());
+            cout << timestamp << "Processing " << scan.fileName << endl;
 
-            // Read all points
-            while(scan_in.good())
+            for(size_t i = 0; i < numPoints && m_outputFile.good(); i++)
             {
-                float x, y, z, rem, dummy;
-                int r, g, b;
-
-                point_counter ++;
-
-                if(has_intensity && !has_color)
+                point_counter++;
+                if(point_counter % skipPoints != 0)
                 {
-                    scan_in >> x >> y >> z >> rem;
+                    continue;
                 }
-                else if(has_intensity && has_color)
-                {
-                    scan_in >> x >> y >> z >> rem >> r >> g >> b;
-                    allColors.push_back(BaseVector<int> (r, g, b));
-                }
-                else if(has_color && !has_intensity)
-                {
-                    scan_in >> x >> y >> z >> r >> g >> b;
-                    allColors.push_back(BaseVector<int> (r, g, b));
-                }
-                else
+
+                m_outputFile << points[3 * i] << " " << points[3 * i + 1] << " " << points[3 * i + 2] << " ";
+
+                // Save remission values if present
+                if(scan.hasIntensity && m_saveRemission)
                 {
-                    scan_in >> x >> y >> z;
-                    for(int n_dummys = 0; n_dummys < num_attributes; n_dummys++) scan_in >> dummy;
+                    m_outputFile << intensities[i] << " ";
                 }
 
-                BaseVector<float> point(x, y, z);
-                BaseVector<unsigned char> color;
-
-                // Code branching for point converter!
-                if(!m_saveToDisk)
+                // Save color values if present
+                if(scan.hasColor)
                 {
-                    tmp_points.push_back(point);
+                    m_outputFile << (int)colors[3 * i] << " " << (int)colors[3 * i + 1] << " " << (int)colors[3 * i + 2];
                 }
-                else
+                else if(m_saveRemissionColor)
                 {
-                    if(m_outputFile.good())
-                    {
-                        if(point_counter % skipPoints == 0)
-                        {
-                            point = tf * point;
-                            m_outputFile << point[0] << " " << point[1] << " " << point[2] << " ";
-
-                            // Save remission values if present
-                            if(has_intensity && m_saveRemission)
-                            {
-                                m_outputFile << rem << " ";
-                            }
-
-                            // Save color values if present
-                            if(has_color)
-                            {
-                                m_outputFile << r << " " << g << " " << b;
-                            }
-                            else if(m_saveRemissionColor)
-                            {
-                                r = g = b = rem;
-                                m_outputFile << r << " " << g << " " << b;
-                            }
-                            m_outputFile << endl;
-                        }
-                    }
+                    int r = intensities[i];
+                    m_outputFile << r << " " << r << " " << r;
                 }
-                ++progress;
-            }
-
-            // Save index of first point of new scan
-            size_t firstIndex;
-            if(allPoints.size() > 0)
-            {
-                firstIndex = allPoints.size();
+                m_outputFile << endl;
             }
-            else
-            {
-                firstIndex = 0;
-            }
-
-            // Transform scan point with current matrix
-            list<Vec >::iterator it, it1;
-            for(it = tmp_points.begin(); it != tmp_points.end(); it++)
-            {
-                Vec v = *it;
-                v = tf * v;
-                allPoints.push_back(v);
-            }
-
-            // Save last index
-            size_t lastIndex;
-            if(allPoints.size() > 0)
-            {
-                lastIndex = allPoints.size() - 1;
-            }
-            else
-            {
-                lastIndex = 0;
-            }
-
-            // Save index pair for current scan
-            sub_clouds.push_back(make_pair(firstIndex, lastIndex));
             m_numScans++;
         }
-        cout << endl;
+        return;
     }
 
-    // Convert into array
-    if ( allPoints.size() )
+    floatArr points( new float[3 * numPointsTotal] );
+    ucharArr pointColors;
+    if(has_color)
     {
-        cout << timestamp << "UOS Reader: Read " << allPoints.size() << " points." << endl;
-
-        // Save position information
+        pointColors = ucharArr( new unsigned char[3 * numPointsTotal] );
+        std::fill(pointColors.get(), pointColors.get() + 3 * numPointsTotal, 0);
+    }
 
-        size_t numPoints(0);
-        floatArr points;
-        ucharArr pointColors;
+    // Parse and transform all scans in parallel directly into the buffers
+    string comment = timestamp.getElapsedTime() + "Reading " + to_string((int)scans.size()) + " scans";
+    ProgressBar progress(scans.size(), comment);
 
+    vector<size_t> numRead(scans.size(), 0);
+    #pragma omp parallel for schedule(dynamic)
+    for(long i = 0; i < (long)scans.size(); i++)
+    {
+        const UosScanFile& scan = scans[i];
+        numRead[i] = parseNewFormatScan(
+                scan,
+                points.get() + 3 * scan.offset,
+                has_color ? pointColors.get() + 3 * scan.offset : nullptr,
+                nullptr);
+        ++progress;
+    }
+    cout << endl;
 
-        numPoints = allPoints.size();
-        points = floatArr( new float[3 * allPoints.size()] );
-        list<Vec >::iterator p_it;
-        size_t i(0);
-        for( p_it = allPoints.begin(); p_it != allPoints.end(); p_it++ )
+    // Close gaps left by lines that could not be parsed and save the
+    // index range of each scan
+    vector<indexPair> sub_clouds;
+    size_t numPoints = 0;
+    for(size_t i = 0; i < scans.size(); i++)
+    {
+        if(numRead[i] == 0)
         {
-            Vec v = *p_it;
-            points[i    ] = v[0];
-            points[i + 1] = v[1];
-            points[i + 2] = v[2];
-            i += 3;
+            continue;
         }
 
-        // Save color information
-        if ( allColors.size() )
+        if(numPoints != scans[i].offset)
         {
-            pointColors = ucharArr( new unsigned char[ 3 * numPoints ] );
-            i = 0;
-            list<BaseVector<int>>::iterator c_it;
-            for(c_it = allColors.begin(); c_it != allColors.end(); c_it++)
+            std::copy(points.get() + 3 * scans[i].offset,
+                      points.get() + 3 * (scans[i].offset + numRead[i]),
+                      points.get() + 3 * numPoints);
+            if(has_color)
             {
-                BaseVector<int> v = *c_it;
-                pointColors[i    ] = (unsigned char) v[0];
-                pointColors[i + 1] = (unsigned char) v[1];
-                pointColors[i + 2] = (unsigned char) v[2];
-                i += 3;
+                std::copy(pointColors.get() + 3 * scans[i].offset,
+                          pointColors.get() + 3 * (scans[i].offset + numRead[i]),
+                          pointColors.get() + 3 * numPoints);
             }
         }
 
+        sub_clouds.push_back(make_pair(numPoints, numPoints + numRead[i] - 1));
+        numPoints += numRead[i];
+        m_numScans++;
+    }
+
+    if ( numPoints )
+    {
+        cout << timestamp << "UOS Reader: Read " << numPoints << " points." << endl;
+        n = numPoints;
+
         // Create point cloud in model
         model = ModelPtr( new Model );
         model->m_pointCloud = PointBufferPtr( new PointBuffer );
         model->m_pointCloud->setPointArray( points, numPoints );
 
-        if (allColors.size())
+        if (has_color)
         {
             model->m_pointCloud->setColorArray(pointColors, numPoints);
         }
@@ -508,194 +500,194 @@ void UosIO::readNewFormat(ModelPtr &model, string dir, int first, int last, size
                 sub_clouds_array[i*2 + 1] = sub_clouds[i].second;
             }
 
-            model->m_pointCloud->addIndexChannel(sub_clouds_array, "sub_clouds", numPoints, 2);
+            model->m_pointCloud->addIndexChannel(sub_clouds_array, "sub_clouds", sub_clouds.size(), 2);
         }
     }
-
 }
 
-void UosIO::readOldFormat(ModelPtr &model, string dir, int first, int last, size_t &n)
+bool UosIO::readOldFormatScan(string dir, int fileCounter, vector<float>& allPoints)
 {
-    Matrix4<Vec> m_tf;
+    float euler[6];
+    ifstream scan_in, pose_in, frame_in;
 
-    list<Vec > ptss;
-    list<Vec > allPoints;
-    for(int fileCounter = first; fileCounter <= last; fileCounter++)
-    {
-        float euler[6];
-        ifstream scan_in, pose_in, frame_in;
+    // Code imported from slam6d! Don't blame me..
+    string scanFileName;
+    string poseFileName;
 
-        // Code imported from slam6d! Don't blame me..
-        string scanFileName;
-        string poseFileName;
+    // Create correct path
+    boost::filesystem::path p(
+            boost::filesystem::path(dir) /
+            boost::filesystem::path( to_string( fileCounter, 3 ) ) /
+            boost::filesystem::path( "position.dat" ) );
 
-        // Create correct path
-        boost::filesystem::path p(
-                boost::filesystem::path(dir) / 
-                boost::filesystem::path( to_string( fileCounter, 3 ) ) /
-                boost::filesystem::path( "position.dat" ) );
+    // Get file name (if some knows a more elegant way to
+    // extract the pull path let me know
+    poseFileName = "/" + p.relative_path().string();
 
-        // Get file name (if some knows a more elegant way to
-        // extract the pull path let me know
-        poseFileName = "/" + p.relative_path().string();
+    // Try to open file
+    pose_in.open(poseFileName.c_str());
 
-        // Try to open file
-        pose_in.open(poseFileName.c_str());
+    // Abort if opening failed and try with next die
+    if (!pose_in.good()) return false;
 
-        // Abort if opening failed and try with next die
-        if (!pose_in.good()) continue;
-        cout << timestamp << "Processing Scan " << dir << "/" << to_string(fileCounter, 3) << endl;
+    // Extract pose information
+    for (unsigned int i = 0; i < 6; pose_in >> euler[i++]);
 
-        // Extract pose information
-        for (unsigned int i = 0; i < 6; pose_in >> euler[i++]);
+    // Convert mm to cm
+    for (unsigned int i = 0; i < 3; i++) euler[i] = euler[i] * 0.1;
 
-        // Convert mm to cm
-        for (unsigned int i = 0; i < 3; i++) euler[i] = euler[i] * 0.1;
+    // Convert angles from deg to rad
+    for (unsigned int i = 3; i <= 5; i++) {
+        euler[i] *= 0.01f;
+        //   if (euler[i] < 0.0) euler[i] += 360;
+        euler[i] = rad(euler[i]);
+    }
 
-        // Convert angles from deg to rad
-        for (unsigned int i = 3; i <= 5; i++) {
-            euler[i] *= 0.01f;
-            //   if (euler[i] < 0.0) euler[i] += 360;
-            euler[i] = rad(euler[i]);
-        }
+    // Create path to frame file
+    boost::filesystem::path framePath(
+            boost::filesystem::path(dir) /
+            boost::filesystem::path("scan" + to_string( fileCounter, 3 ) + ".frames" ) );
+    string frameFileName = "/" + framePath.relative_path().string();
 
-        // Read and convert scan
-        for (int i = 1; ; i++) {
-            //scanFileName = dir + to_string(fileCounter, 3) + "/scan" + to_string(i,3) + ".dat";
-
-            boost::filesystem::path sfile(
-                    boost::filesystem::path(dir) /
-                    boost::filesystem::path( to_string( fileCounter, 3 ) ) /
-                    boost::filesystem::path( "scan" + to_string(i) + ".dat" ) );
-            scanFileName = "/" + sfile.relative_path().string();
-
-            scan_in.open(scanFileName.c_str());
-            if (!scan_in.good()) {
-                scan_in.close();
-                scan_in.clear();
-                break;
-            }
+    // Try to open frame file
+    Matrix4<Vec> m_tf;
+    frame_in.open(frameFileName.c_str());
+    if(frame_in.good())
+    {
+        // Transform scan data according to frame file
+        m_tf = parseFrameFile(frame_in);
+    }
+    else
+    {
+        // Transform scan data using information from 'position.dat'
+        Vec position(euler[0], euler[1], euler[2]);
+        Vec angle(euler[3], euler[4], euler[5]);
+        m_tf = Matrix4<Vec>(position, angle);
+    }
 
+    // Read and convert scan
+    for (int i = 1; ; i++) {
+        boost::filesystem::path sfile(
+                boost::filesystem::path(dir) /
+                boost::filesystem::path( to_string( fileCounter, 3 ) ) /
+                boost::filesystem::path( "scan" + to_string(i) + ".dat" ) );
+        scanFileName = "/" + sfile.relative_path().string();
 
-            int    Nr = 0, intensity_flag = 0;
-            int    D;
-            double current_angle;
-            double X, Z, I;                     // x,z coordinate and intensity
-
-            char firstLine[81];
-            scan_in.getline(firstLine, 80);
-
-            char cNr[4];
-            cNr[0] = firstLine[2];
-            cNr[1] = firstLine[3];
-            cNr[2] = firstLine[4];
-            cNr[3] = 0;
-            Nr = atoi(cNr);
-
-            // determine weather we have the new files with intensity information
-            if (firstLine[16] != 'i') {
-                intensity_flag = 1;
-                char cAngle[8];
-                cAngle[0] = firstLine[35];
-                cAngle[1] = firstLine[36];
-                cAngle[2] = firstLine[37];
-                cAngle[3] = firstLine[38];
-                cAngle[4] = firstLine[39];
-                cAngle[5] = firstLine[40];
-                cAngle[6] = firstLine[41];
-                cAngle[7] = 0;
-                current_angle = atof(cAngle);
-                cout << current_angle << endl;
-            } else {
-                intensity_flag = 0;
-                char cAngle[8];
-                cAngle[0] = firstLine[54];
-                cAngle[1] = firstLine[55];
-                cAngle[2] = firstLine[56];
-                cAngle[3] = firstLine[57];
-                cAngle[4] = firstLine[58];
-                cAngle[5] = firstLine[59];
-                cAngle[6] = firstLine[60];
-                cAngle[7] = 0;
-                current_angle = atof(cAngle);
-            }
+        scan_in.open(scanFileName.c_str());
+        if (!scan_in.good()) {
+            scan_in.close();
+            scan_in.clear();
+            break;
+        }
 
-            double cos_currentAngle = cos(rad(current_angle));
-            double sin_currentAngle = sin(rad(current_angle));
 
-            for (int j = 0; j < Nr; j++) {
-                if (!intensity_flag) {
-                    scan_in >> X >> Z >> D >> I;
-                } else {
-                    scan_in >> X >> Z;
-                    I = 1.0;
-                }
+        int    Nr = 0, intensity_flag = 0;
+        int    D;
+        double current_angle;
+        double X, Z, I;                     // x,z coordinate and intensity
+
+        char firstLine[81];
+        scan_in.getline(firstLine, 80);
+
+        char cNr[4];
+        cNr[0] = firstLine[2];
+        cNr[1] = firstLine[3];
+        cNr[2] = firstLine[4];
+        cNr[3] = 0;
+        Nr = atoi(cNr);
+
+        // determine weather we have the new files with intensity information
+        if (firstLine[16] != 'i') {
+            intensity_flag = 1;
+            char cAngle[8];
+            cAngle[0] = firstLine[35];
+            cAngle[1] = firstLine[36];
+            cAngle[2] = firstLine[37];
+            cAngle[3] = firstLine[38];
+            cAngle[4] = firstLine[39];
+            cAngle[5] = firstLine[40];
+            cAngle[6] = firstLine[41];
+            cAngle[7] = 0;
+            current_angle = atof(cAngle);
+        } else {
+            intensity_flag = 0;
+            char cAngle[8];
+            cAngle[0] = firstLine[54];
+            cAngle[1] = firstLine[55];
+            cAngle[2] = firstLine[56];
+            cAngle[3] = firstLine[57];
+            cAngle[4] = firstLine[58];
+            cAngle[5] = firstLine[59];
+            cAngle[6] = firstLine[60];
+            cAngle[7] = 0;
+            current_angle = atof(cAngle);
+        }
 
-                // calculate 3D coordinates (local coordinates)
-                Vec p;
-                p[0] = X;
-                p[1] = Z * sin_currentAngle;
-                p[2] = Z * cos_currentAngle;
+        double cos_currentAngle = cos(rad(current_angle));
+        double sin_currentAngle = sin(rad(current_angle));
 
-                ptss.push_back(p);
+        allPoints.reserve(allPoints.size() + 3 * Nr);
+        for (int j = 0; j < Nr; j++) {
+            if (!intensity_flag) {
+                scan_in >> X >> Z >> D >> I;
+            } else {
+                scan_in >> X >> Z;
+                I = 1.0;
             }
-            scan_in.close();
-            scan_in.clear();
+
+            // calculate 3D coordinates (local coordinates) and transform
+            // them into the global frame
+            Vec p;
+            p[0] = X;
+            p[1] = Z * sin_currentAngle;
+            p[2] = Z * cos_currentAngle;
+            p = m_tf * p;
+
+            allPoints.push_back(p[0]);
+            allPoints.push_back(p[1]);
+            allPoints.push_back(p[2]);
         }
+        scan_in.close();
+        scan_in.clear();
+    }
 
-        pose_in.close();
-        pose_in.clear();
+    return true;
+}
 
-        // Create path to frame file
-        boost::filesystem::path framePath(
-                boost::filesystem::path(dir) / 
-                boost::filesystem::path("scan" + to_string( fileCounter, 3 ) + ".frames" ) );
-        string frameFileName = "/" + framePath.relative_path().string();
+void UosIO::readOldFormat(ModelPtr &model, string dir, int first, int last, size_t &n)
+{
+    // Read all scan directories in parallel
+    vector<vector<float> > scanPoints(last - first + 1);
+    vector<char> scanRead(scanPoints.size(), 0);
 
-        // Try to open frame file
-        frame_in.open(frameFileName.c_str());
-        if(frame_in.good())
-        {
-            // Transform scan data according to frame file
-            m_tf = parseFrameFile(frame_in);
-        }
-        else
-        {
-            // Transform scan data using information from 'position.dat'
-            Vec position(euler[0], euler[1], euler[2]);
-            Vec angle(euler[3], euler[4], euler[5]);
-            m_tf = Matrix4<Vec>(position, angle);
-        }
+    #pragma omp parallel for schedule(dynamic)
+    for(long i = 0; i < (long)scanPoints.size(); i++)
+    {
+        scanRead[i] = readOldFormatScan(dir, first + i, scanPoints[i]);
+    }
 
-        // Transform points and insert in to global vector
-        list<Vec >::iterator it;
-        for(it = ptss.begin(); it != ptss.end(); it++)
+    size_t numPoints = 0;
+    for(size_t i = 0; i < scanPoints.size(); i++)
+    {
+        if(scanRead[i])
         {
-            Vec v = *it;
-            v = m_tf * v;
-            allPoints.push_back(v);
+            cout << timestamp << "Processed Scan " << dir << "/" << to_string(first + (int)i, 3) << endl;
+            numPoints += scanPoints[i].size() / 3;
+            m_numScans++;
         }
-
-        // Clear scan
-        ptss.clear();
     }
 
     // Convert into indexed array
-    if(allPoints.size() > 0)
+    if(numPoints > 0)
     {
-        cout << timestamp << "UOS Reader: Read " << allPoints.size() << " points." << endl;
-        n = allPoints.size();
-        floatArr points( new float[3 * allPoints.size()] );
-        list<Vec >::iterator p_it;
-        int i(0);
-        for( p_it = allPoints.begin(); p_it != allPoints.end(); p_it++ )
+        cout << timestamp << "UOS Reader: Read " << numPoints << " points." << endl;
+        n = numPoints;
+        floatArr points( new float[3 * numPoints] );
+        float* it = points.get();
+        for(auto& scan : scanPoints)
         {
-            int t_index = 3 * i;
-            Vec v = *p_it;
-            points[t_index    ] = v[0];
-            points[t_index + 1] = v[1];
-            points[t_index + 2] = v[2];
-            i++;
+            it = std::copy(scan.begin(), scan.end(), it);
+            vector<float>().swap(scan);
         }
 
         // Alloc model
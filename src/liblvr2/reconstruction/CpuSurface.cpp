@@ -0,0 +1,289 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "lvr2/reconstruction/CpuSurface.hpp"
+#include "lvr2/config/lvropenmp.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace lvr2
+{
+
+CpuSurface::CpuSurface(floatArr& points, size_t num_points)
+    : m_points(points),
+      m_vx(1000000.0), m_vy(1000000.0), m_vz(1000000.0),
+      m_k(10), m_ki(10), m_kd(5)
+{
+    this->V.dim = 3;
+    this->V.width = static_cast<unsigned int>(num_points);
+    this->V.elements = points.get();
+    this->initKdTree();
+}
+
+CpuSurface::~CpuSurface()
+{
+}
+
+void CpuSurface::calculateNormals()
+{
+    m_normals.assign(static_cast<size_t>(V.width) * 3, 0.0f);
+
+    if(V.width == 0)
+    {
+        return;
+    }
+
+    this->estimateNormals();
+
+    if(m_ki > 1)
+    {
+        this->interpolateNormals();
+    }
+}
+
+void CpuSurface::getNormals(floatArr output_normals)
+{
+    std::copy(m_normals.begin(), m_normals.end(), output_normals.get());
+}
+
+void CpuSurface::setKn(int kn)
+{
+    this->m_k = kn;
+}
+
+void CpuSurface::setKi(int ki)
+{
+    this->m_ki = ki;
+}
+
+void CpuSurface::setKd(int kd)
+{
+    this->m_kd = kd;
+}
+
+void CpuSurface::setFlippoint(float v_x, float v_y, float v_z)
+{
+    this->m_vx = v_x;
+    this->m_vy = v_y;
+    this->m_vz = v_z;
+}
+
+void CpuSurface::setMethod(std::string method)
+{
+    if(method == "RANSAC")
+    {
+        std::cout << "WARNING: RANSAC is not implemented for CPU normals, using PCA" << std::endl;
+    }
+    else if(method != "PCA")
+    {
+        std::cout << "WARNING: Normal Calculation Method is not implemented" << std::endl;
+    }
+}
+
+/// PRIVATE ///
+
+void CpuSurface::initKdTree()
+{
+    kd_tree_gen = boost::shared_ptr<LBKdTree>(new LBKdTree(this->V, OpenMPConfig::getNumThreads() ) );
+    kd_tree_values = kd_tree_gen->getKdTreeValues();
+    kd_tree_splits = kd_tree_gen->getKdTreeSplits();
+    kd_tree_indices = kd_tree_gen->getKdTreeIndices();
+}
+
+void CpuSurface::searchNeighbors(const float* query, unsigned int k, std::vector<Neighbor>& neighbors) const
+{
+    neighbors.clear();
+
+    if(k == 0 || V.width == 0)
+    {
+        return;
+    }
+
+    const float* values = kd_tree_values->elements;
+    const unsigned char* splits = kd_tree_splits->elements;
+    const unsigned int num_splits = kd_tree_splits->width;
+
+    // Subtrees that still have to be visited with a lower bound of their
+    // squared distance. The stack holds at most one entry per tree level.
+    struct StackEntry
+    {
+        unsigned int position;
+        float distance;
+    };
+
+    StackEntry stack[64];
+    int top = 0;
+    stack[top++] = {0, 0.0f};
+
+    while(top > 0)
+    {
+        StackEntry entry = stack[--top];
+
+        if(neighbors.size() == k && entry.distance >= neighbors.front().first)
+        {
+            continue;
+        }
+
+        // Descend to the leaf of the query and remember the far sides
+        unsigned int pos = entry.position;
+        while(pos < num_splits)
+        {
+            float diff = query[splits[pos]] - values[pos];
+            unsigned int near_pos = diff <= 0 ? pos * 2 + 1 : pos * 2 + 2;
+            unsigned int far_pos = diff <= 0 ? pos * 2 + 2 : pos * 2 + 1;
+            float far_distance = std::max(diff * diff, entry.distance);
+
+            if(neighbors.size() < k || far_distance < neighbors.front().first)
+            {
+                stack[top++] = {far_pos, far_distance};
+            }
+            pos = near_pos;
+        }
+
+        unsigned int index = kd_tree_indices->elements[pos - num_splits];
+        const float* p = V.elements + static_cast<size_t>(index) * 3;
+        float dx = p[0] - query[0];
+        float dy = p[1] - query[1];
+        float dz = p[2] - query[2];
+        float distance = dx * dx + dy * dy + dz * dz;
+
+        if(neighbors.size() < k)
+        {
+            neighbors.push_back(Neighbor(distance, index));
+            std::push_heap(neighbors.begin(), neighbors.end());
+        }
+        else if(distance < neighbors.front().first)
+        {
+            std::pop_heap(neighbors.begin(), neighbors.end());
+            neighbors.back() = Neighbor(distance, index);
+            std::push_heap(neighbors.begin(), neighbors.end());
+        }
+    }
+}
+
+void CpuSurface::estimateNormals()
+{
+    unsigned int k = static_cast<unsigned int>(std::max(m_k, 3));
+
+    #pragma omp parallel
+    {
+        std::vector<Neighbor> neighbors;
+        neighbors.reserve(k);
+
+        #pragma omp for schedule(dynamic, 64)
+        for(long i = 0; i < (long)V.width; i++)
+        {
+            const float* query = V.elements + i * 3;
+            searchNeighbors(query, k, neighbors);
+
+            // Covariance of the neighborhood around its centroid
+            Eigen::Vector3f mean = Eigen::Vector3f::Zero();
+            for(const Neighbor& n : neighbors)
+            {
+                mean += Eigen::Map<const Eigen::Vector3f>(V.elements + static_cast<size_t>(n.second) * 3);
+            }
+            mean /= static_cast<float>(neighbors.size());
+
+            Eigen::Matrix3f covariance = Eigen::Matrix3f::Zero();
+            for(const Neighbor& n : neighbors)
+            {
+                Eigen::Vector3f r =
+                    Eigen::Map<const Eigen::Vector3f>(V.elements + static_cast<size_t>(n.second) * 3) - mean;
+                covariance += r * r.transpose();
+            }
+
+            // The normal is the eigenvector of the smallest eigenvalue
+            Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f> solver;
+            solver.computeDirect(covariance);
+            Eigen::Vector3f normal = solver.eigenvectors().col(0);
+
+            if(!std::isfinite(normal.squaredNorm()) || normal.squaredNorm() == 0.0f)
+            {
+                normal = Eigen::Vector3f(0.0f, 0.0f, 1.0f);
+            }
+            normal.normalize();
+
+            // Orientate towards the flippoint
+            Eigen::Vector3f view(m_vx - query[0], m_vy - query[1], m_vz - query[2]);
+            if(normal.dot(view) < 0)
+            {
+                normal = -normal;
+            }
+
+            m_normals[i * 3 + 0] = normal.x();
+            m_normals[i * 3 + 1] = normal.y();
+            m_normals[i * 3 + 2] = normal.z();
+        }
+    }
+}
+
+void CpuSurface::interpolateNormals()
+{
+    unsigned int ki = static_cast<unsigned int>(m_ki);
+    std::vector<float> interpolated(m_normals.size());
+
+    #pragma omp parallel
+    {
+        std::vector<Neighbor> neighbors;
+        neighbors.reserve(ki);
+
+        #pragma omp for schedule(dynamic, 64)
+        for(long i = 0; i < (long)V.width; i++)
+        {
+            searchNeighbors(V.elements + i * 3, ki, neighbors);
+
+            // All normals point towards the flippoint, so the mean keeps
+            // the orientation
+            Eigen::Vector3f mean = Eigen::Map<const Eigen::Vector3f>(&m_normals[i * 3]);
+            for(const Neighbor& n : neighbors)
+            {
+                mean += Eigen::Map<const Eigen::Vector3f>(&m_normals[static_cast<size_t>(n.second) * 3]);
+            }
+
+            if(mean.squaredNorm() > 0.0f)
+            {
+                mean.normalize();
+            }
+            else
+            {
+                mean = Eigen::Map<const Eigen::Vector3f>(&m_normals[i * 3]);
+            }
+
+            interpolated[i * 3 + 0] = mean.x();
+            interpolated[i * 3 + 1] = mean.y();
+            interpolated[i * 3 + 2] = mean.z();
+        }
+    }
+
+    m_normals.swap(interpolated);
+}
+
+} /* namespace lvr2 */
@@ -25,327 +25,341 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <stdio.h>
-
-#include <iostream>
 #include "lvr2/reconstruction/LBKdTree.hpp"
-#include "lvr2/config/lvropenmp.hpp"
+
+#include <algorithm>
+#include <limits>
 
 namespace lvr2
 {
 
-// Static variables
-
-ctpl::thread_pool* LBKdTree::pool;
-int LBKdTree::st_num_threads = 8;
-int LBKdTree::st_depth_threads = 3;
-
-/// Public
+namespace
+{
 
-LBKdTree::LBKdTree( LBPointArray<float>& vertices, int num_threads) {
-    this->m_values = boost::shared_ptr<LBPointArray<float> >(new LBPointArray<float>);
-    this->m_splits = boost::shared_ptr<LBPointArray<unsigned char> >(new LBPointArray<unsigned char>);
-    st_num_threads = num_threads;
-    st_depth_threads = static_cast<int>(log2(st_num_threads));
-    pool = new ctpl::thread_pool(OpenMPConfig::getNumThreads());
-    this->generateKdTree(vertices);
-}
+/// Creates a one-dimensional point array that frees its elements with the last reference
+template<typename T>
+boost::shared_ptr<LBPointArray<T> > makeSharedPointArray(unsigned int width)
+{
+    LBPointArray<T>* m = new LBPointArray<T>;
+    m->width = width;
+    m->dim = 1;
+    m->elements = (T*)malloc(sizeof(T) * width);
 
-LBKdTree::~LBKdTree() {
-    if(pool)
+    return boost::shared_ptr<LBPointArray<T> >(m, [](LBPointArray<T>* p)
     {
-        delete pool;
-    }
+        free(p->elements);
+        delete p;
+    });
 }
 
-void LBKdTree::generateKdTree(LBPointArray<float> &vertices) {
-
-    LBPointArray<unsigned int>* indices_sorted =
-        (LBPointArray<unsigned int>*)malloc(vertices.dim * sizeof(LBPointArray<unsigned int>) );
-    LBPointArray<float>* values_sorted =
-        (LBPointArray<float>*)malloc(vertices.dim * sizeof(LBPointArray<float>) );
+/// Minimum number of points of a node that is partitioned by several threads
+const size_t PARALLEL_PARTITION_SIZE = 1 << 15;
 
-    for(unsigned int i=0; i< vertices.dim; i++)
-    {
-        pool->push(generateAndSort<float, unsigned int>, vertices, indices_sorted, values_sorted, i);
-        //generateAndSort<float, unsigned int>(0, vertices, indices_sorted, values_sorted, i);
-    }
+/**
+ * @brief Parallel std::nth_element for points ordered by coords[dim]
+ *
+ * Two pivots that enclose the n-th element with high probability are taken
+ * from a sample of the range. The points below, between and above them are
+ * counted per block and scattered into scratch in parallel. The selection
+ * continues in the part containing the n-th element, which shrinks it to a
+ * few percent per step, until std::nth_element can finish it.
+ *
+ * @param scratch   Buffer for at least last - first points
+ */
+template<typename PointT>
+void parallelNthElement(PointT* first, PointT* nth, PointT* last, unsigned int dim,
+        PointT* scratch, int num_threads)
+{
+    const long num_blocks = 4 * static_cast<long>(num_threads);
+    const size_t sample_size = 1024;
+    const size_t pivot_distance = 48;
 
-    pool->stop(true);
-    delete pool;
-    pool = new ctpl::thread_pool(OpenMPConfig::getNumThreads());
+    std::vector<size_t> offsets(3 * num_blocks);
+    std::vector<float> sample(sample_size);
 
+    while(static_cast<size_t>(last - first) >= PARALLEL_PARTITION_SIZE)
+    {
+        const size_t count = last - first;
+        const size_t k = nth - first;
 
-    this->generateKdTreeArray(vertices, indices_sorted, vertices.dim);
+        for(size_t i = 0; i < sample_size; i++)
+        {
+            sample[i] = first[i * count / sample_size].coords[dim];
+        }
+        std::sort(sample.begin(), sample.end());
 
-    for(unsigned int i=0; i<vertices.dim;i++)
-    {
-        free(values_sorted[i].elements);
-    }
-}
+        size_t rank = k * sample_size / count;
+        float low = sample[rank >= pivot_distance ? rank - pivot_distance : 0];
+        float high = sample[std::min(rank + pivot_distance, sample_size - 1)];
 
-boost::shared_ptr<LBPointArray<float> > LBKdTree::getKdTreeValues() {
-    return this->m_values;
-}
+        auto part = [dim, low, high](const PointT& p)
+        {
+            return p.coords[dim] < low ? 0 : (p.coords[dim] > high ? 2 : 1);
+        };
 
-boost::shared_ptr<LBPointArray<unsigned char> > LBKdTree::getKdTreeSplits() {
-    return this->m_splits;
-}
+        #pragma omp parallel for schedule(static) num_threads(num_threads)
+        for(long b = 0; b < num_blocks; b++)
+        {
+            size_t c[3] = {0, 0, 0};
+            for(size_t i = count * b / num_blocks; i < count * (b + 1) / num_blocks; i++)
+            {
+                c[part(first[i])]++;
+            }
+            for(int j = 0; j < 3; j++)
+            {
+                offsets[3 * b + j] = c[j];
+            }
+        }
 
-/// Private
+        // Every block writes each of its parts behind those of the
+        // previous blocks
+        size_t offset = 0;
+        for(int j = 0; j < 3; j++)
+        {
+            for(long b = 0; b < num_blocks; b++)
+            {
+                size_t c = offsets[3 * b + j];
+                offsets[3 * b + j] = offset;
+                offset += c;
+            }
+        }
+        const size_t between_begin = offsets[1];
+        const size_t above_begin = offsets[2];
 
-void LBKdTree::generateKdTreeArray(LBPointArray<float>& V,
-        LBPointArray<unsigned int>* sorted_indices, int max_dim) {
+        #pragma omp parallel for schedule(static) num_threads(num_threads)
+        for(long b = 0; b < num_blocks; b++)
+        {
+            size_t o[3] = {offsets[3 * b], offsets[3 * b + 1], offsets[3 * b + 2]};
+            for(size_t i = count * b / num_blocks; i < count * (b + 1) / num_blocks; i++)
+            {
+                scratch[o[part(first[i])]++] = first[i];
+            }
+        }
 
-    // DEBUG CHECK
+        #pragma omp parallel for schedule(static) num_threads(num_threads)
+        for(long i = 0; i < (long)count; i++)
+        {
+            first[i] = scratch[i];
+        }
 
-    int first_split_dim = -1;
-    float best_deviation = -1.0;
-    
-    for(int i=0; i<V.dim; i++)
-    {
-        float deviation = V.elements[static_cast<unsigned int>(
-                            sorted_indices[i].elements[sorted_indices[i].width-1]+0.5)* V.dim + i]
-                        -  V.elements[static_cast<unsigned int>(
-                            sorted_indices[i].elements[i]+0.5)* V.dim + i] ;
-        
-        if(deviation > best_deviation)
+        if(k < between_begin)
         {
-            best_deviation = deviation;
-            first_split_dim = i;
+            last = first + between_begin;
+        }
+        else if(k >= above_begin)
+        {
+            first += above_begin;
+        }
+        else if(low == high)
+        {
+            // All points between the pivots are equal
+            return;
+        }
+        else if(above_begin - between_begin == count)
+        {
+            // No progress, e.g. because of many equal points
+            break;
+        }
+        else
+        {
+            last = first + above_begin;
+            first += between_begin;
         }
     }
 
+    std::nth_element(first, nth, last, [dim](const PointT& a, const PointT& b)
+    {
+        return a.coords[dim] < b.coords[dim];
+    });
+}
 
-    unsigned int size;
-    int max_tree_depth;
+} // anonymous namespace
 
-    max_tree_depth = static_cast<int>( log2f(V.width - 1 ) + 2.0 ) ;
+/// Public
 
-    if (V.width == 1)
-    {
-        max_tree_depth = 1;
-    }
+LBKdTree::LBKdTree( LBPointArray<float>& vertices, int num_threads)
+    : m_numThreads(std::max(num_threads, 1))
+{
+    this->generateKdTree(vertices);
+}
 
-    size = V.width * 2 - 1;
+LBKdTree::~LBKdTree()
+{
+}
 
-    // std::cout << "size values: " << size << std::endl;
-    this->m_values->elements = (float*)malloc(sizeof(float) * size );
-    this->m_values->width = size;
-    this->m_values->dim = 1;
+void LBKdTree::generateKdTree(LBPointArray<float> &vertices) {
 
-    unsigned int size_splits = size - V.width;
-    // std::cout << "size splits: " << size_splits << std::endl;
-    this->m_splits->elements = (unsigned char*)malloc(sizeof(unsigned char) * size_splits );
-    this->m_splits->width = size_splits;
-    this->m_splits->dim = 1;
+    unsigned int n = vertices.width;
 
-    LBPointArray<float>* value_ptr = this->m_values.get();
-    LBPointArray<unsigned char>* splits_ptr = this->m_splits.get();
-    //start real generate
-    generateKdTreeRecursive(0, V, sorted_indices, first_split_dim,
-            max_dim, value_ptr, splits_ptr ,size, max_tree_depth, 0, 0);
+    // A left-balanced tree over n leaves has n - 1 inner nodes
+    unsigned int size = n > 0 ? 2 * n - 1 : 0;
+    unsigned int size_splits = n > 0 ? n - 1 : 0;
 
-    pool->stop(true);
-    delete pool;
-    pool = new ctpl::thread_pool(OpenMPConfig::getNumThreads());
-}
+    this->m_values = makeSharedPointArray<float>(size);
+    this->m_splits = makeSharedPointArray<unsigned char>(size_splits);
+    this->m_indices = makeSharedPointArray<unsigned int>(n);
 
-void LBKdTree::fillCriticalIndices(const LBPointArray<float>& V,
-        LBPointArray<unsigned int>& sorted_indices, unsigned int current_dim,
-        float split_value, unsigned int split_index,
-        std::list<unsigned int>& critical_indices_left,
-        std::list<unsigned int>& critical_indices_right)
-{
-    critical_indices_left.push_back( sorted_indices.elements[split_index] );
-
-    unsigned int iterator;
-    // nach links
-    for(iterator = split_index-1;
-        iterator < sorted_indices.width
-        && V.elements[ sorted_indices.elements[iterator] * V.dim + current_dim] == split_value;
-        iterator--)
+    if(n == 0)
     {
-        critical_indices_left.push_back( sorted_indices.elements[iterator] );
+        return;
     }
 
-    // nach rechts
-    for(iterator = split_index+1;
-        iterator < sorted_indices.width
-        && V.elements[ sorted_indices.elements[iterator] * V.dim + current_dim] == split_value;
-        iterator++)
+    // Partitioning a contiguous copy avoids an indirect load per comparison
+    std::vector<BuildPoint> points(n);
+    unsigned int dim = std::min(vertices.dim, 3u);
+
+    #pragma omp parallel for num_threads(m_numThreads)
+    for(long i = 0; i < (long)n; i++)
     {
-        critical_indices_right.push_back( sorted_indices.elements[iterator] );
+        BuildPoint& p = points[i];
+        for(unsigned int d = 0; d < 3; d++)
+        {
+            p.coords[d] = d < dim ? vertices.elements[static_cast<size_t>(i) * vertices.dim + d] : 0.0f;
+        }
+        p.index = static_cast<unsigned int>(i);
     }
 
+    this->generateKdTreeArray(points);
 }
 
-void LBKdTree::fillCriticalIndicesSet(const LBPointArray<float>& V,
-        LBPointArray<unsigned int>& sorted_indices, unsigned int current_dim,
-        float split_value, unsigned int split_index,
-        std::unordered_set<unsigned int>& critical_indices_left,
-        std::unordered_set<unsigned int>& critical_indices_right)
-{
-    // push split index to the left
-    critical_indices_left.insert(sorted_indices.elements[split_index]);
-
-    unsigned int iterator;
-    // to the left
-    for(iterator = split_index-1;
-        iterator < sorted_indices.width
-        && V.elements[ sorted_indices.elements[iterator] * V.dim + current_dim] == split_value;
-        iterator--)
-    {
-        critical_indices_left.insert( sorted_indices.elements[iterator] );
-    }
+boost::shared_ptr<LBPointArray<float> > LBKdTree::getKdTreeValues() {
+    return this->m_values;
+}
 
-    // to the right
-    for(iterator = split_index+1;
-        iterator < sorted_indices.width
-        && V.elements[ sorted_indices.elements[iterator] * V.dim + current_dim] == split_value;
-        iterator++)
-    {
-        critical_indices_right.insert( sorted_indices.elements[iterator] );
-    }
+boost::shared_ptr<LBPointArray<unsigned char> > LBKdTree::getKdTreeSplits() {
+    return this->m_splits;
+}
 
+boost::shared_ptr<LBPointArray<unsigned int> > LBKdTree::getKdTreeIndices() {
+    return this->m_indices;
 }
 
-void LBKdTree::generateKdTreeRecursive(int id, LBPointArray<float>& V,
-        LBPointArray<unsigned int>* sorted_indices, int current_dim, int max_dim,
-        LBPointArray<float> *values, LBPointArray<unsigned char> *splits ,
-        int size, int max_tree_depth, int position, int current_depth)
+/// Private
+
+void LBKdTree::generateKdTreeArray(std::vector<BuildPoint>& points)
 {
-    int left = position*2+1;
-    int right = position*2+2;
+    // The nodes of one level cover disjoint ranges of the point array and
+    // can be partitioned independently. Levels with fewer nodes than
+    // threads are parallelized inside the nodes instead.
+    std::vector<BuildNode> level;
+    std::vector<BuildNode> children;
+    std::vector<BuildPoint> scratch;
 
+    level.push_back({0, 0, static_cast<unsigned int>(points.size())});
 
-    if( sorted_indices[current_dim].width <= 1 )
+    while(!level.empty())
     {
-        values->elements[position] = static_cast<float>(sorted_indices[current_dim].elements[0] );
-    } else {
-        /// split sorted_indices
-        unsigned int indices_size = sorted_indices[current_dim].width;
+        children.resize(level.size() * 2);
 
-        unsigned int v = pow( 2, static_cast<int>( log2(indices_size-1) ) );
-        unsigned int left_size = indices_size - v/2;
+        bool few_nodes = static_cast<int>(level.size()) < m_numThreads;
 
-        if( left_size > v )
+        if(!few_nodes)
         {
-            left_size = v;
+            // Only needed by the parallel partition of the upper levels
+            std::vector<BuildPoint>().swap(scratch);
         }
 
-        unsigned int right_size = indices_size - left_size;
-
-
-
-        unsigned int split_index = static_cast<unsigned int>(
-                sorted_indices[current_dim].elements[left_size-1] + 0.5
-            );
-
-        float split_value = V.elements[split_index * V.dim + current_dim ];
-
-        // critical indices
-        std::unordered_set<unsigned int> critical_indices_left;
-        std::unordered_set<unsigned int> critical_indices_right;
-
-        fillCriticalIndicesSet(V, sorted_indices[current_dim],
-                current_dim, split_value, left_size-1, 
-                critical_indices_left, critical_indices_right);
-
-        //std::cout << "Split in dimension: " << current_dim << std::endl;
-        values->elements[ position ] = split_value;
-        splits->elements[ position ] = static_cast<unsigned char>(current_dim);
-
-
-        LBPointArray<unsigned int> *sorted_indices_left =
-            (LBPointArray<unsigned int>*)malloc( 3*sizeof(LBPointArray<unsigned int>) );
-        LBPointArray<unsigned int> *sorted_indices_right =
-            (LBPointArray<unsigned int>*)malloc( 3*sizeof(LBPointArray<unsigned int>) );
-
-        int next_dim_left = -1;
-        int next_dim_right = -1;
-        float biggest_deviation_left = -1.0;
-        float biggest_deviation_right = -1.0;
-
-        for( int i=0; i<max_dim; i++ )
+        #pragma omp parallel for schedule(dynamic) num_threads(m_numThreads) if(!few_nodes)
+        for(long i = 0; i < (long)level.size(); i++)
         {
+            partitionNode(points, scratch, level[i], few_nodes, &children[i * 2]);
+        }
 
-            sorted_indices_left[i].width = left_size;
-            sorted_indices_left[i].dim = 1;
-            sorted_indices_left[i].elements = (unsigned int*)malloc( left_size * sizeof(unsigned int) );
-
-            sorted_indices_right[i].width = right_size;
-            sorted_indices_right[i].dim = 1;
-            sorted_indices_right[i].elements = (unsigned int*)malloc( right_size * sizeof(unsigned int) );
-
-            float deviation_left;
-            float deviation_right;
-
-
-            if( i == current_dim ){
-                 splitPointArray<unsigned int>( sorted_indices[i],
-                         sorted_indices_left[i],
-                         sorted_indices_right[i]);
-
-
-                 deviation_left = fabs(V.elements[sorted_indices_left[i].elements[left_size - 1] * V.dim + i ]
-                                    - V.elements[sorted_indices_left[i].elements[0] * V.dim + i ]   );
-                 deviation_right = fabs( V.elements[ sorted_indices_right[i].elements[right_size - 1]  * V.dim + i ]
-                                    - V.elements[sorted_indices_right[i].elements[0]  * V.dim + i] );
+        level.clear();
+        for(const BuildNode& child : children)
+        {
+            if(child.end > child.begin)
+            {
+                level.push_back(child);
+            }
+        }
+    }
+}
 
-            } else {
-                
+void LBKdTree::partitionNode(std::vector<BuildPoint>& points,
+        std::vector<BuildPoint>& scratch,
+        const BuildNode& node,
+        bool parallel,
+        BuildNode* children)
+{
+    unsigned int count = node.end - node.begin;
 
-                // check for wrong value in sorted indices
-                
-                splitPointArrayWithValueSet<float, unsigned int>(V, sorted_indices[i],
-                        sorted_indices_left[i], sorted_indices_right[i],
-                        current_dim, split_value,
-                        deviation_left, deviation_right, i,
-                        critical_indices_left, critical_indices_right);
+    children[0] = {0, 0, 0};
+    children[1] = {0, 0, 0};
 
-            }
+    if(count == 1)
+    {
+        unsigned int index = points[node.begin].index;
+        m_values->elements[node.position] = static_cast<float>(index);
+        m_indices->elements[node.position - m_splits->width] = index;
+        return;
+    }
 
-            if(deviation_left > biggest_deviation_left )
-            {
-                biggest_deviation_left = deviation_left;
-                next_dim_left = i;
-            }
+    // Split along the dimension with the biggest extent
+    parallel = parallel && count >= PARALLEL_PARTITION_SIZE;
 
-            if(deviation_right > biggest_deviation_right )
-            {
-                biggest_deviation_right = deviation_right;
-                next_dim_right = i;
-            }
-        }
+    float min_x = std::numeric_limits<float>::max();
+    float min_y = std::numeric_limits<float>::max();
+    float min_z = std::numeric_limits<float>::max();
+    float max_x = std::numeric_limits<float>::lowest();
+    float max_y = std::numeric_limits<float>::lowest();
+    float max_z = std::numeric_limits<float>::lowest();
 
-        //int next_dim = (current_dim+1)%max_dim;
+    #pragma omp parallel for reduction(min:min_x,min_y,min_z) reduction(max:max_x,max_y,max_z) num_threads(m_numThreads) if(parallel)
+    for(long i = node.begin; i < (long)node.end; i++)
+    {
+        const float* c = points[i].coords;
+        min_x = std::min(min_x, c[0]);
+        min_y = std::min(min_y, c[1]);
+        min_z = std::min(min_z, c[2]);
+        max_x = std::max(max_x, c[0]);
+        max_y = std::max(max_y, c[1]);
+        max_z = std::max(max_z, c[2]);
+    }
 
-        if(current_depth == st_depth_threads )
+    float deviation[3] = {max_x - min_x, max_y - min_y, max_z - min_z};
+    unsigned int split_dim = 0;
+    for(unsigned int d = 1; d < 3; d++)
+    {
+        if(deviation[d] > deviation[split_dim])
         {
-            pool->push(generateKdTreeRecursive, V, sorted_indices_left,
-                    next_dim_left, max_dim, values, splits, size, max_tree_depth,
-                    left, current_depth + 1);
-
-            pool->push(generateKdTreeRecursive, V, sorted_indices_right,
-                    next_dim_right, max_dim, values, splits, size, max_tree_depth,
-                    right, current_depth +1);
-        } else {
-            //std::cout<< "left " << current_dim << std::endl;
-            generateKdTreeRecursive(0, V, sorted_indices_left, next_dim_left, max_dim,
-                    values, splits, size, max_tree_depth, left, current_depth + 1);
-            //std::cout << "right " << current_dim << std::endl;
-            generateKdTreeRecursive(0, V, sorted_indices_right, next_dim_right, max_dim,
-                    values, splits, size, max_tree_depth, right, current_depth +1);
+            split_dim = d;
         }
+    }
 
+    // The left subtree gets as many leaves as needed to fill all but the
+    // last level completely, which keeps the tree left-balanced
+    unsigned int v = 1;
+    while(v * 2 <= count - 1)
+    {
+        v *= 2;
     }
 
-    for(int i=0; i<max_dim; i++) {
-        free(sorted_indices[i].elements );
+    unsigned int left_size = std::min(count - v / 2, v);
+
+    BuildPoint* first = points.data() + node.begin;
+    BuildPoint* split = first + (left_size - 1);
+    if(parallel)
+    {
+        // Nodes with parallel partitions are processed one after another
+        scratch.resize(std::max<size_t>(scratch.size(), count));
+        parallelNthElement(first, split, points.data() + node.end, split_dim,
+                scratch.data(), m_numThreads);
     }
-    free(sorted_indices);
+    else
+    {
+        std::nth_element(first, split, points.data() + node.end,
+            [split_dim](const BuildPoint& a, const BuildPoint& b)
+            {
+                return a.coords[split_dim] < b.coords[split_dim];
+            });
+    }
+
+    m_values->elements[node.position] = split->coords[split_dim];
+    m_splits->elements[node.position] = static_cast<unsigned char>(split_dim);
 
+    children[0] = {node.position * 2 + 1, node.begin, node.begin + left_size};
+    children[1] = {node.position * 2 + 2, node.begin + left_size, node.end};
 }
 
 } /* namespace lvr2 */
@@ -121,10 +121,15 @@ Texture::Texture(const Texture& other)
     this->m_numBytesPerChan = other.m_numBytesPerChan;
     this->m_texelSize = other.m_texelSize;
 
-    size_t data_size = m_width * m_height * m_numChannels * m_numBytesPerChan;
-    m_data = new unsigned char[data_size];
-    std::copy(other.m_data, other.m_data + data_size, m_data);
-    
+    // Textures whose data was already written to disk only keep their
+    // dimensions
+    m_data = nullptr;
+    if (other.m_data)
+    {
+        size_t data_size = (size_t)m_width * m_height * m_numChannels * m_numBytesPerChan;
+        m_data = new unsigned char[data_size];
+        std::copy(other.m_data, other.m_data + data_size, m_data);
+    }
 }
 
 Texture & Texture::operator=(const Texture &other)
@@ -144,9 +149,39 @@ Texture & Texture::operator=(const Texture &other)
         this->m_numBytesPerChan = other.m_numBytesPerChan;
         this->m_texelSize = other.m_texelSize;
 
-        size_t data_size = m_width * m_height * m_numChannels * m_numBytesPerChan;
-        m_data = new unsigned char[data_size];
-        std::copy(other.m_data, other.m_data + data_size, m_data);
+        m_data = nullptr;
+        if (other.m_data)
+        {
+            size_t data_size = (size_t)m_width * m_height * m_numChannels * m_numBytesPerChan;
+            m_data = new unsigned char[data_size];
+            std::copy(other.m_data, other.m_data + data_size, m_data);
+        }
+    }
+
+    return *this;
+}
+
+Texture & Texture::operator=(Texture &&other)
+{
+    if (this != &other)
+    {
+        if (m_data)
+        {
+            delete[] m_data;
+        }
+        this->m_index = other.m_index;
+        this->m_width = other.m_width;
+        this->m_height = other.m_height;
+        this->m_data = other.m_data;
+        this->m_numChannels = other.m_numChannels;
+        this->m_numBytesPerChan = other.m_numBytesPerChan;
+        this->m_texelSize = other.m_texelSize;
+
+        other.m_data = nullptr;
+        other.m_width = 0;
+        other.m_height = 0;
+        other.m_numChannels = 0;
+        other.m_numBytesPerChan = 0;
     }
 
     return *this;
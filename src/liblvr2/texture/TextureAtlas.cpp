@@ -0,0 +1,272 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * TextureAtlas.cpp
+ */
+
+#include "lvr2/texture/TextureAtlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lvr2
+{
+
+TextureAtlas::TextureAtlas(
+    unsigned short int pageWidth,
+    unsigned short int pageHeight,
+    unsigned short int padding,
+    size_t maxOpenPages
+) :
+    m_pageWidth(pageWidth),
+    m_pageHeight(pageHeight),
+    m_padding(padding),
+    m_maxOpenPages(std::max<size_t>(maxOpenPages, 1)),
+    m_numPages(0)
+{
+}
+
+AtlasRegion TextureAtlas::insert(const Texture& texture)
+{
+    const int width = texture.m_width + 2 * m_padding;
+    const int height = texture.m_height + 2 * m_padding;
+
+    // Try the open pages from oldest to newest, so that old pages are
+    // filled up and can be finished early
+    Page* target = nullptr;
+    size_t node = 0;
+    unsigned short int x = 0, y = 0;
+    for (auto& page : m_openPages)
+    {
+        if (page.texture.m_numChannels == texture.m_numChannels
+            && page.texture.m_numBytesPerChan == texture.m_numBytesPerChan
+            && findPosition(page, width, height, node, x, y))
+        {
+            target = &page;
+            break;
+        }
+    }
+
+    if (!target)
+    {
+        if (m_openPages.size() >= m_maxOpenPages)
+        {
+            finishOldestPage();
+        }
+        openPage(texture, width, height);
+        target = &m_openPages.back();
+        findPosition(*target, width, height, node, x, y);
+    }
+
+    addToSkyline(*target, node, x, y, width, height);
+    copyTexels(texture, target->texture, x + m_padding, y + m_padding);
+
+    AtlasRegion region;
+    region.page = target->texture.m_index;
+    region.x = x + m_padding;
+    region.y = y + m_padding;
+    region.width = texture.m_width;
+    region.height = texture.m_height;
+    region.pageWidth = target->texture.m_width;
+    region.pageHeight = target->texture.m_height;
+    return region;
+}
+
+void TextureAtlas::finish()
+{
+    while (!m_openPages.empty())
+    {
+        finishOldestPage();
+    }
+}
+
+bool TextureAtlas::takeFinishedPage(Texture& page)
+{
+    if (m_finishedPages.empty())
+    {
+        return false;
+    }
+    page = std::move(m_finishedPages.front());
+    m_finishedPages.pop_front();
+    return true;
+}
+
+size_t TextureAtlas::numPages() const
+{
+    return m_numPages;
+}
+
+bool TextureAtlas::findPosition(
+    const Page& page,
+    unsigned short int width,
+    unsigned short int height,
+    size_t& node,
+    unsigned short int& x,
+    unsigned short int& y
+) const
+{
+    const auto& skyline = page.skyline;
+    bool found = false;
+
+    // The skyline covers the whole width of the page, sorted by x. Try to
+    // put the rectangle at the start of each node and keep the lowest spot.
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        const int left = skyline[i].x;
+        if (left + width > page.texture.m_width)
+        {
+            break;
+        }
+
+        // The rectangle rests on the highest node below it
+        int top = 0;
+        int remaining = width;
+        for (size_t j = i; remaining > 0; j++)
+        {
+            top = std::max<int>(top, skyline[j].y);
+            remaining -= skyline[j].width;
+        }
+
+        if (top + height > page.texture.m_height)
+        {
+            continue;
+        }
+
+        if (!found || top < y)
+        {
+            found = true;
+            node = i;
+            x = left;
+            y = top;
+        }
+    }
+
+    return found;
+}
+
+void TextureAtlas::addToSkyline(
+    Page& page,
+    size_t node,
+    unsigned short int x,
+    unsigned short int y,
+    unsigned short int width,
+    unsigned short int height
+)
+{
+    auto& skyline = page.skyline;
+    skyline.insert(skyline.begin() + node, SkylineNode{x, static_cast<unsigned short int>(y + height), width});
+
+    // Cut away the parts of the following nodes that are now covered
+    const int right = x + width;
+    size_t i = node + 1;
+    while (i < skyline.size() && skyline[i].x < right)
+    {
+        const int covered = right - skyline[i].x;
+        if (covered >= skyline[i].width)
+        {
+            skyline.erase(skyline.begin() + i);
+        }
+        else
+        {
+            skyline[i].x += covered;
+            skyline[i].width -= covered;
+            break;
+        }
+    }
+
+    // Merge neighbours of the same height
+    for (i = 0; i + 1 < skyline.size(); )
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void TextureAtlas::copyTexels(const Texture& texture, Texture& page, unsigned short int x, unsigned short int y)
+{
+    const int width = texture.m_width;
+    const int height = texture.m_height;
+    const int padding = m_padding;
+    const size_t texelSize = texture.m_numChannels * texture.m_numBytesPerChan;
+
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+
+    for (int row = -padding; row < height + padding; row++)
+    {
+        const int srcRow = std::min(std::max(row, 0), height - 1);
+        const unsigned char* src = texture.m_data + srcRow * width * texelSize;
+        unsigned char* dst = page.m_data + ((y + row) * (size_t)page.m_width + x) * texelSize;
+
+        std::memcpy(dst, src, width * texelSize);
+
+        // Repeat the first and last texel of the row in the padding
+        for (int i = 1; i <= padding; i++)
+        {
+            std::memcpy(dst - i * texelSize, src, texelSize);
+            std::memcpy(dst + (width - 1 + i) * texelSize, src + (width - 1) * texelSize, texelSize);
+        }
+    }
+}
+
+void TextureAtlas::openPage(const Texture& texture, unsigned short int width, unsigned short int height)
+{
+    Page page;
+    page.texture = Texture(
+        m_numPages++,
+        std::max(m_pageWidth, width),
+        std::max(m_pageHeight, height),
+        texture.m_numChannels,
+        texture.m_numBytesPerChan,
+        texture.m_texelSize
+    );
+
+    const size_t numBytes = (size_t)page.texture.m_width * page.texture.m_height
+                          * page.texture.m_numChannels * page.texture.m_numBytesPerChan;
+    std::memset(page.texture.m_data, 0, numBytes);
+
+    page.skyline.push_back(SkylineNode{0, 0, page.texture.m_width});
+    m_openPages.push_back(std::move(page));
+}
+
+void TextureAtlas::finishOldestPage()
+{
+    m_finishedPages.push_back(std::move(m_openPages.front().texture));
+    m_openPages.pop_front();
+}
+
+} // namespace lvr2
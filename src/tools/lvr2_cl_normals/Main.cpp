@@ -34,7 +34,10 @@
 
 #include <boost/filesystem.hpp>
 
+#ifdef LVR2_USE_OPENCL
 #include "lvr2/reconstruction/opencl/ClSurface.hpp"
+#endif
+#include "lvr2/reconstruction/CpuSurface.hpp"
 
 #include "lvr2/geometry/HalfEdgeMesh.hpp"
 
@@ -52,6 +55,30 @@
 
 using namespace lvr2;
 
+using Vec = BaseVector<float>;
+
+template<typename SurfaceT>
+void calculateNormals(SurfaceT& surface, cl_normals::Options& opt, floatArr normals)
+{
+    surface.setKn(opt.kn());
+    surface.setKi(opt.ki());
+
+    if(opt.useRansac())
+    {
+        surface.setMethod("RANSAC");
+    } else
+    {
+        surface.setMethod("PCA");
+    }
+    surface.setFlippoint(opt.flipx(), opt.flipy(), opt.flipz());
+
+    cout << timestamp << "Start Normal Calculation..." << endl;
+    surface.calculateNormals();
+
+    surface.getNormals(normals);
+    cout << timestamp << "Finished Normal Calculation. " << endl;
+}
+
 void computeNormals(string filename, cl_normals::Options& opt, PointBufferPtr& buffer)
 {
     ModelPtr model = ModelFactory::readModel(filename);
@@ -73,31 +100,27 @@ void computeNormals(string filename, cl_normals::Options& opt, PointBufferPtr& b
     floatArr normals = floatArr(new float[ num_points * 3 ]);
 
     cout << timestamp << "Constructing kd-tree..." << endl;
-    ClSurface gpu_surface(points, num_points);
-    cout << timestamp << "Finished kd-tree construction." << endl;
-
-    gpu_surface.setKn(opt.kn());
-    gpu_surface.setKi(opt.ki());
-
-    if(opt.useRansac())
+#ifdef LVR2_USE_OPENCL
+    if(!opt.useCpu())
     {
-        gpu_surface.setMethod("RANSAC");
-    } else
-    {
-        gpu_surface.setMethod("PCA");
-    }
-    gpu_surface.setFlippoint(opt.flipx(), opt.flipy(), opt.flipz());
+        ClSurface gpu_surface(points, num_points);
+        cout << timestamp << "Finished kd-tree construction." << endl;
 
-    cout << timestamp << "Start Normal Calculation..." << endl;
-    gpu_surface.calculateNormals();
+        calculateNormals(gpu_surface, opt, normals);
+        gpu_surface.freeGPU();
+    }
+    else
+#endif
+    {
+        // Without OpenCL support the normals are always estimated on the CPU
+        CpuSurface cpu_surface(points, num_points);
+        cout << timestamp << "Finished kd-tree construction." << endl;
 
-    gpu_surface.getNormals(normals);
-    cout << timestamp << "Finished Normal Calculation. " << endl;
+        calculateNormals(cpu_surface, opt, normals);
+    }
 
     buffer->setPointArray(points, num_points);
     buffer->setNormalArray(normals, num_points);
-
-    gpu_surface.freeGPU();
 }
 
 void reconstructAndSave(PointBufferPtr& buffer, cl_normals::Options& opt)
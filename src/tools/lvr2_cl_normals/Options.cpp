@@ -41,6 +41,7 @@ Options::Options(int argc, char** argv) : m_descr("Supported options")
     ("outputFile,o",    value<string>(&m_outputFile)->default_value("normals.ply"), "Output file name.")
     ("ransac", "Set this flag for RANSAC based normal estimation.")
     ("pca", "Set this flag for RANSAC based normal estimation.")
+    ("cpu", "Estimate the normals on the CPU instead of the OpenCL device. Always done if lvr2 was built without OpenCL.")
     ("kn", value<int>(&m_kn)->default_value(10), "Number of normals used for normal estimation")
     ("ki", value<int>(&m_ki)->default_value(10), "Number of normals used for normal interpolation")
     ("kd", value<int>(&m_kd)->default_value(5), "Number of normals used for distance calculation")
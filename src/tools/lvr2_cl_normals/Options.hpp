@@ -82,6 +82,11 @@ public:
         return (m_variables.count("pca"));
     }
 
+    bool    useCpu() const
+    {
+        return (m_variables.count("cpu"));
+    }
+
     float     flipx() const
     {
         return m_variables["flipx"].as<float>();
@@ -163,6 +168,9 @@ inline ostream& operator<<(ostream& os, const Options& o)
     }else{
         os << "Normal Calculation with PCA" << endl;
     }
+    if(o.useCpu()){
+        os << "Normal Calculation on CPU" << endl;
+    }
     os << "Neighbors for normal estimation: "<< o.kn() << endl;
     os << "Neighbors for normal interpolation: " << o.ki() << endl;
     os << "Neighbors for distance function: " << o.kd() << endl;
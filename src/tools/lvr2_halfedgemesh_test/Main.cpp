@@ -0,0 +1,268 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Main.cpp
+ *
+ * Builds meshes from index buffers with HalfEdgeMesh's bulk constructor and
+ * with one addFace() call per face and checks that both are the same. The
+ * test meshes include boundaries, closed surfaces, non-manifold edges and
+ * vertices and random parts of a grid.
+ */
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/HalfEdgeMesh.hpp"
+#include "lvr2/io/MeshBuffer.hpp"
+#include "lvr2/util/Panic.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace lvr2;
+using Vec = BaseVector<float>;
+
+/**
+ * @brief Describes the topology of the mesh independent of the order of its
+ *        faces and edges.
+ */
+std::string describe(const HalfEdgeMesh<Vec>& mesh)
+{
+    std::string s = std::to_string(mesh.numVertices()) + "/"
+        + std::to_string(mesh.numFaces()) + "/"
+        + std::to_string(mesh.numEdges()) + "|";
+
+    // Faces with their first vertex rotated to the front
+    std::multiset<std::vector<Index>> faces;
+    for (auto fH : mesh.faces())
+    {
+        auto v = mesh.getVerticesOfFace(fH);
+        std::vector<Index> face = {v[0].idx(), v[1].idx(), v[2].idx()};
+        std::rotate(face.begin(), std::min_element(face.begin(), face.end()), face.end());
+        faces.insert(face);
+    }
+    for (auto& face : faces)
+    {
+        s += std::to_string(face[0]) + "," + std::to_string(face[1]) + ","
+            + std::to_string(face[2]) + ";";
+    }
+    s += "|";
+
+    // Neighbors and number of faces of each vertex
+    for (auto vH : mesh.vertices())
+    {
+        std::vector<VertexHandle> neighbors;
+        std::vector<FaceHandle> vertexFaces;
+        try
+        {
+            mesh.getNeighboursOfVertex(vH, neighbors);
+            mesh.getFacesOfVertex(vH, vertexFaces);
+        }
+        catch (PanicException& e)
+        {
+            // Both ways of building have to break the same vertices
+            s += "!";
+        }
+
+        std::set<Index> sorted;
+        for (auto n : neighbors)
+        {
+            sorted.insert(n.idx());
+        }
+
+        s += std::to_string(vH.idx()) + ":";
+        for (auto n : sorted)
+        {
+            s += std::to_string(n) + ",";
+        }
+        s += "f" + std::to_string(vertexFaces.size()) + ";";
+    }
+    s += "|";
+
+    // Edges with the number of their faces
+    std::set<std::string> edges;
+    for (auto eH : mesh.edges())
+    {
+        auto v = mesh.getVerticesOfEdge(eH);
+        auto f = mesh.getFacesOfEdge(eH);
+        edges.insert(std::to_string(std::min(v[0].idx(), v[1].idx())) + "-"
+            + std::to_string(std::max(v[0].idx(), v[1].idx())) + "#"
+            + std::to_string((f[0] ? 1 : 0) + (f[1] ? 1 : 0)));
+    }
+    for (auto& e : edges)
+    {
+        s += e + ";";
+    }
+
+    return s;
+}
+
+/**
+ * @brief Builds the mesh both ways and returns true if they are equal.
+ */
+bool compare(const std::string& name, size_t numVertices, const std::vector<unsigned int>& indices)
+{
+    floatArr vertices(new float[3 * numVertices]);
+    for (size_t i = 0; i < 3 * numVertices; i++)
+    {
+        vertices[i] = i;
+    }
+
+    indexArray faceIndices(new unsigned int[indices.size()]);
+    std::copy(indices.begin(), indices.end(), faceIndices.get());
+
+    MeshBufferPtr buffer(new MeshBuffer);
+    buffer->setVertices(vertices, numVertices);
+    buffer->setFaceIndices(faceIndices, indices.size() / 3);
+
+    HalfEdgeMesh<Vec> bulk(buffer);
+
+    HalfEdgeMesh<Vec> single;
+    for (size_t i = 0; i < numVertices; i++)
+    {
+        single.addVertex(Vec(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]));
+    }
+    for (size_t f = 0; f < indices.size() / 3; f++)
+    {
+        VertexHandle v1(indices[3 * f]);
+        VertexHandle v2(indices[3 * f + 1]);
+        VertexHandle v3(indices[3 * f + 2]);
+        if (v1 == v2 || v2 == v3 || v1 == v3
+            || std::max({v1.idx(), v2.idx(), v3.idx()}) >= numVertices)
+        {
+            continue;
+        }
+
+        try
+        {
+            single.addFace(v1, v2, v3);
+        }
+        catch (PanicException& e)
+        {
+            // Omitted by the bulk constructor as well
+        }
+    }
+
+    std::string expected = describe(single);
+    std::string actual = describe(bulk);
+    if (actual != expected)
+    {
+        std::cout << name << ": Meshes differ." << std::endl;
+        std::cout << "  addFace(): " << expected << std::endl;
+        std::cout << "  bulk:      " << actual << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    size_t failed = 0;
+
+    // Grid with a boundary
+    {
+        const unsigned int n = 30;
+        std::vector<unsigned int> indices;
+        for (unsigned int i = 0; i + 1 < n; i++)
+        {
+            for (unsigned int j = 0; j + 1 < n; j++)
+            {
+                unsigned int a = i * n + j;
+                unsigned int b = (i + 1) * n + j;
+                indices.insert(indices.end(), {a, b, a + 1, b, b + 1, a + 1});
+            }
+        }
+        failed += !compare("grid", n * n, indices);
+    }
+
+    // Closed surface
+    failed += !compare("tetrahedron", 4, {0, 1, 2, 0, 3, 1, 1, 3, 2, 2, 3, 0});
+
+    // Several fans around one vertex
+    failed += !compare("bowtie", 5, {0, 1, 2, 0, 3, 4});
+    failed += !compare("fans", 7, {0, 1, 2, 0, 3, 4, 0, 5, 6, 0, 2, 3});
+
+    // Vertices with more than one closed fan are not compared: A half edge
+    // mesh can't represent them and addFace() leaves broken faces behind.
+
+    // Non-manifold edges
+    failed += !compare("three faces at an edge", 5, {0, 1, 2, 1, 0, 3, 0, 1, 4});
+    failed += !compare("same orientation", 4, {0, 1, 2, 0, 1, 3});
+
+    // Degenerated faces and invalid indices
+    failed += !compare("invalid faces", 4, {0, 1, 1, 0, 1, 2, 2, 1, 3, 0, 2, 7});
+
+    // Random parts of a grid with shuffled faces and vertex indices. They
+    // have holes and vertices with several fans.
+    std::mt19937 rng(42);
+    for (int t = 0; t < 2000; t++)
+    {
+        const unsigned int n = 3 + rng() % 6;
+        std::vector<unsigned int> ids(n * n);
+        for (unsigned int i = 0; i < n * n; i++)
+        {
+            ids[i] = i;
+        }
+        std::shuffle(ids.begin(), ids.end(), rng);
+
+        std::vector<std::array<unsigned int, 3>> faces;
+        for (unsigned int i = 0; i + 1 < n; i++)
+        {
+            for (unsigned int j = 0; j + 1 < n; j++)
+            {
+                unsigned int a = ids[i * n + j];
+                unsigned int b = ids[(i + 1) * n + j];
+                unsigned int c = ids[i * n + j + 1];
+                unsigned int d = ids[(i + 1) * n + j + 1];
+                if (rng() % 4 != 0)
+                {
+                    faces.push_back({a, b, c});
+                }
+                if (rng() % 4 != 0)
+                {
+                    faces.push_back({b, d, c});
+                }
+            }
+        }
+        std::shuffle(faces.begin(), faces.end(), rng);
+
+        std::vector<unsigned int> indices;
+        for (auto& f : faces)
+        {
+            indices.insert(indices.end(), f.begin(), f.end());
+        }
+        failed += !compare("random grid " + std::to_string(t), n * n, indices);
+    }
+
+    std::cout << "HalfEdgeMesh test: " << failed << " failed." << std::endl;
+    return failed == 0 ? 0 : 1;
+}
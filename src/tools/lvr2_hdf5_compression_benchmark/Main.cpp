@@ -0,0 +1,230 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Main.cpp
+ *
+ * Writes a scan project with each HDF5 compression profile and reports
+ * write time, read time and file size.
+ */
+
+#include "lvr2/io/ScanIOUtils.hpp"
+#include "lvr2/io/Timestamp.hpp"
+#include "lvr2/io/hdf5/ArrayIO.hpp"
+#include "lvr2/io/hdf5/HDF5FeatureBase.hpp"
+#include "lvr2/io/hdf5/ScanProjectIO.hpp"
+#include "lvr2/types/ScanTypes.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace lvr2;
+
+using BaseHDF5IO = lvr2::Hdf5IO<>;
+using HDF5IO =
+    BaseHDF5IO::AddFeatures<lvr2::hdf5features::ScanProjectIO, lvr2::hdf5features::ArrayIO>;
+
+namespace
+{
+
+/**
+ * @brief Creates a deterministic scan project that resembles terrestrial
+ *        laser scans: Points are sampled row by row on a noisy sphere
+ *        around each scan position, with intensities and colors.
+ */
+ScanProjectPtr createReferenceProject(size_t numPositions, size_t pointsPerScan)
+{
+    ScanProjectPtr project(new ScanProject);
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+
+    const size_t rows = 1000;
+    const size_t cols = std::max<size_t>(pointsPerScan / rows, 1);
+    const size_t n = rows * cols;
+
+    for(size_t p = 0; p < numPositions; p++)
+    {
+        floatArr points(new float[3 * n]);
+        floatArr intensities(new float[n]);
+        ucharArr colors(new unsigned char[3 * n]);
+
+        float ox = 10.0f * p;
+        for(size_t r = 0; r < rows; r++)
+        {
+            float phi = M_PI * (r + 0.5f) / rows - M_PI_2;
+            for(size_t c = 0; c < cols; c++)
+            {
+                size_t i = r * cols + c;
+                float theta = 2 * M_PI * c / cols;
+                float d = 5.0f + 2.0f * std::sin(3 * theta) * std::cos(phi) + noise(rng);
+
+                points[3 * i]     = ox + d * std::cos(phi) * std::cos(theta);
+                points[3 * i + 1] = d * std::cos(phi) * std::sin(theta);
+                points[3 * i + 2] = d * std::sin(phi);
+                intensities[i]    = 100.0f / (d * d);
+                colors[3 * i]     = static_cast<unsigned char>(128 + 127 * std::sin(theta));
+                colors[3 * i + 1] = static_cast<unsigned char>(128 + 127 * std::cos(phi));
+                colors[3 * i + 2] = static_cast<unsigned char>(d * 20);
+            }
+        }
+
+        PointBufferPtr buffer(new PointBuffer(points, n));
+        buffer->addFloatChannel(intensities, "intensities", n, 1);
+        buffer->setColorArray(colors, n);
+
+        ScanPtr scan(new Scan);
+        scan->points = buffer;
+        scan->numPoints = n;
+        scan->pointsLoaded = true;
+        scan->positionNumber = p;
+        scan->phiMin = -90;
+        scan->phiMax = 90;
+        scan->thetaMin = 0;
+        scan->thetaMax = 360;
+        scan->vResolution = 180.0 / rows;
+        scan->hResolution = 360.0 / cols;
+        for(size_t i = 0; i < n; i++)
+        {
+            scan->boundingBox.expand(BaseVector<float>(points[3 * i], points[3 * i + 1], points[3 * i + 2]));
+        }
+
+        ScanPositionPtr position(new ScanPosition);
+        position->scans.push_back(scan);
+        project->positions.push_back(position);
+    }
+    return project;
+}
+
+double secondsSince(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if(argc > 1 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help"))
+    {
+        std::cout << "Usage: " << argv[0] << " [scan project directory] [output directory]" << std::endl;
+        std::cout << "Without a scan project directory a synthetic reference project is used." << std::endl;
+        return 0;
+    }
+
+    ScanProjectPtr project;
+    if(argc > 1 && std::string(argv[1]) != "-")
+    {
+        project.reset(new ScanProject);
+        std::cout << timestamp << "Reading scan project from " << argv[1] << std::endl;
+        if(!loadScanProject(argv[1], *project))
+        {
+            std::cout << timestamp << "Unable to load scan project from " << argv[1] << std::endl;
+            return -1;
+        }
+    }
+    else
+    {
+        std::cout << timestamp << "Creating reference scan project" << std::endl;
+        project = createReferenceProject(4, 1000000);
+    }
+
+    boost::filesystem::path outputDir = argc > 2 ? argv[2] : boost::filesystem::temp_directory_path();
+    boost::filesystem::create_directories(outputDir);
+
+    size_t rawBytes = 0;
+    for(ScanPositionPtr position : project->positions)
+    {
+        for(ScanPtr scan : position->scans)
+        {
+            if(scan->points)
+            {
+                size_t n = scan->points->numPoints();
+                rawBytes += n * 3 * sizeof(float);
+                rawBytes += scan->points->hasColors() ? n * 3 : 0;
+                rawBytes += scan->points->getFloatChannel("intensities") ? n * sizeof(float) : 0;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, Hdf5CompressionProfile>> profiles = {
+        { "none",               Hdf5CompressionProfile::none() },
+        { "fast",               Hdf5CompressionProfile::fast() },
+        { "balanced",           Hdf5CompressionProfile::balanced() },
+        { "balanced-noshuffle", Hdf5CompressionProfile(Hdf5CompressionProfile::BALANCED, false) },
+        { "max",                Hdf5CompressionProfile::max() },
+        { "zstd",               Hdf5CompressionProfile(Hdf5CompressionProfile::BALANCED, true, Hdf5CompressionProfile::ZSTD) }
+    };
+
+    std::cout << timestamp << "Raw payload: " << rawBytes / 1e6 << " MB" << std::endl;
+    std::cout << "LZ4 filter available:  " << Hdf5CompressionProfile::available(Hdf5CompressionProfile::LZ4) << std::endl;
+    std::cout << "Zstd filter available: " << Hdf5CompressionProfile::available(Hdf5CompressionProfile::ZSTD) << std::endl;
+    std::cout << std::endl;
+    std::cout << std::left << std::setw(20) << "profile"
+              << std::right << std::setw(12) << "size [MB]"
+              << std::setw(10) << "ratio"
+              << std::setw(12) << "write [s]"
+              << std::setw(12) << "write MB/s"
+              << std::setw(12) << "read [s]" << std::endl;
+
+    for(auto& profile : profiles)
+    {
+        boost::filesystem::path file = outputDir / ("compression_" + profile.first + ".h5");
+        boost::filesystem::remove(file);
+
+        auto start = std::chrono::steady_clock::now();
+        {
+            HDF5IO hdf;
+            hdf.open(file.string());
+            hdf.setCompression(profile.second);
+            hdf.save(project);
+        }
+        double writeTime = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        {
+            HDF5IO hdf;
+            hdf.open(file.string());
+            ScanProjectPtr loaded = hdf.loadScanProject();
+        }
+        double readTime = secondsSince(start);
+
+        double size = boost::filesystem::file_size(file);
+        std::cout << std::left << std::setw(20) << profile.first << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(12) << size / 1e6
+                  << std::setw(10) << rawBytes / size
+                  << std::setw(12) << writeTime
+                  << std::setw(12) << rawBytes / 1e6 / writeTime
+                  << std::setw(12) << readTime << std::endl;
+    }
+
+    return 0;
+}
@@ -3,14 +3,21 @@
  * @author ndettmer <ndettmer@uos.de>
  */
 
-#include "lvr2/io/HDF5IO.hpp"
+#include <highfive/H5File.hpp>
 
 #include <boost/range/iterator_range.hpp>
 #include <boost/foreach.hpp>
 #include <boost/filesystem.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <string>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <sys/stat.h>
 
@@ -20,28 +27,121 @@
 
 using namespace lvr2;
 
+/**
+ * @brief Bounded queue of band blocks that were read from HDF5 and wait to be written into the GeoTIFF
+ */
+class BlockQueue
+{
+public:
+    struct Block
+    {
+        size_t channel;
+        size_t row;
+        size_t rows;
+        std::vector<uint16_t> data;
+    };
+
+    /**
+     * @param capacity maximum number of blocks held in the queue
+     */
+    BlockQueue(size_t capacity) : m_capacity(capacity), m_closed(false) {}
+
+    /**
+     * @brief Waits until there is space for the block and appends it
+     * @return false if the queue was closed and the block was dropped
+     */
+    bool push(Block&& block)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_blocks.size() < m_capacity; });
+        if (m_closed)
+        {
+            return false;
+        }
+        m_blocks.push_back(std::move(block));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Waits for the next block
+     * @return false if the queue was closed and all blocks were taken
+     */
+    bool pop(Block& block)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_blocks.empty(); });
+        if (m_blocks.empty())
+        {
+            return false;
+        }
+        block = std::move(m_blocks.front());
+        m_blocks.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Wakes up all waiting threads. Blocks in the queue can still be taken, new ones are dropped.
+     */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_notFull;
+    std::condition_variable m_notEmpty;
+    std::deque<Block> m_blocks;
+    size_t m_capacity;
+    bool m_closed;
+};
+
 /**
  * @brief Extraction of radiometric data from a given HDF5 file into a new GeoTIFF file in (optionally) given output path
+ *
+ * Each band is streamed in blocks of rows that match the tiles of the output file, so only a few
+ * blocks are held in memory. HDF5 serializes all calls (even thread safe builds use a global lock)
+ * and a GDAL dataset has to be written by a single thread. Therefore one thread reads the blocks
+ * from HDF5 while the calling thread writes them into the GeoTIFF. The tiles are compressed by
+ * GDAL's own worker threads.
+ *
  * @param input_filename Path to the input HDF5 file formatted due to lvr_2 convention
  * @param position_code 5 character code of the scan position (e.g. 00000)
  * @param output_filename Path to the output GeoTIFF file
  * @param min_channel lowest channel to be extracted
  * @param max_channel highest channel to be extracted
+ * @param tile_size width and height of the GeoTIFF tiles
+ * @param compression GDAL compression of the GeoTIFF file
  * @return standard C++ return value
  */
 int processConversion(std::string input_filename,
-        std::string position_code, std::string output_filename, size_t min_channel, size_t max_channel)
+        std::string position_code, std::string output_filename, size_t min_channel, size_t max_channel,
+        int tile_size, std::string compression)
 {
     /*------------------- HDF5 INPUT ------------------------*/
-    HDF5IO hdf5(input_filename, false);
-    std::vector<size_t> dim;
+    HighFive::File hdf5(input_filename, HighFive::File::ReadOnly);
 
-    // extract radiometric data
+    // open radiometric data without reading it
     std::string groupname = "raw/spectral/position_" + position_code;
     std::string datasetname = "spectral";
-    boost::shared_array<uint16_t> spectrals = hdf5.getArray<uint16_t>(groupname, datasetname, dim);
+    std::unique_ptr<HighFive::DataSet> spectrals;
+    try
+    {
+        spectrals.reset(new HighFive::DataSet(hdf5.getGroup(groupname).getDataSet(datasetname)));
+    }
+    catch (HighFive::Exception& e)
+    {
+        std::cout << "The dataset " << groupname << "/" << datasetname << " does not exist." << std::endl;
+        return -1;
+    }
 
     // extract array dimension information
+    std::vector<size_t> dim = spectrals->getSpace().getDimensions();
     size_t num_channels = dim[0];
     size_t num_rows = dim[1];
     size_t num_cols = dim[2];
@@ -54,29 +154,63 @@ int processConversion(std::string input_filename,
     }
     num_channels = max_channel - min_channel;
 
-    GeoTIFFIO gtifio(output_filename, num_cols, num_rows, num_channels);
+    GeoTIFFIO gtifio(output_filename, num_cols, num_rows, num_channels, tile_size, compression);
+    size_t block_rows = std::max(gtifio.getBlockHeight(), 1);
 
     /*--------------- FILE CONVERSION --------------------*/
-    // for each channel create a cv::Mat containing the spectral intensity data for the channel ...
-    for(size_t channel = 0; channel < num_channels; channel++)
+    // The reader stays a few blocks ahead of the writer
+    BlockQueue queue(4);
+    bool read_failed = false;
+
+    std::thread reader([&]()
     {
-        cv::Mat *mat = new cv::Mat(num_rows, num_cols, CV_16UC1);
-        for(size_t row = 0; row < num_rows; row++)
+        try
         {
-            for(size_t col = 0; col < num_cols; col++)
+            for(size_t channel = 0; channel < num_channels; channel++)
             {
-                mat->at<uint16_t>(row, col) = spectrals.get()[(channel + min_channel) * num_cols * num_rows + row * num_cols + col];
+                for(size_t row = 0; row < num_rows; row += block_rows)
+                {
+                    BlockQueue::Block block;
+                    block.channel = channel;
+                    block.row = row;
+                    block.rows = std::min(block_rows, num_rows - row);
+                    block.data.resize(block.rows * num_cols);
+                    spectrals->select({channel + min_channel, row, 0}, {1, block.rows, num_cols}).read(block.data.data());
+
+                    // The writer closes the queue if it failed
+                    if (!queue.push(std::move(block)))
+                    {
+                        return;
+                    }
+                }
             }
         }
-        // ... and write it to the output GeoTIFF file
-        int ret = gtifio.writeBand(mat, channel + 1);
-        delete mat;
+        catch (HighFive::Exception& e)
+        {
+            std::cout << "Reading the dataset " << groupname << "/" << datasetname << " failed: " << e.what() << std::endl;
+            read_failed = true;
+        }
+        queue.close();
+    });
+
+    int ret = 0;
+    BlockQueue::Block block;
+    while (queue.pop(block))
+    {
+        ret = gtifio.writeBlock(block.data.data(), block.channel + 1, 0, block.row, num_cols, block.rows);
         if (ret != 0)
         {
-            return ret;
+            queue.close();
+            break;
         }
     }
-    return 0;
+    reader.join();
+
+    if (read_failed)
+    {
+        return -1;
+    }
+    return ret;
 }
 
 int main(int argc, char**argv)
@@ -96,6 +230,9 @@ int main(int argc, char**argv)
 
     std::string position_code = options.getPositionCode();
 
+    int tile_size = options.getTileSize();
+    std::string compression = options.getCompression();
+
     /*---------------- PREPARE CONVERSION -------------------*/
 
     boost::filesystem::path output_dir = output_filename.parent_path();
@@ -105,7 +242,8 @@ int main(int argc, char**argv)
     }
 
     std::cout << "Starting conversion..." <<  std::endl;
-    if (processConversion(input_filename.string(), position_code, output_filename.string(), min_channel, max_channel) < 0)
+    if (processConversion(input_filename.string(), position_code, output_filename.string(), min_channel, max_channel,
+            tile_size, compression) < 0)
     {
         std::cout << "An Error occurred during conversion." << std::endl;
     }
@@ -44,7 +44,9 @@ namespace hdf5togeotiff
                 ("gtif", value<string>()->default_value("gtif.tif"), "Output GeoTIFF raster dataset containing hyperspectral data.")
                 ("min", value<size_t>()->default_value(0), "Minimum hyperspectral band to be included in conversion.")
                 ("max", value<size_t>()->default_value(UINT_MAX), "Maximum hyperspectral band to be included in conversion.")
-                ("pos", value<string>()->default_value("00000"), "5 character identification code of scan position to be converted.");
+                ("pos", value<string>()->default_value("00000"), "5 character identification code of scan position to be converted.")
+                ("tile", value<int>()->default_value(256), "Width and height of the GeoTIFF tiles. 0 writes a striped GeoTIFF.")
+                ("compress", value<string>()->default_value(""), "GDAL compression of the GeoTIFF file, e.g. DEFLATE, LZW or ZSTD.");
 
         // Parse command line and generate variables map
         store(command_line_parser(argc, argv).options(m_descr).positional(m_pdescr).run(), m_variables);
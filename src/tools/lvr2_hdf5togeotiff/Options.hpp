@@ -36,6 +36,8 @@ namespace hdf5togeotiff
         size_t  getMinChannel()     const { return m_variables["min"].as<size_t>(); }
         size_t  getMaxChannel()     const { return m_variables["max"].as<size_t>(); }
         string  getPositionCode()   const { return m_variables["pos"].as<string>(); }
+        int     getTileSize()       const { return m_variables["tile"].as<int>(); }
+        string  getCompression()    const { return m_variables["compress"].as<string>(); }
 
     private:
         /// The internally used variable map
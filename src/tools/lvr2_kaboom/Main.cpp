@@ -36,6 +36,7 @@
 #include "Options.hpp"
 
 #include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/io/PointCloudWriter.hpp"
 #include "lvr2/io/ScanDirectoryParser.hpp"
 #include "lvr2/io/IOUtils.hpp"
 #include "lvr2/registration/OctreeReduction.hpp"
@@ -59,6 +60,49 @@ int main(int argc, char** argv) {
 
     if(options.getInputFile() != "")
     {
+        string targetFileName;
+        if(options.getOutputFile() == "")
+        {
+            targetFileName = "result.ply";
+        }
+        else
+        {
+            targetFileName = options.getOutputFile();
+        }
+
+        // Without reduction the points can be converted batch by batch if
+        // supported by the input and output format
+        if(!options.getTargetSize() && !options.getVoxelSize())
+        {
+            PointCloudWriterPtr writer;
+            bool writerFailed = false;
+            bool streamed = ModelFactory::readPointCloudBatches(options.getInputFile(), 1 << 22,
+                [&](PointBufferPtr batch)
+                {
+                    if(!writer && !writerFailed)
+                    {
+                        std::cout << timestamp << "Streaming '" << options.getInputFile()
+                                  << "' to '" << targetFileName << "'" << std::endl;
+                        writer = ModelFactory::openPointCloudWriter(targetFileName, PointCloudLayout(*batch));
+                        writerFailed = !writer;
+                    }
+                    if(writer)
+                    {
+                        if(options.convertToLVR())
+                        {
+                            slamToLVRInPlace(batch);
+                        }
+                        writer->append(batch);
+                    }
+                });
+
+            if(streamed && writer)
+            {
+                writer->close();
+                return 0;
+            }
+        }
+
         std::cout << timestamp << "Reading '" << options.getInputFile() << "." << std::endl;
         ModelPtr model = ModelFactory::readModel(options.getInputFile());
         if(model)
@@ -86,16 +130,6 @@ int main(int argc, char** argv) {
                 slamToLVRInPlace(result);
             }
 
-            string targetFileName;
-            if(options.getOutputFile() == "")
-            {
-                targetFileName = "result.ply";
-            }
-            else
-            {
-                targetFileName = options.getOutputFile();
-            }
-
             std::cout << timestamp << "Saving '" << targetFileName << "'" << std::endl;
             ModelFactory::saveModel(ModelPtr(new Model(result)), targetFileName);
         }
@@ -117,13 +151,15 @@ int main(int argc, char** argv) {
         parser.setPoseExtension(options.getPoseExtension());
         parser.parseDirectory(); 
 
-        if(options.getTargetSize())
+        // Every scan is written to its own file. Without reduction the
+        // scans are streamed batch by batch like in random reduction.
+        if(options.getVoxelSize())
         {
-            PointBufferPtr result = parser.randomSubSample(options.getTargetSize());
+            parser.octreeSubSample(options.getVoxelSize(), options.getMinPointsPerVoxel());
         }
         else
         {
-            PointBufferPtr result = parser.octreeSubSample(options.getVoxelSize(), options.getMinPointsPerVoxel());
+            parser.randomSubSample(options.getTargetSize());
         }
 
     }
@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Main.cpp
+ *
+ * Builds LBKdTrees with different numbers of threads and checks that the
+ * leaves are a permutation of the points and that every point lies on the
+ * correct side of the splits of all its ancestors.
+ */
+
+#include "lvr2/reconstruction/LBKdTree.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lvr2;
+
+/**
+ * @brief Creates n random points. Mode 0 is uniform, mode 1 has many
+ *        duplicate coordinates, mode 2 has only equal points and mode 3
+ *        is sorted along the x axis.
+ */
+std::vector<float> createPoints(size_t n, int mode)
+{
+    std::mt19937 rng(n + mode);
+    std::uniform_real_distribution<float> uniform(-10, 10);
+
+    std::vector<float> points(n * 3);
+    for (size_t i = 0; i < n * 3; i++)
+    {
+        float v = uniform(rng);
+        if (mode == 1)
+        {
+            v = std::floor(v);
+        }
+        else if (mode == 2)
+        {
+            v = 1.0f;
+        }
+        else if (mode == 3)
+        {
+            v = (i % 3 == 0) ? float(i) : 0.0f;
+        }
+        points[i] = v;
+    }
+    return points;
+}
+
+/**
+ * @brief Checks the tree built for the given points. Returns an error
+ *        message or an empty string.
+ */
+std::string checkTree(LBKdTree& tree, const std::vector<float>& points)
+{
+    const size_t n = points.size() / 3;
+    auto values = tree.getKdTreeValues();
+    auto splits = tree.getKdTreeSplits();
+    auto indices = tree.getKdTreeIndices();
+
+    // Every point is stored in exactly one leaf
+    std::vector<int> seen(n, 0);
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned int p = indices->elements[i];
+        if (p >= n || seen[p]++)
+        {
+            return "leaves are no permutation of the points";
+        }
+    }
+
+    // The leaf values repeat the indices as float
+    for (size_t i = 0; i < n; i++)
+    {
+        if (values->elements[splits->width + i] != static_cast<float>(indices->elements[i]))
+        {
+            return "leaf value " + std::to_string(i) + " differs from its index";
+        }
+    }
+
+    // The leaf of entry i is the node at position splits->width + i. Points
+    // in a left subtree must not be larger than the split value of the
+    // parent, points in a right subtree not smaller.
+    for (size_t i = 0; i < n; i++)
+    {
+        const unsigned int p = indices->elements[i];
+        size_t pos = splits->width + i;
+        while (pos > 0)
+        {
+            const size_t parent = (pos - 1) / 2;
+            const float v = points[p * 3 + splits->elements[parent]];
+            const float split = values->elements[parent];
+            if (pos == 2 * parent + 1 ? v > split : v < split)
+            {
+                return "point " + std::to_string(p) + " is on the wrong side of node "
+                    + std::to_string(parent);
+            }
+            pos = parent;
+        }
+    }
+    return "";
+}
+
+int main(int argc, char** argv)
+{
+    size_t failed = 0;
+
+    // Sizes above 2^15 points use the parallel selection in the upper levels
+    for (size_t n : {1, 2, 3, 100, 5000, 70000, 200001})
+    {
+        for (int mode = 0; mode < 4; mode++)
+        {
+            std::vector<float> points = createPoints(n, mode);
+            LBPointArray<float> vertices;
+            vertices.width = n;
+            vertices.dim = 3;
+            vertices.elements = points.data();
+
+            for (int threads : {1, 2, 4, 8})
+            {
+                std::string name = std::to_string(n) + " points, mode " + std::to_string(mode)
+                    + ", " + std::to_string(threads) + " threads";
+
+                LBKdTree tree(vertices, threads);
+                std::string error = checkTree(tree, points);
+
+                if (!error.empty())
+                {
+                    std::cout << name << ": " << error << std::endl;
+                    failed++;
+                }
+            }
+        }
+    }
+
+    std::cout << "LBKdTree test: " << failed << " failed." << std::endl;
+    return failed == 0 ? 0 : 1;
+}
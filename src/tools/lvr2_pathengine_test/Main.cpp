@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Main.cpp
+ *
+ * Compares the paths and distance fields of PathEngine with the results of
+ * Dijkstra() on a grid mesh with random heights, random edge costs and
+ * blocked vertices.
+ */
+
+#include "lvr2/geometry/BaseVector.hpp"
+#include "lvr2/geometry/Normal.hpp"
+#include "lvr2/geometry/HalfEdgeMesh.hpp"
+#include "lvr2/algorithm/GeometryAlgorithms.hpp"
+#include "lvr2/algorithm/PathEngine.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace lvr2;
+using Vec = BaseVector<float>;
+
+/// Returns true if both distances are infinite or equal up to rounding
+bool sameDistance(float a, float b)
+{
+    if (std::isinf(a) || std::isinf(b))
+    {
+        return std::isinf(a) && std::isinf(b);
+    }
+    return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(b));
+}
+
+/**
+ * @brief Checks that `path` connects start and goal via passable vertices and
+ *        returns its cost. Returns NaN for invalid paths.
+ */
+float pathCost(
+    const HalfEdgeMesh<Vec>& mesh,
+    const DenseEdgeMap<float>& edgeCosts,
+    const DenseVertexMap<float>& vertexCosts,
+    VertexHandle start,
+    VertexHandle goal,
+    const std::list<VertexHandle>& path)
+{
+    const float invalid = std::numeric_limits<float>::quiet_NaN();
+    if (path.empty() || path.front() != start || path.back() != goal)
+    {
+        return invalid;
+    }
+
+    float cost = 0;
+    auto prev = path.begin();
+    for (auto it = std::next(prev); it != path.end(); ++it, ++prev)
+    {
+        auto edge = mesh.getEdgeBetween(*prev, *it);
+        if (!edge || vertexCosts[*it] >= 1)
+        {
+            return invalid;
+        }
+        cost += edgeCosts[edge.unwrap()];
+    }
+    return cost;
+}
+
+int main(int argc, char** argv)
+{
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    // Grid with random heights
+    const unsigned int n = 40;
+    HalfEdgeMesh<Vec> mesh;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+        {
+            mesh.addVertex(Vec(i, j, 2 * uniform(rng)));
+        }
+    }
+    for (unsigned int i = 0; i + 1 < n; i++)
+    {
+        for (unsigned int j = 0; j + 1 < n; j++)
+        {
+            VertexHandle a(i * n + j);
+            VertexHandle b((i + 1) * n + j);
+            VertexHandle c(i * n + j + 1);
+            VertexHandle d((i + 1) * n + j + 1);
+            mesh.addFace(a, b, c);
+            mesh.addFace(b, d, c);
+        }
+    }
+
+    // Edge lengths and lengths scaled by random factors
+    DenseEdgeMap<float> lengths = calcVertexDistances(mesh);
+    DenseEdgeMap<float> scaled = lengths;
+    for (auto eH : mesh.edges())
+    {
+        scaled[eH] *= 1 + 3 * uniform(rng);
+    }
+
+    // Every tenth vertex is blocked
+    DenseVertexMap<float> vertexCosts(mesh.nextVertexIndex(), 0.0f);
+    for (auto vH : mesh.vertices())
+    {
+        vertexCosts[vH] = uniform(rng) < 0.1f ? 1.0f : 0.5f * uniform(rng);
+    }
+
+    size_t failed = 0;
+    for (const DenseEdgeMap<float>* edgeCosts : {&lengths, &scaled})
+    {
+        PathEngine<Vec> engine(mesh, *edgeCosts);
+        engine.setVertexCosts(vertexCosts);
+
+        for (int query = 0; query < 100; query++)
+        {
+            // Dijkstra() only computes all distances if start != goal
+            VertexHandle start(rng() % (n * n));
+            VertexHandle goal(rng() % (n * n));
+            VertexHandle secondStart(rng() % (n * n));
+            if (goal == start || goal == secondStart)
+            {
+                continue;
+            }
+
+            // Reference: distances to all vertices from both start vertices
+            std::list<VertexHandle> expectedPath;
+            DenseVertexMap<float> expected;
+            DenseVertexMap<float> expectedSecond;
+            DenseVertexMap<VertexHandle> predecessors;
+            DenseVertexMap<bool> seen(mesh.nextVertexIndex(), false);
+            bool expectedFound = Dijkstra(mesh, start, goal, *edgeCosts, expectedPath,
+                expected, predecessors, seen, vertexCosts);
+
+            DenseVertexMap<bool> seenSecond(mesh.nextVertexIndex(), false);
+            std::list<VertexHandle> secondPath;
+            Dijkstra(mesh, secondStart, goal, *edgeCosts, secondPath,
+                expectedSecond, predecessors, seenSecond, vertexCosts);
+
+            std::string name = "query " + std::to_string(query) + " from "
+                + std::to_string(start.idx()) + " to " + std::to_string(goal.idx());
+
+            // Path query
+            std::list<VertexHandle> path;
+            bool found = engine.findPath(start, goal, path);
+            if (found != expectedFound)
+            {
+                std::cout << name << ": Path found: " << found << ", expected "
+                          << expectedFound << std::endl;
+                failed++;
+            }
+            else if (found)
+            {
+                float cost = pathCost(mesh, *edgeCosts, vertexCosts, start, goal, path);
+                if (!sameDistance(cost, expected[goal]) || !sameDistance(engine.distance(goal), expected[goal]))
+                {
+                    std::cout << name << ": Path cost " << cost << ", expected "
+                              << expected[goal] << std::endl;
+                    failed++;
+                }
+            }
+
+            // Path query with two start vertices
+            float closest = std::min(expected[goal], expectedSecond[goal]);
+            found = engine.findPath({start, secondStart}, goal, path);
+            if (found != !std::isinf(closest) || (found && !sameDistance(engine.distance(goal), closest)))
+            {
+                std::cout << name << ": Wrong path from two start vertices." << std::endl;
+                failed++;
+            }
+
+            // Distance fields
+            DenseVertexMap<float> field = engine.distanceField({start});
+            DenseVertexMap<float> parallelField = engine.distanceFieldParallel({start});
+            for (auto vH : mesh.vertices())
+            {
+                if (vH != start && vertexCosts[vH] >= 1)
+                {
+                    continue;
+                }
+                if (!sameDistance(field[vH], expected[vH]) || !sameDistance(parallelField[vH], expected[vH]))
+                {
+                    std::cout << name << ": Distance of vertex " << vH.idx() << " is "
+                              << field[vH] << " (parallel " << parallelField[vH]
+                              << "), expected " << expected[vH] << std::endl;
+                    failed++;
+                    break;
+                }
+            }
+        }
+    }
+
+    std::cout << "PathEngine test: " << failed << " failed." << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -30,6 +30,7 @@
 #include <rply.h>
 
 #include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/io/PointCloudWriter.hpp"
 #include "lvr2/io/Progress.hpp"
 
 #include <boost/filesystem.hpp>
@@ -181,94 +182,21 @@ void parsePLYHeader(
 }
 
 
-void writePLYHeader(ofstream& outfile, size_t numPoints, bool writeColors, bool writeNormals)
+void addToFile(PointCloudWriterPtr writer, string filename)
 {
-    outfile << "ply" << endl;
-    outfile << "format binary_little_endian 1.0" << endl;
-    outfile << "element vertex " << numPoints << endl;
-    outfile << "property float x" << endl;
-    outfile << "property float y" << endl;
-    outfile << "property float z" << endl;
-    if(writeColors)
-    {
-        outfile << "property uchar red" << endl;
-        outfile << "property uchar green" << endl;
-        outfile << "property uchar blue" << endl;
-    }
-
-    if(writeNormals)
-    {
-        outfile << "property float nx" << endl;
-        outfile << "property float ny" << endl;
-        outfile << "property float nz" << endl;
-    }
-    outfile << "end_header" << endl;
-}
-
-void addToFile(ofstream& out, string filename)
-{
-    ModelPtr model = ModelFactory::readModel(filename);
-    PointBufferPtr pointBuffer = model->m_pointCloud;
-
-    size_t np, nn, nc;
-    size_t w_color;
-    np = pointBuffer->numPoints();
-    nc = nn = np;
-
-    floatArr points = pointBuffer->getPointArray();
-    ucharArr colors = pointBuffer->getColorArray(w_color);
-    floatArr normals = pointBuffer->getNormalArray();
-
-    // Determine size of single point
-    size_t buffer_size = 3 * sizeof(float);
-
-    if(colors)
-    {
-        buffer_size += w_color * sizeof(unsigned char);
-    }
-
-    if(normals)
-    {
-        buffer_size += 3 * sizeof(float);
-    }
-
-    char* buffer = new char[buffer_size];
+    // Stream the points of binary files batch by batch, load other files
+    // completely
+    bool streamed = ModelFactory::readPointCloudBatches(filename, 1 << 22,
+        [&](PointBufferPtr batch) { writer->append(batch); });
 
-    for(size_t i = 0; i < np; i++)
+    if(!streamed)
     {
-        char* ptr = &buffer[0];
-
-        // Write coordinates to buffer
-        *((float*)ptr) = points[3*i];
-        ptr += sizeof(float);
-        *((float*)ptr) = points[3*i+1];
-        ptr += sizeof(float);
-        *((float*)ptr) = points[3*i+2];
-
-        // Write colors to buffer
-        if(colors)
-        {
-            ptr += sizeof(float);
-            *((unsigned char*)ptr) = colors[3 * i];
-            ptr += sizeof(unsigned char);
-            *((unsigned char*)ptr) = colors[3 * i + 1];
-            ptr += sizeof(unsigned char);
-            *((unsigned char*)ptr) = colors[3 * i + 2];
-        }
-
-        if(normals)
+        ModelPtr model = ModelFactory::readModel(filename);
+        if(model && model->m_pointCloud)
         {
-            ptr += sizeof(unsigned char);
-            *((float*)ptr) = normals[3*i];
-            ptr += sizeof(float);
-            *((float*)ptr) = normals[3*i+1];
-            ptr += sizeof(float);
-            *((float*)ptr) = normals[3*i+2];
+            writer->append(model->m_pointCloud);
         }
-        out.write((const char*)buffer, buffer_size);
     }
-
-    delete[] buffer;
 }
 
 /**
@@ -355,39 +283,25 @@ int main(int argc, char** argv)
     }
 
     string outfile_name = options.outputFile();
-    ofstream out;
-    out.open(outfile_name.c_str(), std::ios::binary);
-    writePLYHeader(out, totalNumPoints, mergeColors, mergeNormals);
+    PointCloudWriterPtr writer = ModelFactory::openPointCloudWriter(
+        outfile_name, PointCloudLayout(mergeColors, mergeNormals));
 
-    size_t maxChunkPoints = 1e7;
-    auto it = ply_file_names.begin();
+    if(!writer)
+    {
+        cout << timestamp << "Unable to write '" << outfile_name << "'." << endl;
+        return -1;
+    }
 
     PacmanProgressBar progress(ply_file_names.size(), "Merging...");
 
-    while(it != ply_file_names.end())
+    for(auto it = ply_file_names.begin(); it != ply_file_names.end(); ++it)
     {
-        size_t pointsInChunk = 0;
-        vector<string> filesInChunk;
-        do
-        {
-            filesInChunk.push_back(it->first);
-            pointsInChunk += it->second;
-            ++it;
-        }
-        while(it != ply_file_names.end() && pointsInChunk < maxChunkPoints);
-
-
-        for(auto chunkIt: filesInChunk)
-        {
-            addToFile(out, chunkIt);
-        }
-
-        for(size_t c = 0; c < filesInChunk.size(); c++)
-        {
-            ++progress;
-        }
+        addToFile(writer, it->first);
+        ++progress;
     }
 
+    writer->close();
+
 	return 0;
 }
 
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 
 #include <boost/optional.hpp>
+#include <boost/filesystem.hpp>
 
 #include "lvr2/config/lvropenmp.hpp"
 
@@ -468,6 +469,22 @@ int main(int argc, char** argv)
         options.getTexMaxClusterSize()
     );
 
+    // Pack the textures into a few large pages. OBJ files only reference
+    // their textures by file name, so if all outputs are OBJ files, the
+    // pages are written to disk and released while the remaining textures
+    // are generated. Other formats need the texels of all pages.
+    bool streamPages = options.getTexturePageSize() > 0;
+    for (const std::string& output_filename : options.getOutputFileNames())
+    {
+        streamPages &= boost::filesystem::path(output_filename).extension() == ".obj";
+    }
+
+    TextureAtlas atlas(options.getTexturePageSize(), options.getTexturePageSize());
+    if (options.getTexturePageSize() > 0)
+    {
+        texturizer.setAtlas(atlas, streamPages);
+    }
+
     // When using textures ...
     if (options.generateTextures())
     {
@@ -510,8 +527,17 @@ int main(int argc, char** argv)
     {
         // Set optioins to save them to disk
         materializer.saveTextures();
-        buffer->addIntAtomic(1, "mesh_save_textures");
-        buffer->addIntAtomic(1, "mesh_texture_image_extension");
+        if (streamPages)
+        {
+            // The pages were already written as texture_<index>.ppm
+            buffer->addIntAtomic(0, "mesh_save_textures");
+            buffer->addIntAtomic(0, "mesh_texture_image_extension");
+        }
+        else
+        {
+            buffer->addIntAtomic(1, "mesh_save_textures");
+            buffer->addIntAtomic(1, "mesh_texture_image_extension");
+        }
     }
 
     // =======================================================================
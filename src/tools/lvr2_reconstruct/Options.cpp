@@ -92,6 +92,7 @@ Options::Options(int argc, char** argv)
         ("texMaxClusterSize", value<int>(&m_texMaxClusterSize)->default_value(0), "Maximum number of faces of a cluster to create a texture from (0 = no limit)")
         ("textureAnalysis", "Enable texture analysis features for texture matchung.")
         ("texelSize", value<float>(&m_texelSize)->default_value(1), "Texel size that determines texture resolution.")
+        ("texturePageSize", value<int>(&m_texturePageSize)->default_value(0), "Pack the textures into pages of this size (in texels) instead of writing one texture per cluster (0 = no packing)")
         ("classifier", value<string>(&m_classifier)->default_value("PlaneSimpsons"),"Classfier object used to color the mesh.")
         ("recalcNormals,r", "Always estimate normals, even if given in .ply file.")
         ("threads", value<int>(&m_numThreads)->default_value( lvr2::OpenMPConfig::getNumThreads() ), "Number of threads")
@@ -346,6 +347,11 @@ float Options::getTexelSize() const
     return m_texelSize;
 }
 
+int Options::getTexturePageSize() const
+{
+    return m_texturePageSize;
+}
+
 float Options::getLineFusionThreshold() const
 {
     return m_variables["lft"].as<float>();
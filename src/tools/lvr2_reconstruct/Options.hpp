@@ -268,6 +268,11 @@ public:
      */
     float getTexelSize() const;
 
+    /**
+     * @brief   Returns the size of the pages the textures are packed into (0 = no packing)
+     */
+    int getTexturePageSize() const;
+
     /**
      * @brief   Returns the sharp feature threshold when using sharp feature decomposition
      */
@@ -392,6 +397,9 @@ private:
     /// Texel size
     float                           m_texelSize;
 
+    /// The size of the texture pages
+    int                             m_texturePageSize;
+
     /// Threshold for line fusing when tesselating
     float                           m_lineFusionThreshold;
 
@@ -559,6 +567,10 @@ inline ostream& operator<<(ostream& os, const Options &o)
     {
         cout << "##### Generate Textures \t: YES" << endl;
         cout << "##### Texel size \t\t: " << o.getTexelSize() << endl;
+        if(o.getTexturePageSize() > 0)
+        {
+            cout << "##### Texture page size \t: " << o.getTexturePageSize() << endl;
+        }
         cout << "##### Texture Min#Cluster \t: " << o.getTexMinClusterSize() << endl;
         cout << "##### Texture Max#Cluster \t: " << o.getTexMaxClusterSize() << endl;
 
@@ -40,6 +40,7 @@
 #include <fstream>
 #include <utility>
 #include <iterator>
+#include <limits>
 using namespace std;
 
 #include <boost/filesystem.hpp>
@@ -74,6 +75,13 @@ boost::filesystem::path getCorrespondingPath(const boost::filesystem::path& scan
     return boost::filesystem::path(ss.str());
 }
 
+int getScanNumber(const boost::filesystem::path& scan)
+{
+    int num = -1;
+    sscanf(scan.filename().string().c_str(), "scan%d", &num);
+    return num;
+}
+
 
 
 } // namespace slam6dmerger
@@ -156,10 +164,18 @@ int main(int argc, char** argv)
         }
     }
 
+    // Only scans in the given range are merged, the files of all other
+    // scans are not touched. Scans without number are only merged if no
+    // range is given.
+    int start = options.getStart();
+    int last = options.getEnd() > 0 ? options.getEnd() : std::numeric_limits<int>::max();
+    bool useRange = options.getStart() > 0 || options.getEnd() > 0;
     for(directory_iterator it(mergeDir); it != end; ++it)
     {
         string extension = it->path().extension().string();
-        if(extension == ".3d")
+        int num = getScanNumber(it->path());
+        bool inRange = num < 0 ? !useRange : (num >= start && num <= last);
+        if(extension == ".3d" && inRange)
         {
             merge_scans.push_back(it->path());
         }
@@ -169,11 +185,15 @@ int main(int argc, char** argv)
     std::sort(merge_scans.begin(),  merge_scans.end());
 
     // Copy files from input directory and merge directory
-    // and assure consistent numbering
-    int scan_counter = 0;
-    char name_buffer[256];
-    for(auto current_path : input_scans)
+    // and assure consistent numbering. The scans are independent,
+    // so they are copied in parallel.
+    #pragma omp parallel for schedule(dynamic)
+    for(long i = 0; i < (long)input_scans.size(); i++)
     {
+        const path& current_path = input_scans[i];
+        int scan_counter = i;
+        char name_buffer[256];
+
         // -------->>>> SCAN FILE
         sprintf(name_buffer, "scan%03d.3d", scan_counter);
         path target_path = outputDir / path(name_buffer);
@@ -230,13 +250,15 @@ int main(int argc, char** argv)
             std::cout << timestamp << "Copying " << pose_in.string() << " to " << pose_out.string() << "." << std::endl;
             boost::filesystem::copy(pose_in, pose_out);
         }
-
-
-        scan_counter++;
     }
 
-    for(auto current_path : merge_scans)
+    #pragma omp parallel for schedule(dynamic)
+    for(long i = 0; i < (long)merge_scans.size(); i++)
     {
+        const path& current_path = merge_scans[i];
+        int scan_counter = input_scans.size() + i;
+        char name_buffer[256];
+
         // -------->>>> SCAN
         // Copy scan file
         sprintf(name_buffer, "scan%03d.3d", scan_counter);
@@ -310,9 +332,6 @@ int main(int argc, char** argv)
             writePose(pos, ang, pose_out);
 
         }
-
-
-        scan_counter++;
     }
 
     return 0;
@@ -101,7 +101,7 @@ inline ostream& operator<<(ostream& os, const Options &o)
 	cout << "##### Output dir \t\t: " 	<< o.getOutputDir() << endl;
     cout << "##### Transform \t\t:" << o.getTransformFile() << endl;
     cout << "##### Start scan \t\t: " << o.getStart() << endl;
-    cout << "##### End scan \t\t\t: " << o.getStart() << endl;
+    cout << "##### End scan \t\t\t: " << o.getEnd() << endl;
 	return os;
 }
 
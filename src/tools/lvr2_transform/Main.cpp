@@ -38,6 +38,7 @@
 #include "lvr2/geometry/Matrix4.hpp"
 #include "lvr2/io/Model.hpp"
 #include "lvr2/io/ModelFactory.hpp"
+#include "lvr2/io/PointCloudWriter.hpp"
 #include "lvr2/io/Timestamp.hpp"
 #include <iostream>
 #include <cmath>
@@ -48,6 +49,19 @@ using std::endl;
 
 using Vec = BaseVector<float>;
 
+void transformChannel(FloatChannelOptional points, const Matrix4<Vec>& mat, const transform::Options& options)
+{
+  #pragma omp parallel for
+  for(long i = 0; i < (long)points->numElements(); i++)
+  {
+    Vec v((*points)[i][0], (*points)[i][1], (*points)[i][2]);
+    v = mat * v;
+    v.x = options.anyScaleX() ? v[0] * options.getScaleX() : v[0];
+    v.y = options.anyScaleX() ? v[1] * options.getScaleX() : v[1];
+    v.z = options.anyScaleX() ? v[2] * options.getScaleX() : v[2];
+    (*points)[i] = v;
+  }
+}
 
 int main(int argc, char **argv)
 {
@@ -64,15 +78,6 @@ int main(int argc, char **argv)
     if(options.printUsage())
       return 0;
 
-    // load model via ModelFactory
-    ModelPtr model = ModelFactory::readModel(options.getInputFile());
-    
-    if(!model)
-    {
-      cout << timestamp << "IO Error: Unable to parse " << options.getInputFile() << endl;
-      exit(-1);
-    }
-
     if(options.anyTransformFile())
     {
       // Check if transformFile was given, check if it's a pose or frames file and
@@ -148,6 +153,43 @@ int main(int argc, char **argv)
       mat = Matrix4<Vec>(Vec(x, y, z), Vec(r1, r2, r3));
     }
 
+    // Point clouds are transformed batch by batch if supported by the input
+    // and output format
+    PointCloudWriterPtr writer;
+    bool writerFailed = false;
+    bool streamed = ModelFactory::readPointCloudBatches(options.getInputFile(), 1 << 22,
+      [&](PointBufferPtr batch)
+      {
+        if(!writer && !writerFailed)
+        {
+          cout << timestamp << "Using points" << endl;
+          cout << mat;
+          writer = ModelFactory::openPointCloudWriter(options.getOutputFile(), PointCloudLayout(*batch));
+          writerFailed = !writer;
+        }
+        if(writer)
+        {
+          transformChannel(batch->getFloatChannel("points"), mat, options);
+          writer->append(batch);
+        }
+      });
+
+    if(streamed && writer)
+    {
+      writer->close();
+      cout << timestamp << "Finished. Program end." << endl;
+      return 0;
+    }
+
+    // load model via ModelFactory
+    ModelPtr model = ModelFactory::readModel(options.getInputFile());
+
+    if(!model)
+    {
+      cout << timestamp << "IO Error: Unable to parse " << options.getInputFile() << endl;
+      exit(-1);
+    }
+
     // Get point buffer
     if(model->m_pointCloud)
     {
@@ -155,18 +197,9 @@ int main(int argc, char **argv)
 
       cout << timestamp << "Using points" << endl;
       did_anything = true;
-      FloatChannelOptional points = p_buffer->getFloatChannel("points");
-       
+
       cout << mat;
-      for(size_t i = 0; i < points->numElements(); i++)
-      {
-        Vec v((*points)[i][0], (*points)[i][1], (*points)[i][2]);
-        v = mat * v;
-        v.x = options.anyScaleX() ? v[0] * options.getScaleX() : v[0];
-        v.y = options.anyScaleX() ? v[1] * options.getScaleX() : v[1];
-        v.z = options.anyScaleX() ? v[2] * options.getScaleX() : v[2];
-        (*points)[i] = v;
-      }
+      transformChannel(p_buffer->getFloatChannel("points"), mat, options);
     }
 
     // Get mesh buffer
@@ -176,17 +209,7 @@ int main(int argc, char **argv)
 
       cout << timestamp << "Using meshes" << endl;
       did_anything = true;
-      FloatChannelOptional points = m_buffer->getFloatChannel("vertices");
-
-      for(size_t i = 0; i < points->numElements(); i++)
-      {
-        Vec v((*points)[i][0], (*points)[i][1], (*points)[i][2]);
-        v = mat * v;
-        v.x = options.anyScaleX() ? v[0] * options.getScaleX() : v[0];
-        v.y = options.anyScaleX() ? v[1] * options.getScaleX() : v[1];
-        v.z = options.anyScaleX() ? v[2] * options.getScaleX() : v[2];
-        (*points)[i] = v;
-      }
+      transformChannel(m_buffer->getFloatChannel("vertices"), mat, options);
     }
 
     if(!did_anything)
@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2018, University Osnabrück
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the University Osnabrück nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL University Osnabrück BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/**
+ * Main.cpp
+ *
+ * Reads a scan in the new UOS format that contains a line longer than any
+ * fixed size line buffer and checks that all points are read.
+ */
+
+#include "lvr2/io/UosIO.hpp"
+
+#include <boost/filesystem.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace lvr2;
+
+int main(int argc, char** argv)
+{
+    const size_t numPoints = 20000;
+
+    boost::filesystem::path dir =
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("lvr2_uos_test_%%%%-%%%%");
+    boost::filesystem::create_directories(dir);
+
+    // Header, one point, an over-long comment and many more points
+    {
+        std::ofstream out((dir / "scan000.3d").string());
+        out << "# header" << std::endl;
+        out << "0 0 0" << std::endl;
+        out << "#" << std::string(1500, 'x') << std::endl;
+        for(size_t i = 1; i <= numPoints; i++)
+        {
+            out << i << " " << 2 * i << " " << 3 * i << std::endl;
+        }
+    }
+
+    UosIO io;
+    ModelPtr model = io.read(dir.string());
+    boost::filesystem::remove_all(dir);
+
+    if(!model || !model->m_pointCloud)
+    {
+        std::cout << "UOS test: Unable to read scan" << std::endl;
+        return 1;
+    }
+
+    size_t n = model->m_pointCloud->numPoints();
+    if(n != numPoints + 1)
+    {
+        std::cout << "UOS test: Read " << n << " points, expected "
+                  << numPoints + 1 << std::endl;
+        return 1;
+    }
+
+    floatArr points = model->m_pointCloud->getPointArray();
+    for(size_t i = 0; i < n; i++)
+    {
+        if(points[3 * i] != i || points[3 * i + 1] != 2 * i || points[3 * i + 2] != 3 * i)
+        {
+            std::cout << "UOS test: Wrong coordinates of point " << i << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "UOS test: Read " << n << " points." << std::endl;
+    return 0;
+}